@@ -0,0 +1,128 @@
+/**
+ * Converts ledmap (ledmap.json, ledmapN.json) and 2D gap (2d-gaps.json) files into the binary
+ * map format read by MapFileReader (wled00/file.cpp). Binary maps are loaded without the JSON buffer.
+ *
+ * Usage:
+ *   node tools/ledmap_convert.js ledmap1.json [ledmap1.bin] [--raw]
+ *   node tools/ledmap_convert.js --decode ledmap1.bin      (prints the map as JSON, for checking)
+ *
+ * Upload the resulting file (i.e. /ledmap1.bin or /2d-gaps.bin) using /edit.
+ * If both .bin and .json exist, the .bin file is used.
+ *
+ * Format (little endian):
+ *   header: "WMAP", uint8 version (1), uint8 encoding, uint8 name length, uint8 reserved, uint32 entry count
+ *   name (ledmap "n" field, not terminated)
+ *   encoding 0: uint16 per entry (-1 is stored as 0xFFFF)
+ *   encoding 1: runs of {uint16 first value, uint16 count, int16 step}
+ * Run encoding is used if it is smaller (unless --raw is given).
+ */
+
+const fs = require("fs");
+
+const MAGIC = "WMAP";
+const VERSION = 1;
+const ENC_RAW = 0;
+const ENC_RUNS = 1;
+const HEADER_LEN = 12;
+
+function encodeRaw(values) {
+  const buf = Buffer.alloc(values.length * 2);
+  values.forEach((v, i) => buf.writeUInt16LE(v, i * 2));
+  return buf;
+}
+
+function encodeRuns(values) {
+  const runs = [];
+  for (let i = 0; i < values.length; ) {
+    const step = i + 1 < values.length ? (values[i + 1] - values[i]) & 0xffff : 0;
+    let count = 1;
+    while (i + count < values.length && count < 0xffff &&
+           ((values[i + count] - values[i + count - 1]) & 0xffff) === step) count++;
+    runs.push([values[i], count, step]);
+    i += count;
+  }
+  const buf = Buffer.alloc(runs.length * 6);
+  runs.forEach(([value, count, step], i) => {
+    buf.writeUInt16LE(value, i * 6);
+    buf.writeUInt16LE(count, i * 6 + 2);
+    buf.writeUInt16LE(step, i * 6 + 4);
+  });
+  return buf;
+}
+
+function encode(values, name, forceRaw) {
+  const raw = encodeRaw(values);
+  const runs = forceRaw ? null : encodeRuns(values);
+  const useRuns = runs !== null && runs.length < raw.length;
+  const nameBuf = Buffer.from(name || "", "utf8").subarray(0, 255);
+  const header = Buffer.alloc(HEADER_LEN);
+  header.write(MAGIC, 0, "ascii");
+  header.writeUInt8(VERSION, 4);
+  header.writeUInt8(useRuns ? ENC_RUNS : ENC_RAW, 5);
+  header.writeUInt8(nameBuf.length, 6);
+  header.writeUInt32LE(values.length, 8);
+  return Buffer.concat([header, nameBuf, useRuns ? runs : raw]);
+}
+
+function decode(buf) {
+  if (buf.length < HEADER_LEN || buf.toString("ascii", 0, 4) !== MAGIC || buf.readUInt8(4) !== VERSION) {
+    throw new Error("not a map file");
+  }
+  const encoding = buf.readUInt8(5);
+  const nameLen = buf.readUInt8(6);
+  const count = buf.readUInt32LE(8);
+  const name = buf.toString("utf8", HEADER_LEN, HEADER_LEN + nameLen);
+  const values = [];
+  let pos = HEADER_LEN + nameLen;
+  while (values.length < count && pos < buf.length) {
+    if (encoding === ENC_RAW) {
+      values.push(buf.readUInt16LE(pos));
+      pos += 2;
+    } else {
+      let value = buf.readUInt16LE(pos);
+      const n = buf.readUInt16LE(pos + 2);
+      const step = buf.readInt16LE(pos + 4);
+      for (let i = 0; i < n && values.length < count; i++, value = (value + step) & 0xffff) values.push(value);
+      pos += 6;
+    }
+  }
+  return { name, values: values.map((v) => (v === 0xffff ? -1 : v)) };
+}
+
+function main(args) {
+  const forceRaw = args.includes("--raw");
+  const files = args.filter((a) => !a.startsWith("--"));
+
+  if (args.includes("--decode")) {
+    if (files.length !== 1) throw new Error("--decode needs a .bin file");
+    const map = decode(fs.readFileSync(files[0]));
+    const out = map.name ? { n: map.name, map: map.values } : { map: map.values };
+    console.log(JSON.stringify(out));
+    return;
+  }
+
+  if (files.length < 1 || files.length > 2) {
+    console.log("Usage: node tools/ledmap_convert.js <input.json> [output.bin] [--raw] | --decode <input.bin>");
+    process.exit(1);
+  }
+
+  const json = JSON.parse(fs.readFileSync(files[0], "utf8"));
+  // ledmap: {"map":[...],"n":"name"}, 2D gaps: [...]
+  const list = Array.isArray(json) ? json : json.map;
+  if (!Array.isArray(list)) throw new Error(`${files[0]}: no "map" array found`);
+  const values = list.map((v) => (v < 0 ? 0xffff : v & 0xffff));
+  const name = Array.isArray(json) ? "" : json.n;
+
+  const output = files[1] || files[0].replace(/\.json$/i, "") + ".bin";
+  const bin = encode(values, name, forceRaw);
+  fs.writeFileSync(output, bin);
+  const encoding = bin.readUInt8(5) === ENC_RUNS ? "runs" : "raw";
+  console.log(`${output}: ${values.length} entries, ${bin.length} bytes (${encoding}), JSON was ${fs.statSync(files[0]).size} bytes`);
+}
+
+try {
+  main(process.argv.slice(2));
+} catch (e) {
+  console.error(e.message);
+  process.exit(1);
+}
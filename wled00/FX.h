@@ -83,8 +83,28 @@
   assuming each segment uses the same amount of data. 256 for ESP8266, 640 for ESP32. */
 #define FAIR_DATA_PER_SEG (MAX_SEGMENT_DATA / strip.getMaxSegments())
 
+/* Size of the arena holding segment data, transitions (incl. copies of effect data) and mode blending layers.
+  Sized from the configured LED count (SEGMENT_ARENA_PER_LED bytes each, at least SEGMENT_ARENA_MIN) and capped
+  at SEGMENT_ARENA_SIZE. Allocated on first use, requests that do not fit are served from heap. */
+#ifndef SEGMENT_ARENA_SIZE
+  #define SEGMENT_ARENA_SIZE (MAX_SEGMENT_DATA + MAX_SEGMENT_DATA/4)
+#endif
+#ifndef SEGMENT_ARENA_MIN
+  #define SEGMENT_ARENA_MIN 2048
+#endif
+#ifndef SEGMENT_ARENA_PER_LED
+  #define SEGMENT_ARENA_PER_LED 8 /* effect data + one transition/blending pixel copy */
+#endif
+
 #define MIN_SHOW_DELAY   (_frametime < 16 ? 8 : 15)
 
+// IRAM on ESP32 only (IRAM is nearly full on ESP8266, functions stay in flash there)
+#ifdef ESP8266
+  #define IRAM_ATTR_YN
+#else
+  #define IRAM_ATTR_YN IRAM_ATTR
+#endif
+
 #define NUM_COLORS       3 /* number of colors per segment */
 #define SEGMENT          strip._segments[strip.getCurrSegmentId()]
 #define SEGENV           strip._segments[strip.getCurrSegmentId()]
@@ -324,6 +344,36 @@ typedef enum mapping1D2D {
   M12_pCorner = 3
 } mapping1D2D_t;
 
+// fixed memory pool for segment runtime allocations (first fit with coalescing of free neighbours)
+// avoids heap fragmentation caused by effect/preset changes, falls back to heap if exhausted
+class SegmentArena {
+  public:
+    SegmentArena() : _mem(nullptr), _size(0), _wanted(SEGMENT_ARENA_MIN), _used(0), _highWater(0), _fallbacks(0) {}
+
+    void  reserve(size_t len); // sets arena size, re-allocated on next use only if nothing is in use
+    void *alloc(size_t len);  // never returns arena memory to heap, falls back to malloc()
+    void  free(void *ptr);    // handles both arena and heap pointers
+
+    inline bool   contains(const void *ptr) const { return _mem && (const uint8_t*)ptr >= _mem && (const uint8_t*)ptr < _mem + _size; }
+    inline size_t getSize(void)      const { return _size; }
+    inline size_t getUsed(void)      const { return _used; }      // bytes in use (incl. block headers)
+    inline size_t getHighWater(void) const { return _highWater; }
+    inline uint16_t getFallbacks(void) const { return _fallbacks; } // number of allocations that did not fit
+    size_t getLargestFree(void) const;
+
+  private:
+    uint8_t  *_mem;
+    size_t    _size;
+    size_t    _wanted;
+    size_t    _used;
+    size_t    _highWater;
+    uint16_t  _fallbacks;
+
+    // block header, size includes header and is a multiple of 4, LSB is set if block is used
+    static inline uint32_t &header(uint8_t *b) { return *(uint32_t*)b; }
+    bool begin(void);
+};
+
 // segment, 80 bytes
 typedef struct Segment {
   public:
@@ -373,6 +423,7 @@ typedef struct Segment {
     uint16_t aux0;  // custom var
     uint16_t aux1;  // custom var
     byte     *data; // effect data pointer
+    uint32_t *pixels; // render buffer (unscaled colors of virtual pixels), composited onto strip in WS2812FX::service()
     static uint16_t maxWidth, maxHeight;  // these define matrix width & height (max. segment dimensions)
 
     typedef struct TemporarySegmentData {
@@ -411,7 +462,25 @@ typedef struct Segment {
       };
     };
     uint16_t        _dataLen;
+    uint16_t        _pixelsLen;       // number of entries in pixels[] (virtual length or virtual width * height)
+    uint16_t       *_pixelMap;        // precompiled strip (logical) indices of each pixels[] entry, _mapStride entries per pixel
+    uint16_t       *_m12Map;          // precompiled 1D->2D expansion: virtualLength()+1 offsets followed by pixels[] indices
+    uint8_t         _mapStride;       // max number of strip pixels a virtual pixel expands to (0xFFFF marks unused entry)
+    struct {                          // geometry the pixel maps were compiled for
+      uint16_t start, stop, startY, stopY, offset, options, maxWidth, maxHeight;
+      uint8_t  grouping, spacing;
+    } _mapKey;
+    // frame context: transition state sampled once per frame by beginFrame() so all pixels of a frame see the same values
+    struct {
+      uint32_t colors[NUM_COLORS];    // transitional (blended) colors
+      uint16_t progress;              // transition progress
+      uint8_t  bri;                   // effective opacity
+      uint8_t  cct;                   // effective CCT
+      bool     valid;
+    } _frame;
     static uint16_t _usedSegmentData;
+    static SegmentArena _arena;
+    static bool     _inFrame;         // WS2812FX::service() is running, frame context can be used
 
     // perhaps this should be per segment, not static
     static CRGBPalette16 _randomPalette;      // actual random palette
@@ -435,14 +504,37 @@ typedef struct Segment {
       uint8_t       _prevPaletteBlends; // number of previous palette blends (there are max 255 blends possible)
       unsigned long _start;       // must accommodate millis()
       uint16_t      _dur;
+      #ifndef WLED_DISABLE_MODE_BLEND
+      uint32_t     *_pixelsT;     // layer (render buffer) of previous mode, blended with pixels in composite()
+      uint16_t      _pixelsLenT;
+      #endif
       Transition(uint16_t dur=750)
         : _palT(CRGBPalette16(CRGB::Black))
         , _prevPaletteBlends(0)
         , _start(millis())
         , _dur(dur)
+        #ifndef WLED_DISABLE_MODE_BLEND
+        , _pixelsT(nullptr)
+        , _pixelsLenT(0)
+        #endif
       {}
     } *_t;
 
+    // expand virtual pixel onto physical pixels of the strip (color must already be scaled by segment brightness)
+    // if map is given, strip indices are stored into it instead of painting (returns number of indices)
+    unsigned paintPixel(int i, uint32_t col, uint16_t *map = nullptr);
+    #ifndef WLED_DISABLE_2D
+    unsigned paintPixelXY(int x, int y, uint32_t col, uint16_t *map = nullptr);
+    unsigned expand1D2D(int i, uint16_t *map = nullptr); // render buffer indices of 1D pixel expanded onto 2D segment
+    #endif
+    void setBufferPixel(unsigned i, uint32_t col);      // write into render buffer (blends if mode blending)
+    uint32_t *directBuffer(void);                       // render buffer if it can be processed in place (nullptr otherwise)
+    static void blurBuffer(uint32_t *p, unsigned n, unsigned stride, uint8_t blur_amount, bool rgbOnly); // blur n pixels stride apart
+    void deallocatePixelMap(void);
+    #ifndef WLED_DISABLE_MODE_BLEND
+    void deallocateLayer(void);
+    #endif
+
   public:
 
     Segment(uint16_t sStart=0, uint16_t sStop=30) :
@@ -474,8 +566,15 @@ typedef struct Segment {
       aux0(0),
       aux1(0),
       data(nullptr),
+      pixels(nullptr),
       _capabilities(0),
       _dataLen(0),
+      _pixelsLen(0),
+      _pixelMap(nullptr),
+      _m12Map(nullptr),
+      _mapStride(0),
+      _mapKey{0},
+      _frame{{0,0,0}, 0xFFFFU, 0, 0, false},
       _t(nullptr)
     {
       #ifdef WLED_DEBUG
@@ -501,13 +600,14 @@ typedef struct Segment {
       if (name) { delete[] name; name = nullptr; }
       stopTransition();
       deallocateData();
+      deallocatePixels();
     }
 
     Segment& operator= (const Segment &orig); // copy assignment
     Segment& operator= (Segment &&orig) noexcept; // move assignment
 
 #ifdef WLED_DEBUG
-    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (name?strlen(name):0) + (_t?sizeof(Transition):0); }
+    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (pixels?_pixelsLen*sizeof(uint32_t):0) + (_pixelMap?_pixelsLen*_mapStride*sizeof(uint16_t):0) + (name?strlen(name):0) + (_t?sizeof(Transition):0); }
 #endif
 
     inline bool     getOption(uint8_t n) const { return ((options >> n) & 0x01); }
@@ -525,10 +625,13 @@ typedef struct Segment {
     inline uint8_t  getLightCapabilities(void) const { return _capabilities; }
 
     static uint16_t getUsedSegmentData(void)    { return _usedSegmentData; }
+    static const SegmentArena& getArena(void)   { return _arena; }
+    static void     reserveArena(size_t len)    { _arena.reserve(len); }
     static void     addUsedSegmentData(int len) { _usedSegmentData += len; }
     #ifndef WLED_DISABLE_MODE_BLEND
     static void     modeBlend(bool blend)       { _modeBlend = blend; }
     #endif
+    static void     frameActive(bool active)    { _inFrame = active; }
     static void     handleRandomPalette();
 
     void    setUp(uint16_t i1, uint16_t i2, uint8_t grp=1, uint8_t spc=0, uint16_t ofs=UINT16_MAX, uint16_t i1Y=0, uint16_t i2Y=1, uint8_t segId = 255);
@@ -554,6 +657,12 @@ typedef struct Segment {
       */
     inline void markForReset(void) { reset = true; }  // setOption(SEG_OPTION_RESET, true)
 
+    // render buffer functions
+    bool allocatePixels(void);   // (re)allocates render buffer if virtual dimensions changed, returns false if no buffer
+    void deallocatePixels(void);
+    void updatePixelMap(void);   // recompiles pixel maps if segment geometry (bounds, grouping, options, mapping) changed
+    void composite(void);        // paints render buffer onto the strip (applies opacity, grouping, mirroring & offset)
+
     // transition functions
     void     startTransition(uint16_t dur); // transition has to start before actual segment values change
     void     stopTransition(void);
@@ -561,8 +670,11 @@ typedef struct Segment {
     #ifndef WLED_DISABLE_MODE_BLEND
     void     swapSegenv(tmpsegd_t &tmpSegD);
     void     restoreSegenv(tmpsegd_t &tmpSegD);
+    bool     swapLayer(void); // exchange render buffer with previous mode's layer (allocated on 1st use)
     #endif
     uint16_t progress(void); //transition progression between 0-65535
+    inline uint16_t frameProgress(void) { return (_inFrame && _frame.valid) ? _frame.progress : progress(); } // progress at start of frame
+    void     beginFrame(void);   // sample transition progress, brightness & colors for this frame
     uint8_t  currentBri(bool useCct = false);
     uint8_t  currentMode(void);
     uint32_t currentColor(uint8_t slot);
@@ -703,14 +815,22 @@ class WS2812FX {  // 96 bytes
       _targetFps(WLED_FPS),
       _frametime(FRAMETIME_FIXED),
       _cumulativeFps(2),
+      _cumulativeFxTime(0),
+      _cumulativeShowTime(0),
       _isServicing(false),
       _isOffRefreshRequired(false),
       _hasWhiteChannel(false),
       _triggered(false),
+      _paletteLUTValid(false),
+      _composited(false),
+      _paletteSeg(nullptr),
       _modeCount(MODE_COUNT),
       _callback(nullptr),
       customMappingTable(nullptr),
       customMappingSize(0),
+      customMappingRuns(nullptr),
+      customMappingRunCount(0),
+      _lastMappingRun(0),
       _lastShow(0),
       _segment_index(0),
       _mainSegment(0),
@@ -731,7 +851,7 @@ class WS2812FX {  // 96 bytes
     }
 
     ~WS2812FX() {
-      if (customMappingTable) delete[] customMappingTable;
+      clearMapping();
       _mode.clear();
       _modeData.clear();
       _segments.clear();
@@ -742,6 +862,9 @@ class WS2812FX {  // 96 bytes
     }
 
     static WS2812FX* getInstance(void) { return instance; }
+    #ifdef WLED_BENCHMARK_LEDMAP
+    static void benchmarkLedmaps(void);
+    #endif
 
     void
 #ifdef WLED_DEBUG
@@ -774,6 +897,7 @@ class WS2812FX {  // 96 bytes
     // outsmart the compiler :) by correctly overloading
     inline void setPixelColor(int n, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) { setPixelColor(n, RGBW32(r,g,b,w)); }
     inline void setPixelColor(int n, CRGB c) { setPixelColor(n, c.red, c.green, c.blue); }
+    void setPixelColors(unsigned n, const uint32_t *c, unsigned count); // consecutive (logical) pixels, ledmap runs are copied in bulk
     inline void trigger(void) { _triggered = true; } // Forces the next frame to be computed on all active segments.
     inline void setShowCallback(show_callback cb) { _callback = cb; }
     inline void setTransition(uint16_t t) { _transitionDur = t; }
@@ -822,6 +946,9 @@ class WS2812FX {  // 96 bytes
     inline uint16_t getMinShowDelay(void) { return MIN_SHOW_DELAY; }
     inline uint16_t getLength(void) { return _length; } // 2D matrix may have less pixels than W*H
     inline uint16_t getTransition(void) { return _transitionDur; }
+    inline uint16_t getMappingLength(void) { return customMappingSize; } // logical pixels [0, length) are remapped by ledmap
+
+    uint16_t getMappedPixelIndex(uint16_t index); // physical pixel of logical pixel (ledmap applied)
 
     uint32_t
       now,
@@ -829,6 +956,8 @@ class WS2812FX {  // 96 bytes
       getPixelColor(uint16_t);
 
     inline uint32_t getLastShow(void) { return _lastShow; }
+    inline uint32_t getEffectTime(void) { return _cumulativeFxTime; }  // smoothed time (us) spent running effects per frame
+    inline uint32_t getShowTime(void) { return _cumulativeShowTime; }  // smoothed time (us) spent in show() per frame
     inline uint32_t segColor(uint8_t i) { return _colors_t[i]; }
 
     const char *
@@ -907,6 +1036,8 @@ class WS2812FX {  // 96 bytes
     uint8_t  _targetFps;
     uint16_t _frametime;
     uint16_t _cumulativeFps;
+    uint32_t _cumulativeFxTime;
+    uint32_t _cumulativeShowTime;
 
     // will require only 1 byte
     struct {
@@ -914,8 +1045,14 @@ class WS2812FX {  // 96 bytes
       bool _isOffRefreshRequired : 1; //periodic refresh is required for the strip to remain off.
       bool _hasWhiteChannel      : 1;
       bool _triggered            : 1;
+      bool _paletteLUTValid      : 1; // _paletteLUT holds expanded _currentPalette
+      bool _composited           : 1; // all strip pixels of this frame were painted from render buffers (can be repainted)
     };
 
+    // _currentPalette expanded to 256 colors, filled on first color_from_palette() of the segment being serviced
+    uint32_t _paletteLUT[256];
+    Segment *_paletteSeg;         // segment _currentPalette was resolved for (only while running its effect)
+
     uint8_t                  _modeCount;
     std::vector<mode_ptr>    _mode;     // SRAM footprint: 4 bytes per element
     std::vector<const char*> _modeData; // mode (effect) name and its slider control data array
@@ -925,6 +1062,24 @@ class WS2812FX {  // 96 bytes
     uint16_t* customMappingTable;
     uint16_t  customMappingSize;
 
+    // customMappingTable compressed into runs of linearly mapped pixels (replaces table if it saves enough RAM)
+    // run r covers logical pixels [start, customMappingRuns[r+1].start), last entry is a sentinel (start == customMappingSize)
+    typedef struct MappingRun {
+      uint16_t start;  // first logical pixel of run
+      uint16_t target; // its physical pixel (0xFFFF if unmapped)
+      int16_t  step;   // physical increment per logical pixel (1 forward, -1 reversed, 0 single pixel or unmapped)
+    } mapping_run;
+    MappingRun *customMappingRuns;
+    uint16_t    customMappingRunCount;
+    uint16_t    _lastMappingRun; // pixels are mostly accessed sequentially
+
+    uint16_t findMappingRun(uint16_t i);
+    bool     compressMappingTable(bool fromPanels = false); // false if out of memory
+    void     clearMapping(void);
+    #ifndef WLED_DISABLE_2D
+    uint16_t panelPixel(unsigned index) const;
+    #endif
+
     unsigned long _lastShow;
 
     uint8_t _segment_index;
@@ -938,6 +1093,7 @@ class WS2812FX {  // 96 bytes
       estimateCurrentAndLimitBri(void);
 
     void
+      compositeSegments(void),
       setUpSegmentFromQueuedChanges(void);
 };
 
@@ -37,9 +37,7 @@
 void WS2812FX::setUpMatrix() {
 #ifndef WLED_DISABLE_2D
   // erase old ledmap, just in case.
-  if (customMappingTable != nullptr) delete[] customMappingTable;
-  customMappingTable = nullptr;
-  customMappingSize = 0;
+  clearMapping();
 
   // isMatrix is set in cfg.cpp or set.cpp
   if (isMatrix) {
@@ -68,80 +66,105 @@ void WS2812FX::setUpMatrix() {
       return;
     }
 
-    customMappingTable = new uint16_t[Segment::maxWidth * Segment::maxHeight];
-
-    if (customMappingTable != nullptr) {
-      customMappingSize = Segment::maxWidth * Segment::maxHeight;
-
-      // fill with empty in case we don't fill the entire matrix
-      for (size_t i = 0; i< customMappingSize; i++) {
-        customMappingTable[i] = (uint16_t)-1;
+    customMappingSize = Segment::maxWidth * Segment::maxHeight;
+
+    // we will try to load a "gap" array (a JSON file)
+    // the array has to have the same amount of values as mapping array (or larger)
+    // "gap" array is used while building ledmap (mapping array)
+    // and discarded afterwards as it has no meaning after the process
+    // content of the file is just raw JSON array in the form of [val1,val2,val3,...]
+    // there are no other "key":"value" pairs in it
+    // allowed values are: -1 (missing pixel/no LED attached), 0 (inactive/unused pixel), 1 (active/used pixel)
+    // the same array may be stored in binary form (2d-gaps.bin, see MapFileReader) which is preferred
+    char    fileName[32]; strcpy_P(fileName, PSTR("/2d-gaps.bin")); // reduce flash footprint
+    bool    isBinary = WLED_FS.exists(fileName);
+    if (!isBinary) strcpy_P(fileName, PSTR("/2d-gaps.json"));
+    bool    isFile = !isBinary && WLED_FS.exists(fileName);
+    size_t  gapSize = 0;
+    int8_t *gapTable = nullptr;
+
+    if (isBinary) {
+      DEBUG_PRINT(F("Reading LED gap from "));
+      DEBUG_PRINTLN(fileName);
+      MapFileReader map(fileName);
+      if (map.isValid() && map.size() >= customMappingSize) { // not an empty map
+        gapSize = customMappingSize; // entries beyond matrix are not used (count in file is not trusted)
+        gapTable = new int8_t[gapSize];
+        if (gapTable && map.read(gapTable, gapSize) < gapSize) { // truncated file
+          delete[] gapTable;
+          gapTable = nullptr;
+        }
       }
-
-      // we will try to load a "gap" array (a JSON file)
-      // the array has to have the same amount of values as mapping array (or larger)
-      // "gap" array is used while building ledmap (mapping array)
-      // and discarded afterwards as it has no meaning after the process
-      // content of the file is just raw JSON array in the form of [val1,val2,val3,...]
-      // there are no other "key":"value" pairs in it
-      // allowed values are: -1 (missing pixel/no LED attached), 0 (inactive/unused pixel), 1 (active/used pixel)
-      char    fileName[32]; strcpy_P(fileName, PSTR("/2d-gaps.json")); // reduce flash footprint
-      bool    isFile = WLED_FS.exists(fileName);
-      size_t  gapSize = 0;
-      int8_t *gapTable = nullptr;
-
-      if (isFile && requestJSONBufferLock(20)) {
-        DEBUG_PRINT(F("Reading LED gap from "));
-        DEBUG_PRINTLN(fileName);
-        // read the array into global JSON buffer
-        if (readObjectFromFile(fileName, nullptr, &doc)) {
-          // the array is similar to ledmap, except it has only 3 values:
-          // -1 ... missing pixel (do not increase pixel count)
-          //  0 ... inactive pixel (it does count, but should be mapped out (-1))
-          //  1 ... active pixel (it will count and will be mapped)
-          JsonArray map = doc.as<JsonArray>();
-          gapSize = map.size();
-          if (!map.isNull() && gapSize >= customMappingSize) { // not an empty map
-            gapTable = new int8_t[gapSize];
-            if (gapTable) for (size_t i = 0; i < gapSize; i++) {
-              gapTable[i] = constrain(map[i], -1, 1);
-            }
+      DEBUG_PRINTLN(F("Gaps loaded."));
+    } else if (isFile && requestJSONBufferLock(20)) {
+      DEBUG_PRINT(F("Reading LED gap from "));
+      DEBUG_PRINTLN(fileName);
+      // read the array into global JSON buffer
+      if (readObjectFromFile(fileName, nullptr, &doc)) {
+        // the array is similar to ledmap, except it has only 3 values:
+        // -1 ... missing pixel (do not increase pixel count)
+        //  0 ... inactive pixel (it does count, but should be mapped out (-1))
+        //  1 ... active pixel (it will count and will be mapped)
+        JsonArray map = doc.as<JsonArray>();
+        if (!map.isNull() && map.size() >= customMappingSize) { // not an empty map
+          gapSize = customMappingSize; // entries beyond matrix are not used
+          gapTable = new int8_t[gapSize];
+          if (gapTable) for (size_t i = 0; i < gapSize; i++) {
+            gapTable[i] = constrain(map[i], -1, 1);
           }
         }
-        DEBUG_PRINTLN(F("Gaps loaded."));
-        releaseJSONBufferLock();
       }
+      DEBUG_PRINTLN(F("Gaps loaded."));
+      releaseJSONBufferLock();
+    }
+
+    bool mapped;
+    if (!gapTable) {
+      // without gaps every panel line is a forward or reversed run, build runs from panels (no table needed)
+      mapped = compressMappingTable(true);
+    } else {
+      customMappingTable = new uint16_t[customMappingSize];
+      mapped = customMappingTable != nullptr;
+      if (mapped) {
+        // fill with empty in case we don't fill the entire matrix
+        for (size_t i = 0; i< customMappingSize; i++) {
+          customMappingTable[i] = (uint16_t)-1;
+        }
 
-      uint16_t x, y, pix=0; //pixel
-      for (size_t pan = 0; pan < panel.size(); pan++) {
-        Panel &p = panel[pan];
-        uint16_t h = p.vertical ? p.height : p.width;
-        uint16_t v = p.vertical ? p.width  : p.height;
-        for (size_t j = 0; j < v; j++){
-          for(size_t i = 0; i < h; i++) {
-            y = (p.vertical?p.rightStart:p.bottomStart) ? v-j-1 : j;
-            x = (p.vertical?p.bottomStart:p.rightStart) ? h-i-1 : i;
-            x = p.serpentine && j%2 ? h-x-1 : x;
-            size_t index = (p.yOffset + (p.vertical?x:y)) * Segment::maxWidth + p.xOffset + (p.vertical?y:x);
-            if (!gapTable || (gapTable && gapTable[index] >  0)) customMappingTable[index] = pix; // a useful pixel (otherwise -1 is retained)
-            if (!gapTable || (gapTable && gapTable[index] >= 0)) pix++; // not a missing pixel
+        uint16_t x, y, pix=0; //pixel
+        for (size_t pan = 0; pan < panel.size(); pan++) {
+          Panel &p = panel[pan];
+          uint16_t h = p.vertical ? p.height : p.width;
+          uint16_t v = p.vertical ? p.width  : p.height;
+          for (size_t j = 0; j < v; j++){
+            for(size_t i = 0; i < h; i++) {
+              y = (p.vertical?p.rightStart:p.bottomStart) ? v-j-1 : j;
+              x = (p.vertical?p.bottomStart:p.rightStart) ? h-i-1 : i;
+              x = p.serpentine && j%2 ? h-x-1 : x;
+              size_t index = (p.yOffset + (p.vertical?x:y)) * Segment::maxWidth + p.xOffset + (p.vertical?y:x);
+              if (gapTable[index] >  0) customMappingTable[index] = pix; // a useful pixel (otherwise -1 is retained)
+              if (gapTable[index] >= 0) pix++; // not a missing pixel
+            }
           }
         }
+        compressMappingTable(); // gaps may break panel lines anywhere
       }
-
       // delete gap array as we no longer need it
-      if (gapTable) delete[] gapTable;
+      delete[] gapTable;
+    }
 
+    if (mapped) {
       #ifdef WLED_DEBUG
       DEBUG_PRINT(F("Matrix ledmap:"));
       for (unsigned i=0; i<customMappingSize; i++) {
         if (!(i%Segment::maxWidth)) DEBUG_PRINTLN();
-        DEBUG_PRINTF("%4d,", customMappingTable[i]);
+        DEBUG_PRINTF("%4d,", getMappedPixelIndex(i));
       }
       DEBUG_PRINTLN();
       #endif
     } else { // memory allocation error
       DEBUG_PRINTLN(F("Ledmap alloc error."));
+      clearMapping();
       isMatrix = false;
       panels = 0;
       panel.clear();
@@ -155,6 +178,32 @@ void WS2812FX::setUpMatrix() {
 #endif
 }
 
+#ifndef WLED_DISABLE_2D
+// physical pixel of logical matrix pixel index as laid out by setUpMatrix() without gaps, 0xFFFF if not on a panel
+// (inverse of panel walk in setUpMatrix(), later panels overlap earlier ones)
+uint16_t WS2812FX::panelPixel(unsigned index) const
+{
+  const unsigned X = index % Segment::maxWidth;
+  const unsigned Y = index / Segment::maxWidth;
+  uint16_t pix = 0xFFFFU;
+  unsigned base = 0; // first pixel of panel
+  for (const Panel &p : panel) {
+    const unsigned h = p.vertical ? p.height : p.width;  // pixels per line
+    const unsigned v = p.vertical ? p.width  : p.height; // lines
+    if (X >= p.xOffset && X < p.xOffset + p.width && Y >= p.yOffset && Y < p.yOffset + p.height) {
+      unsigned j = p.vertical ? X - p.xOffset : Y - p.yOffset; // line
+      unsigned i = p.vertical ? Y - p.yOffset : X - p.xOffset; // pixel within line
+      if (p.vertical ? p.rightStart : p.bottomStart) j = v - j - 1;
+      if (p.serpentine && j%2) i = h - i - 1;
+      if (p.vertical ? p.bottomStart : p.rightStart) i = h - i - 1;
+      pix = base + j*h + i;
+    }
+    base += h*v;
+  }
+  return pix;
+}
+#endif
+
 
 ///////////////////////////////////////////////////////////
 // Segment:: routines
@@ -175,24 +224,38 @@ void IRAM_ATTR Segment::setPixelColorXY(int x, int y, uint32_t col)
   if (!isActive()) return; // not active
   if (x >= virtualWidth() || y >= virtualHeight() || x<0 || y<0) return;  // if pixel would fall out of virtual segment just exit
 
-  uint8_t _bri_t = currentBri();
-  if (_bri_t < 255) {
-    byte r = scale8(R(col), _bri_t);
-    byte g = scale8(G(col), _bri_t);
-    byte b = scale8(B(col), _bri_t);
-    byte w = scale8(W(col), _bri_t);
-    col = RGBW32(r, g, b, w);
+  if (pixels) { // draw into render buffer, it will be painted onto the strip in WS2812FX::service()
+    unsigned i = x + y * virtualWidth();
+    if (i < _pixelsLen) setBufferPixel(i, col);
+    return;
   }
 
+  // no render buffer, draw directly onto the strip
+  uint8_t _bri_t = currentBri();
+  if (_bri_t < 255) col = color_fade(col, _bri_t);
+  paintPixelXY(x, y, col);
+}
+
+// paints a (virtual) pixel of 2D segment onto the strip (or stores strip indices into map)
+unsigned IRAM_ATTR Segment::paintPixelXY(int x, int y, uint32_t col, uint16_t *map)
+{
+  if (x >= virtualWidth() || y >= virtualHeight() || x<0 || y<0) return 0;  // if pixel would fall out of virtual segment just exit
+
   if (reverse  ) x = virtualWidth()  - x - 1;
   if (reverse_y) y = virtualHeight() - y - 1;
   if (transpose) { uint16_t t = x; x = y; y = t; } // swap X & Y if segment transposed
 
   x *= groupLength(); // expand to physical pixels
   y *= groupLength(); // expand to physical pixels
-  if (x >= width() || y >= height()) return;  // if pixel would fall out of segment just exit
+  if (x >= width() || y >= height()) return 0;  // if pixel would fall out of segment just exit
 
+  unsigned n = 0;
   uint32_t tmpCol = col;
+  // same as strip.setPixelColorXY() unless we are only collecting indices
+  auto put = [&](unsigned px, unsigned py) {
+    if (map) map[n++] = py * Segment::maxWidth + px;
+    else     strip.setPixelColorXY(px, py, tmpCol);
+  };
   for (int j = 0; j < grouping; j++) {   // groupping vertically
     for (int g = 0; g < grouping; g++) { // groupping horizontally
       uint16_t xX = (x+g), yY = (y+j);
@@ -200,24 +263,64 @@ void IRAM_ATTR Segment::setPixelColorXY(int x, int y, uint32_t col)
 
 #ifndef WLED_DISABLE_MODE_BLEND
       // if blending modes, blend with underlying pixel
-      if (_modeBlend) tmpCol = color_blend(strip.getPixelColorXY(start + xX, startY + yY), col, 0xFFFFU - progress(), true);
+      if (_modeBlend && !map) tmpCol = color_blend(strip.getPixelColorXY(start + xX, startY + yY), col, 0xFFFFU - frameProgress(), true);
 #endif
 
-      strip.setPixelColorXY(start + xX, startY + yY, tmpCol);
+      put(start + xX, startY + yY);
 
       if (mirror) { //set the corresponding horizontally mirrored pixel
-        if (transpose) strip.setPixelColorXY(start + xX, startY + height() - yY - 1, tmpCol);
-        else           strip.setPixelColorXY(start + width() - xX - 1, startY + yY, tmpCol);
+        if (transpose) put(start + xX, startY + height() - yY - 1);
+        else           put(start + width() - xX - 1, startY + yY);
       }
       if (mirror_y) { //set the corresponding vertically mirrored pixel
-        if (transpose) strip.setPixelColorXY(start + width() - xX - 1, startY + yY, tmpCol);
-        else           strip.setPixelColorXY(start + xX, startY + height() - yY - 1, tmpCol);
+        if (transpose) put(start + width() - xX - 1, startY + yY);
+        else           put(start + xX, startY + height() - yY - 1);
       }
       if (mirror_y && mirror) { //set the corresponding vertically AND horizontally mirrored pixel
-        strip.setPixelColorXY(width() - xX - 1, height() - yY - 1, tmpCol);
+        put(width() - xX - 1, height() - yY - 1);
       }
     }
   }
+  return n;
+}
+
+// render buffer indices of 1D pixel expanded onto 2D segment (M12_pBar, M12_pArc & M12_pCorner)
+// returns number of indices (map may be nullptr to just count them)
+unsigned Segment::expand1D2D(int i, uint16_t *map)
+{
+  const int vW = virtualWidth();
+  const int vH = virtualHeight();
+  unsigned n = 0;
+  auto put = [&](int x, int y) {
+    if (x < 0 || y < 0 || x >= vW || y >= vH) return; // same as bounds check in setPixelColorXY()
+    if (map) map[n] = x + y * vW;
+    n++;
+  };
+  switch (map1D2D) {
+    case M12_pBar:
+      for (int x = 0; x < vW; x++) put(x, vH - i - 1);
+      break;
+    case M12_pArc:
+      if (i==0)
+        put(0, 0);
+      else {
+        int prevX = -1, prevY = -1;
+        float step = HALF_PI / (2.85f*i);
+        for (float rad = 0.0f; rad <= HALF_PI+step/2; rad += step) {
+          int x = roundf(sin_t(rad) * i);
+          int y = roundf(cos_t(rad) * i);
+          if (x == prevX && y == prevY) continue; // skip repeated pixel
+          put(x, y);
+          prevX = x; prevY = y;
+        }
+      }
+      break;
+    case M12_pCorner:
+      for (int x = 0; x <= i; x++) put(x, i);
+      for (int y = 0; y <  i; y++) put(i, y);
+      break;
+  }
+  return n;
 }
 
 // anti-aliased version of setPixelColorXY()
@@ -268,6 +371,10 @@ void Segment::setPixelColorXY(float x, float y, uint32_t col, bool aa)
 uint32_t Segment::getPixelColorXY(uint16_t x, uint16_t y) {
   if (!isActive()) return 0; // not active
   if (x >= virtualWidth() || y >= virtualHeight() || x<0 || y<0) return 0;  // if pixel would fall out of virtual segment just exit
+  if (pixels) { // read from render buffer (lossless)
+    unsigned i = x + y * virtualWidth();
+    return (i < _pixelsLen) ? pixels[i] : 0;
+  }
   if (reverse  ) x = virtualWidth()  - x - 1;
   if (reverse_y) y = virtualHeight() - y - 1;
   if (transpose) { uint16_t t = x; x = y; y = t; } // swap X & Y if segment transposed
@@ -301,6 +408,7 @@ void Segment::blurRow(uint16_t row, fract8 blur_amount) {
   const uint_fast16_t rows = virtualHeight();
 
   if (row >= rows) return;
+  if (uint32_t *buf = directBuffer()) { blurBuffer(buf + row*cols, cols, 1, blur_amount, true); return; }
   // blur one row
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
@@ -329,6 +437,7 @@ void Segment::blurCol(uint16_t col, fract8 blur_amount) {
   const uint_fast16_t rows = virtualHeight();
 
   if (col >= cols) return;
+  if (uint32_t *buf = directBuffer()) { blurBuffer(buf + col, rows, cols, blur_amount, true); return; }
   // blur one column
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
@@ -70,10 +70,83 @@
 #endif
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Segment arena implementation
+///////////////////////////////////////////////////////////////////////////////
+void SegmentArena::reserve(size_t len) {
+  _wanted = constrain(len, (size_t)SEGMENT_ARENA_MIN, (size_t)SEGMENT_ARENA_SIZE) & ~3U;
+  if (_mem && _used == 0 && _wanted != _size) {
+    // nothing handed out, let begin() allocate the new size
+    ::free(_mem);
+    _mem = nullptr;
+    _size = 0;
+  }
+}
+
+bool SegmentArena::begin() {
+  if (_mem) return true;
+  if (ESP.getFreeHeap() < _wanted + MIN_HEAP_SIZE) return false;
+  // do not use SPI RAM on ESP32 since it is slow
+  _mem = (uint8_t*) malloc(_wanted);
+  if (!_mem) return false;
+  _size = _wanted & ~3U;
+  header(_mem) = _size; // one free block
+  DEBUG_PRINTF("Segment arena: %u bytes\n", _size);
+  return true;
+}
+
+void *SegmentArena::alloc(size_t len) {
+  if (len == 0) return nullptr;
+  size_t need = ((len + 3) & ~3U) + sizeof(uint32_t);
+  if (begin()) {
+    for (uint8_t *b = _mem; b < _mem + _size; b += header(b) & ~1U) {
+      uint32_t bSize = header(b);
+      if ((bSize & 1U) || bSize < need) continue;
+      if (bSize - need >= 2*sizeof(uint32_t)) { // split
+        header(b + need) = bSize - need;
+        bSize = need;
+      }
+      header(b) = bSize | 1U;
+      _used += bSize;
+      if (_used > _highWater) _highWater = _used;
+      return b + sizeof(uint32_t);
+    }
+  }
+  _fallbacks++;
+  return malloc(len);
+}
+
+void SegmentArena::free(void *ptr) {
+  if (!ptr) return;
+  if (!contains(ptr)) { ::free(ptr); return; }
+  uint8_t *blk = (uint8_t*)ptr - sizeof(uint32_t);
+  header(blk) &= ~1U;
+  _used -= header(blk);
+  // coalesce adjacent free blocks
+  for (uint8_t *b = _mem; b < _mem + _size; b += header(b) & ~1U) {
+    if (header(b) & 1U) continue;
+    uint8_t *n = b + header(b);
+    while (n < _mem + _size && !(header(n) & 1U)) {
+      header(b) += header(n);
+      n = b + header(b);
+    }
+  }
+}
+
+size_t SegmentArena::getLargestFree() const {
+  size_t largest = 0;
+  if (_mem) for (uint8_t *b = _mem; b < _mem + _size; b += header(b) & ~1U) {
+    if (!(header(b) & 1U) && header(b) > largest) largest = header(b);
+  }
+  return largest ? largest - sizeof(uint32_t) : 0;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Segment class implementation
 ///////////////////////////////////////////////////////////////////////////////
 uint16_t Segment::_usedSegmentData = 0U; // amount of RAM all segments use for their data[]
+SegmentArena Segment::_arena;
 uint16_t Segment::maxWidth = DEFAULT_LED_COUNT;
 uint16_t Segment::maxHeight = 1;
 
@@ -84,6 +157,7 @@ unsigned long Segment::_lastPaletteChange = 0; // perhaps it should be per segme
 #ifndef WLED_DISABLE_MODE_BLEND
 bool Segment::_modeBlend = false;
 #endif
+bool Segment::_inFrame = false;
 
 // copy constructor
 Segment::Segment(const Segment &orig) {
@@ -93,6 +167,12 @@ Segment::Segment(const Segment &orig) {
   name = nullptr;
   data = nullptr;
   _dataLen = 0;
+  pixels = nullptr; // render buffer will be allocated when needed
+  _pixelsLen = 0;
+  _pixelMap = nullptr;
+  _m12Map = nullptr;
+  _mapKey.stop      = 0; // invalidate pixel maps
+  _frame.valid = false;
   if (orig.name) { name = new char[strlen(orig.name)+1]; if (name) strcpy(name, orig.name); }
   if (orig.data) { if (allocateData(orig._dataLen)) memcpy(data, orig.data, orig._dataLen); }
 }
@@ -105,6 +185,10 @@ Segment::Segment(Segment &&orig) noexcept {
   orig.name = nullptr;
   orig.data = nullptr;
   orig._dataLen = 0;
+  orig.pixels = nullptr;
+  orig._pixelsLen = 0;
+  orig._pixelMap = nullptr;
+  orig._m12Map = nullptr;
 }
 
 // copy assignment
@@ -115,11 +199,18 @@ Segment& Segment::operator= (const Segment &orig) {
     if (name) { delete[] name; name = nullptr; }
     stopTransition();
     deallocateData();
+    deallocatePixels();
     // copy source
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
     // erase pointers to allocated data
     data = nullptr;
     _dataLen = 0;
+    pixels = nullptr;
+    _pixelsLen = 0;
+    _pixelMap = nullptr;
+    _m12Map = nullptr;
+    _mapKey.stop      = 0;
+    _frame.valid = false;
     // copy source data
     if (orig.name) { name = new char[strlen(orig.name)+1]; if (name) strcpy(name, orig.name); }
     if (orig.data) { if (allocateData(orig._dataLen)) memcpy(data, orig.data, orig._dataLen); }
@@ -134,10 +225,15 @@ Segment& Segment::operator= (Segment &&orig) noexcept {
     if (name) { delete[] name; name = nullptr; } // free old name
     stopTransition();
     deallocateData(); // free old runtime data
+    deallocatePixels(); // free old render buffer
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
     orig.name = nullptr;
     orig.data = nullptr;
     orig._dataLen = 0;
+    orig.pixels = nullptr;
+    orig._pixelsLen = 0;
+    orig._pixelMap = nullptr;
+    orig._m12Map = nullptr;
     orig._t   = nullptr; // old segment cannot be in transition
   }
   return *this;
@@ -158,7 +254,7 @@ bool Segment::allocateData(size_t len) {
     return false;
   }
   // do not use SPI RAM on ESP32 since it is slow
-  data = (byte*) malloc(len);
+  data = (byte*) _arena.alloc(len);
   if (!data) { DEBUG_PRINTLN(F("!!! Allocation failed. !!!")); return false; } //allocation failed
   Segment::addUsedSegmentData(len);
   //DEBUG_PRINTF("---  Allocated data (%p): %d/%d -> %p\n", this, len, Segment::getUsedSegmentData(), data);
@@ -171,7 +267,7 @@ void Segment::deallocateData() {
   if (!data) { _dataLen = 0; return; }
   //DEBUG_PRINTF("---  Released data (%p): %d/%d -> %p\n", this, _dataLen, Segment::getUsedSegmentData(), data);
   if ((Segment::getUsedSegmentData() > 0) && (_dataLen > 0)) { // check that we don't have a dangling / inconsistent data pointer
-    free(data);
+    _arena.free(data);
   } else {
     DEBUG_PRINT(F("---- Released data "));
     DEBUG_PRINTF("(%p): ", this);
@@ -184,6 +280,195 @@ void Segment::deallocateData() {
   _dataLen = 0;
 }
 
+/**
+  * Allocates render buffer for virtual pixels if it does not exist yet or its size
+  * no longer matches segment's virtual dimensions (i.e. after setUp() or option change).
+  * Buffer content is lost on reallocation. If there is not enough RAM the segment
+  * keeps drawing directly onto the strip (slower and lossy pixel read-back).
+  */
+bool Segment::allocatePixels() {
+  if (!isActive()) { deallocatePixels(); return false; }
+  size_t len = is2D() ? virtualWidth() * virtualHeight() : virtualLength();
+  if (pixels && _pixelsLen == len) return true;
+  deallocatePixels();
+  if (len == 0) return false;
+  if (ESP.getFreeHeap() < len * sizeof(uint32_t) + MIN_HEAP_SIZE) return false; // leave enough heap for web server
+  // do not use SPI RAM on ESP32 since it is slow
+  pixels = (uint32_t*) calloc(len, sizeof(uint32_t));
+  if (!pixels) { DEBUG_PRINTLN(F("!!! Render buffer allocation failed. !!!")); return false; }
+  //DEBUG_PRINTF("---  Allocated render buffer (%p): %d -> %p\n", this, len, pixels);
+  _pixelsLen = len;
+  return true;
+}
+
+void Segment::deallocatePixels() {
+  deallocatePixelMap(); // maps refer to render buffer
+  #ifndef WLED_DISABLE_MODE_BLEND
+  deallocateLayer();    // layer has the same dimensions as render buffer
+  #endif
+  if (pixels) free(pixels);
+  pixels = nullptr;
+  _pixelsLen = 0;
+}
+
+#ifndef WLED_DISABLE_MODE_BLEND
+/**
+  * Exchanges render buffer with the layer of the previous mode so that during mode
+  * transition each effect draws into (and reads back from) its own buffer.
+  * Layers are blended once per pixel in composite().
+  * Layer is allocated on first use (with a copy of current render buffer) and counts
+  * towards MAX_SEGMENT_DATA. Returns false if there is no render buffer or not enough
+  * memory, in which case the previous mode blends while drawing.
+  */
+bool Segment::swapLayer() {
+  if (!pixels || !isInTransition()) return false;
+  if (_t->_pixelsT && _t->_pixelsLenT != _pixelsLen) deallocateLayer(); // geometry changed
+  if (!_t->_pixelsT) {
+    size_t len = _pixelsLen * sizeof(uint32_t);
+    if (Segment::getUsedSegmentData() + len > MAX_SEGMENT_DATA || ESP.getFreeHeap() < len + MIN_HEAP_SIZE) return false;
+    _t->_pixelsT = (uint32_t*) _arena.alloc(len);
+    if (!_t->_pixelsT) return false;
+    memcpy(_t->_pixelsT, pixels, len); // previous mode continues from what is currently displayed
+    _t->_pixelsLenT = _pixelsLen;
+    Segment::addUsedSegmentData(len);
+  }
+  std::swap(pixels, _t->_pixelsT);
+  return true;
+}
+
+void Segment::deallocateLayer() {
+  if (!_t || !_t->_pixelsT) return;
+  _arena.free(_t->_pixelsT);
+  Segment::addUsedSegmentData(-(int)(_t->_pixelsLenT * sizeof(uint32_t)));
+  _t->_pixelsT = nullptr;
+  _t->_pixelsLenT = 0;
+}
+#endif
+
+void Segment::deallocatePixelMap() {
+  if (_pixelMap) free(_pixelMap);
+  if (_m12Map) free(_m12Map);
+  _pixelMap = nullptr;
+  _m12Map = nullptr;
+  _mapStride = 0;
+  _mapKey.stop      = 0; // no active segment has stop == 0
+}
+
+/**
+  * Precompiles segment's pixel index maps so that hot paths become table walks:
+  * - strip (logical) indices of every render buffer pixel (grouping, spacing, reverse,
+  *   mirror, transpose & offset applied) used by composite()
+  * - render buffer indices of every 1D pixel expanded onto 2D segment (bar, arc & corner
+  *   mappings) used by setPixelColor()
+  * Maps are recompiled only when segment geometry changes (setUp(), setOption(), map1D2D,
+  * matrix size). If there is not enough RAM arithmetic fallback is used.
+  */
+void Segment::updatePixelMap() {
+  if (!pixels) { deallocatePixelMap(); return; }
+  const uint16_t geometryOptions = options & 0x0FCAU; // reverse, mirror, reverse_y, mirror_y, transpose & map1D2D
+  if (_mapKey.stop == stop && _mapKey.start == start && _mapKey.startY == startY && _mapKey.stopY == stopY
+      && _mapKey.offset == offset && _mapKey.grouping == grouping && _mapKey.spacing == spacing
+      && _mapKey.options == geometryOptions && _mapKey.maxWidth == Segment::maxWidth && _mapKey.maxHeight == Segment::maxHeight) return; // maps are up to date
+
+  deallocatePixelMap();
+  _mapKey.start     = start;
+  _mapKey.stop      = stop;
+  _mapKey.startY    = startY;
+  _mapKey.stopY     = stopY;
+  _mapKey.offset    = offset;
+  _mapKey.grouping  = grouping;
+  _mapKey.spacing   = spacing;
+  _mapKey.options   = geometryOptions;
+  _mapKey.maxWidth  = Segment::maxWidth;
+  _mapKey.maxHeight = Segment::maxHeight;
+
+  // how many strip pixels a single virtual pixel may expand to
+  [[maybe_unused]] bool paintXY = false;
+  size_t stride = grouping * (mirror ? 2 : 1);
+#ifndef WLED_DISABLE_2D
+  paintXY = is2D() || (Segment::maxHeight!=1 && (width()==1 || height()==1) && start < Segment::maxWidth*Segment::maxHeight);
+  if (paintXY) stride = grouping * grouping * (mirror ? 2 : 1) * (mirror_y ? 2 : 1);
+#endif
+  size_t len = _pixelsLen * stride;
+  if (stride <= 64 && ESP.getFreeHeap() > len * sizeof(uint16_t) + MIN_HEAP_SIZE) {
+    _pixelMap = (uint16_t*) malloc(len * sizeof(uint16_t));
+  }
+  if (_pixelMap) {
+    _mapStride = stride;
+    memset(_pixelMap, 0xFF, len * sizeof(uint16_t)); // mark all entries unused
+#ifndef WLED_DISABLE_2D
+    if (paintXY) {
+      const uint16_t cols = is2D() ? virtualWidth() : 1;
+      const bool vertical = virtualHeight()>1;
+      for (unsigned j = 0; j < _pixelsLen; j++) {
+        int x = is2D() ? j % cols : (vertical ? 0 : j);
+        int y = is2D() ? j / cols : (vertical ? j : 0);
+        paintPixelXY(x, y, 0, _pixelMap + j * stride);
+      }
+    } else
+#endif
+    {
+      const unsigned vLen = MIN(_pixelsLen, virtualLength());
+      for (unsigned j = 0; j < vLen; j++) paintPixel(j, 0, _pixelMap + j * stride);
+    }
+  }
+
+#ifndef WLED_DISABLE_2D
+  if (is2D() && (map1D2D == M12_pBar || map1D2D == M12_pArc || map1D2D == M12_pCorner)) {
+    const unsigned vLen = virtualLength();
+    size_t total = vLen + 1; // offsets
+    for (unsigned i = 0; i < vLen; i++) total += expand1D2D(i);
+    if (total < 0xFFFFU && ESP.getFreeHeap() > total * sizeof(uint16_t) + MIN_HEAP_SIZE) {
+      _m12Map = (uint16_t*) malloc(total * sizeof(uint16_t));
+    }
+    if (_m12Map) {
+      unsigned pos = vLen + 1;
+      for (unsigned i = 0; i < vLen; i++) {
+        _m12Map[i] = pos;
+        pos += expand1D2D(i, _m12Map + pos);
+      }
+      _m12Map[vLen] = pos;
+    }
+  }
+#endif
+  //DEBUG_PRINTF("---  Compiled pixel map (%p): %d*%d %p %p\n", this, (int)_pixelsLen, (int)_mapStride, _pixelMap, _m12Map);
+}
+
+void IRAM_ATTR Segment::setBufferPixel(unsigned i, uint32_t col) {
+#ifndef WLED_DISABLE_MODE_BLEND
+  if (_modeBlend) col = color_blend(pixels[i], col, 0xFFFFU - frameProgress(), true);
+#endif
+  pixels[i] = col;
+}
+
+// returns render buffer if whole segment can be processed in place (same result as get/setPixelColor() on all pixels)
+// buffer must match current virtual dimensions and must not be blended with old effect
+uint32_t *Segment::directBuffer() {
+#ifndef WLED_DISABLE_MODE_BLEND
+  if (_modeBlend) return nullptr;
+#endif
+  if (!pixels) return nullptr;
+  size_t len = is2D() ? virtualWidth() * virtualHeight() : virtualLength();
+  return (_pixelsLen == len) ? pixels : nullptr;
+}
+
+// blurs n pixels of a render buffer which are stride apart (row: stride = 1, column: stride = width)
+// rgbOnly mimics CRGB arithmetic of blurRow()/blurCol() (white channel is dropped), otherwise same as 1D blur()
+void Segment::blurBuffer(uint32_t *p, unsigned n, unsigned stride, uint8_t blur_amount, bool rgbOnly) {
+  const uint32_t mask = rgbOnly ? 0x00FFFFFFU : 0xFFFFFFFFU;
+  uint8_t keep = 255 - blur_amount;
+  uint8_t seep = blur_amount >> 1;
+  uint32_t carryover = BLACK;
+  for (unsigned i = 0; i < n; i++, p += stride) {
+    uint32_t before = *p & mask;
+    uint32_t part = color_fade(before, seep);
+    uint32_t cur  = color_add(color_fade(before, keep), carryover, true);
+    if (i > 0) p[-(int)stride] = color_add(p[-(int)stride] & mask, part, true);
+    if (before != cur) *p = cur; // optimization: only set pixel if color has changed
+    carryover = part;
+  }
+}
+
 /**
   * If reset of this segment was requested, clears runtime
   * settings of this segment.
@@ -290,8 +575,9 @@ void Segment::startTransition(uint16_t dur) {
   if (isInTransition()) return; // already in transition no need to store anything
 
   // starting a transition has to occur before change so we get current values 1st
-  _t = new Transition(dur); // no previous transition running
-  if (!_t) return; // failed to allocate data
+  void *mem = _arena.alloc(sizeof(Transition));
+  if (!mem) return; // failed to allocate data
+  _t = new (mem) Transition(dur); // no previous transition running
 
   //DEBUG_PRINTF("-- Started transition: %p\n", this);
   loadPalette(_t->_palT, palette);
@@ -304,7 +590,7 @@ void Segment::startTransition(uint16_t dur) {
     _t->_segT._dataLenT = 0;
     _t->_segT._dataT    = nullptr;
     if (_dataLen > 0 && data) {
-      _t->_segT._dataT = (byte *)malloc(_dataLen);
+      _t->_segT._dataT = (byte *)_arena.alloc(_dataLen);
       if (_t->_segT._dataT) {
         //DEBUG_PRINTF("--  Allocated duplicate data (%d): %p\n", _dataLen, _t->_segT._dataT);
         memcpy(_t->_segT._dataT, data, _dataLen);
@@ -323,14 +609,16 @@ void Segment::stopTransition() {
   //DEBUG_PRINTF("-- Stopping transition: %p\n", this);
   if (isInTransition()) {
     #ifndef WLED_DISABLE_MODE_BLEND
+    deallocateLayer();
     if (_t->_segT._dataT && _t->_segT._dataLenT > 0) {
       //DEBUG_PRINTF("--  Released duplicate data (%d): %p\n", _t->_segT._dataLenT, _t->_segT._dataT);
-      free(_t->_segT._dataT);
+      _arena.free(_t->_segT._dataT);
       _t->_segT._dataT = nullptr;
       _t->_segT._dataLenT = 0;
     }
     #endif
-    delete _t;
+    _t->~Transition();
+    _arena.free(_t);
     _t = nullptr;
   }
 }
@@ -422,7 +710,30 @@ void Segment::restoreSegenv(tmpsegd_t &tmpSeg) {
 }
 #endif
 
+// samples transition state once per frame (called from WS2812FX::service() before effects run)
+void Segment::beginFrame() {
+  _frame.valid = false; // use live values below
+  _frame.progress = progress();
+  uint32_t prog = _frame.progress;
+  _frame.bri = on ? opacity : 0;
+  _frame.cct = cct;
+  for (size_t i = 0; i < NUM_COLORS; i++) _frame.colors[i] = colors[i];
+  if (prog < 0xFFFFU) {
+    _frame.bri = (_frame.bri * prog + _t->_briT * (0xFFFFU - prog)) / 0xFFFFU;
+    _frame.cct = (_frame.cct * prog + _t->_cctT * (0xFFFFU - prog)) / 0xFFFFU;
+  }
+  if (isInTransition()) for (size_t i = 0; i < NUM_COLORS; i++) {
+#ifndef WLED_DISABLE_MODE_BLEND
+    _frame.colors[i] = color_blend(_t->_segT._colorT[i], colors[i], prog, true);
+#else
+    _frame.colors[i] = color_blend(_t->_colorT[i], colors[i], prog, true);
+#endif
+  }
+  _frame.valid = true;
+}
+
 uint8_t Segment::currentBri(bool useCct) {
+  if (_inFrame && _frame.valid) return useCct ? _frame.cct : _frame.bri;
   uint32_t prog = progress();
   if (prog < 0xFFFFU) {
     uint32_t curBri = (useCct ? cct : (on ? opacity : 0)) * prog;
@@ -434,13 +745,14 @@ uint8_t Segment::currentBri(bool useCct) {
 
 uint8_t Segment::currentMode() {
 #ifndef WLED_DISABLE_MODE_BLEND
-  uint16_t prog = progress();
+  uint16_t prog = frameProgress();
   if (modeBlending && prog < 0xFFFFU) return _t->_modeT;
 #endif
   return mode;
 }
 
 uint32_t Segment::currentColor(uint8_t slot) {
+  if (_inFrame && _frame.valid) return _frame.colors[slot];
 #ifndef WLED_DISABLE_MODE_BLEND
   return isInTransition() ? color_blend(_t->_segT._colorT[slot], colors[slot], progress(), true) : colors[slot];
 #else
@@ -450,7 +762,7 @@ uint32_t Segment::currentColor(uint8_t slot) {
 
 CRGBPalette16 &Segment::currentPalette(CRGBPalette16 &targetPalette, uint8_t pal) {
   loadPalette(targetPalette, pal);
-  uint16_t prog = progress();
+  uint16_t prog = frameProgress();
   if (strip.paletteFade && prog < 0xFFFFU) {
     // blend palettes
     // there are about 255 blend passes of 48 "blends" to completely blend two palettes (in _dur time)
@@ -482,7 +794,10 @@ void Segment::setUp(uint16_t i1, uint16_t i2, uint8_t grp, uint8_t spc, uint16_t
 
   stateChanged = true; // send UDP/WS broadcast
 
-  if (stop) fill(BLACK); // turn old segment range off (clears pixels if changing spacing)
+  if (stop) { // turn old segment range off (clears pixels if changing spacing)
+    fill(BLACK);
+    composite(); // render buffer needs to be painted with old geometry
+  }
   if (grp) { // prevent assignment of 0
     grouping = grp;
     spacing = spc;
@@ -671,6 +986,11 @@ void IRAM_ATTR Segment::setPixelColor(int i, uint32_t col)
 
 #ifndef WLED_DISABLE_2D
   if (is2D()) {
+    if (pixels && vStrip == 0) {
+      // render buffer index of M12_Pixels equals virtual index, other mappings use precompiled expansion
+      if (map1D2D == M12_Pixels) { if (unsigned(i) < _pixelsLen) setBufferPixel(i, col); return; }
+      if (_m12Map && _mapKey.options == (options & 0x0FCAU)) { for (unsigned k = _m12Map[i]; k < _m12Map[i+1]; k++) setBufferPixel(_m12Map[k], col); return; }
+    }
     uint16_t vH = virtualHeight();  // segment height in logical pixels
     uint16_t vW = virtualWidth();
     switch (map1D2D) {
@@ -729,16 +1049,23 @@ void IRAM_ATTR Segment::setPixelColor(int i, uint32_t col)
   }
 #endif
 
-  uint16_t len = length();
-  uint8_t _bri_t = currentBri();
-  if (_bri_t < 255) {
-    byte r = scale8(R(col), _bri_t);
-    byte g = scale8(G(col), _bri_t);
-    byte b = scale8(B(col), _bri_t);
-    byte w = scale8(W(col), _bri_t);
-    col = RGBW32(r, g, b, w);
+  if (pixels) { // draw into render buffer, it will be painted onto the strip in WS2812FX::service()
+    if (i < _pixelsLen) setBufferPixel(i, col);
+    return;
   }
 
+  // no render buffer, draw directly onto the strip
+  uint8_t _bri_t = currentBri();
+  if (_bri_t < 255) col = color_fade(col, _bri_t);
+  paintPixel(i, col);
+}
+
+// paints a (virtual) pixel of 1D segment onto the strip (or stores strip indices into map)
+unsigned IRAM_ATTR Segment::paintPixel(int i, uint32_t col, uint16_t *map)
+{
+  uint16_t len = length();
+  unsigned n = 0;
+
   // expand pixel (taking into account start, grouping, spacing [and offset])
   i = i * groupLength();
   if (reverse) { // is segment reversed?
@@ -759,19 +1086,24 @@ void IRAM_ATTR Segment::setPixelColor(int i, uint32_t col)
         uint16_t indexMir = stop - indexSet + start - 1;
         indexMir += offset; // offset/phase
         if (indexMir >= stop) indexMir -= len; // wrap
+        if (map) map[n++] = indexMir;
+        else {
 #ifndef WLED_DISABLE_MODE_BLEND
-        if (_modeBlend) tmpCol = color_blend(strip.getPixelColor(indexMir), col, 0xFFFFU - progress(), true);
+          if (_modeBlend) tmpCol = color_blend(strip.getPixelColor(indexMir), col, 0xFFFFU - frameProgress(), true);
 #endif
-        strip.setPixelColor(indexMir, tmpCol);
+          strip.setPixelColor(indexMir, tmpCol);
+        }
       }
       indexSet += offset; // offset/phase
       if (indexSet >= stop) indexSet -= len; // wrap
+      if (map) { map[n++] = indexSet; continue; }
 #ifndef WLED_DISABLE_MODE_BLEND
-      if (_modeBlend) tmpCol = color_blend(strip.getPixelColor(indexSet), col, 0xFFFFU - progress(), true);
+      if (_modeBlend) tmpCol = color_blend(strip.getPixelColor(indexSet), col, 0xFFFFU - frameProgress(), true);
 #endif
       strip.setPixelColor(indexSet, tmpCol);
     }
   }
+  return n;
 }
 
 // anti-aliased normalized version of setPixelColor()
@@ -837,6 +1169,8 @@ uint32_t Segment::getPixelColor(int i)
   }
 #endif
 
+  if (pixels) return (i < _pixelsLen) ? pixels[i] : 0; // read from render buffer (lossless)
+
   if (reverse) i = virtualLength() - i - 1;
   i *= groupLength();
   i += start;
@@ -846,6 +1180,83 @@ uint32_t Segment::getPixelColor(int i)
   return strip.getPixelColor(i);
 }
 
+// paints render buffer onto the strip, later segments overwrite earlier ones
+void Segment::composite() {
+  if (!pixels || !isActive()) return;
+  uint8_t _bri_t = currentBri();
+  const uint32_t *layer = nullptr; // previous mode's layer (if blending modes)
+  uint16_t prog = 0xFFFFU;
+#ifndef WLED_DISABLE_MODE_BLEND
+  if (isInTransition() && _t->_pixelsT && _t->_pixelsLenT == _pixelsLen && currentMode() != mode) {
+    layer = _t->_pixelsT;
+    prog  = frameProgress();
+  }
+#endif
+  // blended and brightness scaled render buffer pixel
+  // pixels are read sequentially so they are prepared in chunks using array color functions
+  uint32_t chunk[32];
+  unsigned chunkStart = 0, chunkLen = 0;
+  const bool direct = !layer && _bri_t == 255; // render buffer can be painted as is
+  auto prepare = [&](unsigned j) {
+    chunkStart = j;
+    chunkLen = MIN(sizeof(chunk)/sizeof(uint32_t), _pixelsLen - j);
+    if (direct) return;
+    if (layer) {
+      memcpy(chunk, layer + j, chunkLen * sizeof(uint32_t));
+      color_blend(chunk, pixels + j, chunkLen, prog, true);
+    } else {
+      memcpy(chunk, pixels + j, chunkLen * sizeof(uint32_t));
+    }
+    if (_bri_t < 255) color_fade(chunk, chunkLen, _bri_t);
+  };
+  auto pixel = [&](unsigned j) {
+    if (direct) return pixels[j];
+    if (j - chunkStart >= chunkLen) prepare(j);
+    return chunk[j - chunkStart];
+  };
+  if (_pixelMap && _mapStride == 1) { // one strip pixel per buffer pixel: paint consecutive strip indices as runs
+    for (unsigned j = 0; j < _pixelsLen; j += chunkLen) {
+      prepare(j);
+      const uint32_t *col = direct ? pixels + j : chunk;
+      const uint16_t *map = _pixelMap + j;
+      for (unsigned k = 0, n; k < chunkLen; k += n) {
+        for (n = 1; k + n < chunkLen && map[k+n] == map[k] + n; n++);
+        if (map[k] != 0xFFFFU) strip.setPixelColors(map[k], col + k, n);
+      }
+    }
+    return;
+  }
+  if (_pixelMap) { // walk precompiled strip indices
+    const uint16_t *map = _pixelMap;
+    for (unsigned j = 0; j < _pixelsLen; j++, map += _mapStride) {
+      uint32_t col = pixel(j);
+      for (unsigned k = 0; k < _mapStride && map[k] != 0xFFFFU; k++) strip.setPixelColor(map[k], col);
+    }
+    return;
+  }
+#ifndef WLED_DISABLE_2D
+  if (is2D()) {
+    const uint16_t cols = virtualWidth();
+    const uint16_t rows = virtualHeight();
+    for (unsigned y = 0; y < rows; y++) for (unsigned x = 0; x < cols; x++) {
+      paintPixelXY(x, y, pixel(x + y * cols));
+    }
+    return;
+  } else if (Segment::maxHeight!=1 && (width()==1 || height()==1) && start < Segment::maxWidth*Segment::maxHeight) {
+    // vertical or horizontal 1D segment within matrix (same mapping as in setPixelColor())
+    const bool vertical = virtualHeight()>1;
+    for (unsigned i = 0; i < _pixelsLen; i++) {
+      paintPixelXY(vertical ? 0 : i, vertical ? i : 0, pixel(i));
+    }
+    return;
+  }
+#endif
+  const unsigned len = MIN(_pixelsLen, virtualLength()); // buffer may not be reallocated yet after option change
+  for (unsigned i = 0; i < len; i++) {
+    paintPixel(i, pixel(i));
+  }
+}
+
 uint8_t Segment::differs(Segment& b) const {
   uint8_t d = 0;
   if (start != b.start)         d |= SEG_DIFFERS_BOUNDS;
@@ -887,7 +1298,7 @@ void Segment::refreshLightCapabilities() {
     // we are withing 2D matrix (includes 1D segments)
     for (int y = startY; y < stopY; y++) for (int x = start; x < stop; x++) {
       uint16_t index = x + Segment::maxWidth * y;
-      if (index < strip.customMappingSize) index = strip.customMappingTable[index]; // convert logical address to physical
+      index = strip.getMappedPixelIndex(index); // convert logical address to physical
       if (index < 0xFFFFU) {
         if (segStartIdx > index) segStartIdx = index;
         if (segStopIdx  < index) segStopIdx  = index;
@@ -928,6 +1339,10 @@ void Segment::refreshLightCapabilities() {
  */
 void Segment::fill(uint32_t c) {
   if (!isActive()) return; // not active
+  if (uint32_t *buf = directBuffer()) {
+    for (unsigned i = 0; i < _pixelsLen; i++) buf[i] = c;
+    return;
+  }
   const uint16_t cols = is2D() ? virtualWidth() : virtualLength();
   const uint16_t rows = virtualHeight(); // will be 1 for 1D
   for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
@@ -969,8 +1384,7 @@ void Segment::fade_out(uint8_t rate) {
   int g2 = G(color);
   int b2 = B(color);
 
-  for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
-    color = is2D() ? getPixelColorXY(x, y) : getPixelColor(x);
+  auto fade = [&](uint32_t color) {
     int w1 = W(color);
     int r1 = R(color);
     int g1 = G(color);
@@ -987,8 +1401,17 @@ void Segment::fade_out(uint8_t rate) {
     gdelta += (g2 == g1) ? 0 : (g2 > g1) ? 1 : -1;
     bdelta += (b2 == b1) ? 0 : (b2 > b1) ? 1 : -1;
 
-    if (is2D()) setPixelColorXY(x, y, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
-    else        setPixelColor(x, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+    return RGBW32(r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+  };
+
+  if (uint32_t *buf = directBuffer()) {
+    for (unsigned i = 0; i < _pixelsLen; i++) if (buf[i] != colors[1]) buf[i] = fade(buf[i]);
+    return;
+  }
+
+  for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
+    if (is2D()) setPixelColorXY(x, y, fade(getPixelColorXY(x, y)));
+    else        setPixelColor(x, fade(getPixelColor(x)));
   }
 }
 
@@ -998,6 +1421,11 @@ void Segment::fadeToBlackBy(uint8_t fadeBy) {
   const uint16_t cols = is2D() ? virtualWidth() : virtualLength();
   const uint16_t rows = virtualHeight(); // will be 1 for 1D
 
+  if (uint32_t *buf = directBuffer()) {
+    color_fade(buf, _pixelsLen, 255-fadeBy);
+    return;
+  }
+
   for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
     if (is2D()) setPixelColorXY(x, y, color_fade(getPixelColorXY(x,y), 255-fadeBy));
     else        setPixelColor(x, color_fade(getPixelColor(x), 255-fadeBy));
@@ -1010,16 +1438,26 @@ void Segment::fadeToBlackBy(uint8_t fadeBy) {
 void Segment::blur(uint8_t blur_amount)
 {
   if (!isActive() || blur_amount == 0) return; // optimization: 0 means "don't blur"
+  uint32_t *buf = directBuffer();
 #ifndef WLED_DISABLE_2D
   if (is2D()) {
     // compatibility with 2D
     const unsigned cols = virtualWidth();
     const unsigned rows = virtualHeight();
+    if (buf) { // separable blur directly on render buffer
+      for (unsigned i = 0; i < rows; i++) blurBuffer(buf + i*cols, cols, 1, blur_amount, true);    // blur all rows
+      for (unsigned k = 0; k < cols; k++) blurBuffer(buf + k, rows, cols, blur_amount, true);      // blur all columns
+      return;
+    }
     for (unsigned i = 0; i < rows; i++) blurRow(i, blur_amount); // blur all rows
     for (unsigned k = 0; k < cols; k++) blurCol(k, blur_amount); // blur all columns
     return;
   }
 #endif
+  if (buf) {
+    blurBuffer(buf, _pixelsLen, 1, blur_amount, false);
+    return;
+  }
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
   uint32_t carryover = BLACK;
@@ -1078,6 +1516,22 @@ uint32_t Segment::color_from_palette(uint16_t i, bool mapping, bool wrap, uint8_
   uint8_t paletteIndex = i;
   if (mapping && virtualLength() > 1) paletteIndex = (i*255)/(virtualLength() -1);
   if (!wrap && strip.paletteBlend != 3) paletteIndex = scale8(paletteIndex, 240); //cut off blend at palette "end"
+
+  // effect of this segment is running: palette was already resolved by service(), use (lazily) expanded lookup table
+  if (this == strip._paletteSeg) {
+    if (!strip._paletteLUTValid) {
+      TBlendType blendType = (strip.paletteBlend == 3)? NOBLEND:LINEARBLEND;
+      for (unsigned p = 0; p < 256; p++) {
+        CRGB c = ColorFromPalette(strip._currentPalette, p, 255, blendType);
+        strip._paletteLUT[p] = RGBW32(c.r, c.g, c.b, 0);
+      }
+      strip._paletteLUTValid = true;
+    }
+    uint32_t color = strip._paletteLUT[paletteIndex];
+    if (pbri == 255) return color;
+    return pbri ? color_fade(color, pbri+1) : 0; // same rounding as ColorFromPalette()
+  }
+
   CRGBPalette16 curPal;
   curPal = currentPalette(curPal, palette);
   //if (isInTransition()) curPal = _t->_palT;
@@ -1151,6 +1605,7 @@ void WS2812FX::finalizeInit(void)
     Segment::maxWidth  = _length;
     Segment::maxHeight = 1;
   }
+  Segment::reserveArena((size_t)getLengthTotal() * SEGMENT_ARENA_PER_LED);
 
   //segments are created in makeAutoSegments();
   DEBUG_PRINTLN(F("Loading custom palettes"));
@@ -1166,7 +1621,9 @@ void WS2812FX::service() {
   bool doShow = false;
 
   _isServicing = true;
+  Segment::frameActive(true);
   _segment_index = 0;
+  unsigned long fxStart = micros();
   Segment::handleRandomPalette(); // move it into for loop when each segment has individual random palette
   for (segment &seg : _segments) {
     // process transition (mode changes in the middle of transition)
@@ -1174,7 +1631,12 @@ void WS2812FX::service() {
     // reset the segment runtime data if needed
     seg.resetIfRequired();
 
+    // (re)allocate render buffer if needed (segment will draw directly onto strip if not possible)
+    seg.allocatePixels(); // will release buffer of inactive segment
+    seg.updatePixelMap(); // recompile pixel maps if geometry changed
+
     if (!seg.isActive()) continue;
+    seg.beginFrame(); // all pixels of this frame (effect and composite()) use the same transition state
 
     // last condition ensures all solid segments are updated at the same time
     if (nowUp > seg.next_time || _triggered || (doShow && seg.mode == FX_MODE_STATIC))
@@ -1188,6 +1650,8 @@ void WS2812FX::service() {
         _colors_t[1] = seg.currentColor(1);
         _colors_t[2] = seg.currentColor(2);
         seg.currentPalette(_currentPalette, seg.palette); // we need to pass reference
+        _paletteSeg = &seg;         // palette resolved once per frame, color_from_palette() will use lookup table
+        _paletteLUTValid = false;
 
         if (!cctFromRgb || correctWB) busses.setSegmentCCT(seg.currentBri(true), correctWB);
         for (int c = 0; c < NUM_COLORS; c++) _colors_t[c] = gamma32(_colors_t[c]);
@@ -1195,23 +1659,26 @@ void WS2812FX::service() {
         // Effect blending
         // When two effects are being blended, each may have different segment data, this
         // data needs to be saved first and then restored before running previous mode.
-        // The blending will largely depend on the effect behaviour since actual output (LEDs) may be
-        // overwritten by later effect. To enable seamless blending for every effect, additional LED buffer
-        // would need to be allocated for each effect and then blended together for each pixel.
+        // Previous mode renders into its own layer buffer (if memory allows) and both layers are
+        // blended once per pixel in composite(). Without a layer previous mode blends its output
+        // with what the new mode has drawn (result largely depends on the effect behaviour).
         [[maybe_unused]] uint8_t tmpMode = seg.currentMode();  // this will return old mode while in transition
         delay = (*_mode[seg.mode])();         // run new/current mode
 #ifndef WLED_DISABLE_MODE_BLEND
         if (modeBlending && seg.mode != tmpMode) {
           Segment::tmpsegd_t _tmpSegData;
-          Segment::modeBlend(true);           // set semaphore
+          bool layered = seg.swapLayer();     // old mode draws into its own layer if possible
+          Segment::modeBlend(!layered);       // set semaphore (blend while drawing)
           seg.swapSegenv(_tmpSegData);        // temporarily store new mode state (and swap it with transitional state)
           _virtualSegmentLength = seg.virtualLength(); // update SEGLEN (mapping may have changed)
           uint16_t d2 = (*_mode[tmpMode])();  // run old mode
           seg.restoreSegenv(_tmpSegData);     // restore mode state (will also update transitional state)
+          if (layered) seg.swapLayer();       // back to new mode's render buffer
           delay = MIN(delay,d2);              // use shortest delay
           Segment::modeBlend(false);          // unset semaphore
         }
 #endif
+        _paletteSeg = nullptr;
         if (seg.mode != FX_MODE_HALLOWEEN_EYES) seg.call++;
         if (seg.isInTransition() && delay > FRAMETIME) delay = FRAMETIME; // force faster updates during transition
       }
@@ -1221,8 +1688,10 @@ void WS2812FX::service() {
     if (_segment_index == _queuedChangesSegId) setUpSegmentFromQueuedChanges();
     _segment_index++;
   }
+  if (doShow) compositeSegments();
   _virtualSegmentLength = 0;
   busses.setSegmentCCT(-1);
+  Segment::frameActive(false);
   _isServicing = false;
   _triggered = false;
 
@@ -1230,6 +1699,7 @@ void WS2812FX::service() {
   if (millis() - nowUp > _frametime) DEBUG_PRINTLN(F("Slow effects."));
   #endif
   if (doShow) {
+    _cumulativeFxTime = (3 * _cumulativeFxTime + (micros() - fxStart) +2) >> 2; // only account frames that ran effects
     yield();
     show();
   }
@@ -1240,18 +1710,152 @@ void WS2812FX::service() {
 
 void IRAM_ATTR WS2812FX::setPixelColor(int i, uint32_t col)
 {
-  if (i < customMappingSize) i = customMappingTable[i];
+  if (i < customMappingSize) i = getMappedPixelIndex(i);
   if (i >= _length) return;
   busses.setPixelColor(i, col);
 }
 
 uint32_t WS2812FX::getPixelColor(uint16_t i)
 {
-  if (i < customMappingSize) i = customMappingTable[i];
+  if (i < customMappingSize) i = getMappedPixelIndex(i);
   if (i >= _length) return 0;
   return busses.getPixelColor(i);
 }
 
+// sets count consecutive logical pixels starting at i, pixels within a ledmap run are copied without lookups
+void IRAM_ATTR_YN WS2812FX::setPixelColors(unsigned i, const uint32_t *c, unsigned count)
+{
+  if (customMappingTable) { // uncompressed ledmap
+    for (; count && i < customMappingSize; count--) setPixelColor(i++, *c++);
+  }
+  while (count && i < customMappingSize && customMappingRuns) {
+    const unsigned r = findMappingRun(i);
+    const MappingRun &run = customMappingRuns[r];
+    const unsigned n = MIN(count, customMappingRuns[r+1].start - i);
+    uint16_t p = run.target + (i - run.start) * run.step;
+    if (run.step == 1 && p < _length && p + n <= _length) {
+      for (unsigned k = 0; k < n; k++) busses.setPixelColor(p + k, c[k]); // forward run (i.e. identity), no bounds checks
+    } else {
+      for (unsigned k = 0; k < n; k++, p += run.step) if (p < _length) busses.setPixelColor(p, c[k]);
+    }
+    i += n; c += n; count -= n;
+  }
+  for (; count && i < _length; count--) busses.setPixelColor(i++, *c++); // not remapped
+}
+
+// physical pixel of logical pixel i (ledmap/matrix mapping applied), 0xFFFF if i is not mapped
+uint16_t IRAM_ATTR WS2812FX::getMappedPixelIndex(uint16_t i)
+{
+  if (i >= customMappingSize) return i;
+  if (customMappingTable) return customMappingTable[i];
+  if (!customMappingRuns) return i;
+  unsigned r = _lastMappingRun; // run of last lookup (always valid), others are found by findMappingRun()
+  if (i < customMappingRuns[r].start || i >= customMappingRuns[r+1].start) r = findMappingRun(i);
+  const MappingRun &run = customMappingRuns[r];
+  return run.target + (i - run.start) * run.step;
+}
+
+// index of mapping run containing logical pixel i (< customMappingSize)
+uint16_t IRAM_ATTR_YN WS2812FX::findMappingRun(uint16_t i)
+{
+  unsigned r = _lastMappingRun;
+  if (r < customMappingRunCount && i >= customMappingRuns[r].start && i < customMappingRuns[r+1].start) return r;
+  if (r+1 < customMappingRunCount && i >= customMappingRuns[r+1].start && i < customMappingRuns[r+2].start) {
+    r++; // next run (sequential access)
+  } else { // binary search
+    unsigned lo = 0, hi = customMappingRunCount;
+    while (hi - lo > 1) {
+      unsigned mid = (lo + hi) / 2;
+      if (customMappingRuns[mid].start <= i) lo = mid;
+      else                                   hi = mid;
+    }
+    r = lo;
+  }
+  _lastMappingRun = r;
+  return r;
+}
+
+// releases ledmap (table or runs)
+void WS2812FX::clearMapping(void)
+{
+  if (customMappingTable) delete[] customMappingTable;
+  if (customMappingRuns)  delete[] customMappingRuns;
+  customMappingTable    = nullptr;
+  customMappingRuns     = nullptr;
+  customMappingSize     = 0;
+  customMappingRunCount = 0;
+  _lastMappingRun       = 0;
+}
+
+/*
+ * Converts freshly built/loaded customMappingTable into runs of linearly mapped pixels.
+ * Matrix panels (also serpentine) and most ledmaps consist of forward and reversed rows
+ * so a 2 bytes per pixel table shrinks to 6 bytes per row. Trailing identity entries are
+ * dropped (pixels beyond customMappingSize are not remapped), an identity ledmap is released.
+ * Table is kept if runs would not save at least half of its RAM (i.e. random ledmaps).
+ * With fromPanels the entries come from the matrix panel layout (customMappingSize set, no gaps)
+ * and the table is only allocated if runs are not worth it, so peak RAM is that of the result.
+ */
+bool WS2812FX::compressMappingTable(bool fromPanels)
+{
+  #ifdef WLED_DISABLE_2D
+  fromPanels = false;
+  #endif
+  if (!fromPanels && !customMappingTable) return true;
+  auto entry = [this, fromPanels](unsigned i) -> uint16_t {
+    #ifndef WLED_DISABLE_2D
+    if (fromPanels) return panelPixel(i);
+    #endif
+    return customMappingTable[i];
+  };
+  while (customMappingSize && entry(customMappingSize-1) == customMappingSize-1) customMappingSize--;
+  if (!customMappingSize) {
+    clearMapping();
+    DEBUG_PRINTLN(F("Identity ledmap released."));
+    return true;
+  }
+
+  auto runEnd = [this, &entry](unsigned i) { // end of linear run starting at i
+    unsigned j = i + 1;
+    if (j < customMappingSize) {
+      uint16_t prev = entry(i), cur = entry(j);
+      uint16_t step = cur - prev;
+      while (uint16_t(cur - prev) == step && ++j < customMappingSize) {
+        prev = cur;
+        cur  = entry(j);
+      }
+    }
+    return j;
+  };
+  unsigned count = 0;
+  for (unsigned i = 0; i < customMappingSize; i = runEnd(i)) count++;
+  bool worthIt = (count + 1) * sizeof(MappingRun) <= customMappingSize * sizeof(uint16_t) / 2;
+
+  MappingRun *runs = worthIt ? new MappingRun[count + 1] : nullptr;
+  if (!runs) {
+    if (!fromPanels) return true; // keep table
+    customMappingTable = new uint16_t[customMappingSize];
+    if (!customMappingTable) return false;
+    for (unsigned i = 0; i < customMappingSize; i++) customMappingTable[i] = entry(i);
+    return true;
+  }
+  unsigned r = 0;
+  for (unsigned i = 0, j; i < customMappingSize; i = j, r++) {
+    j = runEnd(i);
+    runs[r].start  = i;
+    runs[r].target = entry(i);
+    runs[r].step   = (j - i > 1) ? int16_t(entry(i+1) - entry(i)) : 0;
+  }
+  runs[count] = {customMappingSize, 0xFFFFU, 0}; // sentinel
+  if (customMappingTable) delete[] customMappingTable;
+  customMappingTable    = nullptr;
+  customMappingRuns     = runs;
+  customMappingRunCount = count;
+  _lastMappingRun       = 0;
+  DEBUG_PRINTF("Ledmap compressed: %u pixels in %u runs.\n", customMappingSize, count);
+  return true;
+}
+
 
 //DISCLAIMER
 //The following function attemps to calculate the current LED power usage,
@@ -1274,6 +1878,8 @@ uint8_t WS2812FX::estimateCurrentAndLimitBri() {
 
   if (ablMilliampsMax < 150 || actualMilliampsPerLed == 0) { //0 mA per LED and too low numbers turn off calculation
     currentMilliamps = 0;
+    Bus::setPowerModel(POWER_MODEL_NONE); // busses stop summing power while pixels are set
+    for (uint_fast8_t bNum = 0; bNum < busses.getNumBusses(); bNum++) busses.getBus(bNum)->setUsedCurrent(0);
     return _brightness;
   }
 
@@ -1281,32 +1887,24 @@ uint8_t WS2812FX::estimateCurrentAndLimitBri() {
     useWackyWS2815PowerModel = true;
     actualMilliampsPerLed = 12; // from testing an actual strip
   }
+  Bus::setPowerModel(useWackyWS2815PowerModel ? POWER_MODEL_WS2815 : POWER_MODEL_RGBW);
 
   size_t powerBudget = (ablMilliampsMax - MA_FOR_ESP); //100mA for ESP power
 
   size_t pLen = 0; //getLengthPhysical();
   size_t powerSum = 0;
+  uint32_t busPowerSums[WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES] = {0};
   for (uint_fast8_t bNum = 0; bNum < busses.getNumBusses(); bNum++) {
     Bus *bus = busses.getBus(bNum);
     if (!IS_DIGITAL(bus->getType())) continue; //exclude non-digital network busses
-    uint16_t len = bus->getLength();
-    pLen += len;
-    uint32_t busPowerSum = 0;
-    for (uint_fast16_t i = 0; i < len; i++) { //sum up the usage of each LED
-      uint32_t c = bus->getPixelColor(i); // always returns original or restored color without brightness scaling
-      byte r = R(c), g = G(c), b = B(c), w = W(c);
-
-      if(useWackyWS2815PowerModel) { //ignore white component on WS2815 power calculation
-        busPowerSum += (MAX(MAX(r,g),b)) * 3;
-      } else {
-        busPowerSum += (r + g + b + w);
-      }
-    }
+    pLen += bus->getLength();
+    uint32_t busPowerSum = bus->getPowerSum(); // usage of all LEDs, summed by the bus while pixels are set
 
     if (bus->hasWhite()) { //RGBW led total output with white LEDs enabled is still 50mA, so each channel uses less
       busPowerSum *= 3;
       busPowerSum >>= 2; //same as /= 4
     }
+    busPowerSums[bNum] = busPowerSum;
     powerSum += busPowerSum;
   }
 
@@ -1329,26 +1927,54 @@ uint8_t WS2812FX::estimateCurrentAndLimitBri() {
   currentMilliamps = (powerSum * newBri) / 255;
   currentMilliamps += MA_FOR_ESP; //add power of ESP back to estimate
   currentMilliamps += pLen; //add standby power (1mA/LED) back to estimate
+
+  // per-bus estimate (without ESP power)
+  for (uint_fast8_t bNum = 0; bNum < busses.getNumBusses(); bNum++) {
+    Bus *bus = busses.getBus(bNum);
+    uint32_t busMilliamps = 0;
+    if (IS_DIGITAL(bus->getType())) busMilliamps = (busPowerSums[bNum] * actualMilliampsPerLed / 765) * newBri / 255 + bus->getLength();
+    bus->setUsedCurrent(MIN(busMilliamps, 65535U));
+  }
   return newBri;
 }
 
+// paints all segments' render buffers onto the strip in one pass (in segment order)
+void WS2812FX::compositeSegments(void) {
+  bool all = true;
+  for (segment &seg : _segments) {
+    if (!seg.isActive()) continue;
+    if (!seg.pixels) { all = false; continue; } // segment draws directly onto strip
+    if (!cctFromRgb || correctWB) busses.setSegmentCCT(seg.currentBri(true), correctWB);
+    seg.composite();
+  }
+  _composited = all;
+}
+
 void WS2812FX::show(void) {
   // avoid race condition, capture _callback value
   show_callback callback = _callback;
   if (callback) callback();
 
+  unsigned long showStart = micros();
   uint8_t newBri = estimateCurrentAndLimitBri();
-  busses.setBrightness(newBri); // "repaints" all pixels if brightness changed
+
+  // limited brightness is applied by each bus when outputting (no repaint of painted colors)
+  // except for unbuffered busses: NeoPixelBus scales colors while they are set, so these are repainted
+  // from render buffers at new brightness (lossless) if the frame was composited, otherwise restored lossy
+  // from NeoPixelBus (realtime data, segments without render buffer, unless WLED_LOSSLESS_BRIGHTNESS is set)
+  if (busses.setBrightnessLimit(newBri, _composited)) {
+    Segment::frameActive(true); // same transition state as when frame was painted
+    compositeSegments();
+    Segment::frameActive(false);
+    busses.setSegmentCCT(-1);
+  }
+  _composited = false;
 
   // some buses send asynchronously and this method will return before
   // all of the data has been sent.
   // See https://github.com/Makuna/NeoPixelBus/wiki/ESP32-NeoMethods#neoesp32rmt-methods
-  busses.show();
-
-  // restore bus brightness to its original value
-  // this is done right after show, so this is only OK if LED updates are completed before show() returns
-  // or async show has a separate buffer (ESP32 RMT and I2S are ok)
-  if (newBri < _brightness) busses.setBrightness(_brightness);
+  busses.show(newBri);
+  _cumulativeShowTime = (3 * _cumulativeShowTime + (micros() - showStart) +2) >> 2;
 
   unsigned long showNow = millis();
   size_t diff = showNow - _lastShow;
@@ -1421,7 +2047,7 @@ void WS2812FX::setBrightness(uint8_t b, bool direct) {
     }
   }
   // setting brightness with NeoPixelBusLg has no effect on already painted pixels,
-  // so we need to force an update to existing buffer
+  // busses will rescale their output on next show()
   busses.setBrightness(b);
   if (!direct) {
     unsigned long t = millis();
@@ -1720,7 +2346,8 @@ void WS2812FX::printSize() {
   DEBUG_PRINTF("Segments: %d -> %uB\n", _segments.size(), size);
   DEBUG_PRINTF("Modes: %d*%d=%uB\n", sizeof(mode_ptr), _mode.size(), (_mode.capacity()*sizeof(mode_ptr)));
   DEBUG_PRINTF("Data: %d*%d=%uB\n", sizeof(const char *), _modeData.size(), (_modeData.capacity()*sizeof(const char *)));
-  DEBUG_PRINTF("Map: %d*%d=%uB\n", sizeof(uint16_t), (int)customMappingSize, customMappingSize*sizeof(uint16_t));
+  if (customMappingRuns) DEBUG_PRINTF("Map: %d*%d=%uB\n", sizeof(MappingRun), (int)customMappingRunCount+1, (customMappingRunCount+1)*sizeof(MappingRun));
+  else                   DEBUG_PRINTF("Map: %d*%d=%uB\n", sizeof(uint16_t), (int)customMappingSize, customMappingTable ? customMappingSize*sizeof(uint16_t) : 0);
   size = getLengthTotal();
   if (useGlobalLedBuffer) DEBUG_PRINTF("Buffer: %d*%u=%uB\n", sizeof(CRGB), size, size*sizeof(CRGB));
 }
@@ -1775,26 +2402,44 @@ void WS2812FX::loadCustomPalettes() {
   }
 }
 
-//load custom mapping table from JSON file (called from finalizeInit() or deserializeState())
+//load custom mapping table from binary or JSON file (called from finalizeInit() or deserializeState())
 bool WS2812FX::deserializeMap(uint8_t n) {
   // 2D support creates its own ledmap (on the fly) if a ledmap.json exists it will overwrite built one.
 
   char fileName[32];
   strcpy_P(fileName, PSTR("/ledmap"));
   if (n) sprintf(fileName +7, "%d", n);
-  strcat_P(fileName, PSTR(".json"));
-  bool isFile = WLED_FS.exists(fileName);
+  char *ext = fileName + strlen(fileName);
+  strcpy_P(ext, PSTR(".bin")); // binary ledmap takes precedence (does not need JSON buffer)
+  bool isBinary = WLED_FS.exists(fileName);
+  if (!isBinary) strcpy_P(ext, PSTR(".json"));
+  bool isFile = isBinary || WLED_FS.exists(fileName);
 
   if (!isFile) {
     // erase custom mapping if selecting nonexistent ledmap.json (n==0)
-    if (!isMatrix && !n && customMappingTable != nullptr) {
-      customMappingSize = 0;
-      delete[] customMappingTable;
-      customMappingTable = nullptr;
-    }
+    if (!isMatrix && !n) clearMapping();
     return false;
   }
 
+  if (isBinary) {
+    MapFileReader map(fileName);
+    if (!map.isValid()) return false;
+
+    DEBUG_PRINT(F("Reading LED map from "));
+    DEBUG_PRINTLN(fileName);
+
+    clearMapping(); // erase old custom ledmap
+
+    // count in file is not trusted, entries beyond the strip are never looked up
+    size_t size = MIN(map.size(), (size_t)getLengthTotal());
+    if (size) {  // not an empty map
+      customMappingTable = new uint16_t[size];
+      if (customMappingTable) customMappingSize = map.read(customMappingTable, size);
+      compressMappingTable();
+    }
+    return true;
+  }
+
   if (!requestJSONBufferLock(7)) return false;
 
   if (!readObjectFromFile(fileName, nullptr, &doc)) {
@@ -1805,12 +2450,7 @@ bool WS2812FX::deserializeMap(uint8_t n) {
   DEBUG_PRINT(F("Reading LED map from "));
   DEBUG_PRINTLN(fileName);
 
-  // erase old custom ledmap
-  if (customMappingTable != nullptr) {
-    customMappingSize = 0;
-    delete[] customMappingTable;
-    customMappingTable = nullptr;
-  }
+  clearMapping(); // erase old custom ledmap
 
   JsonArray map = doc[F("map")];
   if (!map.isNull() && map.size()) {  // not an empty map
@@ -1822,9 +2462,50 @@ bool WS2812FX::deserializeMap(uint8_t n) {
   }
 
   releaseJSONBufferLock();
+  compressMappingTable();
   return true;
 }
 
+#ifdef WLED_BENCHMARK_LEDMAP
+// loads every ledmap that exists in both formats as JSON and as binary, compares content and load time (results on debug output)
+void WS2812FX::benchmarkLedmaps(void) {
+  for (size_t n = 0; n < WLED_MAX_LEDMAPS; n++) {
+    char jsonName[32], binName[32];
+    strcpy_P(jsonName, PSTR("/ledmap"));
+    if (n) sprintf(jsonName +7, "%d", n);
+    strcpy(binName, jsonName);
+    strcat_P(jsonName, PSTR(".json"));
+    strcat_P(binName, PSTR(".bin"));
+    if (!WLED_FS.exists(jsonName) || !WLED_FS.exists(binName)) continue;
+
+    uint32_t t0 = millis();
+    uint16_t *jsonTable = nullptr;
+    size_t    jsonSize  = 0;
+    if (!requestJSONBufferLock(7)) return;
+    if (readObjectFromFile(jsonName, nullptr, &doc)) {
+      JsonArray map = doc[F("map")];
+      jsonSize  = map.size();
+      jsonTable = new uint16_t[jsonSize];
+      if (jsonTable) for (size_t i=0; i<jsonSize; i++) jsonTable[i] = (uint16_t) (map[i]<0 ? 0xFFFFU : map[i]);
+    }
+    releaseJSONBufferLock();
+    uint32_t tJson = millis() - t0;
+
+    t0 = millis();
+    MapFileReader bin(binName);
+    size_t    binSize  = MIN(bin.size(), (size_t)MAX_LEDS);
+    uint16_t *binTable = new uint16_t[binSize];
+    if (binTable) binSize = bin.read(binTable, binSize);
+    uint32_t tBin = millis() - t0;
+
+    bool same = jsonTable && binTable && jsonSize == binSize && !memcmp(jsonTable, binTable, binSize * sizeof(uint16_t));
+    DEBUGOUT.printf("Ledmap %u: %u entries, JSON %u ms, binary %u ms%s\n", n, jsonSize, tJson, tBin, same ? "" : " (content differs)");
+    delete[] jsonTable;
+    delete[] binTable;
+  }
+}
+#endif
+
 
 WS2812FX* WS2812FX::instance = nullptr;
 
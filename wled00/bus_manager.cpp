@@ -74,6 +74,40 @@ uint8_t IRAM_ATTR ColorOrderMap::getPixelColorOrder(uint16_t pix, uint8_t defaul
   return defaultColorOrder;
 }
 
+uint8_t ColorOrderMap::compile(uint16_t start, uint16_t len, ColorOrderMapEntry *runs, uint8_t maxRuns) const {
+  if (len == 0 || maxRuns == 0) return 0;
+  // run boundaries: range ends and every mapping edge falling inside the range
+  uint16_t edges[2*WLED_MAX_COLOR_ORDER_MAPPINGS+2];
+  uint8_t nEdges = 0;
+  edges[nEdges++] = 0;
+  edges[nEdges++] = len;
+  for (uint8_t m = 0; m < _count; m++) {
+    uint32_t e[2] = { _mappings[m].start, (uint32_t)_mappings[m].start + _mappings[m].len };
+    for (uint8_t k = 0; k < 2; k++) if (e[k] > start && e[k] < (uint32_t)start + len) edges[nEdges++] = e[k] - start;
+  }
+  // sort (insertion sort, at most 22 entries), duplicates produce empty intervals that are skipped below
+  for (uint8_t i = 1; i < nEdges; i++) {
+    uint16_t v = edges[i];
+    uint8_t j = i;
+    for (; j > 0 && edges[j-1] > v; j--) edges[j] = edges[j-1];
+    edges[j] = v;
+  }
+  // order of each interval (first matching mapping wins, same as getPixelColorOrder()), merge equal neighbours
+  uint8_t nRuns = 0;
+  for (uint8_t e = 0; e+1 < nEdges; e++) {
+    if (edges[e] == edges[e+1]) continue;
+    uint8_t co = getPixelColorOrder(start + edges[e], COL_ORDER_DEFAULT);
+    if (co != COL_ORDER_DEFAULT) co &= 0x0F; // W swap is taken from bus color order when used
+    if (nRuns && runs[nRuns-1].colorOrder == co) { runs[nRuns-1].len += edges[e+1] - edges[e]; continue; }
+    if (nRuns >= maxRuns) break;
+    runs[nRuns].start = edges[e];
+    runs[nRuns].len = edges[e+1] - edges[e];
+    runs[nRuns].colorOrder = co;
+    nRuns++;
+  }
+  return nRuns;
+}
+
 
 uint32_t Bus::autoWhiteCalc(uint32_t c) {
   uint8_t aWM = _autoWhiteMode;
@@ -91,20 +125,144 @@ uint32_t Bus::autoWhiteCalc(uint32_t c) {
   return RGBW32(r, g, b, w);
 }
 
+// "power units" of a single pixel as used for current estimation (brightness not included)
+uint32_t IRAM_ATTR Bus::colorPower(uint32_t c) {
+  uint8_t r = R(c), g = G(c), b = B(c);
+  if (_gPowerModel == POWER_MODEL_WS2815) return (r > g ? (r > b ? r : b) : (g > b ? g : b)) * 3; //ignore white component on WS2815 power calculation
+  return r + g + b + W(c);
+}
+
+// sum of colorPower() over all pixels, walks the whole bus
+uint32_t Bus::getPowerSum() {
+  uint32_t sum = 0;
+  for (unsigned i = 0; i < getLength(); i++) sum += colorPower(getPixelColor(i)); // always returns original or restored color without brightness scaling
+  return sum;
+}
+
+// sets count pixels from raw RGB (channels=3) or RGBW (channels=4) data, gamma is an optional lookup table
+void Bus::setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma) {
+  for (unsigned i = 0; i < count; i++, data += channels) {
+    uint8_t r = data[0], g = data[1], b = data[2], w = channels > 3 ? data[3] : 0;
+    if (gamma) { r = gamma[r]; g = gamma[g]; b = gamma[b]; w = gamma[w]; }
+    setPixelColor(pix + i, RGBW32(r, g, b, w));
+  }
+}
+
 uint8_t *Bus::allocData(size_t size) {
   if (_data) free(_data); // should not happen, but for safety
   return _data = (uint8_t *)(size>0 ? calloc(size, sizeof(uint8_t)) : nullptr);
 }
 
 
+// stores color into _data (CH = bytes per pixel)
+template<unsigned CH>
+void IRAM_ATTR BusDigital::storePixel(uint8_t *dst, uint32_t c) {
+  if (CH == 1) { dst[0] = W(c); return; }
+  dst[0] = R(c);
+  dst[1] = G(c);
+  dst[2] = B(c);
+  if (CH == 4) dst[3] = W(c);
+}
+
+// encodes pixels [from,to) from _data into NeoPixelBus, all of them use color order co
+template<unsigned CH>
+void IRAM_ATTR BusDigital::encodeRange(BusDigital *bus, uint16_t from, uint16_t to, uint8_t co) {
+  const uint8_t *src = bus->_data + from*CH;
+  const int step = bus->_reversed ? -1 : 1;
+  int pix = (bus->_reversed ? bus->_len - from - 1 : from) + bus->_skip;
+  void *busPtr = bus->_busPtr;
+  const uint8_t iType = bus->_iType;
+  for (unsigned i = from; i < to; i++, src += CH, pix += step) {
+    uint32_t c;
+    if      (CH == 4) c = RGBW32(src[0], src[1], src[2], src[3]);
+    else if (CH == 3) c = RGBW32(src[0], src[1], src[2], 0);
+    else              c = RGBW32(src[0], src[0], src[0], src[0]); // same as getPixelColor()
+    PolyBus::setPixelColor(busPtr, iType, pix, c, co);
+  }
+}
+
+// white-only chips, each IC controls 3 LEDs (G, R, B channel), same mapping as unbuffered setPixelColor()
+void IRAM_ATTR BusDigital::encodeRangeX3(BusDigital *bus, uint16_t from, uint16_t to, uint8_t co) {
+  const int len = bus->_len;
+  auto led = [&](int p) -> uint8_t {  // p is physical LED index (incl. skipped)
+    int l = p - bus->_skip;
+    if (bus->_reversed) l = len - 1 - l;
+    return (l >= 0 && l < len) ? bus->_data[l] : 0;
+  };
+  int first = bus->_reversed ? len - to : from;
+  int last  = bus->_reversed ? len - 1 - from : to - 1;
+  for (int ic = IC_INDEX_WS2812_1CH_3X(first + bus->_skip); ic <= IC_INDEX_WS2812_1CH_3X(last + bus->_skip); ic++) {
+    uint32_t c = RGBW32(led(3*ic+1), led(3*ic), led(3*ic+2), 0);
+    PolyBus::setPixelColor(bus->_busPtr, bus->_iType, ic, c, co);
+  }
+}
+
+// color order of a run (bus color order if no mapping applies, W swap always from bus color order)
+inline uint8_t BusDigital::runColorOrder(const ColorOrderMapEntry &run) const {
+  return run.colorOrder == COL_ORDER_DEFAULT ? _colorOrder : run.colorOrder | (_colorOrder & 0xF0);
+}
+
+// color order for pixel index as used by getPixelColorOrder() (relative to bus start)
+uint8_t IRAM_ATTR BusDigital::colorOrderAt(uint16_t pix) {
+  if (!_coRuns) return _colorOrder;
+  uint8_t r = _coRunHint;
+  if (pix < _coRuns[r].start || pix >= _coRuns[r].start + _coRuns[r].len) {
+    uint8_t lo = 0, hi = _coRunCount - 1; // binary search for last run starting at or before pix
+    while (lo < hi) {
+      uint8_t mid = (lo + hi + 1) / 2;
+      if (_coRuns[mid].start <= pix) lo = mid;
+      else                           hi = mid - 1;
+    }
+    _coRunHint = r = lo;
+  }
+  return runColorOrder(_coRuns[r]);
+}
+
+// compiles color order map into runs covering the bus (incl. skipped pixels), needs to be called if map changes
+void BusDigital::compileColorOrderRuns() {
+  if (_coRuns) free(_coRuns);
+  _coRuns = nullptr;
+  _coRunCount = 0;
+  _coRunHint = 0;
+  _dirty = true;
+  if (_colorOrderMap.count() == 0) return;
+  ColorOrderMapEntry runs[COL_ORDER_RUNS_MAX];
+  uint8_t n = _colorOrderMap.compile(_start, _len + _skip, runs, COL_ORDER_RUNS_MAX);
+  if (n == 0 || (n == 1 && runs[0].colorOrder == COL_ORDER_DEFAULT)) return; // no mapping applies to this bus
+  _coRuns = (ColorOrderMapEntry*) malloc(n * sizeof(ColorOrderMapEntry));
+  if (!_coRuns) { DEBUG_PRINTLN(F("Color order runs allocation failed.")); return; }
+  memcpy(_coRuns, runs, n * sizeof(ColorOrderMapEntry));
+  _coRunCount = n;
+  DEBUG_PRINTF("Bus at %u: %u color order runs.\n", _start, n);
+}
+
 BusDigital::BusDigital(BusConfig &bc, uint8_t nr, const ColorOrderMap &com)
 : Bus(bc.type, bc.start, bc.autoWhite, bc.count, bc.reversed, (bc.refreshReq || bc.type == TYPE_TM1814))
 , _skip(bc.skipAmount) //sacrificial pixels
 , _colorOrder(bc.colorOrder)
 , _colorOrderMap(com)
+, _paintBri(255)
+, _framePower(0)
+, _frameSet(nullptr)
+, _frameCount(0)
+, _framePowerModel(POWER_MODEL_NONE)
+, _frameOverlap(false)
+, _dirty(true)
+, _channels(Bus::hasWhite(bc.type) + 3*Bus::hasRGB(bc.type))
+, _coRuns(nullptr)
+, _coRunCount(0)
+, _coRunHint(0)
+, _shadow(false)
 {
+  switch (_channels) {
+    case 4:  _store = storePixel<4>; _encode = encodeRange<4>; break;
+    case 3:  _store = storePixel<3>; _encode = encodeRange<3>; break;
+    default: _store = storePixel<1>; _encode = encodeRange<1>; break;
+  }
+  if (bc.type == TYPE_WS2812_1CH_X3) _encode = encodeRangeX3;
   if (!IS_DIGITAL(bc.type) || !bc.count) return;
   if (!pinManager.allocatePin(bc.pins[0], true, PinOwner::BusDigital)) return;
+  _frameSet = (uint8_t*) calloc((bc.count + 7) / 8, 1); // without it busses are walked for power estimate
   _frequencykHz = 0U;
   _pins[0] = bc.pins[0];
   if (IS_2PIN(bc.type)) {
@@ -117,43 +275,76 @@ BusDigital::BusDigital(BusConfig &bc, uint8_t nr, const ColorOrderMap &com)
   }
   _iType = PolyBus::getI(bc.type, _pins, nr);
   if (_iType == I_NONE) return;
-  if (bc.doubleBuffer && !allocData(bc.count * (Bus::hasWhite(_type) + 3*Bus::hasRGB(_type)))) return; //warning: hardcoded channel count
+  if (bc.doubleBuffer && !allocData(bc.count * _channels)) return;
   _buffering = bc.doubleBuffer;
+  #ifdef WLED_LOSSLESS_BRIGHTNESS
+  // keep unscaled colors of unbuffered bus too (NeoPixelBus only holds brightness scaled ones)
+  if (!_buffering) _shadow = allocData(bc.count * _channels) != nullptr;
+  #endif
   uint16_t lenToCreate = bc.count;
   if (bc.type == TYPE_WS2812_1CH_X3) lenToCreate = NUM_ICS_WS2812_1CH_3X(bc.count); // only needs a third of "RGB" LEDs for NeoPixelBus
   _busPtr = PolyBus::create(_iType, _pins, lenToCreate + _skip, nr, _frequencykHz);
   _valid = (_busPtr != nullptr);
+  compileColorOrderRuns();
   DEBUG_PRINTF("%successfully inited strip %u (len %u) with type %u and pins %u,%u (itype %u)\n", _valid?"S":"Uns", nr, bc.count, bc.type, _pins[0], _pins[1], _iType);
 }
 
+// requested brightness and ABL limit are applied at output only, and only if they changed
+// NeoPixelBus holds scaled colors so without _data every LED must be repainted to the new brightness
+// canRepaint: caller sets all pixels again if every pixel was set this frame (true is returned),
+// otherwise colors are restored from NeoPixelBus (lossy, use buffering or WLED_LOSSLESS_BRIGHTNESS to avoid)
+bool BusDigital::applyOutputBrightness(bool canRepaint) {
+  uint8_t outBri = getOutputBrightness();
+  if (!_valid || outBri == _paintBri) return false;
+  uint8_t prevBri = _paintBri;
+  _paintBri = outBri;
+  _dirty = true;
+  PolyBus::setBrightness(_busPtr, _iType, outBri);
+  if (_shadow) {
+    encodeAll(); // repaint from retained colors (lossless)
+  } else if (!_buffering) {
+    if (canRepaint && frameComplete()) return true;
+    // new brightness is kept after show() so subsequent setPixelColor() calls need no further repaint
+    uint16_t hwLen = _len;
+    if (_type == TYPE_WS2812_1CH_X3) hwLen = NUM_ICS_WS2812_1CH_3X(_len); // only needs a third of "RGB" LEDs for NeoPixelBus
+    for (uint_fast16_t i = 0; i < hwLen; i++) {
+      // use 0 as color order, actual order does not matter here as we just update the channel values as-is
+      uint32_t c = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, i, 0), prevBri);
+      PolyBus::setPixelColor(_busPtr, _iType, i, c, 0);
+    }
+  }
+  return false;
+}
+
 void BusDigital::show() {
   if (!_valid) return;
+  applyOutputBrightness(false); // no-op if already applied by BusManager::setBrightnessLimit()
+  frameClear(); // power and coverage are tracked per frame
+  // LEDs latch their last color, so there is no need to encode and transmit unchanged content
+  // (unless LEDs require periodic refresh)
+  if (!_dirty && !_needsRefresh) return;
   if (_buffering) { // should be _data != nullptr, but that causes ~20% FPS drop
-    size_t channels = Bus::hasWhite(_type) + 3*Bus::hasRGB(_type);
-    for (size_t i=0; i<_len; i++) {
-      size_t offset = i*channels;
-      uint8_t co = _colorOrderMap.getPixelColorOrder(i+_start, _colorOrder);
-      uint32_t c;
-      if (_type == TYPE_WS2812_1CH_X3) { // map to correct IC, each controls 3 LEDs (_len is always a multiple of 3)
-        switch (i%3) {
-          case 0: c = RGBW32(_data[offset]  , _data[offset+1], _data[offset+2], 0); break;
-          case 1: c = RGBW32(_data[offset-1], _data[offset]  , _data[offset+1], 0); break;
-          case 2: c = RGBW32(_data[offset-2], _data[offset-1], _data[offset]  , 0); break;
-        }
-      } else {
-        c = RGBW32(_data[offset],_data[offset+1],_data[offset+2],(Bus::hasWhite(_type)?_data[offset+3]:0));
-      }
-      uint16_t pix = i;
-      if (_reversed) pix = _len - pix -1;
-      pix += _skip;
-      PolyBus::setPixelColor(_busPtr, _iType, pix, c, co);
-    }
+    encodeAll();
     #if !defined(STATUSLED) || STATUSLED>=0
-    if (_skip) PolyBus::setPixelColor(_busPtr, _iType, 0, 0, _colorOrderMap.getPixelColorOrder(_start, _colorOrder)); // paint skipped pixels black
+    if (_skip) PolyBus::setPixelColor(_busPtr, _iType, 0, 0, colorOrderAt(0)); // paint skipped pixels black
     #endif
-    for (int i=1; i<_skip; i++) PolyBus::setPixelColor(_busPtr, _iType, i, 0, _colorOrderMap.getPixelColorOrder(_start, _colorOrder)); // paint skipped pixels black
+    for (int i=1; i<_skip; i++) PolyBus::setPixelColor(_busPtr, _iType, i, 0, colorOrderAt(0)); // paint skipped pixels black
   }
   PolyBus::show(_busPtr, _iType, !_buffering); // faster if buffer consistency is not important
+  _dirty = false;
+}
+
+// encodes all pixels from _data into NeoPixelBus
+void BusDigital::encodeAll() {
+  if (!_coRuns || _type == TYPE_WS2812_1CH_X3) {
+    _encode(this, 0, _len, colorOrderAt(0));
+    return;
+  }
+  // encode run by run, color order is fixed within a run
+  for (uint8_t r = 0; r < _coRunCount && _coRuns[r].start < _len; r++) {
+    uint16_t to = _coRuns[r].start + _coRuns[r].len;
+    _encode(this, _coRuns[r].start, to < _len ? to : _len, runColorOrder(_coRuns[r]));
+  }
 }
 
 bool BusDigital::canShow() {
@@ -169,70 +360,84 @@ void BusDigital::setBrightness(uint8_t b) {
     if (_pins[0] == LED_BUILTIN || _pins[1] == LED_BUILTIN) reinit();
   }
   #endif
-  uint8_t prevBri = _bri;
-  Bus::setBrightness(b);
-  PolyBus::setBrightness(_busPtr, _iType, b);
-
-  if (_buffering) return;
-
-  // must update/repaint every LED in the NeoPixelBus buffer to the new brightness
-  // the only case where repainting is unnecessary is when all pixels are set after the brightness change but before the next show
-  // (which we can't rely on)
-  uint16_t hwLen = _len;
-  if (_type == TYPE_WS2812_1CH_X3) hwLen = NUM_ICS_WS2812_1CH_3X(_len); // only needs a third of "RGB" LEDs for NeoPixelBus
-  for (uint_fast16_t i = 0; i < hwLen; i++) {
-    // use 0 as color order, actual order does not matter here as we just update the channel values as-is
-    uint32_t c = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, i, 0),prevBri);
-    PolyBus::setPixelColor(_busPtr, _iType, i, c, 0);
-  }
+  Bus::setBrightness(b); // NeoPixelBus brightness is updated (and LEDs repainted if needed) in show()
 }
 
 //If LEDs are skipped, it is possible to use the first as a status LED.
 //TODO only show if no new show due in the next 50ms
 void BusDigital::setStatusPixel(uint32_t c) {
   if (_valid && _skip) {
-    PolyBus::setPixelColor(_busPtr, _iType, 0, c, _colorOrderMap.getPixelColorOrder(_start, _colorOrder));
+    PolyBus::setPixelColor(_busPtr, _iType, 0, c, colorOrderAt(0));
     if (canShow()) PolyBus::show(_busPtr, _iType);
   }
 }
 
 void IRAM_ATTR BusDigital::setPixelColor(uint16_t pix, uint32_t c) {
   if (!_valid) return;
+  // colors retained in _data can be read back cheaply, reading from NeoPixelBus (color order decode) costs more than it saves
+  // so without _data the bus is always shown
+  const bool stored = _buffering || _shadow;
+  // old color is only needed to find out if the bus content changed since last show()
+  bool checkOld = stored && !_dirty;
+  if (!stored) _dirty = true;
+  uint32_t cOld = checkOld ? getPixelColor(pix) : 0;
+  uint16_t lPix = pix; // pix is converted to physical index below if not buffering
   if (Bus::hasWhite(_type)) c = autoWhiteCalc(c);
   if (_cct >= 1900) c = colorBalanceFromKelvin(_cct, c); //color correction from CCT
+  framePixel(lPix, c);
   if (_buffering) { // should be _data != nullptr, but that causes ~20% FPS drop
-    size_t channels = Bus::hasWhite(_type) + 3*Bus::hasRGB(_type);
-    size_t offset = pix*channels;
-    if (Bus::hasRGB(_type)) {
-      _data[offset++] = R(c);
-      _data[offset++] = G(c);
-      _data[offset++] = B(c);
-    }
-    if (Bus::hasWhite(_type)) _data[offset] = W(c);
+    _store(_data + pix*_channels, c);
   } else {
+    if (_shadow) _store(_data + pix*_channels, c); // retain unscaled color
     if (_reversed) pix = _len - pix -1;
     pix += _skip;
-    uint8_t co = _colorOrderMap.getPixelColorOrder(pix+_start, _colorOrder);
-    if (_type == TYPE_WS2812_1CH_X3) { // map to correct IC, each controls 3 LEDs
-      uint16_t pOld = pix;
-      pix = IC_INDEX_WS2812_1CH_3X(pix);
-      uint32_t cOld = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, pix, co),_bri);
-      switch (pOld % 3) { // change only the single channel (TODO: this can cause loss because of get/set)
-        case 0: c = RGBW32(R(cOld), W(c)   , B(cOld), 0); break;
-        case 1: c = RGBW32(W(c)   , G(cOld), B(cOld), 0); break;
-        case 2: c = RGBW32(R(cOld), G(cOld), W(c)   , 0); break;
+    uint8_t co = colorOrderAt(pix);
+    if (_type == TYPE_WS2812_1CH_X3 && _shadow) {
+      _encode(this, lPix, lPix+1, co); // repaint IC from retained colors
+    } else {
+      if (_type == TYPE_WS2812_1CH_X3) { // map to correct IC, each controls 3 LEDs
+        uint16_t pOld = pix;
+        pix = IC_INDEX_WS2812_1CH_3X(pix);
+        uint32_t cIC = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, pix, co),_paintBri);
+        switch (pOld % 3) { // change only the single channel (TODO: this can cause loss because of get/set)
+          case 0: c = RGBW32(R(cIC), W(c)  , B(cIC), 0); break;
+          case 1: c = RGBW32(W(c)  , G(cIC), B(cIC), 0); break;
+          case 2: c = RGBW32(R(cIC), G(cIC), W(c)  , 0); break;
+        }
       }
+      PolyBus::setPixelColor(_busPtr, _iType, pix, c, co);
     }
-    PolyBus::setPixelColor(_busPtr, _iType, pix, c, co);
   }
+  if (checkOld && getPixelColor(lPix) != cOld) _dirty = true;
 }
 
-// returns original color if global buffering is enabled, else returns lossly restored color from bus
+// copies raw channel data straight into the buffer if no color transformation is needed
+void IRAM_ATTR BusDigital::setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma) {
+  if (!_valid) return;
+  uint8_t aWM = _gAWM != AW_GLOBAL_DISABLED ? _gAWM : _autoWhiteMode;
+  if (!_buffering || !Bus::hasRGB(_type) || channels != _channels || _cct >= 1900 || (Bus::hasWhite(_type) && aWM != RGBW_MODE_MANUAL_ONLY)) {
+    Bus::setPixelColors(pix, count, data, channels, gamma);
+    return;
+  }
+  uint8_t *dst = _data + pix*channels;
+  bool changed = false;
+  for (unsigned i = 0; i < count; i++, dst += channels) {
+    for (unsigned c = 0; c < channels; c++) {
+      uint8_t v = gamma ? gamma[*data] : *data;
+      changed |= (dst[c] != v);
+      dst[c] = v;
+      data++;
+    }
+    framePixel(pix + i, RGBW32(dst[0], dst[1], dst[2], channels > 3 ? dst[3] : 0));
+  }
+  if (changed) _dirty = true;
+}
+
+// returns original color if global buffering (or lossless brightness) is enabled, else returns lossly restored color from bus
 uint32_t BusDigital::getPixelColor(uint16_t pix) {
   if (!_valid) return 0;
-  if (_buffering) { // should be _data != nullptr, but that causes ~20% FPS drop
-    size_t channels = Bus::hasWhite(_type) + 3*Bus::hasRGB(_type);
-    size_t offset = pix*channels;
+  if (_buffering || _shadow) { // should be _data != nullptr, but that causes ~20% FPS drop
+    size_t offset = pix*_channels;
     uint32_t c;
     if (!Bus::hasRGB(_type)) {
       c = RGBW32(_data[offset], _data[offset], _data[offset], _data[offset]);
@@ -243,8 +448,8 @@ uint32_t BusDigital::getPixelColor(uint16_t pix) {
   } else {
     if (_reversed) pix = _len - pix -1;
     pix += _skip;
-    uint8_t co = _colorOrderMap.getPixelColorOrder(pix+_start, _colorOrder);
-    uint32_t c = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, (_type==TYPE_WS2812_1CH_X3) ? IC_INDEX_WS2812_1CH_3X(pix) : pix, co),_bri);
+    uint8_t co = colorOrderAt(pix);
+    uint32_t c = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, (_type==TYPE_WS2812_1CH_X3) ? IC_INDEX_WS2812_1CH_3X(pix) : pix, co),_paintBri);
     if (_type == TYPE_WS2812_1CH_X3) { // map to correct IC, each controls 3 LEDs
       uint8_t r = R(c);
       uint8_t g = _reversed ? B(c) : G(c); // should G and B be switched if _reversed?
@@ -259,6 +464,11 @@ uint32_t BusDigital::getPixelColor(uint16_t pix) {
   }
 }
 
+// power is summed while pixels are set, whole bus is only walked if pixels were missed or set more than once this frame
+uint32_t BusDigital::getPowerSum() {
+  return (frameComplete() && _framePowerModel == _gPowerModel) ? _framePower : Bus::getPowerSum();
+}
+
 uint8_t BusDigital::getPins(uint8_t* pinArray) {
   uint8_t numPins = IS_2PIN(_type) ? 2 : 1;
   for (uint8_t i = 0; i < numPins; i++) pinArray[i] = _pins[i];
@@ -269,11 +479,13 @@ void BusDigital::setColorOrder(uint8_t colorOrder) {
   // upper nibble contains W swap information
   if ((colorOrder & 0x0F) > 5) return;
   _colorOrder = colorOrder;
+  _dirty = true;
 }
 
 void BusDigital::reinit() {
   if (!_valid) return;
   PolyBus::begin(_busPtr, _iType, _pins);
+  _dirty = true;
 }
 
 void BusDigital::cleanup() {
@@ -283,6 +495,11 @@ void BusDigital::cleanup() {
   _valid = false;
   _busPtr = nullptr;
   if (_data != nullptr) freeData();
+  if (_frameSet) free(_frameSet);
+  _frameSet = nullptr;
+  if (_coRuns) free(_coRuns);
+  _coRuns = nullptr;
+  _coRunCount = 0;
   pinManager.deallocatePin(_pins[1], PinOwner::BusDigital);
   pinManager.deallocatePin(_pins[0], PinOwner::BusDigital);
 }
@@ -385,7 +602,7 @@ void BusPwm::show() {
   if (!_valid) return;
   uint8_t numPins = NUM_PWM_PINS(_type);
   for (uint8_t i = 0; i < numPins; i++) {
-    uint8_t scaled = (_data[i] * _bri) / 255;
+    uint8_t scaled = (_data[i] * getOutputBrightness()) / 255;
     if (_reversed) scaled = 255 - scaled;
     #ifdef ESP8266
     analogWrite(_pins[i], scaled);
@@ -507,7 +724,7 @@ uint32_t BusNetwork::getPixelColor(uint16_t pix) {
 void BusNetwork::show() {
   if (!_valid || !canShow()) return;
   _broadcastLock = true;
-  realtimeBroadcast(_UDPtype, _client, _len, _data, _bri, _rgbw);
+  realtimeBroadcast(_UDPtype, _client, _len, _data, getOutputBrightness(), _rgbw);
   _broadcastLock = false;
 }
 
@@ -530,17 +747,21 @@ uint32_t BusManager::memUsage(BusConfig &bc) {
   uint8_t type = bc.type;
   uint16_t len = bc.count + bc.skipAmount;
   if (type > 15 && type < 32) { // digital types
+    uint32_t shadow = 0;
+    #ifdef WLED_LOSSLESS_BRIGHTNESS
+    if (!bc.doubleBuffer) shadow = bc.count * (Bus::hasWhite(type) + 3*Bus::hasRGB(type)); // retained unscaled colors
+    #endif
     if (type == TYPE_UCS8903 || type == TYPE_UCS8904) len *= 2; // 16-bit LEDs
     #ifdef ESP8266
       if (bc.pins[0] == 3) { //8266 DMA uses 5x the mem
-        if (type > 28) return len*20; //RGBW
-        return len*15;
+        if (type > 28) return len*20 + shadow; //RGBW
+        return len*15 + shadow;
       }
-      if (type > 28) return len*4; //RGBW
-      return len*3;
+      if (type > 28) return len*4 + shadow; //RGBW
+      return len*3 + shadow;
     #else //ESP32 RMT uses double buffer?
-      if (type > 28) return len*8; //RGBW
-      return len*6;
+      if (type > 28) return len*8 + shadow; //RGBW
+      return len*6 + shadow;
     #endif
   }
   if (type > 31 && type < 48) return 5;
@@ -562,6 +783,14 @@ int BusManager::add(BusConfig &bc) {
 }
 
 //do not call this method from system context (network callback)
+void BusManager::updateColorOrderMap(const ColorOrderMap &com) {
+  memcpy(&colorOrderMap, &com, sizeof(ColorOrderMap));
+  // digital busses keep compiled runs of the map
+  for (uint8_t i = 0; i < numBusses; i++) {
+    if (IS_DIGITAL(busses[i]->getType())) static_cast<BusDigital*>(busses[i])->compileColorOrderRuns();
+  }
+}
+
 void BusManager::removeAll() {
   DEBUG_PRINTLN(F("Removing all."));
   //prevents crashes due to deleting busses while in use.
@@ -570,12 +799,54 @@ void BusManager::removeAll() {
   numBusses = 0;
 }
 
-void BusManager::show() {
+// briLimit is the (ABL) brightness limit applied to output only, painted colors are not altered
+// applies ABL limit to busses before show(), returns true if busses need all pixels set again (see BusDigital::applyOutputBrightness())
+bool BusManager::setBrightnessLimit(uint8_t briLimit, bool canRepaint) {
+  bool repaint = false;
   for (uint8_t i = 0; i < numBusses; i++) {
+    busses[i]->setBrightnessLimit(briLimit);
+    repaint |= busses[i]->applyOutputBrightness(canRepaint);
+  }
+  return repaint;
+}
+
+void BusManager::show(uint8_t briLimit) {
+  for (uint8_t i = 0; i < numBusses; i++) {
+    busses[i]->setBrightnessLimit(briLimit);
     busses[i]->show();
   }
 }
 
+#ifdef WLED_BENCHMARK_COLOR_ORDER
+// times show() of the configured busses with 0, 1 and max color order mappings (output on debug serial)
+// each timed show() starts after the previous frame has been sent, so only encoding cost is measured
+void BusManager::benchmarkColorOrder() {
+  const uint16_t len = getTotalLength();
+  if (len == 0) return;
+  const uint8_t counts[] = {0, 1, WLED_MAX_COLOR_ORDER_MAPPINGS};
+  const unsigned warmup = 5, passes = 50;
+  ColorOrderMap saved;
+  memcpy(&saved, &colorOrderMap, sizeof(ColorOrderMap));
+  for (uint8_t n : counts) {
+    ColorOrderMap com = {};
+    for (uint8_t m = 0; m < n; m++) com.add(m * (len/n), len/(2*n), (m % 5) + 1); // mapped stretches with gaps in between
+    updateColorOrderMap(com);
+    uint32_t total = 0;
+    for (unsigned p = 0; p < warmup + passes; p++) {
+      setPixelColor(0, (p & 1) ? 0x010101 : 0); // make busses dirty
+      while (!canAllShow()) yield();
+      uint32_t t0 = micros();
+      show();
+      if (p >= warmup) total += micros() - t0;
+    }
+    DEBUGOUT.printf("Color order %u mappings, %u px: show() %u us\n", n, len, total/passes);
+  }
+  updateColorOrderMap(saved);
+  setPixelColor(0, 0);
+  show();
+}
+#endif
+
 void BusManager::setStatusPixel(uint32_t c) {
   for (uint8_t i = 0; i < numBusses; i++) {
     busses[i]->setStatusPixel(c);
@@ -591,6 +862,19 @@ void IRAM_ATTR BusManager::setPixelColor(uint16_t pix, uint32_t c) {
   }
 }
 
+// writes a run of raw RGB(W) pixel data, each bus is resolved only once per run
+void BusManager::setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma) {
+  for (uint8_t i = 0; i < numBusses; i++) {
+    Bus* b = busses[i];
+    uint16_t bstart = b->getStart();
+    uint16_t bend = bstart + b->getLength();
+    uint16_t from = pix > bstart ? pix : bstart;
+    uint16_t to = pix + count < bend ? pix + count : bend;
+    if (from >= to) continue;
+    b->setPixelColors(from - bstart, to - from, data + (from - pix)*channels, channels, gamma);
+  }
+}
+
 void BusManager::setBrightness(uint8_t b) {
   for (uint8_t i = 0; i < numBusses; i++) {
     busses[i]->setBrightness(b);
@@ -638,4 +922,5 @@ uint16_t BusManager::getTotalLength() {
 // Bus static member definition
 int16_t Bus::_cct = -1;
 uint8_t Bus::_cctBlend = 0;
+uint8_t Bus::_gPowerModel = POWER_MODEL_NONE;
 uint8_t Bus::_gAWM = 255;
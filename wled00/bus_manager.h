@@ -18,6 +18,11 @@
 #define IC_INDEX_WS2812_2CH_3X(i)  ((i)*2/3)
 #define WS2812_2CH_3X_SPANS_2_ICS(i) ((i)&0x01)    // every other LED zone is on two different ICs
 
+// power models used for current estimation (see Bus::colorPower())
+#define POWER_MODEL_NONE   0 // ABL disabled, power is not summed
+#define POWER_MODEL_RGBW   1 // sum of all channels
+#define POWER_MODEL_WS2815 2 // brightest RGB channel x3, white is ignored
+
 // flag for using double buffering in BusDigital
 extern bool useGlobalLedBuffer;
 
@@ -70,6 +75,9 @@ struct BusConfig {
 
 
 // Defines an LED Strip and its color ordering.
+#define COL_ORDER_RUNS_MAX (2*WLED_MAX_COLOR_ORDER_MAPPINGS+1) // each mapping can split a run into 3
+#define COL_ORDER_DEFAULT  0xFF                              // run uses bus color order
+
 struct ColorOrderMapEntry {
   uint16_t start;
   uint16_t len;
@@ -95,6 +103,10 @@ struct ColorOrderMap {
 
     uint8_t getPixelColorOrder(uint16_t pix, uint8_t defaultColorOrder) const;
 
+    // compiles mappings into sorted, gap-free runs covering [start, start+len) (run start is relative to start)
+    // colorOrder of a run is COL_ORDER_DEFAULT if no mapping applies, returns number of runs
+    uint8_t compile(uint16_t start, uint16_t len, ColorOrderMapEntry *runs, uint8_t maxRuns) const;
+
   private:
     uint8_t _count;
     ColorOrderMapEntry _mappings[WLED_MAX_COLOR_ORDER_MAPPINGS];
@@ -107,11 +119,13 @@ class Bus {
     Bus(uint8_t type, uint16_t start, uint8_t aw, uint16_t len = 1, bool reversed = false, bool refresh = false)
     : _type(type)
     , _bri(255)
+    , _briLimit(255)
     , _start(start)
     , _len(len)
     , _reversed(reversed)
     , _valid(false)
     , _needsRefresh(refresh)
+    , _milliAmps(0)
     , _data(nullptr) // keep data access consistent across all types of buses
     {
       _autoWhiteMode = Bus::hasWhite(type) ? aw : RGBW_MODE_MANUAL_ONLY;
@@ -123,8 +137,11 @@ class Bus {
     virtual bool     canShow()                   { return true; }
     virtual void     setStatusPixel(uint32_t c)  {}
     virtual void     setPixelColor(uint16_t pix, uint32_t c) = 0;
+    virtual void     setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma);
     virtual uint32_t getPixelColor(uint16_t pix) { return 0; }
     virtual void     setBrightness(uint8_t b)    { _bri = b; };
+    virtual bool     applyOutputBrightness(bool canRepaint) { return false; } // true if caller needs to set all pixels again
+    virtual uint32_t getPowerSum();
     virtual void     cleanup() = 0;
     virtual uint8_t  getPins(uint8_t* pinArray)  { return 0; }
     virtual uint16_t getLength()                 { return _len; }
@@ -135,6 +152,9 @@ class Bus {
     inline  void     setReversed(bool reversed)  { _reversed = reversed; }
     inline  uint16_t getStart()                  { return _start; }
     inline  void     setStart(uint16_t start)    { _start = start; }
+    inline  void     setBrightnessLimit(uint8_t b) { _briLimit = b; } // ABL limit, only applied to output in show()
+    inline  void     setUsedCurrent(uint16_t mA) { _milliAmps = mA; }
+    inline  uint16_t getUsedCurrent()            { return _milliAmps; } // estimated current (mA) of last frame
     inline  uint8_t  getType()                   { return _type; }
     inline  bool     isOk()                      { return _valid; }
     inline  bool     isReversed()                { return _reversed; }
@@ -174,21 +194,27 @@ class Bus {
     inline        uint8_t getAutoWhiteMode()          { return _autoWhiteMode; }
     inline static void    setGlobalAWMode(uint8_t m)  { if (m < 5) _gAWM = m; else _gAWM = AW_GLOBAL_DISABLED; }
     inline static uint8_t getGlobalAWMode()           { return _gAWM; }
+    inline static void    setPowerModel(uint8_t m)    { _gPowerModel = m; }
+    static uint32_t colorPower(uint32_t c);
 
   protected:
     uint8_t  _type;
     uint8_t  _bri;
+    uint8_t  _briLimit;
     uint16_t _start;
     uint16_t _len;
     bool     _reversed;
     bool     _valid;
     bool     _needsRefresh;
+    uint16_t _milliAmps;
     uint8_t  _autoWhiteMode;
     uint8_t  *_data;
     static uint8_t _gAWM;
     static int16_t _cct;
     static uint8_t _cctBlend;
+    static uint8_t _gPowerModel;
 
+    inline uint8_t getOutputBrightness() { return _bri < _briLimit ? _bri : _briLimit; }
     uint32_t autoWhiteCalc(uint32_t c);
     uint8_t *allocData(size_t size = 1);
     void     freeData() { if (_data != nullptr) free(_data); _data = nullptr; }
@@ -203,16 +229,20 @@ class BusDigital : public Bus {
     void show();
     bool canShow();
     void setBrightness(uint8_t b);
+    bool applyOutputBrightness(bool canRepaint);
     void setStatusPixel(uint32_t c);
     void setPixelColor(uint16_t pix, uint32_t c);
+    void setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma);
     void setColorOrder(uint8_t colorOrder);
     uint32_t getPixelColor(uint16_t pix);
+    uint32_t getPowerSum();
     uint8_t  getColorOrder() { return _colorOrder; }
     uint8_t  getPins(uint8_t* pinArray);
     uint8_t  skippedLeds()   { return _skip; }
     uint16_t getFrequency()  { return _frequencykHz; }
     void reinit();
     void cleanup();
+    void compileColorOrderRuns();
 
   private:
     uint8_t _skip;
@@ -223,6 +253,47 @@ class BusDigital : public Bus {
     void * _busPtr;
     const ColorOrderMap &_colorOrderMap;
     bool _buffering; // temporary until we figure out why comparison "_data != nullptr" causes severe FPS drop
+    uint8_t _paintBri;    // brightness NeoPixelBus currently scales colors with
+    uint32_t _framePower;   // sum of colorPower() of pixels set since last show() (if power model is set)
+    uint8_t *_frameSet;     // bit per pixel set since last show()
+    uint16_t _frameCount;   // number of distinct pixels set since last show()
+    uint8_t _framePowerModel; // power model in effect when frame started
+    bool _frameOverlap;     // a pixel was set more than once since last show()
+    bool _dirty;            // content changed since last show()
+    uint8_t _channels;      // bytes per pixel in _data
+    ColorOrderMapEntry *_coRuns; // color order runs (pixel index as used for lookup), nullptr if no mappings
+    uint8_t _coRunCount;
+    uint8_t _coRunHint;     // last run found by colorOrderAt() (pixels are mostly set sequentially)
+
+    bool _shadow;           // _data retains unscaled colors of unbuffered bus (WLED_LOSSLESS_BRIGHTNESS)
+
+    uint8_t colorOrderAt(uint16_t pix);
+    void encodeAll();
+    // every pixel was set exactly once since last show() (i.e. by segments covering the bus), _framePower is exact
+    inline bool frameComplete() const { return _frameSet && !_frameOverlap && _frameCount == _len; }
+    inline void frameClear() {
+      if (_frameSet) memset(_frameSet, 0, (_len + 7) / 8);
+      _framePowerModel = _gPowerModel;
+      _framePower = 0;
+      _frameCount = 0;
+      _frameOverlap = false;
+    }
+    inline void framePixel(uint16_t pix, uint32_t c) { // c as stored, i.e. as returned by getPixelColor()
+      if (_gPowerModel != POWER_MODEL_NONE) _framePower += colorPower(c);
+      if (!_frameSet) return;
+      uint8_t &b = _frameSet[pix >> 3];
+      uint8_t  m = 1 << (pix & 7);
+      if (b & m) _frameOverlap = true;
+      else     { b |= m; _frameCount++; }
+    }
+    inline uint8_t runColorOrder(const ColorOrderMapEntry &run) const;
+
+    // pixel kernels specialized per channel layout, selected once in constructor
+    void (*_store)(uint8_t *dst, uint32_t c);                                 // color -> _data
+    void (*_encode)(BusDigital *bus, uint16_t from, uint16_t to, uint8_t co); // _data -> NeoPixelBus, pixels [from,to) share color order co
+    template<unsigned CH> static void storePixel(uint8_t *dst, uint32_t c);
+    template<unsigned CH> static void encodeRange(BusDigital *bus, uint16_t from, uint16_t to, uint8_t co);
+    static void encodeRangeX3(BusDigital *bus, uint16_t from, uint16_t to, uint8_t co);
 
     inline uint32_t restoreColorLossy(uint32_t c, uint8_t restoreBri) {
       if (restoreBri < 255) {
@@ -313,10 +384,12 @@ class BusManager {
     //do not call this method from system context (network callback)
     void removeAll();
 
-    void show();
+    void show(uint8_t briLimit = 255);
+    bool setBrightnessLimit(uint8_t briLimit, bool canRepaint);
     bool canAllShow();
     void setStatusPixel(uint32_t c);
     void setPixelColor(uint16_t pix, uint32_t c);
+    void setPixelColors(uint16_t pix, uint16_t count, const uint8_t *data, uint8_t channels, const uint8_t *gamma = nullptr);
     void setBrightness(uint8_t b);
     void setSegmentCCT(int16_t cct, bool allowWBCorrection = false);
     uint32_t getPixelColor(uint16_t pix);
@@ -327,9 +400,13 @@ class BusManager {
     uint16_t getTotalLength();
     inline uint8_t getNumBusses() const { return numBusses; }
 
-    inline void                 updateColorOrderMap(const ColorOrderMap &com) { memcpy(&colorOrderMap, &com, sizeof(ColorOrderMap)); }
+    void                        updateColorOrderMap(const ColorOrderMap &com);
     inline const ColorOrderMap& getColorOrderMap() const { return colorOrderMap; }
 
+    #ifdef WLED_BENCHMARK_COLOR_ORDER
+    void benchmarkColorOrder();
+    #endif
+
   private:
     uint8_t numBusses;
     Bus* busses[WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES];
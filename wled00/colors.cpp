@@ -4,6 +4,54 @@
  * Color conversion & utility methods
  */
 
+/*
+ * Packed color math
+ * channels are processed in pairs (R+B and W+G) in 16 bit lanes of a 32 bit word so one multiply scales two channels
+ * results are identical to per-channel scale8()/scale8_video()/qadd8() (checked by colorMathBenchmark())
+ */
+#define MASK_RB 0x00FF00FFU
+
+static inline uint32_t blend8_32(uint32_t c1, uint32_t c2, uint8_t blend) {
+  uint32_t inv = 255 - blend; // lane sum never exceeds 255*255
+  uint32_t rb = (((c2 & MASK_RB) * blend + (c1 & MASK_RB) * inv) >> 8) & MASK_RB;
+  uint32_t wg = ((((c2 >> 8) & MASK_RB) * blend + ((c1 >> 8) & MASK_RB) * inv)) & ~MASK_RB;
+  return rb | wg;
+}
+
+static inline uint32_t blend16_32(uint32_t c1, uint32_t c2, uint16_t blend) {
+  // 8x16 bit products need 24 bits, use 32 bit lanes of a 64 bit word
+  auto spread = [](uint32_t c) { return uint64_t(c & 0xFFU) | (uint64_t(c & 0xFF0000U) << 16); };
+  const uint64_t mask = 0x000000FF000000FFULL;
+  uint32_t inv = 0xFFFFU - blend;
+  uint64_t rb = ((spread(c2) * blend + spread(c1) * inv) >> 16) & mask;
+  uint64_t wg = ((spread(c2 >> 8) * blend + spread(c1 >> 8) * inv) >> 16) & mask;
+  return uint32_t(rb) | (uint32_t(rb >> 16)) | (uint32_t(wg) << 8) | (uint32_t(wg >> 16) << 8);
+}
+
+static inline uint32_t qadd32(uint32_t a, uint32_t b) {
+  uint32_t sum   = ((a & 0x7F7F7F7FU) + (b & 0x7F7F7F7FU)) ^ ((a ^ b) & 0x80808080U); // add without carry between channels
+  uint32_t carry = ((a & b) | ((a | b) & ~sum)) & 0x80808080U;                        // channels that overflowed
+  return sum | ((carry >> 7) * 0xFF);                                                  // saturate them
+}
+
+static inline uint32_t scale32(uint32_t c, uint8_t amount) {
+#if defined(FASTLED_SCALE8_FIXED) && FASTLED_SCALE8_FIXED == 1
+  uint32_t scale = uint32_t(amount) + 1;
+#else
+  uint32_t scale = amount;
+#endif
+  return ((((c & MASK_RB) * scale) >> 8) & MASK_RB) | ((((c >> 8) & MASK_RB) * scale) & ~MASK_RB);
+}
+
+static inline uint32_t scale32_video(uint32_t c, uint8_t amount) {
+  if (amount == 0) return 0;
+  uint32_t rb = c & MASK_RB;
+  uint32_t wg = (c >> 8) & MASK_RB;
+  rb = (((rb * amount) >> 8) & MASK_RB) + (((rb + MASK_RB) >> 8) & 0x00010001U); // +1 for each non-zero channel
+  wg = (((wg * amount) >> 8) & MASK_RB) + (((wg + MASK_RB) >> 8) & 0x00010001U);
+  return rb | (wg << 8);
+}
+
 /*
  * color blend function
  */
@@ -11,24 +59,15 @@ uint32_t color_blend(uint32_t color1, uint32_t color2, uint16_t blend, bool b16)
   if(blend == 0)   return color1;
   uint16_t blendmax = b16 ? 0xFFFF : 0xFF;
   if(blend == blendmax) return color2;
-  uint8_t shift = b16 ? 16 : 8;
-
-  uint32_t w1 = W(color1);
-  uint32_t r1 = R(color1);
-  uint32_t g1 = G(color1);
-  uint32_t b1 = B(color1);
-
-  uint32_t w2 = W(color2);
-  uint32_t r2 = R(color2);
-  uint32_t g2 = G(color2);
-  uint32_t b2 = B(color2);
-
-  uint32_t w3 = ((w2 * blend) + (w1 * (blendmax - blend))) >> shift;
-  uint32_t r3 = ((r2 * blend) + (r1 * (blendmax - blend))) >> shift;
-  uint32_t g3 = ((g2 * blend) + (g1 * (blendmax - blend))) >> shift;
-  uint32_t b3 = ((b2 * blend) + (b1 * (blendmax - blend))) >> shift;
+  return b16 ? blend16_32(color1, color2, blend) : blend8_32(color1, color2, blend);
+}
 
-  return RGBW32(r3, g3, b3, w3);
+// blends n colors of src into dst
+void color_blend(uint32_t *dst, const uint32_t *src, size_t n, uint16_t blend, bool b16) {
+  if (blend == 0) return;
+  if (blend == (b16 ? 0xFFFF : 0xFF)) { memcpy(dst, src, n * sizeof(uint32_t)); return; }
+  if (b16) for (size_t i = 0; i < n; i++) dst[i] = blend16_32(dst[i], src[i], blend);
+  else     for (size_t i = 0; i < n; i++) dst[i] = blend8_32(dst[i], src[i], blend);
 }
 
 /*
@@ -37,28 +76,25 @@ uint32_t color_blend(uint32_t color1, uint32_t color2, uint16_t blend, bool b16)
  */
 uint32_t color_add(uint32_t c1, uint32_t c2, bool fast)
 {
-  if (fast) {
-    uint8_t r = R(c1);
-    uint8_t g = G(c1);
-    uint8_t b = B(c1);
-    uint8_t w = W(c1);
-    r = qadd8(r, R(c2));
-    g = qadd8(g, G(c2));
-    b = qadd8(b, B(c2));
-    w = qadd8(w, W(c2));
-    return RGBW32(r,g,b,w);
-  } else {
-    uint32_t r = R(c1) + R(c2);
-    uint32_t g = G(c1) + G(c2);
-    uint32_t b = B(c1) + B(c2);
-    uint32_t w = W(c1) + W(c2);
-    uint16_t max = r;
-    if (g > max) max = g;
-    if (b > max) max = b;
-    if (w > max) max = w;
-    if (max < 256) return RGBW32(r, g, b, w);
-    else           return RGBW32(r * 255 / max, g * 255 / max, b * 255 / max, w * 255 / max);
-  }
+  if (fast) return qadd32(c1, c2);
+  uint32_t rb = (c1 & MASK_RB) + (c2 & MASK_RB);               // 9 bit sums, no carry into next lane
+  uint32_t wg = ((c1 >> 8) & MASK_RB) + ((c2 >> 8) & MASK_RB);
+  if (!((rb | wg) & 0x01000100U)) return rb | (wg << 8);       // no channel overflowed
+  uint32_t r = rb >> 16;
+  uint32_t g = wg & 0xFFFF;
+  uint32_t b = rb & 0xFFFF;
+  uint32_t w = wg >> 16;
+  uint16_t max = r;
+  if (g > max) max = g;
+  if (b > max) max = b;
+  if (w > max) max = w;
+  return RGBW32(r * 255 / max, g * 255 / max, b * 255 / max, w * 255 / max);
+}
+
+// adds n colors of src to dst
+void color_add(uint32_t *dst, const uint32_t *src, size_t n, bool fast) {
+  if (fast) for (size_t i = 0; i < n; i++) dst[i] = qadd32(dst[i], src[i]);
+  else      for (size_t i = 0; i < n; i++) dst[i] = color_add(dst[i], src[i], false);
 }
 
 /*
@@ -67,23 +103,91 @@ uint32_t color_add(uint32_t c1, uint32_t c2, bool fast)
  */
 uint32_t color_fade(uint32_t c1, uint8_t amount, bool video)
 {
-  uint8_t r = R(c1);
-  uint8_t g = G(c1);
-  uint8_t b = B(c1);
-  uint8_t w = W(c1);
-  if (video) {
-    r = scale8_video(r, amount);
-    g = scale8_video(g, amount);
-    b = scale8_video(b, amount);
-    w = scale8_video(w, amount);
-  } else {
-    r = scale8(r, amount);
-    g = scale8(g, amount);
-    b = scale8(b, amount);
-    w = scale8(w, amount);
+  return video ? scale32_video(c1, amount) : scale32(c1, amount);
+}
+
+// fades n colors in place
+void color_fade(uint32_t *buf, size_t n, uint8_t amount, bool video) {
+  if (video) for (size_t i = 0; i < n; i++) buf[i] = scale32_video(buf[i], amount);
+  else       for (size_t i = 0; i < n; i++) buf[i] = scale32(buf[i], amount);
+}
+
+#ifdef WLED_BENCHMARK_COLOR_MATH
+// per-channel reference implementations (as used before packed color math)
+static uint32_t color_blend_ref(uint32_t c1, uint32_t c2, uint16_t blend, bool b16) {
+  if (blend == 0) return c1;
+  uint16_t blendmax = b16 ? 0xFFFF : 0xFF;
+  if (blend == blendmax) return c2;
+  uint8_t shift = b16 ? 16 : 8;
+  uint32_t w3 = ((W(c2) * blend) + (W(c1) * (blendmax - blend))) >> shift;
+  uint32_t r3 = ((R(c2) * blend) + (R(c1) * (blendmax - blend))) >> shift;
+  uint32_t g3 = ((G(c2) * blend) + (G(c1) * (blendmax - blend))) >> shift;
+  uint32_t b3 = ((B(c2) * blend) + (B(c1) * (blendmax - blend))) >> shift;
+  return RGBW32(r3, g3, b3, w3);
+}
+
+static uint32_t color_add_ref(uint32_t c1, uint32_t c2, bool fast) {
+  if (fast) return RGBW32(qadd8(R(c1), R(c2)), qadd8(G(c1), G(c2)), qadd8(B(c1), B(c2)), qadd8(W(c1), W(c2)));
+  uint32_t r = R(c1) + R(c2);
+  uint32_t g = G(c1) + G(c2);
+  uint32_t b = B(c1) + B(c2);
+  uint32_t w = W(c1) + W(c2);
+  uint16_t max = r;
+  if (g > max) max = g;
+  if (b > max) max = b;
+  if (w > max) max = w;
+  if (max < 256) return RGBW32(r, g, b, w);
+  else           return RGBW32(r * 255 / max, g * 255 / max, b * 255 / max, w * 255 / max);
+}
+
+static uint32_t color_fade_ref(uint32_t c, uint8_t amount, bool video) {
+  if (video) return RGBW32(scale8_video(R(c), amount), scale8_video(G(c), amount), scale8_video(B(c), amount), scale8_video(W(c), amount));
+  return RGBW32(scale8(R(c), amount), scale8(G(c), amount), scale8(B(c), amount), scale8(W(c), amount));
+}
+
+// verifies packed color math against reference implementations and measures both (results on debug output)
+void colorMathBenchmark(size_t len) {
+  uint32_t *a = (uint32_t*)malloc(len * sizeof(uint32_t));
+  uint32_t *b = (uint32_t*)malloc(len * sizeof(uint32_t));
+  uint32_t *c = (uint32_t*)malloc(len * sizeof(uint32_t));
+  if (!a || !b || !c) { free(a); free(b); free(c); return; }
+  auto random32 = []() { return (uint32_t(random16()) << 16) | random16(); };
+  for (size_t i = 0; i < len; i++) { a[i] = random32(); b[i] = random32(); }
+  a[0] = 0; b[0] = 0xFFFFFFFF; // edge cases
+
+  unsigned errors = 0;
+  for (size_t i = 0; i < len; i++) {
+    uint16_t amt = random16();
+    errors += color_blend(a[i], b[i], amt & 0xFF, false) != color_blend_ref(a[i], b[i], amt & 0xFF, false);
+    errors += color_blend(a[i], b[i], amt, true)         != color_blend_ref(a[i], b[i], amt, true);
+    errors += color_add(a[i], b[i], true)                != color_add_ref(a[i], b[i], true);
+    errors += color_add(a[i], b[i], false)               != color_add_ref(a[i], b[i], false);
+    errors += color_fade(a[i], amt, false)               != color_fade_ref(a[i], amt, false);
+    errors += color_fade(a[i], amt, true)                != color_fade_ref(a[i], amt, true);
   }
-  return RGBW32(r, g, b, w);
+  DEBUGOUT.printf("Color math: %u mismatches in %u pixels\n", errors, len);
+
+  const unsigned passes = 20;
+  volatile uint32_t sink = 0;
+  uint32_t t0 = micros();
+  for (unsigned p = 0; p < passes; p++) for (size_t i = 0; i < len; i++) c[i] = color_blend_ref(a[i], b[i], p+1, true);
+  uint32_t tBlendRef = micros() - t0; t0 = micros();
+  for (unsigned p = 0; p < passes; p++) { memcpy(c, a, len * sizeof(uint32_t)); color_blend(c, b, len, p+1, true); }
+  uint32_t tBlend = micros() - t0; t0 = micros();
+  for (unsigned p = 0; p < passes; p++) for (size_t i = 0; i < len; i++) c[i] = color_add_ref(a[i], b[i], true);
+  uint32_t tAddRef = micros() - t0; t0 = micros();
+  for (unsigned p = 0; p < passes; p++) { memcpy(c, a, len * sizeof(uint32_t)); color_add(c, b, len, true); }
+  uint32_t tAdd = micros() - t0; t0 = micros();
+  for (unsigned p = 0; p < passes; p++) for (size_t i = 0; i < len; i++) c[i] = color_fade_ref(a[i], 200-p, false);
+  uint32_t tFadeRef = micros() - t0; t0 = micros();
+  for (unsigned p = 0; p < passes; p++) { memcpy(c, a, len * sizeof(uint32_t)); color_fade(c, len, 200-p, false); }
+  uint32_t tFade = micros() - t0;
+  sink = sink + c[len-1];
+  DEBUGOUT.printf("Color math %u px (us per pass, reference/packed): blend %u/%u, add %u/%u, fade %u/%u\n", len,
+    tBlendRef/passes, tBlend/passes, tAddRef/passes, tAdd/passes, tFadeRef/passes, tFade/passes);
+  free(a); free(b); free(c);
 }
+#endif
 
 void setRandomColor(byte* rgb)
 {
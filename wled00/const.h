@@ -255,7 +255,7 @@
 #define TYPE_LPD6803             54
 //Network types (master broadcast) (80-95)
 #define TYPE_NET_DDP_RGB         80            //network DDP RGB bus (master broadcast bus)
-#define TYPE_NET_E131_RGB        81            //network E131 RGB bus (master broadcast bus, unused)
+#define TYPE_NET_E131_RGB        81            //network E131 RGB bus (master broadcast bus)
 #define TYPE_NET_ARTNET_RGB      82            //network ArtNet RGB bus (master broadcast bus, unused)
 #define TYPE_NET_DDP_RGBW        88            //network DDP RGBW bus (master broadcast bus)
 
@@ -450,9 +450,32 @@
   #define JSON_BUFFER_SIZE 24576
 #endif
 
+// Number of JSON documents (global doc + additional ones allocated on demand) available to read-only requests
+#ifndef WLED_JSON_POOL_SIZE
+  #ifdef ESP8266
+    #define WLED_JSON_POOL_SIZE 1
+  #else
+    #define WLED_JSON_POOL_SIZE 3
+  #endif
+#endif
+
 //#define MIN_HEAP_SIZE (8k for AsyncWebServer)
 #define MIN_HEAP_SIZE 8192
 
+// Number of recently applied presets kept in RAM (MessagePack encoded) and their maximum size, 0 disables preset cache
+#ifndef WLED_PRESET_CACHE_SIZE
+  #ifdef ESP8266
+    #define WLED_PRESET_CACHE_SIZE 2
+  #else
+    #define WLED_PRESET_CACHE_SIZE 8
+  #endif
+#endif
+#ifdef ESP8266
+  #define PRESET_CACHE_MAX_LEN 1024
+#else
+  #define PRESET_CACHE_MAX_LEN 4096
+#endif
+
 // Maximum size of node map (list of other WLED instances)
 #ifdef ESP8266
   #define WLED_MAX_NODES 24
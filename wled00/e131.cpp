@@ -8,6 +8,168 @@
  * E1.31 handler
  */
 
+#define E131_FRAME_TIMEOUT  100  // ms after which an incomplete multi-universe frame is shown anyway
+#define E131_SYNC_TIMEOUT  4000  // ms without sync packet after which complete frames are shown immediately again
+
+// frame assembler: universes of a frame are staged in a frame slot and the frame is written to the LEDs
+// and shown at once from the loop, either when all expected universes arrived or (if sender uses them)
+// on E1.31 sync/ArtSync packet; with two slots the next frame is assembled while the previous one waits
+// for show(), universes arriving while both slots are in use are dropped
+#define FRAME_FREE       0
+#define FRAME_ASSEMBLING 1
+#define FRAME_READY      2 // complete, waiting for loop
+#define FRAME_SHOWING    3 // being written to LEDs by loop
+
+typedef struct E131FrameSlot {
+  uint32_t universes;                         // bit mask of universes staged
+  uint8_t  state;
+  uint8_t  channels;                          // 3 or 4, 0 = single color frame (single RGB/DRGB modes)
+  uint32_t color;                             // color of single color frame
+  uint16_t start[E131_MAX_UNIVERSE_COUNT];    // first LED of each staged universe
+  uint16_t count[E131_MAX_UNIVERSE_COUNT];    // LEDs in each staged universe
+  byte    *data;                              // channel data indexed by LED (frameBufLen bytes)
+} e131_frame_t;
+
+static e131_frame_t  frameSlot[2];
+static int8_t        frameAssembling = -1;  // slot being assembled
+static bool          frameWriting   = false; // universe data is being copied into assembled slot
+static byte         *frameBuf       = nullptr; // staging memory of both slots
+static size_t        frameBufLen    = 0;    // staging bytes per slot
+static uint8_t       frameExpected  = 1;    // number of universes making up a complete frame
+static unsigned long frameStart     = 0;    // time first universe of the frame arrived
+static unsigned long lastSyncPacket = 0;    // time last sync packet arrived (0 = never)
+
+// assembler state is written by the UDP callback (async_udp task on ESP32) and by handleE131Frame() in the loop
+// (the lock only guards slot state, staged data is copied outside of it)
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE frameMux = portMUX_INITIALIZER_UNLOCKED;
+#define FRAME_LOCK()   portENTER_CRITICAL(&frameMux)
+#define FRAME_UNLOCK() portEXIT_CRITICAL(&frameMux)
+#else // ESP8266 UDP callbacks do not preempt the loop
+#define FRAME_LOCK()
+#define FRAME_UNLOCK()
+#endif
+
+static inline bool syncActive() {
+  return lastSyncPacket && millis() - lastSyncPacket < E131_SYNC_TIMEOUT;
+}
+
+// hand assembled frame over to handleE131Frame() (called with FRAME_LOCK held)
+static void commitFrame() {
+  if (frameAssembling < 0 || frameWriting) return;
+  e131_frame_t &f = frameSlot[frameAssembling];
+  uint32_t all = (1UL << frameExpected) - 1;
+  for (uint32_t missing = all & ~f.universes; missing; missing &= missing - 1) e131UniDropped++;
+  e131_frame_t &other = frameSlot[frameAssembling ^ 1];
+  if (other.state == FRAME_READY) other.state = FRAME_FREE; // not shown yet, superseded by newer frame
+  f.state = FRAME_READY;
+  frameAssembling = -1;
+}
+
+// get slot to stage universe into, nullptr if universe has to be dropped
+// channels: 3/4 for LED data (needs bytes of staging memory), 0 for single color frame
+static e131_frame_t* frameUniverseBegin(uint8_t idx, uint8_t channels, size_t bytes = 0) {
+  e131_frame_t *f = nullptr;
+  FRAME_LOCK();
+  if (frameAssembling >= 0 && (frameSlot[frameAssembling].universes & (1UL << idx))) commitFrame(); // universe repeats: next frame started before previous one was complete
+  if (frameAssembling < 0) {
+    for (int i = 0; i < 2; i++) if (frameSlot[i].state == FRAME_FREE) { frameAssembling = i; break; }
+    if (frameAssembling >= 0) {
+      frameSlot[frameAssembling].state     = FRAME_ASSEMBLING;
+      frameSlot[frameAssembling].universes = 0;
+      frameStart = millis();
+    }
+  }
+  if (frameAssembling >= 0 && bytes <= frameBufLen) {
+    f = &frameSlot[frameAssembling];
+    f->channels  = channels;
+    frameWriting = true;
+  } else e131UniDropped++; // previous frames not shown yet or no staging memory (allocated by loop)
+  FRAME_UNLOCK();
+  return f;
+}
+
+static void frameUniverseDone(uint8_t idx, uint8_t expected) {
+  FRAME_LOCK();
+  if (frameWriting && frameAssembling >= 0) {
+    frameWriting  = false;
+    frameExpected = expected;
+    e131_frame_t &f = frameSlot[frameAssembling];
+    f.universes |= 1UL << idx;
+    uint32_t all = (1UL << expected) - 1;
+    if ((f.universes & all) == all && !syncActive()) commitFrame();
+  }
+  FRAME_UNLOCK();
+}
+
+// sync packet: show assembled frame now and wait for sync packets from now on
+static void frameSync() {
+  FRAME_LOCK();
+  lastSyncPacket = millis() | 1;
+  commitFrame();
+  FRAME_UNLOCK();
+}
+
+// (re)allocate staging memory for current DMX mode and LED count, released when not in realtime mode
+static void frameAllocate() {
+  size_t need = 0;
+  if (realtimeMode) switch (DMXMode) {
+    case DMX_MODE_MULTIPLE_RGB:
+    case DMX_MODE_MULTIPLE_DRGB: need = strip.getLengthTotal() * 3; break;
+    case DMX_MODE_MULTIPLE_RGBW: need = strip.getLengthTotal() * 4; break;
+  }
+  if (need == frameBufLen) return;
+  FRAME_LOCK();
+  bool busy = frameWriting;
+  if (!busy) {
+    frameBufLen = 0; // stops staging
+    frameAssembling = -1;
+    frameSlot[0].state = frameSlot[1].state = FRAME_FREE;
+  }
+  FRAME_UNLOCK();
+  if (busy) return; // try again next loop
+  free(frameBuf);
+  frameBuf = need ? (byte*)malloc(need * 2) : nullptr;
+  if (!frameBuf) { DEBUG_PRINTLN(F("E1.31 frame alloc error.")); return; }
+  frameSlot[0].data = frameBuf;
+  frameSlot[1].data = frameBuf + need;
+  FRAME_LOCK();
+  frameBufLen = need;
+  FRAME_UNLOCK();
+}
+
+// called from main loop, writes assembled frame to the LEDs and shows frames that will not complete
+// (sender stopped or sends fewer universes)
+void handleE131Frame() {
+  frameAllocate();
+  e131_frame_t *f = nullptr;
+  FRAME_LOCK();
+  if (frameAssembling >= 0 && frameSlot[frameAssembling].universes
+      && millis() - frameStart > (syncActive() ? E131_SYNC_TIMEOUT : E131_FRAME_TIMEOUT)) commitFrame();
+  for (int i = 0; i < 2; i++) if (frameSlot[i].state == FRAME_READY) {
+    f = &frameSlot[i];
+    f->state = FRAME_SHOWING;
+  }
+  FRAME_UNLOCK();
+  if (!f) return;
+
+  if (!realtimeOverride || (realtimeMode && useMainSegmentOnly)) {
+    if (f->channels) {
+      for (uint32_t u = f->universes; u; u &= u - 1) {
+        unsigned i = __builtin_ctz(u);
+        setRealtimePixels(f->start[i], f->count[i], f->data + f->start[i] * f->channels, f->channels);
+      }
+    } else {
+      for (unsigned i = 0; i < strip.getLengthTotal(); i++)
+        setRealtimePixel(i, R(f->color), G(f->color), B(f->color), W(f->color));
+    }
+    e131NewData = true;
+  }
+  FRAME_LOCK();
+  f->state = FRAME_FREE;
+  FRAME_UNLOCK();
+}
+
 //DDP protocol support, called by handleE131Packet
 //handles RGB data only
 void handleDDPPacket(e131_packet_t* p) {
@@ -18,9 +180,9 @@ void handleDDPPacket(e131_packet_t* p) {
     int sn = p->sequenceNum & 0xF;
     if (sn) {
       if (lastPushSeq > 5) {
-        if (sn > (lastPushSeq -5) && sn < lastPushSeq) return;
+        if (sn > (lastPushSeq -5) && sn < lastPushSeq) { e131UniLate++; return; }
       } else {
-        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) return;
+        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) { e131UniLate++; return; }
       }
     }
   }
@@ -36,11 +198,8 @@ void handleDDPPacket(e131_packet_t* p) {
 
   realtimeLock(realtimeTimeoutMs, REALTIME_MODE_DDP);
 
-  if (!realtimeOverride || (realtimeMode && useMainSegmentOnly)) {
-    for (uint16_t i = start; i < stop; i++) {
-      setRealtimePixel(i, data[c], data[c+1], data[c+2], ddpChannelsPerLed >3 ? data[c+3] : 0);
-      c += ddpChannelsPerLed;
-    }
+  if ((!realtimeOverride || (realtimeMode && useMainSegmentOnly)) && stop > start) {
+    setRealtimePixels(start, stop - start, &data[c], ddpChannelsPerLed);
   }
 
   bool push = p->flags & DDP_PUSH_FLAG;
@@ -64,12 +223,20 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       handleArtnetPollReply(clientIP);
       return;
     }
+    if (p->art_opcode == ARTNET_OPCODE_OPSYNC) {
+      frameSync();
+      return;
+    }
     uni = p->art_universe;
     dmxChannels = htons(p->art_length);
     e131_data = p->art_data;
     seq = p->art_sequence_number;
     mde = REALTIME_MODE_ARTNET;
   } else if (protocol == P_E131) {
+    if (htonl(p->root_vector) == E131_VECTOR_ROOT_EXTENDED) { // synchronization packet (E1.31: 6.3)
+      frameSync();
+      return;
+    }
     // Ignore PREVIEW data (E1.31: 6.2.6)
     if ((p->options & 0x80) != 0) return;
     dmxChannels = htons(p->property_value_count) - 1;
@@ -104,10 +271,12 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
 
   uint8_t previousUniverses = uni - e131Universe;
 
-  if (e131SkipOutOfSequence)
-    if (seq < e131LastSequenceNumber[previousUniverses] && seq > 20 && e131LastSequenceNumber[previousUniverses] < 250){
+  byte lastSeq = e131LastSequenceNumber[previousUniverses];
+  if (seq < lastSeq && seq > 20 && lastSeq < 250) {
+    e131UniLate++;
+    if (e131SkipOutOfSequence) {
       DEBUG_PRINT(F("skipping E1.31 frame (last seq="));
-      DEBUG_PRINT(e131LastSequenceNumber[previousUniverses]);
+      DEBUG_PRINT(lastSeq);
       DEBUG_PRINT(F(", current seq="));
       DEBUG_PRINT(seq);
       DEBUG_PRINT(F(", universe="));
@@ -115,7 +284,11 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       DEBUG_PRINTLN(")");
       return;
     }
+  } else if (seq && lastSeq && seq != (byte)(lastSeq + 1)) {
+    e131UniOoo++; // packets in between were lost or reordered (sequence 0 means sequencing is disabled)
+  }
   e131LastSequenceNumber[previousUniverses] = seq;
+  uint8_t expectedUniverses = 1;
 
   // update status info
   realtimeIP = clientIP;
@@ -151,8 +324,9 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       if (realtimeOverride && !(realtimeMode && useMainSegmentOnly)) return;
 
       wChannel = (availDMXLen > 3) ? e131_data[dataOffset+3] : 0;
-      for (uint16_t i = 0; i < totalLen; i++)
-        setRealtimePixel(i, e131_data[dataOffset+0], e131_data[dataOffset+1], e131_data[dataOffset+2], wChannel);
+      if (e131_frame_t *f = frameUniverseBegin(0, 0)) {
+        f->color = RGBW32(e131_data[dataOffset+0], e131_data[dataOffset+1], e131_data[dataOffset+2], wChannel);
+      }
       break;
 
     case DMX_MODE_SINGLE_DRGB:  // 4 channel: [Dimmer,R,G,B]
@@ -168,8 +342,9 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
         strip.setBrightness(bri, true);
       }
 
-      for (uint16_t i = 0; i < totalLen; i++)
-        setRealtimePixel(i, e131_data[dataOffset+1], e131_data[dataOffset+2], e131_data[dataOffset+3], wChannel);
+      if (e131_frame_t *f = frameUniverseBegin(0, 0)) {
+        f->color = RGBW32(e131_data[dataOffset+1], e131_data[dataOffset+2], e131_data[dataOffset+3], wChannel);
+      }
       break;
 
     case DMX_MODE_PRESET:       // 2 channel: [Dimmer,Preset]
@@ -269,6 +444,14 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
         uint8_t stripBrightness = bri;
         uint16_t previousLeds, dmxOffset, ledsTotal;
 
+        // number of universes needed for all LEDs (a frame is complete once all of them arrived)
+        {
+          const uint16_t dimmerOffset = (DMXMode == DMX_MODE_MULTIPLE_DRGB) ? 1 : 0;
+          const uint16_t ledsInFirstUniverse = (((MAX_CHANNELS_PER_UNIVERSE - DMXAddress) + dmxLenOffset) - dimmerOffset) / dmxChannelsPerLed;
+          if (totalLen > ledsInFirstUniverse) expectedUniverses += (totalLen - ledsInFirstUniverse + ledsPerUniverse - 1) / ledsPerUniverse;
+          if (expectedUniverses > E131_MAX_UNIVERSE_COUNT) expectedUniverses = E131_MAX_UNIVERSE_COUNT;
+        }
+
         if (previousUniverses == 0) {
           if (availDMXLen < 1) return;
           dmxOffset = dataOffset;
@@ -308,17 +491,12 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
           }
         }
 
-        if (!is4Chan) {
-          for (uint16_t i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], 0);
-            dmxOffset+=3;
-          }
-        } else {
-          for (uint16_t i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], e131_data[dmxOffset+3]);
-            dmxOffset+=4;
-          }
-        }
+        // staged in frame slot, written to LEDs by handleE131Frame()
+        e131_frame_t *f = frameUniverseBegin(previousUniverses, dmxChannelsPerLed, ledsTotal * dmxChannelsPerLed);
+        if (!f) return;
+        f->start[previousUniverses] = previousLeds;
+        f->count[previousUniverses] = ledsTotal > previousLeds ? ledsTotal - previousLeds : 0;
+        memcpy(f->data + previousLeds * dmxChannelsPerLed, &e131_data[dmxOffset], f->count[previousUniverses] * dmxChannelsPerLed);
         break;
       }
     default:
@@ -327,7 +505,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       break;
   }
 
-  e131NewData = true;
+  frameUniverseDone(previousUniverses, expectedUniverses);
 }
 
 void handleArtnetPollReply(IPAddress ipAddress) {
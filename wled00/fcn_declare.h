@@ -57,6 +57,7 @@ class NeoGammaWLEDMethod {
     static uint32_t Correct32(uint32_t color);  // apply Gamma to RGBW32 color (WLED specific, not used by NPB)
     static void calcGammaTable(float gamma);    // re-calculates & fills gamma table
     static inline uint8_t rawGamma8(uint8_t val) { return gammaT[val]; }  // get value from Gamma table (WLED specific, not used by NPB)
+    static inline const uint8_t* getTable() { return gammaT; }             // direct access to Gamma table for bulk operations
   private:
     static uint8_t gammaT[];
 };
@@ -65,6 +66,12 @@ class NeoGammaWLEDMethod {
 uint32_t color_blend(uint32_t,uint32_t,uint16_t,bool b16=false);
 uint32_t color_add(uint32_t,uint32_t, bool fast=false);
 uint32_t color_fade(uint32_t c1, uint8_t amount, bool video=false);
+void color_blend(uint32_t *dst, const uint32_t *src, size_t n, uint16_t blend, bool b16=false); // dst[i] = color_blend(dst[i], src[i], ...)
+void color_add(uint32_t *dst, const uint32_t *src, size_t n, bool fast=false);                  // dst[i] = color_add(dst[i], src[i], ...)
+void color_fade(uint32_t *buf, size_t n, uint8_t amount, bool video=false);                     // buf[i] = color_fade(buf[i], ...)
+#ifdef WLED_BENCHMARK_COLOR_MATH
+void colorMathBenchmark(size_t len = 1024);
+#endif
 inline uint32_t colorFromRgbw(byte* rgbw) { return uint32_t((byte(rgbw[3]) << 24) | (byte(rgbw[0]) << 16) | (byte(rgbw[1]) << 8) | (byte(rgbw[2]))); }
 void colorHStoRGB(uint16_t hue, byte sat, byte* rgb); //hue, sat to rgb
 void colorKtoRGB(uint16_t kelvin, byte* rgb);
@@ -83,6 +90,7 @@ void handleDMX();
 
 //e131.cpp
 void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol);
+void handleE131Frame();
 void handleArtnetPollReply(IPAddress ipAddress);
 void prepareArtnetPollReply(ArtPollReply* reply);
 void sendArtnetPollReply(ArtPollReply* reply, IPAddress ipAddress, uint16_t portAddress);
@@ -93,6 +101,26 @@ bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* conte
 bool writeObjectToFile(const char* file, const char* key, JsonDocument* content);
 bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest);
 bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest);
+void invalidateObjectIndex(const char* file);
+bool compactObjectFile(const char* file);
+// binary ledmap/gap file, entries are streamed into caller's table
+class MapFileReader {
+  public:
+    MapFileReader(const char *fileName);
+    ~MapFileReader() { _file.close(); }
+    bool     isValid() const { return _valid; }
+    size_t   size() const { return _count; }             // number of entries
+    bool     getName(char *dest, size_t len);            // name stored in file (if any)
+    size_t   read(uint16_t *dest, size_t maxCount);      // returns number of entries read
+    size_t   read(int8_t *dest, size_t maxCount);        // gap values (-1, 0, 1)
+  private:
+    File     _file;
+    uint32_t _count    = 0;
+    uint8_t  _encoding = 0;
+    uint8_t  _nameLen  = 0;
+    bool     _valid    = false;
+    template<typename T> size_t decode(T *dest, size_t maxCount);
+};
 void updateFSInfo();
 void closeFile();
 
@@ -144,13 +172,53 @@ void handleIR();
 #include "FX.h"
 
 bool deserializeSegment(JsonObject elem, byte it, byte presetId = 0);
-bool deserializeState(JsonObject root, byte callMode = CALL_MODE_DIRECT_CHANGE, byte presetId = 0);
+bool deserializeState(JsonObject root, byte callMode = CALL_MODE_DIRECT_CHANGE, byte presetId = 0, bool *applied = nullptr); // applied false: state lock timed out, nothing changed
 void serializeSegment(JsonObject& root, Segment& seg, byte id, bool forPreset = false, bool segmentBounds = true);
 void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true, bool selectedSegmentsOnly = false);
 void serializeInfo(JsonObject root);
 void serializeModeNames(JsonArray root);
 void serializeModeData(JsonArray root);
 void serveJson(AsyncWebServerRequest* request);
+#define JSON_PATH_STATE      1
+#define JSON_PATH_INFO       2
+#define JSON_PATH_STATE_INFO 3
+#define JSON_PATH_NODES      4
+#define JSON_PATH_PALETTES   5
+#define JSON_PATH_FXDATA     6
+#define JSON_PATH_NETWORKS   7
+#define JSON_PATH_EFFECTS    8
+// generates JSON response (state, info, effects or all of them) in small pieces without building a document of it
+// pieces are filled into one reused piece document and serialized straight into the send buffer if they fit
+class JsonStreamer {
+  public:
+    JsonStreamer(byte subJson, bool measureOnly = false); // measureOnly: output is discarded (no side effects)
+    ~JsonStreamer();
+    JsonStreamer(const JsonStreamer&) = delete;
+    JsonStreamer& operator=(const JsonStreamer&) = delete;
+    static bool canStream(byte subJson);
+    bool   begin();                            // generates first piece before anything is sent, false if it failed
+    size_t read(uint8_t *buf, size_t maxLen); // copies next part of response into buf, returns 0 when finished
+    inline bool failed() const { return _failed; } // a piece could not be generated, output is incomplete
+  private:
+    const uint8_t *_program;      // sequence of pieces to generate
+    uint8_t        _step  = 0;
+    uint16_t       _item  = 0;    // segment or effect being generated
+    uint16_t       _count = 0;    // items already generated (for separators)
+    DynamicJsonDocument *_doc = nullptr; // piece document (reused, grown if a piece does not fit)
+    char          *_buf   = nullptr; // piece that did not fit into send buffer (reused)
+    size_t         _bufSize = 0;
+    const char    *_pgm   = nullptr; // piece is a PROGMEM string (else it is in _buf)
+    const char    *_prefix = nullptr; // PROGMEM string written before next document piece
+    uint8_t        _trim  = 0;    // chars of document piece not written (at its end)
+    size_t         _len   = 0;
+    size_t         _pos   = 0;
+    bool           _measureOnly;
+    bool           _failed = false;
+    bool next(char *dst, size_t room, size_t &direct);
+    bool emitDoc(char *dst, size_t room, size_t &direct);
+    bool reserveBuf(size_t size);
+    template<typename Fill> bool fillDoc(size_t &size, Fill fill);
+};
 #ifdef WLED_ENABLE_JSONLIVE
 bool serveLiveLeds(AsyncWebServerRequest* request, uint32_t wsClient = 0);
 #endif
@@ -177,9 +245,14 @@ bool parseLx(int lxValue, byte* rgbw);
 void parseLxJson(int lxValue, byte segId, bool secondary);
 #endif
 
+//msgpack.cpp
+size_t serializeStateInfoMsgPack(Print *out, bool state = true, bool info = true);
+size_t serializeStateInfoMsgPack(uint8_t *buf, size_t len, bool state = true, bool info = true);
+
 //mqtt.cpp
 bool initMqtt();
 void publishMqtt();
+void handleMqtt();
 
 //ntp.cpp
 void handleTime();
@@ -216,6 +289,7 @@ inline bool applyTemporaryPreset() {return applyPreset(255);};
 void savePreset(byte index, const char* pname = nullptr, JsonObject saveobj = JsonObject());
 inline void saveTemporaryPreset() {savePreset(255);};
 void deletePreset(byte index);
+void invalidatePresetCache(byte index = 0); // 0 invalidates all presets
 bool getPresetName(byte index, String& name);
 
 //remote.cpp
@@ -233,6 +307,7 @@ void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC);
 void exitRealtime();
 void handleNotifications();
 void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w);
+void setRealtimePixels(uint16_t start, uint16_t count, const byte *data, uint8_t channels);
 void refreshNodeList();
 void sendSysInfoUDP();
 
@@ -345,8 +420,12 @@ void sappend(char stype, const char* key, int val);
 void sappends(char stype, const char* key, char* val);
 void prepareHostname(char* hostname);
 bool isAsterisksOnly(const char* str, byte maxLen);
-bool requestJSONBufferLock(uint8_t module=255);
+bool requestJSONBufferLock(uint8_t module=255, unsigned long timeout=1000);
 void releaseJSONBufferLock();
+JsonDocument* acquireJsonDoc(uint8_t module=255); // for read-only (serialization) use, waits for global doc only if pool is exhausted
+void releaseJsonDoc(JsonDocument* d);
+bool requestStateLock(uint8_t module=255, unsigned long timeout=1000); // segments and busses do not change while held
+void releaseStateLock();
 uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen);
 uint8_t extractModeSlider(uint8_t mode, uint8_t slider, char *dest, uint8_t maxLen, uint8_t *var = nullptr);
 int16_t extractModeDefaults(uint8_t mode, const char *segVar);
@@ -372,6 +451,18 @@ class JSONBufferGuard {
     inline void release() { if (holding_lock) releaseJSONBufferLock(); holding_lock = false; }
 };
 
+// RAII guard class for the state lock (taken after JSON buffer lock if both are needed)
+class StateLockGuard {
+  bool holding_lock;
+  public:
+    inline StateLockGuard(uint8_t module=255) : holding_lock(requestStateLock(module)) {};
+    inline ~StateLockGuard() { if (holding_lock) releaseStateLock(); };
+    inline StateLockGuard(const StateLockGuard&) = delete; // Noncopyable
+    inline StateLockGuard& operator=(const StateLockGuard&) = delete;
+    inline bool owns_lock() const { return holding_lock; }
+    explicit inline operator bool() const { return owns_lock(); };
+};
+
 #ifdef WLED_ADD_EEPROM_SUPPORT
 //wled_eeprom.cpp
 void applyMacro(byte index);
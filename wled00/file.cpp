@@ -176,6 +176,260 @@ static void writeSpace(size_t l)
   if (knownLargestSpace < l) knownLargestSpace = l;
 }
 
+/*
+ * Offset index of files written by writeObjectToFileUsingId() (i.e. presets.json -> presets.idx)
+ * Holds key position, value position and length of each object so reads and writes by id do not need to scan the file.
+ * Writes never move other objects (they are overwritten with spaces or appended) so only the written entry changes.
+ * Index is rebuilt by a single scan whenever the file size does not match (i.e. file was uploaded or edited).
+ */
+#define OBJ_INDEX_MAGIC      0x32444957U // "WID2"
+#define OBJ_INDEX_ENTRIES    256         // ids 0-255
+#define FS_COMPACT_MIN_HOLES 4096        // compact file if whitespace holes exceed this and a quarter of file size
+
+struct ObjIndexHeader {
+  uint32_t magic;
+  uint32_t fileSize;
+};
+
+struct ObjIndexEntry {
+  uint32_t keyPos; // position of key ('"')
+  uint32_t pos;    // position of value object ('{'), 0 if no object with that id
+  uint32_t len;    // length of value object
+};
+
+static uint32_t lastObjectKeyPos = 0, lastObjectPos = 0, lastObjectLen = 0; // object written by last writeObject() call
+
+static bool getIndexName(const char *file, char *idxName, size_t len) {
+  size_t l = strlen(file);
+  if (l < 6 || l >= len || strcmp_P(file + l - 5, PSTR(".json"))) return false;
+  strcpy(idxName, file);
+  strcpy_P(idxName + l - 5, PSTR(".idx"));
+  return true;
+}
+
+//walks root level objects of JSON object file calling cb(key, keyPos, valuePos, valueLen) for each object value
+//returns false if file is not a well formed JSON object
+template<typename Callback>
+static bool scanRootObjects(File &src, Callback cb) {
+  byte buf[FS_BUFSIZE];
+  char key[8] = "";
+  size_t keyLen = 0, keyPos = 0, valuePos = 0, pos = 0;
+  unsigned depth = 0;
+  bool inString = false, escape = false, inKey = false, expectKey = false;
+
+  src.seek(0);
+  while (size_t bufsize = src.read(buf, FS_BUFSIZE)) {
+    for (size_t count = 0; count < bufsize; count++, pos++) {
+      char c = buf[count];
+      if (inString) {
+        if (escape)         escape = false;
+        else if (c == '\\') escape = true;
+        else if (c == '"')  { inString = false; if (inKey) { inKey = false; key[keyLen] = '\0'; } }
+        else if (inKey && keyLen < sizeof(key)-1) key[keyLen++] = c;
+        continue;
+      }
+      switch (c) {
+        case '"':
+          inString = true;
+          if (depth == 1 && expectKey) { inKey = true; expectKey = false; keyLen = 0; keyPos = pos; }
+          break;
+        case ',':
+          if (depth == 1) expectKey = true;
+          break;
+        case '{': case '[':
+          if (depth == 1) valuePos = pos;
+          if (depth++ == 0) expectKey = true;
+          break;
+        case '}': case ']':
+          if (depth == 0) return false;
+          if (--depth == 1 && c == '}') cb(key, keyPos, valuePos, pos + 1 - valuePos);
+          break;
+      }
+    }
+  }
+  return depth == 0 && !inString && pos > 0;
+}
+
+void invalidateObjectIndex(const char* file) {
+  char idxName[33];
+  if (getIndexName(file, idxName, sizeof(idxName)) && WLED_FS.exists(idxName)) WLED_FS.remove(idxName);
+}
+
+static bool rebuildObjectIndex(const char *file) {
+  char idxName[33];
+  if (!getIndexName(file, idxName, sizeof(idxName))) return false;
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTF("Rebuild index %s\n", idxName);
+    uint32_t s = millis();
+  #endif
+  File src = WLED_FS.open(file, "r");
+  if (!src) { invalidateObjectIndex(file); return false; }
+  File idx = WLED_FS.open(idxName, "w");
+  if (!idx) { src.close(); return false; }
+
+  ObjIndexHeader hdr = {0, (uint32_t)src.size()}; // magic is written last so an interrupted rebuild is detected
+  idx.write((const uint8_t*)&hdr, sizeof(hdr));
+  byte zero[FS_BUFSIZE] = {0};
+  for (size_t l = OBJ_INDEX_ENTRIES * sizeof(ObjIndexEntry); l > 0; ) {
+    size_t block = (l>FS_BUFSIZE) ? FS_BUFSIZE : l;
+    idx.write(zero, block);
+    l -= block;
+  }
+  bool valid = src.size() == 0 || scanRootObjects(src, [&](const char *key, size_t keyPos, size_t valuePos, size_t valueLen) {
+    char *end;
+    unsigned long id = strtoul(key, &end, 10);
+    if (!key[0] || *end || id >= OBJ_INDEX_ENTRIES) return; // not an id
+    ObjIndexEntry e = {(uint32_t)keyPos, (uint32_t)valuePos, (uint32_t)valueLen};
+    idx.seek(sizeof(hdr) + id * sizeof(e));
+    idx.write((const uint8_t*)&e, sizeof(e));
+  });
+  src.close();
+  if (valid) {
+    hdr.magic = OBJ_INDEX_MAGIC;
+    idx.seek(0);
+    idx.write((const uint8_t*)&hdr, sizeof(hdr));
+  }
+  idx.close();
+  DEBUGFS_PRINTF("Index %s, took %d ms\n", valid ? "built" : "invalid", millis() - s);
+  return valid;
+}
+
+//reads index entry of object id, rebuilds index if it does not match file size (rebuilt is set in that case)
+static bool lookupObjectIndex(const char *file, size_t fileSize, uint16_t id, ObjIndexEntry &e, bool &rebuilt) {
+  char idxName[33];
+  rebuilt = false;
+  if (id >= OBJ_INDEX_ENTRIES || !getIndexName(file, idxName, sizeof(idxName))) return false;
+  ObjIndexHeader hdr = {0, 0};
+  for (int attempt = 0; attempt < 2; attempt++) {
+    File idx = WLED_FS.open(idxName, "r");
+    if (idx && idx.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == OBJ_INDEX_MAGIC && hdr.fileSize == fileSize) {
+      idx.seek(sizeof(hdr) + id * sizeof(e));
+      bool ok = idx.read((uint8_t*)&e, sizeof(e)) == sizeof(e);
+      idx.close();
+      return ok;
+    }
+    if (idx) idx.close();
+    if (attempt || !rebuildObjectIndex(file)) break;
+    rebuilt = true;
+  }
+  return false;
+}
+
+//stores position of last written object into index
+static void updateObjectIndex(const char *file, uint16_t id, size_t fileSize) {
+  char idxName[33];
+  if (id >= OBJ_INDEX_ENTRIES || !getIndexName(file, idxName, sizeof(idxName))) return;
+  File idx = WLED_FS.open(idxName, "r+");
+  if (!idx) return; // will be built on next lookup
+  ObjIndexHeader hdr;
+  if (idx.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != OBJ_INDEX_MAGIC) {
+    idx.close();
+    WLED_FS.remove(idxName);
+    return;
+  }
+  ObjIndexEntry e = {lastObjectKeyPos, lastObjectPos, lastObjectLen};
+  idx.seek(sizeof(hdr) + id * sizeof(e));
+  idx.write((const uint8_t*)&e, sizeof(e));
+  hdr.fileSize = fileSize;
+  idx.seek(0);
+  idx.write((const uint8_t*)&hdr, sizeof(hdr));
+  idx.close();
+}
+
+//bytes of file not occupied by indexed objects (whitespace holes left by deleting or moving objects)
+static size_t objectFileHoles(const char *file) {
+  char idxName[33];
+  if (!getIndexName(file, idxName, sizeof(idxName))) return 0;
+  File idx = WLED_FS.open(idxName, "r");
+  if (!idx) return 0;
+  ObjIndexHeader hdr;
+  size_t used = 2; // enclosing {}
+  if (idx.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != OBJ_INDEX_MAGIC) { idx.close(); return 0; }
+  ObjIndexEntry e;
+  for (unsigned id = 0; id < OBJ_INDEX_ENTRIES && idx.read((uint8_t*)&e, sizeof(e)) == sizeof(e); id++) {
+    if (e.pos) used += e.pos + e.len - e.keyPos + 1; // "id": {...} and separating ,
+  }
+  idx.close();
+  return hdr.fileSize > used ? hdr.fileSize - used : 0;
+}
+
+//positions f right after key of object with key (and id if >= 0) like bufferedFind(), uses index if available
+static bool findObject(const char *file, const char *key, int id) {
+  ObjIndexEntry e;
+  bool rebuilt;
+  if (id >= 0 && lookupObjectIndex(file, f.size(), id, e, rebuilt)) {
+    if (!e.pos) return false; // no such object
+    char buf[10];
+    size_t keyLen = strlen(key);
+    bool match = keyLen < sizeof(buf) && e.keyPos + keyLen <= e.pos;
+    if (match) {
+      f.seek(e.keyPos);
+      match = f.read((uint8_t*)buf, keyLen) == keyLen && !memcmp(buf, key, keyLen);
+    }
+    for (size_t p = e.keyPos + keyLen; match && p < e.pos; p++) match = isspace(f.read()); // whitespace before value
+    if (match) { f.seek(e.keyPos + keyLen); return true; }
+    // a freshly built index can not be stale, key is just not in the form bufferedFind() looks for
+    if (!rebuilt) {
+      DEBUGFS_PRINTLN(F("Stale index."));
+      invalidateObjectIndex(file);
+    }
+  }
+  return bufferedFind(key);
+}
+
+//rewrites file without whitespace holes (keeping object order) and rebuilds its index
+bool compactObjectFile(const char* file)
+{
+  if (doCloseFile) closeFile();
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTF("Compact %s\n", file);
+    uint32_t s = millis();
+  #endif
+  const char *tmpName = "/compact.tmp";
+  File src = WLED_FS.open(file, "r");
+  if (!src) return false;
+  updateFSInfo();
+  if (src.size() + FS_BUFSIZE > fsBytesTotal - fsBytesUsed) { src.close(); return false; } // not enough space for a copy
+  File rd  = WLED_FS.open(file, "r"); // scanRootObjects() reads src sequentially
+  File dst = WLED_FS.open(tmpName, "w");
+  if (!rd || !dst) { src.close(); rd.close(); dst.close(); WLED_FS.remove(tmpName); return false; }
+
+  byte buf[FS_BUFSIZE];
+  bool first = true;
+  dst.write('{');
+  bool valid = scanRootObjects(src, [&](const char *key, size_t keyPos, size_t valuePos, size_t valueLen) {
+    if (!first) dst.write(',');
+    first = false;
+    rd.seek(keyPos);
+    for (size_t l = valuePos + valueLen - keyPos; l > 0; ) {
+      size_t block = rd.read(buf, (l>FS_BUFSIZE) ? FS_BUFSIZE : l);
+      if (!block) break;
+      dst.write(buf, block);
+      l -= block;
+    }
+  });
+  dst.write('}');
+  src.close();
+  rd.close();
+  dst.close();
+  if (!valid) { // do not risk losing data
+    WLED_FS.remove(tmpName);
+    DEBUGFS_PRINTLN(F("Not a JSON object, not compacted."));
+    return false;
+  }
+  // rename replaces file in one step, original stays intact if interrupted before
+  if (!WLED_FS.rename(tmpName, file)) {
+    WLED_FS.remove(tmpName);
+    DEBUGFS_PRINTLN(F("Rename failed, not compacted."));
+    return false;
+  }
+  knownLargestSpace = MAX_SPACE;
+  rebuildObjectIndex(file);
+  updateFSInfo();
+  DEBUGFS_PRINTF("Compacted, took %d ms\n", millis() - s);
+  return true;
+}
+
 bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint32_t contentLen = 0)
 {
   #ifdef WLED_DEBUG_FS
@@ -201,7 +455,10 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   DEBUGFS_PRINTF("CLen %d\n", contentLen);
   if (bufferedFindSpace(contentLen + strlen(key) + 1)) {
     if (f.position() > 2) f.write(','); //add comma if not first object
+    lastObjectKeyPos = f.position();
     f.print(key);
+    lastObjectPos = f.position();
+    lastObjectLen = contentLen;
     serializeJson(*content, f);
     DEBUGFS_PRINTF("Inserted, took %d ms (total %d)", millis() - s1, millis() - s);
     doCloseFile = true;
@@ -244,9 +501,12 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
     f.print('{'); //start JSON
   }
 
+  lastObjectKeyPos = f.position();
   f.print(key);
 
   //Append object
+  lastObjectPos = f.position();
+  lastObjectLen = contentLen;
   serializeJson(*content, f);
   f.write('}');
 
@@ -255,14 +515,8 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   return true;
 }
 
-bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content)
-{
-  char objKey[10];
-  sprintf(objKey, "\"%d\":", id);
-  return writeObjectToFile(file, objKey, content);
-}
-
-bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
+//writes (or deletes if content is null) object with key, id >= 0 allows use of offset index
+static bool writeObject(const char* file, const char* key, int id, JsonDocument* content)
 {
   uint32_t s = 0; //timing
   #ifdef WLED_DEBUG_FS
@@ -271,6 +525,8 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
     s = millis();
   #endif
 
+  if (doCloseFile) closeFile();
+  lastObjectKeyPos = lastObjectPos = lastObjectLen = 0;
   size_t pos = 0;
   f = WLED_FS.open(file, "r+");
   if (!f && !WLED_FS.exists(file)) f = WLED_FS.open(file, "w+");
@@ -279,9 +535,12 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
     return false;
   }
 
-  if (!bufferedFind(key)) //key does not exist in file
+  size_t contentLen = 0;
+  if (!content->isNull()) contentLen = measureJson(*content);
+
+  if (!findObject(file, key, id)) //key does not exist in file
   {
-    return appendObjectToFile(key, content, s);
+    return appendObjectToFile(key, content, s, contentLen);
   }
 
   //an object with this key already exists, replace or delete it
@@ -299,18 +558,17 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   //3. The new content is larger than the old, but smaller than old + trailing spaces, overwrite with new
   //4. The new content is larger than old + trailing spaces, delete old and append
 
-  size_t contentLen = 0;
-  if (!content->isNull()) contentLen = measureJson(*content);
-
   if (contentLen && contentLen <= oldLen) { //replace and fill diff with spaces
     DEBUGFS_PRINTLN(F("replace"));
     f.seek(pos);
     serializeJson(*content, f);
     writeSpace(pos2 - f.position());
+    lastObjectKeyPos = pos - strlen(key); lastObjectPos = pos; lastObjectLen = contentLen;
   } else if (contentLen && bufferedFindSpace(contentLen - oldLen, false)) { //enough leading spaces to replace
     DEBUGFS_PRINTLN(F("replace (trailing)"));
     f.seek(pos);
     serializeJson(*content, f);
+    lastObjectKeyPos = pos - strlen(key); lastObjectPos = pos; lastObjectLen = contentLen;
   } else {
     DEBUGFS_PRINTLN(F("delete"));
     pos -= strlen(key);
@@ -325,15 +583,36 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   return true;
 }
 
-bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest)
+bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content)
 {
   char objKey[10];
   sprintf(objKey, "\"%d\":", id);
-  return readObjectFromFile(file, objKey, dest);
+  bool success = writeObject(file, objKey, id, content);
+  if (!success && errorFlag == ERR_FS_QUOTA && compactObjectFile(file)) { // reclaim holes and retry
+    errorFlag = ERR_NONE;
+    success = writeObject(file, objKey, id, content);
+  }
+  if (!success) {
+    if (doCloseFile) closeFile();
+    invalidateObjectIndex(file); // file may have been modified
+    return false;
+  }
+  size_t fileSize = f.size();
+  closeFile();
+  updateObjectIndex(file, id, fileSize);
+  size_t holes = objectFileHoles(file);
+  if (holes > FS_COMPACT_MIN_HOLES && holes > fileSize/4) compactObjectFile(file);
+  return true;
+}
+
+bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
+{
+  invalidateObjectIndex(file); // arbitrary keys are not indexed
+  return writeObject(file, key, -1, content);
 }
 
 //if the key is a nullptr, deserialize entire object
-bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
+static bool readObject(const char* file, const char* key, int id, JsonDocument* dest)
 {
   if (doCloseFile) closeFile();
   #ifdef WLED_DEBUG_FS
@@ -343,7 +622,7 @@ bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
   f = WLED_FS.open(file, "r");
   if (!f) return false;
 
-  if (key != nullptr && !bufferedFind(key)) //key does not exist in file
+  if (key != nullptr && !findObject(file, key, id)) //key does not exist in file
   {
     f.close();
     dest->clear();
@@ -358,6 +637,108 @@ bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
   return true;
 }
 
+bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest)
+{
+  char objKey[10];
+  sprintf(objKey, "\"%d\":", id);
+  return readObject(file, objKey, id, dest);
+}
+
+bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
+{
+  return readObject(file, key, -1, dest);
+}
+
+/*
+ * Binary map files (i.e. /ledmap.bin, /2d-gaps.bin), alternative to JSON for large ledmaps.
+ * Entries are decoded while streaming from file so neither the JSON buffer nor a file sized buffer is needed.
+ * Layout (little endian): MapFileHeader, name (nameLen bytes, not terminated), entries
+ * MAP_ENC_RAW:  uint16_t per entry (0xFFFF = -1)
+ * MAP_ENC_RUNS: MapFileRun per linear run of entries (value, value+step, value+2*step, ...)
+ * Use tools/ledmap_convert.js to create map files from JSON.
+ */
+#define MAP_FILE_MAGIC   0x50414D57U // "WMAP"
+#define MAP_FILE_VERSION 1
+#define MAP_ENC_RAW      0
+#define MAP_ENC_RUNS     1
+
+struct MapFileHeader {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  encoding;
+  uint8_t  nameLen;
+  uint8_t  reserved;
+  uint32_t count;    // number of decoded entries
+};
+
+struct MapFileRun {
+  uint16_t value;    // first entry
+  uint16_t count;    // number of entries in run
+  int16_t  step;     // difference between consecutive entries
+};
+
+MapFileReader::MapFileReader(const char *fileName)
+{
+  MapFileHeader hdr;
+  _file = WLED_FS.open(fileName, "r");
+  if (!_file || _file.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr)) return;
+  if (hdr.magic != MAP_FILE_MAGIC || hdr.version != MAP_FILE_VERSION || hdr.encoding > MAP_ENC_RUNS) return;
+  if (_file.size() < sizeof(hdr) + hdr.nameLen) return;
+  // count comes from file, raw entries must all be present (runs are checked while decoding, callers limit allocation)
+  if (hdr.encoding == MAP_ENC_RAW && (_file.size() - sizeof(hdr) - hdr.nameLen) / sizeof(uint16_t) < hdr.count) return;
+  _count    = hdr.count;
+  _encoding = hdr.encoding;
+  _nameLen  = hdr.nameLen;
+  _valid    = true;
+}
+
+bool MapFileReader::getName(char *dest, size_t len)
+{
+  if (!_valid || !_nameLen || !len) return false;
+  size_t n = (_nameLen < len) ? _nameLen : len-1;
+  _file.seek(sizeof(MapFileHeader));
+  n = _file.read((uint8_t*)dest, n);
+  dest[n] = '\0';
+  return n > 0;
+}
+
+static inline void storeMapEntry(uint16_t &dest, uint16_t v) { dest = v; }
+static inline void storeMapEntry(int8_t &dest, uint16_t v)   { dest = constrain((int16_t)v, -1, 1); } // gaps: -1, 0, 1
+
+template<typename T> size_t MapFileReader::decode(T *dest, size_t maxCount)
+{
+  if (!_valid || !dest) return 0;
+  #ifdef WLED_DEBUG_FS
+    uint32_t s = millis();
+  #endif
+  if (maxCount > _count) maxCount = _count;
+  const size_t recLen = (_encoding == MAP_ENC_RUNS) ? sizeof(MapFileRun) : sizeof(uint16_t);
+  byte buf[FS_BUFSIZE - FS_BUFSIZE % sizeof(MapFileRun)]; // multiple of both record sizes
+  size_t n = 0;
+  _file.seek(sizeof(MapFileHeader) + _nameLen);
+  while (n < maxCount) {
+    size_t len = _file.read(buf, sizeof(buf));
+    if (len % recLen) _file.seek(_file.position() - len % recLen); // partial record is read again
+    len -= len % recLen;
+    if (!len) break;
+    for (size_t i = 0; i < len && n < maxCount; i += recLen) {
+      uint16_t v = buf[i] | (buf[i+1] << 8);
+      if (_encoding == MAP_ENC_RAW) {
+        storeMapEntry(dest[n++], v);
+      } else {
+        uint16_t count = buf[i+2] | (buf[i+3] << 8);
+        int16_t  step  = buf[i+4] | (buf[i+5] << 8);
+        for (; count && n < maxCount; count--, v += step) storeMapEntry(dest[n++], v);
+      }
+    }
+  }
+  DEBUGFS_PRINTF("Map decoded %u entries, took %d ms\n", n, millis() - s);
+  return n;
+}
+
+size_t MapFileReader::read(uint16_t *dest, size_t maxCount) { return decode(dest, maxCount); }
+size_t MapFileReader::read(int8_t *dest, size_t maxCount)   { return decode(dest, maxCount); }
+
 void updateFSInfo() {
   #ifdef ARDUINO_ARCH_ESP32
     #if WLED_FS == LITTLEFS || ESP_IDF_VERSION_MAJOR >= 4
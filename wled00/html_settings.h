@@ -301,533 +301,532 @@ const uint8_t PAGE_settings_wifi[] PROGMEM = {
 
 
 // Autogenerated from wled00/data/settings_leds.htm, do not edit!!
-const uint16_t PAGE_settings_leds_length = 8391;
+const uint16_t PAGE_settings_leds_length = 8382;
 const uint8_t PAGE_settings_leds[] PROGMEM = {
-  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x13, 0xdd, 0x7d, 0xeb, 0x76, 0xdb, 0x38,
-  0x92, 0xf0, 0x7f, 0x3d, 0x05, 0x8c, 0xee, 0x76, 0xc8, 0x16, 0x25, 0x91, 0xb2, 0xe5, 0x76, 0x24,
-  0x51, 0x5e, 0xdb, 0xb9, 0xb4, 0x77, 0xec, 0xd8, 0xc7, 0x72, 0x3a, 0xb3, 0x27, 0x9d, 0xed, 0xd0,
-  0x14, 0x24, 0x31, 0xa1, 0x48, 0x0d, 0x49, 0xf9, 0xb2, 0xb6, 0xf7, 0x99, 0xf6, 0x19, 0xf6, 0xc9,
-  0xbe, 0x2a, 0x5c, 0x78, 0x11, 0x49, 0xd9, 0xf9, 0x66, 0xf7, 0xcf, 0xce, 0x39, 0x1d, 0x53, 0x64,
-  0xa1, 0x50, 0x28, 0xd4, 0x15, 0x28, 0x60, 0x86, 0x5b, 0x6f, 0xce, 0x8f, 0xaf, 0xfe, 0xed, 0xe2,
-  0x2d, 0x99, 0x27, 0x0b, 0x7f, 0x34, 0xc4, 0x7f, 0x89, 0xef, 0x04, 0x33, 0x9b, 0xb2, 0x80, 0xc2,
-  0x6f, 0xe6, 0x4c, 0x46, 0xc3, 0x05, 0x4b, 0x1c, 0xe2, 0xce, 0x9d, 0x28, 0x66, 0x89, 0x4d, 0x57,
-  0xc9, 0xb4, 0xb5, 0x4f, 0xe5, 0xdb, 0x86, 0x1b, 0x06, 0x09, 0x0b, 0xe0, 0xf5, 0xad, 0x37, 0x49,
-  0xe6, 0xf6, 0x84, 0xdd, 0x78, 0x2e, 0x6b, 0xf1, 0x1f, 0x86, 0x17, 0x78, 0x89, 0xe7, 0xf8, 0xad,
-  0xd8, 0x75, 0x7c, 0x66, 0x5b, 0xc6, 0xc2, 0xb9, 0xf3, 0x16, 0xab, 0x45, 0xfa, 0x7b, 0x15, 0xb3,
-  0x88, 0xff, 0x70, 0xae, 0xe1, 0x77, 0x10, 0x52, 0xd2, 0x08, 0x9c, 0x05, 0xb3, 0xe9, 0x8d, 0xc7,
-  0x6e, 0x97, 0x61, 0x94, 0x40, 0x2f, 0x89, 0x97, 0xf8, 0x6c, 0x74, 0xfa, 0xf6, 0x0d, 0x19, 0xb3,
-  0x24, 0xf1, 0x82, 0x59, 0x3c, 0xec, 0x88, 0x77, 0xc3, 0xd8, 0x8d, 0xbc, 0x65, 0x32, 0x6a, 0xdc,
-  0x38, 0x11, 0x99, 0xd8, 0x93, 0xd0, 0x5d, 0x2d, 0x80, 0x12, 0xc3, 0x77, 0x96, 0x11, 0xbb, 0xb1,
-  0x7b, 0x3d, 0xec, 0xef, 0x48, 0x74, 0xfb, 0x87, 0x6d, 0xe2, 0x9f, 0x33, 0x7b, 0x97, 0xed, 0xe0,
-  0xc3, 0xc5, 0x91, 0xbd, 0x6b, 0xbe, 0xde, 0xc3, 0xc7, 0x53, 0xdb, 0xda, 0xd9, 0xe1, 0x2f, 0x4f,
-  0xaf, 0xff, 0xb1, 0x0a, 0x13, 0xdb, 0x1c, 0x4c, 0xda, 0xab, 0xc5, 0x5f, 0x4b, 0xfb, 0xf3, 0x17,
-  0x63, 0xd2, 0x8e, 0xe2, 0x9b, 0x89, 0x7c, 0x0a, 0xff, 0x9a, 0x2d, 0xbd, 0x50, 0xfc, 0x00, 0x70,
-  0xf1, 0xab, 0x67, 0x0e, 0xb0, 0x7f, 0x3f, 0x74, 0xbd, 0xa5, 0x91, 0x78, 0x0b, 0x16, 0xae, 0x12,
-  0xc3, 0x5d, 0xc5, 0x49, 0xb8, 0x18, 0x27, 0x4e, 0x94, 0xc4, 0xf6, 0x96, 0x65, 0xc4, 0xfc, 0xe9,
-  0x8d, 0x17, 0x25, 0xf7, 0xd8, 0x1c, 0x1a, 0x1f, 0x9f, 0x9f, 0xdf, 0xb0, 0x28, 0xf2, 0x26, 0x2c,
-  0xb6, 0x7b, 0x06, 0xb4, 0x46, 0x30, 0xf8, 0xb3, 0x8c, 0xc2, 0x24, 0xb4, 0xe9, 0x3c, 0x49, 0x96,
-  0x7d, 0x3a, 0x98, 0xae, 0x02, 0x37, 0xf1, 0xc2, 0x80, 0xfc, 0xae, 0xe9, 0x0f, 0xb7, 0x5e, 0x30,
-  0x09, 0x6f, 0xdb, 0xe1, 0x92, 0x05, 0x1a, 0x07, 0x88, 0xfb, 0x9d, 0xce, 0xf7, 0x20, 0x6c, 0xdf,
-  0xfa, 0x6c, 0xd2, 0x9e, 0xb1, 0xce, 0x94, 0x39, 0xc9, 0x2a, 0x62, 0x71, 0x27, 0x96, 0x9c, 0xea,
-  0xfc, 0x04, 0x5f, 0x5a, 0xea, 0x17, 0xd5, 0x9f, 0x52, 0x7c, 0x47, 0x6b, 0xf8, 0x66, 0x2c, 0xf9,
-  0x78, 0x79, 0xaa, 0xd1, 0x4e, 0x06, 0x6c, 0xd0, 0xbf, 0x62, 0xe6, 0x4f, 0xf3, 0xad, 0x66, 0x27,
-  0x13, 0x8d, 0xe9, 0x0f, 0x11, 0x83, 0x6e, 0x02, 0x82, 0x7d, 0x26, 0x6f, 0x7d, 0x86, 0x4c, 0x3f,
-  0xba, 0xe7, 0x9f, 0x32, 0xd0, 0x70, 0x3a, 0x45, 0xd0, 0x3c, 0x4c, 0x7c, 0x74, 0xff, 0x01, 0x66,
-  0x17, 0x5e, 0x7f, 0x36, 0xbf, 0xb4, 0x6f, 0x1c, 0x7f, 0xc5, 0xec, 0x96, 0x95, 0x35, 0xf1, 0x43,
-  0x67, 0xf2, 0xaf, 0x63, 0x8d, 0x19, 0x81, 0xbd, 0x65, 0xea, 0x0f, 0x3e, 0x4b, 0x48, 0x62, 0x4f,
-  0xda, 0x6e, 0x04, 0xc3, 0x62, 0x12, 0x87, 0x46, 0xc5, 0xa4, 0x53, 0x7d, 0x90, 0xb4, 0x81, 0xd6,
-  0xc3, 0x24, 0x89, 0xbc, 0xeb, 0x55, 0xc2, 0xe0, 0x43, 0xe4, 0x52, 0x83, 0xe9, 0xc6, 0xfa, 0xfb,
-  0xe4, 0x7e, 0xc9, 0xa8, 0x41, 0x13, 0x76, 0x97, 0x74, 0xbe, 0x39, 0x37, 0x8e, 0x42, 0x50, 0x02,
-  0x74, 0xe2, 0xfb, 0x00, 0x50, 0x04, 0x3a, 0x4c, 0xef, 0x75, 0x38, 0xb9, 0x6f, 0x3b, 0x4b, 0x60,
-  0xcd, 0xe4, 0x78, 0xee, 0xf9, 0x13, 0x2d, 0x41, 0x78, 0x67, 0x32, 0x79, 0x7b, 0x03, 0x54, 0x9c,
-  0x7a, 0x31, 0xc8, 0x3c, 0x8b, 0x34, 0x8a, 0x34, 0x53, 0x43, 0xd3, 0xed, 0xd1, 0xc3, 0x7b, 0x96,
-  0xfc, 0xa1, 0xe9, 0x86, 0x3b, 0x67, 0xee, 0xf7, 0xb1, 0x07, 0x4f, 0x88, 0xfd, 0xe8, 0x54, 0x43,
-  0x74, 0xe3, 0x69, 0x45, 0xdb, 0x78, 0x75, 0xbd, 0xf0, 0x12, 0x6a, 0x24, 0xd1, 0xfd, 0x98, 0x3f,
-  0xea, 0x46, 0xcb, 0xb2, 0x6d, 0x21, 0x7c, 0xc0, 0xa2, 0xed, 0x6d, 0xf1, 0xd8, 0x8e, 0xe7, 0xde,
-  0x34, 0x01, 0x3c, 0x4b, 0x2f, 0x78, 0x13, 0x85, 0x4b, 0x98, 0xb4, 0x20, 0xd6, 0xf4, 0xa7, 0x6a,
-  0x8a, 0x40, 0xa8, 0xc2, 0x08, 0x18, 0x01, 0x14, 0x81, 0x6a, 0xc6, 0xa1, 0xcf, 0xda, 0x7e, 0x38,
-  0xd3, 0xe8, 0x5b, 0x7c, 0x4f, 0x24, 0x9b, 0x61, 0x86, 0xc9, 0xd4, 0xf3, 0x19, 0x67, 0x18, 0xe8,
-  0x62, 0x04, 0x8c, 0x3d, 0x95, 0xef, 0xc3, 0x29, 0x81, 0x86, 0x53, 0x6f, 0xb6, 0x8a, 0x1c, 0x3e,
-  0x2f, 0x82, 0x61, 0x64, 0xea, 0x78, 0x28, 0x67, 0x7f, 0x06, 0x27, 0x81, 0x1b, 0x2e, 0x96, 0x30,
-  0x3d, 0x8c, 0x2c, 0x9d, 0x19, 0x23, 0x13, 0x27, 0x71, 0xb6, 0x40, 0x4c, 0x72, 0xb3, 0x1f, 0xcf,
-  0xc3, 0xdb, 0xab, 0xd0, 0x89, 0x13, 0x31, 0x9b, 0x96, 0xfe, 0x80, 0x3a, 0x92, 0xd8, 0x28, 0x40,
-  0x34, 0xc1, 0x0f, 0x7c, 0x02, 0xbd, 0x00, 0x48, 0xfe, 0xfd, 0xea, 0xec, 0xd4, 0x66, 0x30, 0x16,
-  0xd7, 0x77, 0xe2, 0x18, 0x25, 0xc4, 0x0e, 0x0e, 0xe4, 0x30, 0xfa, 0x14, 0x31, 0x51, 0xc3, 0xf5,
-  0x99, 0x13, 0x5d, 0x09, 0xe5, 0xd2, 0xa4, 0x92, 0xf1, 0x09, 0x4c, 0xee, 0x61, 0x7c, 0x4e, 0xe0,
-  0x2d, 0x38, 0xa9, 0x36, 0x0d, 0xc2, 0x00, 0x06, 0x25, 0x21, 0x6c, 0x98, 0x01, 0xd5, 0x48, 0x53,
-  0xb4, 0x81, 0xe0, 0xe7, 0xbb, 0xca, 0x3d, 0xb7, 0x23, 0xb6, 0xf4, 0x1d, 0x17, 0x45, 0x89, 0x77,
-  0x4a, 0x71, 0x4c, 0x46, 0xf7, 0xb5, 0x69, 0xe6, 0x46, 0x76, 0x7d, 0xea, 0xc1, 0x4c, 0xc5, 0x38,
-  0x2e, 0x23, 0x31, 0x1c, 0xc3, 0xd3, 0x1f, 0xb8, 0x95, 0x61, 0xc2, 0xca, 0x04, 0xc2, 0xca, 0x38,
-  0xd2, 0xc6, 0x24, 0xc2, 0xc0, 0x78, 0x59, 0x7b, 0x98, 0xc3, 0xf8, 0xfc, 0x6f, 0x9a, 0x60, 0x08,
-  0xb3, 0xb9, 0x68, 0xfc, 0x63, 0xc5, 0x40, 0x04, 0x98, 0xcf, 0xdc, 0x24, 0x8c, 0x0e, 0x7d, 0x5f,
-  0xa3, 0x3f, 0x2d, 0x4e, 0x8f, 0x89, 0x17, 0x2c, 0x57, 0xc9, 0x67, 0x34, 0x88, 0xff, 0x6e, 0x9f,
-  0x7e, 0x01, 0x86, 0x4d, 0xc3, 0x48, 0xf3, 0xc0, 0x3c, 0x79, 0x43, 0x98, 0x53, 0x16, 0xcc, 0x92,
-  0xf9, 0xc0, 0x6b, 0x36, 0x05, 0xaa, 0xc0, 0x66, 0x9f, 0xbd, 0x2f, 0x6d, 0x84, 0x6e, 0x83, 0x60,
-  0xc5, 0x20, 0xd5, 0xc1, 0x4c, 0x33, 0x8d, 0xae, 0x3e, 0xf0, 0xa6, 0x30, 0xb9, 0x26, 0xb5, 0xed,
-  0xe0, 0xf1, 0x91, 0x9e, 0x5a, 0xea, 0xa1, 0xab, 0x1e, 0x76, 0xf0, 0x41, 0xcd, 0x50, 0x15, 0x16,
-  0x81, 0x63, 0x89, 0xe6, 0xff, 0x04, 0x54, 0xb0, 0x4a, 0xa7, 0xe9, 0xe9, 0x15, 0x6d, 0x26, 0x99,
-  0x62, 0x1b, 0x96, 0xa9, 0x8f, 0xec, 0x7d, 0x53, 0x47, 0xf7, 0xe0, 0x05, 0x2b, 0xf6, 0x04, 0x18,
-  0x5e, 0x40, 0x06, 0x3e, 0xec, 0x72, 0x7a, 0xb6, 0xb7, 0x29, 0xdd, 0x12, 0xe4, 0x70, 0x8c, 0xf0,
-  0xbb, 0x65, 0x15, 0xde, 0x08, 0x92, 0x1d, 0x5b, 0xd8, 0xe8, 0x36, 0xf4, 0xe4, 0x3a, 0x48, 0x1d,
-  0xea, 0x0c, 0xa7, 0xb8, 0x86, 0xb9, 0x31, 0xff, 0xd1, 0x86, 0x99, 0xa0, 0x7a, 0x1b, 0x78, 0xfa,
-  0xd6, 0x71, 0xe7, 0x1a, 0xea, 0x0b, 0x13, 0x78, 0x47, 0x2d, 0x6b, 0x7b, 0xdb, 0x69, 0x2f, 0x57,
-  0xf1, 0x3c, 0x1b, 0xb4, 0xfc, 0xa6, 0xa3, 0x48, 0x38, 0xed, 0x38, 0x84, 0x31, 0x07, 0xf6, 0x28,
-  0xb0, 0xed, 0x0c, 0x22, 0x23, 0x4c, 0xd7, 0xa5, 0x89, 0x14, 0xaa, 0xf5, 0x75, 0x1c, 0x46, 0xd1,
-  0xbd, 0xc1, 0xe7, 0x9e, 0xfc, 0xfc, 0xf0, 0xaf, 0xe3, 0xf3, 0x0f, 0x6d, 0xc1, 0x5a, 0x6f, 0x7a,
-  0xaf, 0x39, 0xfa, 0x13, 0x71, 0x9d, 0xe0, 0x55, 0x42, 0xae, 0x19, 0x01, 0x8f, 0x38, 0x69, 0x7f,
-  0xd5, 0x8d, 0x0c, 0x99, 0x4d, 0xa9, 0xf8, 0x35, 0x05, 0xff, 0x06, 0x6a, 0x6f, 0x6c, 0x59, 0x38,
-  0xb6, 0xce, 0xaf, 0x5b, 0x5a, 0xb0, 0x20, 0xb6, 0x4d, 0xe8, 0xc9, 0x25, 0x25, 0x8f, 0x8f, 0x24,
-  0x58, 0xd8, 0x36, 0x3d, 0xba, 0xa2, 0x3a, 0xd9, 0xde, 0xfe, 0xb5, 0x93, 0xba, 0xab, 0xff, 0x51,
-  0x5a, 0x53, 0xac, 0x40, 0xb3, 0x13, 0x31, 0x21, 0xa2, 0x60, 0x54, 0xfc, 0xfb, 0xe7, 0x89, 0x46,
-  0xe9, 0xfd, 0x66, 0x7b, 0x4d, 0x6b, 0xf0, 0x2d, 0x93, 0xdf, 0x6f, 0x4a, 0x7e, 0x7d, 0x98, 0xd8,
-  0x6f, 0xcf, 0xc8, 0xaf, 0xaf, 0x04, 0xc7, 0x57, 0x82, 0xe3, 0x2b, 0xc1, 0xf1, 0x95, 0xe0, 0xf8,
-  0xfa, 0x03, 0x87, 0x87, 0x47, 0xdb, 0x2f, 0x60, 0xb2, 0x74, 0xd1, 0x53, 0x58, 0xd9, 0xd3, 0x4b,
-  0x65, 0x3c, 0x7c, 0x46, 0xc6, 0x85, 0xd0, 0x7e, 0x4b, 0x85, 0x36, 0xc7, 0x93, 0xdc, 0xfb, 0x35,
-  0x9e, 0x5f, 0x78, 0x01, 0xb7, 0xb9, 0xbe, 0xe7, 0xa2, 0x14, 0x24, 0xb7, 0x8c, 0x05, 0xc0, 0xfc,
-  0x54, 0x17, 0x9f, 0x3a, 0xf8, 0x43, 0x12, 0xfd, 0xb4, 0xc5, 0x59, 0xfd, 0xad, 0xc0, 0xea, 0x6f,
-  0x79, 0x56, 0x3f, 0xc1, 0xff, 0x44, 0x07, 0x5b, 0x66, 0x66, 0x79, 0x52, 0x37, 0x83, 0x7e, 0x59,
-  0x69, 0x07, 0xda, 0xee, 0x1c, 0x9e, 0x36, 0x46, 0x4e, 0x30, 0xe4, 0x37, 0x6c, 0xea, 0xac, 0x7c,
-  0xf4, 0x39, 0x5b, 0xca, 0x60, 0x29, 0x92, 0x81, 0x69, 0x49, 0xb8, 0xbc, 0x00, 0x3f, 0xe4, 0xcc,
-  0x1c, 0x61, 0x50, 0xa5, 0x48, 0xf2, 0xe8, 0x69, 0x64, 0x81, 0xb9, 0x94, 0x16, 0x89, 0x5e, 0x85,
-  0x21, 0x59, 0x38, 0xc1, 0x3d, 0x81, 0xf0, 0x2d, 0x26, 0x20, 0x00, 0x64, 0xc1, 0x48, 0x12, 0x92,
-  0xb9, 0x13, 0x4c, 0x7c, 0xb6, 0x45, 0x07, 0x68, 0x2c, 0x87, 0x16, 0xdb, 0xdd, 0xde, 0xd6, 0x82,
-  0xa6, 0x4d, 0xff, 0x0c, 0xfe, 0x8c, 0x8e, 0xc1, 0x69, 0x41, 0x54, 0x14, 0x81, 0x2a, 0xa0, 0x37,
-  0x72, 0x02, 0xf2, 0x76, 0x7c, 0xb1, 0xd3, 0x6d, 0x53, 0xe5, 0xa8, 0x02, 0xfd, 0x89, 0x93, 0xce,
-  0x1d, 0xed, 0x1f, 0x8e, 0xef, 0x4d, 0xbc, 0xe4, 0x5e, 0xd3, 0xd1, 0x5b, 0xc2, 0x5b, 0xe1, 0x54,
-  0xb5, 0x9c, 0xc5, 0x66, 0x01, 0xf7, 0xc2, 0xd2, 0xe0, 0x72, 0x0f, 0x84, 0xe1, 0x26, 0xe8, 0x3e,
-  0xc7, 0xc0, 0x26, 0x03, 0xde, 0xf0, 0xf4, 0x50, 0xf2, 0x81, 0x1d, 0x88, 0x00, 0xb2, 0x6f, 0x1a,
-  0x0a, 0x18, 0x60, 0x85, 0xa7, 0x99, 0x78, 0x31, 0xb8, 0x88, 0x7b, 0x80, 0xa1, 0x5e, 0xe0, 0x7b,
-  0xe0, 0x6b, 0xfa, 0xd2, 0xe5, 0x70, 0xd0, 0x65, 0xbc, 0xea, 0xbe, 0x00, 0xb6, 0xd0, 0xdf, 0xc8,
-  0xdc, 0xde, 0x4e, 0x23, 0x85, 0x8f, 0x27, 0x45, 0xca, 0x4f, 0x0f, 0x8b, 0x9e, 0xe2, 0xf4, 0x10,
-  0x8c, 0x97, 0x68, 0xb7, 0x4e, 0xb5, 0xa0, 0xe0, 0xf4, 0x10, 0xba, 0x2d, 0x91, 0xd0, 0x33, 0xed,
-  0x0a, 0x32, 0x8a, 0x9d, 0x29, 0x1a, 0x1e, 0xe2, 0x5b, 0x2f, 0x01, 0x83, 0x58, 0xc1, 0x28, 0x08,
-  0xcb, 0x8c, 0x75, 0x32, 0x00, 0xb7, 0x91, 0xd3, 0x9a, 0x1c, 0x49, 0xa0, 0x6e, 0xae, 0x13, 0x33,
-  0x62, 0xf6, 0x2b, 0x51, 0x59, 0x86, 0x9c, 0x98, 0xc1, 0x35, 0x04, 0x78, 0xdf, 0x07, 0x1c, 0x76,
-  0xc7, 0xec, 0x97, 0x3a, 0xd8, 0x31, 0x0b, 0x10, 0xbd, 0x0a, 0x88, 0x5e, 0x1e, 0xa2, 0x57, 0x01,
-  0xd1, 0x2b, 0x40, 0x74, 0xab, 0x40, 0xba, 0x29, 0xcc, 0x44, 0x08, 0x7f, 0x7f, 0x03, 0x43, 0x15,
-  0x2b, 0x9f, 0x38, 0xcc, 0xc2, 0x02, 0x80, 0x2c, 0x96, 0x41, 0xa1, 0xce, 0xc5, 0xcc, 0x2c, 0x39,
-  0x63, 0x0b, 0x8c, 0x17, 0x54, 0x48, 0xfb, 0x8c, 0x91, 0x39, 0xa6, 0xcd, 0x20, 0x33, 0x32, 0x10,
-  0x26, 0x35, 0x9f, 0x69, 0x31, 0x3e, 0x5d, 0x6b, 0x81, 0xdd, 0x38, 0x10, 0x27, 0xa4, 0x71, 0x3a,
-  0x0e, 0xf5, 0x8d, 0x62, 0x3d, 0xe8, 0x9a, 0x63, 0xef, 0xfe, 0x0a, 0xf1, 0x13, 0x1b, 0xee, 0x74,
-  0x0f, 0xb4, 0xee, 0x1e, 0x58, 0xac, 0xed, 0xed, 0xee, 0x6b, 0xf8, 0xf3, 0xf8, 0xa8, 0x25, 0xbf,
-  0xda, 0x5d, 0xdd, 0xc8, 0x14, 0x73, 0x07, 0x23, 0xd2, 0x2a, 0x3a, 0xcd, 0x42, 0xaf, 0x07, 0x6c,
-  0xd4, 0xdd, 0x3f, 0xe8, 0x9a, 0xbf, 0x26, 0x4d, 0xa7, 0x6f, 0xf5, 0xf8, 0x1f, 0x44, 0x32, 0xb2,
-  0x01, 0x8b, 0xf8, 0xb8, 0xcf, 0x5f, 0xee, 0xf1, 0x7f, 0xf9, 0x8b, 0x5d, 0xfe, 0xb8, 0x83, 0xff,
-  0xea, 0xf0, 0x66, 0x07, 0xdc, 0x2e, 0x1b, 0xee, 0xee, 0x1f, 0xf4, 0xc4, 0xbb, 0x8c, 0x87, 0x20,
-  0xa9, 0x8c, 0x47, 0x91, 0x38, 0x32, 0x8c, 0x27, 0x8d, 0x04, 0xff, 0xc1, 0x31, 0x0a, 0xd9, 0x5a,
-  0x2c, 0x6f, 0x9d, 0x28, 0x00, 0x7b, 0x51, 0x9a, 0x29, 0x3e, 0xf8, 0x33, 0xa5, 0x6b, 0xbf, 0x75,
-  0x4d, 0xb3, 0xa4, 0x07, 0x30, 0xf3, 0xb6, 0x5d, 0x10, 0x5d, 0x69, 0x01, 0x6c, 0xab, 0xdb, 0x2f,
-  0xe9, 0xaa, 0x26, 0xbf, 0x15, 0x65, 0xdd, 0xd8, 0x14, 0xc8, 0x89, 0x80, 0x43, 0x45, 0x72, 0x57,
-  0x5f, 0x72, 0x61, 0x87, 0x07, 0x61, 0x87, 0x70, 0x7f, 0x5e, 0xd9, 0x23, 0x19, 0x61, 0x36, 0xf3,
-  0x9e, 0x9a, 0x5c, 0x74, 0xa3, 0xc2, 0xd8, 0x98, 0x13, 0xda, 0xf4, 0xf3, 0x82, 0x17, 0xa2, 0x37,
-  0xda, 0xde, 0x0e, 0x87, 0xaf, 0xf7, 0x0e, 0xe8, 0xc9, 0x05, 0x81, 0xe4, 0x00, 0xb2, 0xc1, 0xb8,
-  0x4f, 0xfb, 0xe1, 0x68, 0xf7, 0xf5, 0x01, 0x7d, 0x03, 0xc6, 0x9e, 0xbc, 0xbf, 0x38, 0x39, 0x17,
-  0x6f, 0xac, 0x03, 0x8a, 0x3f, 0xf0, 0x3b, 0x15, 0x6f, 0xa5, 0x15, 0xb3, 0xca, 0x88, 0x77, 0x5f,
-  0x23, 0xde, 0xbd, 0xdd, 0x03, 0x7a, 0xec, 0x7f, 0x57, 0x38, 0xc0, 0x63, 0x38, 0x4d, 0x5b, 0x0a,
-  0x78, 0x68, 0xf8, 0x90, 0xfc, 0xd8, 0xd6, 0xc0, 0x1d, 0xf6, 0x06, 0xae, 0x72, 0xeb, 0x71, 0x8d,
-  0xf0, 0xd0, 0xa6, 0x0b, 0x5d, 0x80, 0xf4, 0x0c, 0x62, 0x60, 0x69, 0x8e, 0xf0, 0xed, 0x6d, 0x77,
-  0xb8, 0xfb, 0xf8, 0x28, 0x7a, 0x84, 0x6c, 0xc8, 0xe5, 0xcf, 0x16, 0x7e, 0xec, 0x01, 0x88, 0xdb,
-  0xdc, 0x35, 0x87, 0xe1, 0x81, 0x16, 0xd7, 0x28, 0xa4, 0x11, 0x43, 0x14, 0xff, 0x8f, 0x95, 0x17,
-  0x71, 0x6b, 0xa5, 0xf7, 0xcb, 0x80, 0x62, 0xce, 0xf3, 0x60, 0x90, 0x9e, 0xa7, 0x2e, 0x10, 0xe2,
-  0x3b, 0xd0, 0x05, 0xc1, 0xe0, 0x68, 0xca, 0xd9, 0xa0, 0x2c, 0x56, 0xc5, 0xbb, 0xc7, 0xc7, 0x1d,
-  0x20, 0x31, 0x34, 0x42, 0x2e, 0xbb, 0x21, 0xc8, 0x2e, 0xb4, 0xad, 0xd5, 0x6a, 0x3f, 0x97, 0xf7,
-  0x42, 0x30, 0x62, 0xe4, 0x11, 0x42, 0xec, 0x0a, 0xce, 0xff, 0xbb, 0xcd, 0xf1, 0x1d, 0x60, 0x3e,
-  0xb9, 0x65, 0xf5, 0x79, 0x5a, 0xf9, 0x64, 0x24, 0x8f, 0x76, 0x00, 0x53, 0x60, 0xfd, 0x86, 0x5d,
-  0x74, 0xbb, 0xc8, 0x90, 0xee, 0x3e, 0x3e, 0xef, 0xf0, 0xe7, 0x5d, 0xce, 0xb9, 0x5d, 0xe0, 0xdc,
-  0xee, 0xce, 0x96, 0x1d, 0x3e, 0x3e, 0xee, 0xef, 0x23, 0x4d, 0x1c, 0xbb, 0x1b, 0x72, 0xec, 0x45,
-  0x16, 0xe4, 0xb8, 0x8d, 0xed, 0x6d, 0x89, 0x60, 0xff, 0x40, 0xf0, 0xa6, 0x9f, 0xf2, 0x92, 0xa3,
-  0x98, 0x78, 0x33, 0xc0, 0xd1, 0xa4, 0xb7, 0xb4, 0x8c, 0x47, 0x91, 0x51, 0x52, 0xa9, 0x3c, 0x85,
-  0xd5, 0x0c, 0xf9, 0x74, 0x5e, 0x64, 0x88, 0xa9, 0x17, 0xbb, 0x73, 0x2b, 0xba, 0x7b, 0x21, 0xa5,
-  0x11, 0xdd, 0x30, 0xe2, 0xcd, 0x4d, 0x63, 0xfa, 0x3f, 0xc3, 0xac, 0x69, 0x15, 0x1e, 0x6b, 0x2f,
-  0x9b, 0x34, 0xbb, 0x67, 0x2a, 0x85, 0xaa, 0x0a, 0x24, 0x14, 0x1e, 0xa7, 0x84, 0x27, 0x80, 0x69,
-  0x36, 0x61, 0x9a, 0x37, 0xb7, 0xf3, 0x2b, 0xfa, 0xdf, 0xdd, 0xdf, 0xd4, 0x23, 0x98, 0xb4, 0xb2,
-  0x35, 0xc9, 0x06, 0x7b, 0x12, 0xdc, 0x40, 0xec, 0xc5, 0x26, 0x04, 0x72, 0x69, 0x08, 0xf9, 0xa1,
-  0xed, 0x25, 0x04, 0x8a, 0x60, 0x9b, 0x26, 0x44, 0x8b, 0xc2, 0xc4, 0xc1, 0x4f, 0xd6, 0xbe, 0xf9,
-  0xdf, 0xff, 0xa5, 0xa7, 0xa1, 0xd0, 0x64, 0x33, 0xbe, 0x09, 0xbb, 0x43, 0x13, 0xc2, 0xd7, 0xc8,
-  0xfa, 0xf4, 0x49, 0x4e, 0xff, 0x6d, 0x79, 0xde, 0x93, 0x12, 0xc1, 0x09, 0x17, 0x2a, 0xb0, 0xb7,
-  0x87, 0x9f, 0xda, 0xc2, 0xb6, 0xb2, 0x09, 0x47, 0x68, 0xcb, 0xf8, 0xe4, 0xf8, 0x32, 0x17, 0x67,
-  0xe8, 0x62, 0x7d, 0xee, 0x87, 0x52, 0x6d, 0xb0, 0xbc, 0xa6, 0x11, 0xc3, 0x7f, 0x11, 0xb8, 0x98,
-  0x2c, 0xed, 0xf6, 0x4b, 0x69, 0xf7, 0xd2, 0xf6, 0x6b, 0xd2, 0x6e, 0x63, 0x55, 0xf9, 0x49, 0xe5,
-  0x33, 0xc7, 0x90, 0x27, 0x2c, 0x65, 0xae, 0x82, 0xb9, 0xcd, 0x52, 0xe5, 0x36, 0x4b, 0xbd, 0xd6,
-  0x80, 0xac, 0xb8, 0xbe, 0x80, 0x57, 0xb5, 0xf9, 0xea, 0xc2, 0xa0, 0xa2, 0xb1, 0x4a, 0x8c, 0x96,
-  0x2a, 0x31, 0x12, 0x7d, 0x3c, 0x9f, 0xd7, 0xac, 0x72, 0x01, 0x04, 0x4f, 0x6a, 0x1e, 0x38, 0xf5,
-  0xd8, 0x19, 0xf8, 0x47, 0x43, 0xfc, 0xf0, 0x02, 0x60, 0x09, 0x7f, 0x14, 0x53, 0xe4, 0x86, 0x7e,
-  0x18, 0xd9, 0xf4, 0xa7, 0xe9, 0x74, 0x4a, 0x07, 0x69, 0x16, 0x94, 0x36, 0xcc, 0x56, 0x49, 0xb3,
-  0xf6, 0x2d, 0x2b, 0xb7, 0x12, 0xb0, 0x89, 0x6e, 0x95, 0xd0, 0x2d, 0xe5, 0x4a, 0x80, 0x5f, 0x5a,
-  0x09, 0xf0, 0xd7, 0x56, 0x02, 0xdc, 0x9a, 0x95, 0x00, 0x9c, 0xbf, 0x7f, 0x66, 0x29, 0xc0, 0xdd,
-  0xb0, 0x14, 0xf0, 0x0d, 0xe4, 0xe2, 0x5b, 0x26, 0x17, 0x98, 0xce, 0xc2, 0xf0, 0xbc, 0x2d, 0xfb,
-  0x9b, 0xa0, 0xe9, 0x06, 0xa8, 0x7c, 0x2e, 0xad, 0xbd, 0x51, 0x5c, 0xb8, 0x51, 0x5c, 0xb8, 0x51,
-  0x5c, 0xb8, 0x51, 0x5c, 0xb8, 0xc9, 0xa5, 0xb5, 0x37, 0x95, 0x69, 0xed, 0xa2, 0xb2, 0xa7, 0x97,
-  0xa6, 0xb5, 0x8b, 0x4d, 0x69, 0xad, 0x60, 0xff, 0xb7, 0x12, 0xfb, 0xb3, 0x37, 0xeb, 0x2c, 0xca,
-  0xbe, 0x21, 0x36, 0xfd, 0xe9, 0xc9, 0x15, 0xcb, 0x10, 0xc0, 0x5a, 0x96, 0x5b, 0x86, 0xc8, 0xcd,
-  0xa0, 0x7e, 0x50, 0x96, 0x2b, 0xf0, 0xce, 0xb4, 0x5f, 0x7a, 0xbd, 0xb6, 0xb2, 0xb1, 0x09, 0x25,
-  0x0d, 0x23, 0x27, 0x98, 0xa1, 0xe1, 0xe0, 0x22, 0xfa, 0xf4, 0xc4, 0xfc, 0x98, 0x71, 0x6e, 0x4d,
-  0xab, 0x5a, 0x20, 0xad, 0x83, 0xfc, 0xd2, 0x3d, 0x64, 0x66, 0xd9, 0xc2, 0xfd, 0xe7, 0xd5, 0x17,
-  0xb0, 0x3b, 0xdc, 0x4a, 0xf9, 0x31, 0x2a, 0x8c, 0xf4, 0x5c, 0xa1, 0x34, 0x5d, 0xf2, 0x25, 0x98,
-  0x2d, 0x4c, 0x75, 0xc0, 0xf2, 0xe4, 0x31, 0x19, 0x53, 0x88, 0x0c, 0xb4, 0xfb, 0xac, 0xd7, 0x12,
-  0x1e, 0x5d, 0x6f, 0x4e, 0x47, 0x21, 0x06, 0x43, 0xf6, 0x7d, 0x73, 0xaa, 0x1b, 0xd3, 0x51, 0x04,
-  0x3f, 0x22, 0x1b, 0x1e, 0x7f, 0x4c, 0x7b, 0x87, 0xe8, 0xaf, 0xb4, 0xb8, 0x09, 0x2d, 0x81, 0xf1,
-  0xa2, 0x1f, 0xb4, 0xaa, 0xb8, 0x00, 0x7e, 0x2c, 0x37, 0x6b, 0x64, 0x78, 0xb0, 0x2c, 0xbd, 0xb7,
-  0xed, 0xf8, 0x80, 0x02, 0xbf, 0x34, 0xda, 0x8c, 0x9b, 0x94, 0x2c, 0xe7, 0xf7, 0xb1, 0xe7, 0x3a,
-  0xbe, 0xb2, 0xea, 0x0b, 0xb3, 0x90, 0xe9, 0x38, 0x86, 0xd8, 0x31, 0x71, 0x3a, 0x18, 0xea, 0xff,
-  0x0a, 0xa9, 0xbf, 0x74, 0x43, 0xd7, 0x4e, 0xe6, 0x84, 0xaf, 0x1d, 0xf7, 0xfb, 0x2c, 0x0a, 0x57,
-  0xc1, 0xc4, 0xfe, 0x8a, 0x66, 0xdc, 0x89, 0x5a, 0xb3, 0xc8, 0x99, 0x78, 0xb8, 0x9a, 0xff, 0xda,
-  0x9c, 0xb0, 0x99, 0x41, 0x7e, 0x7e, 0x10, 0x6b, 0x07, 0x7b, 0xe6, 0x81, 0x78, 0x78, 0x0d, 0x51,
-  0x3a, 0x9f, 0xfd, 0xdc, 0x0c, 0xba, 0xae, 0x4b, 0x9f, 0x88, 0xa9, 0x80, 0x9f, 0x7e, 0x31, 0xc8,
-  0x4f, 0xbb, 0xbb, 0xbb, 0xd9, 0x6f, 0x02, 0xfd, 0xff, 0xa2, 0x7f, 0x95, 0xb3, 0xc1, 0x26, 0x75,
-  0x29, 0x41, 0x34, 0x3a, 0x73, 0x92, 0x39, 0x5a, 0x23, 0x8d, 0xdb, 0x51, 0x63, 0xdf, 0x34, 0xf5,
-  0xc7, 0x47, 0xd1, 0xf3, 0xbe, 0x59, 0xed, 0x1f, 0x2b, 0xf0, 0x09, 0x71, 0x54, 0xd8, 0x9c, 0xbb,
-  0x0a, 0x6c, 0x96, 0xb9, 0x3e, 0x10, 0xe9, 0xe6, 0x20, 0xd1, 0x8c, 0xc3, 0xa0, 0xc0, 0xcc, 0xac,
-  0xff, 0x7d, 0xf3, 0x17, 0x5c, 0x85, 0x07, 0x74, 0x6d, 0x5c, 0x39, 0x21, 0x0b, 0xb6, 0x08, 0xa3,
-  0x7b, 0xda, 0xcc, 0x56, 0x58, 0x0e, 0xbe, 0x12, 0x6d, 0x78, 0x3d, 0x7a, 0x7b, 0x79, 0x79, 0x7e,
-  0xd9, 0x27, 0x1f, 0xf9, 0x4a, 0x49, 0x08, 0xfe, 0x18, 0x98, 0xc1, 0xb3, 0xcf, 0xa3, 0xad, 0x61,
-  0xe7, 0x7a, 0xa4, 0x7f, 0x85, 0x10, 0x5d, 0xef, 0x03, 0x3e, 0x53, 0xac, 0xc0, 0x2c, 0x01, 0x42,
-  0x3a, 0x70, 0xee, 0x14, 0x67, 0x36, 0xa7, 0xdd, 0x65, 0x9e, 0xaf, 0x69, 0x80, 0xb6, 0x19, 0xff,
-  0x2a, 0xb2, 0x1b, 0xbd, 0xd3, 0x83, 0x51, 0x74, 0xba, 0x83, 0x99, 0x3d, 0x1b, 0xf5, 0x0e, 0x32,
-  0xa8, 0x99, 0xde, 0x9f, 0xf1, 0xa6, 0xf7, 0xb8, 0x5e, 0x74, 0x0a, 0xc9, 0xb9, 0x5d, 0x5a, 0x99,
-  0x30, 0x4e, 0xec, 0x7c, 0x4a, 0x95, 0xad, 0x58, 0xcc, 0x86, 0x56, 0xdb, 0xec, 0x6e, 0x6f, 0x6f,
-  0x9d, 0xc2, 0x7f, 0x27, 0x07, 0x80, 0xe2, 0xed, 0xf8, 0x82, 0xf4, 0xfe, 0xc0, 0xc5, 0x46, 0x72,
-  0xeb, 0x25, 0x73, 0x62, 0x1d, 0x92, 0x8f, 0xe3, 0x23, 0x12, 0xaf, 0x96, 0x4b, 0xff, 0x9e, 0xf6,
-  0xb5, 0xfb, 0xa6, 0x7d, 0x7a, 0x40, 0xad, 0xee, 0x1f, 0x84, 0xf6, 0x4f, 0x0e, 0xe8, 0xa7, 0x71,
-  0x77, 0xdf, 0xea, 0x11, 0xf1, 0x9b, 0x42, 0x43, 0x6a, 0x00, 0xc4, 0x0c, 0xff, 0xa1, 0x87, 0xb2,
-  0x15, 0x2e, 0xa4, 0x05, 0x3c, 0x24, 0xc0, 0x95, 0x26, 0x1c, 0x36, 0x15, 0x11, 0xc0, 0xbc, 0x7e,
-  0xb0, 0x96, 0x18, 0xad, 0x31, 0xb6, 0xa9, 0xc6, 0x57, 0xa9, 0xc2, 0x38, 0x21, 0x6c, 0x3a, 0x05,
-  0x34, 0xb1, 0x41, 0xfe, 0x93, 0x0e, 0xc6, 0x4d, 0x7b, 0x6e, 0xcf, 0x0b, 0x9c, 0x98, 0xeb, 0xfd,
-  0xb9, 0x31, 0xe6, 0x1d, 0x7b, 0x31, 0x61, 0x41, 0xb8, 0x9a, 0xcd, 0xf5, 0xe1, 0x75, 0x34, 0xca,
-  0xd6, 0x82, 0x0a, 0xd3, 0x7b, 0x5f, 0x58, 0x22, 0xca, 0xde, 0x9f, 0xa0, 0xbe, 0x8d, 0xc5, 0xc7,
-  0x6f, 0x42, 0x26, 0x8a, 0xe2, 0xba, 0x2f, 0x39, 0x79, 0x72, 0x25, 0x93, 0x53, 0xaa, 0x24, 0x33,
-  0xb7, 0x75, 0xe6, 0xc4, 0xc9, 0xdb, 0x60, 0x22, 0x57, 0xf6, 0xd8, 0xd0, 0x52, 0xab, 0x75, 0xe6,
-  0xe0, 0xe6, 0xb9, 0xf5, 0x86, 0x31, 0x08, 0x16, 0x6b, 0x81, 0x1b, 0xc9, 0x4c, 0x48, 0xf3, 0xf9,
-  0x25, 0x8a, 0xf5, 0x26, 0x03, 0xb1, 0xe4, 0xf7, 0xbc, 0xa9, 0x2a, 0x35, 0x94, 0x94, 0x06, 0x3c,
-  0x87, 0x0a, 0x44, 0x0e, 0x05, 0xa9, 0xb7, 0x6e, 0x78, 0xf1, 0x07, 0xe7, 0x83, 0x76, 0xa3, 0x1f,
-  0x98, 0xfd, 0x9b, 0x6c, 0xa8, 0x90, 0xd4, 0xe2, 0xa4, 0xa6, 0xdb, 0x84, 0x62, 0xdb, 0x62, 0xad,
-  0xbb, 0x63, 0xb5, 0xa7, 0xa3, 0x51, 0x6f, 0x7c, 0x85, 0x4b, 0x87, 0x76, 0x92, 0xc6, 0x6e, 0x53,
-  0x6d, 0x4b, 0x83, 0x34, 0x0b, 0xdc, 0x96, 0x33, 0xc2, 0x48, 0xea, 0xa8, 0x89, 0x5b, 0x37, 0x8f,
-  0x8f, 0x2d, 0xf1, 0x12, 0x24, 0xda, 0x91, 0x3e, 0xd5, 0x13, 0x49, 0x1f, 0x44, 0x88, 0x94, 0xfb,
-  0x51, 0x04, 0x50, 0xcb, 0xd5, 0x5f, 0x87, 0x13, 0xef, 0x86, 0xf0, 0xcd, 0x23, 0x9b, 0x77, 0x32,
-  0xfa, 0x33, 0x18, 0xce, 0x23, 0xf5, 0x26, 0x5e, 0xf8, 0xf8, 0xe6, 0xe7, 0x07, 0xa7, 0x69, 0x3d,
-  0xf5, 0xe1, 0x93, 0x08, 0x35, 0x88, 0xd8, 0xdf, 0x3e, 0xbd, 0x82, 0x0f, 0x4f, 0x94, 0x40, 0xa0,
-  0x32, 0x47, 0xb3, 0x60, 0xd3, 0x8f, 0x27, 0x5a, 0x12, 0x01, 0x3b, 0xe8, 0x08, 0xbe, 0x08, 0xb2,
-  0x70, 0xa2, 0x5f, 0x0d, 0xc3, 0x25, 0x1f, 0xb6, 0x4c, 0x50, 0xbb, 0x5d, 0x4a, 0x54, 0xc8, 0x3b,
-  0xe2, 0xea, 0x70, 0x37, 0xec, 0x08, 0x90, 0xd1, 0x1a, 0xe8, 0x8e, 0x49, 0x47, 0xe3, 0xbf, 0xed,
-  0xed, 0x5b, 0xdd, 0x0e, 0x07, 0xdc, 0x25, 0x97, 0xef, 0x8f, 0x3e, 0xd5, 0x42, 0x5b, 0x74, 0x74,
-  0x75, 0x66, 0x01, 0x58, 0x1d, 0x44, 0x77, 0x97, 0x42, 0xae, 0x69, 0x7e, 0xff, 0xfd, 0x3f, 0x6a,
-  0x21, 0x7a, 0x02, 0x47, 0xf7, 0x75, 0x2d, 0xc4, 0x1e, 0x1d, 0x7d, 0x3c, 0x1e, 0xef, 0xbf, 0x36,
-  0x77, 0x6a, 0x41, 0x5e, 0x2b, 0x90, 0xcd, 0x04, 0xf7, 0x60, 0x78, 0x38, 0x2e, 0xd3, 0xaa, 0x85,
-  0x80, 0x21, 0x1d, 0x5e, 0x1c, 0x5a, 0x66, 0xb7, 0x16, 0xa2, 0x4b, 0x47, 0xa7, 0x17, 0x6f, 0xf6,
-  0xf7, 0xcd, 0xbd, 0x5a, 0x90, 0x5d, 0x0e, 0xb2, 0xb7, 0x5f, 0x4f, 0x71, 0x6f, 0x87, 0x8e, 0x2e,
-  0x5e, 0xef, 0x5b, 0xb5, 0x00, 0xd6, 0x6b, 0x41, 0xaa, 0x65, 0x91, 0x4f, 0x73, 0x2f, 0x61, 0x75,
-  0x70, 0xbb, 0x30, 0xa4, 0xf3, 0xa0, 0x73, 0x3e, 0x9d, 0xd6, 0x42, 0xc0, 0x90, 0x2e, 0x3e, 0x9d,
-  0x3d, 0x83, 0xa6, 0x2b, 0x80, 0x8e, 0x8f, 0xaf, 0x6a, 0x41, 0x76, 0x04, 0x08, 0x30, 0xb8, 0x16,
-  0x64, 0x37, 0x05, 0xa9, 0x9d, 0x83, 0xdd, 0x5e, 0x0a, 0xd3, 0xcc, 0xf7, 0xf6, 0xe7, 0xdd, 0x8e,
-  0xbb, 0xd5, 0x6a, 0xad, 0x01, 0xef, 0x65, 0xc0, 0x6f, 0x72, 0xd0, 0xad, 0x16, 0x80, 0xb3, 0x57,
-  0x4f, 0xa0, 0x23, 0xc5, 0x06, 0xfb, 0xc0, 0x8e, 0x37, 0x6f, 0x2e, 0xb0, 0x01, 0xd1, 0x02, 0x96,
-  0xdc, 0x86, 0xd1, 0x77, 0x3d, 0xeb, 0x23, 0xa8, 0xec, 0x65, 0x1f, 0x38, 0xf4, 0xd6, 0x6a, 0xef,
-  0x58, 0xd5, 0xcd, 0x44, 0x67, 0xe5, 0xae, 0x80, 0x65, 0x87, 0x51, 0xd2, 0xfa, 0xc0, 0x92, 0xda,
-  0xee, 0xd6, 0x9b, 0xec, 0xa7, 0xd4, 0x7d, 0xaa, 0x86, 0xef, 0x08, 0x45, 0x1d, 0xa1, 0x53, 0x80,
-  0x9f, 0x68, 0x2e, 0xbc, 0x89, 0x4d, 0xdd, 0x50, 0xe8, 0x3e, 0xb7, 0xf2, 0x36, 0x95, 0x66, 0xbe,
-  0x2f, 0x83, 0x8e, 0xd1, 0x31, 0x46, 0x15, 0xe4, 0x3c, 0x9a, 0xb0, 0xa8, 0x64, 0x36, 0x8e, 0xcf,
-  0x79, 0xd3, 0x32, 0x31, 0xc0, 0xa9, 0xf7, 0x97, 0x47, 0xf5, 0xc4, 0x02, 0x53, 0xf2, 0x53, 0x5d,
-  0xfa, 0x0e, 0xc3, 0x3f, 0xba, 0x7c, 0x5f, 0xff, 0x1d, 0xc4, 0xe5, 0xf2, 0x68, 0xc3, 0x77, 0x90,
-  0x95, 0xa3, 0xf7, 0x97, 0xf5, 0xdf, 0x41, 0x4e, 0xde, 0x1f, 0x5d, 0x56, 0x32, 0xa7, 0x03, 0x7c,
-  0xc9, 0xb3, 0x67, 0xe2, 0xcd, 0x70, 0x90, 0xb7, 0x25, 0x06, 0x71, 0x97, 0x37, 0x1a, 0xdf, 0x3a,
-  0xcb, 0x3e, 0x29, 0xb2, 0xe5, 0x93, 0x64, 0x4b, 0x99, 0x29, 0x1f, 0xa0, 0x4d, 0xad, 0x56, 0x82,
-  0x52, 0x92, 0x6d, 0x52, 0xab, 0x00, 0x5d, 0xf1, 0xfd, 0x7d, 0xad, 0xc5, 0x14, 0xdf, 0xb3, 0x51,
-  0x3d, 0x3b, 0x26, 0xbf, 0x66, 0x4c, 0xc7, 0x7e, 0xe8, 0x7e, 0x5f, 0x1f, 0xd4, 0xf8, 0xa2, 0x6e,
-  0x50, 0x63, 0x3f, 0xbc, 0x65, 0x71, 0xb2, 0x61, 0x5c, 0x08, 0xb1, 0x61, 0x58, 0x1f, 0xc2, 0x68,
-  0xe1, 0xf8, 0x1b, 0xc6, 0xf5, 0xce, 0xa9, 0x47, 0xbf, 0x2b, 0x3e, 0x17, 0x08, 0xa8, 0x1a, 0x38,
-  0xfe, 0x89, 0x97, 0x4e, 0xc0, 0x19, 0xb0, 0x8c, 0x27, 0x62, 0x34, 0x62, 0xb9, 0x07, 0x1a, 0xc0,
-  0x97, 0x11, 0x19, 0x8a, 0xfd, 0x63, 0xac, 0xd0, 0xb1, 0x69, 0xb0, 0x5a, 0x5c, 0xb3, 0x88, 0x2a,
-  0x0f, 0x39, 0x16, 0x5a, 0x82, 0xad, 0xfd, 0x58, 0x3c, 0x4b, 0xd7, 0xea, 0x13, 0x91, 0x95, 0x51,
-  0x82, 0x0b, 0x0a, 0xc0, 0x11, 0x8c, 0x94, 0x51, 0xf3, 0x5f, 0x5b, 0x54, 0x51, 0xf9, 0xf3, 0x83,
-  0x0a, 0x89, 0x1c, 0x9d, 0xfb, 0x59, 0xde, 0x13, 0xb8, 0xe5, 0x5c, 0x3e, 0x87, 0x48, 0xbf, 0xd8,
-  0xe8, 0x75, 0x07, 0xb8, 0x15, 0x36, 0xa0, 0x44, 0xad, 0x09, 0x93, 0xce, 0x68, 0x3b, 0xb8, 0x8e,
-  0x97, 0x83, 0xf2, 0x1c, 0xba, 0xb5, 0x8a, 0x7b, 0xca, 0xc3, 0x8b, 0xfe, 0xc6, 0x41, 0x1d, 0x17,
-  0x07, 0x22, 0x47, 0x60, 0xc9, 0x11, 0xf0, 0xe0, 0xfd, 0xe2, 0xe8, 0x89, 0x66, 0x53, 0x99, 0x91,
-  0x94, 0x0e, 0x01, 0x69, 0xa5, 0x40, 0xa1, 0x60, 0xb6, 0x34, 0x2e, 0x9d, 0x12, 0xc7, 0x4d, 0xc9,
-  0x71, 0xbe, 0x56, 0x2f, 0x19, 0xbe, 0x89, 0x34, 0x53, 0x90, 0x96, 0xf6, 0xa7, 0xe2, 0x98, 0xb5,
-  0x20, 0x45, 0x1f, 0x40, 0xb0, 0xfe, 0x71, 0x39, 0xd1, 0x92, 0xb9, 0x17, 0x03, 0xcf, 0x3a, 0xc5,
-  0x5e, 0x2d, 0xd9, 0xeb, 0x0b, 0x3a, 0xb4, 0x0a, 0xbc, 0xf8, 0xc1, 0x7e, 0xba, 0x2f, 0xef, 0xa7,
-  0xfb, 0xcf, 0xf4, 0xb3, 0xf3, 0xf2, 0x7e, 0x76, 0xfe, 0x99, 0x7e, 0x76, 0x5f, 0xde, 0xcf, 0xee,
-  0x8f, 0xf7, 0xb3, 0x26, 0xc3, 0x51, 0xad, 0x0c, 0xa3, 0x34, 0x65, 0x54, 0x41, 0x6e, 0x24, 0xa8,
-  0x52, 0x6b, 0xbd, 0x92, 0xba, 0x35, 0x19, 0xe7, 0x4b, 0xad, 0xd7, 0xe1, 0x9d, 0xa2, 0xf0, 0xf8,
-  0x0f, 0x35, 0x96, 0x6a, 0x33, 0x18, 0x6f, 0xec, 0x7e, 0xfc, 0xdd, 0x5b, 0x92, 0xa9, 0x17, 0x41,
-  0x06, 0x86, 0x71, 0xfe, 0x46, 0x7d, 0x1a, 0x9f, 0x0a, 0x5e, 0x14, 0xec, 0x00, 0xe4, 0x9e, 0x34,
-  0xb3, 0x96, 0x6b, 0x7a, 0x53, 0x4b, 0xd4, 0x74, 0x23, 0x51, 0x10, 0x92, 0x91, 0x4b, 0x36, 0x8d,
-  0x58, 0x9c, 0x29, 0x38, 0xe7, 0xd0, 0x54, 0x10, 0x50, 0xcd, 0x88, 0xcb, 0x77, 0x9b, 0x19, 0xe1,
-  0x6c, 0xec, 0xf3, 0x70, 0x95, 0x84, 0x2d, 0xd7, 0xf1, 0xdd, 0x95, 0xef, 0x24, 0x8c, 0xdc, 0x62,
-  0xc8, 0x87, 0x45, 0xb8, 0x90, 0x39, 0xfa, 0x64, 0x1a, 0x85, 0x0b, 0x0c, 0x3d, 0xfa, 0x62, 0xc6,
-  0xf2, 0x8e, 0xe3, 0xf0, 0x53, 0x95, 0xe3, 0x30, 0x37, 0xf9, 0x42, 0x6b, 0x74, 0x14, 0x79, 0xb3,
-  0x79, 0xc2, 0xa2, 0x1a, 0x80, 0xee, 0xe8, 0xd0, 0x75, 0xb1, 0x1e, 0xb0, 0x0e, 0xc3, 0xce, 0xe8,
-  0xcd, 0xaa, 0xd6, 0xa5, 0xec, 0x8e, 0xce, 0x9c, 0xbb, 0xb2, 0xb7, 0x10, 0x26, 0x36, 0x65, 0x0e,
-  0xff, 0xfb, 0x75, 0xe0, 0x41, 0x6e, 0x1c, 0xb3, 0x28, 0x39, 0x9c, 0x7c, 0x73, 0x5c, 0xc8, 0xe6,
-  0x30, 0x49, 0xd6, 0xe8, 0x35, 0x83, 0xbc, 0x9c, 0xb1, 0x60, 0x42, 0x0d, 0x5f, 0x7f, 0x92, 0x99,
-  0x9a, 0x96, 0x7c, 0x6e, 0xb5, 0x9c, 0x2f, 0xed, 0x88, 0x2d, 0xc2, 0x1b, 0xa6, 0xe9, 0x06, 0xfc,
-  0x92, 0x8b, 0x71, 0xcd, 0x52, 0x1a, 0xed, 0x0c, 0xd3, 0x54, 0xaf, 0x65, 0x55, 0xaf, 0xf1, 0xb4,
-  0xca, 0x8d, 0x46, 0xe5, 0xe5, 0xa0, 0xe0, 0xf1, 0x91, 0x57, 0x4e, 0x14, 0x52, 0xd2, 0xe3, 0xf3,
-  0x33, 0x0d, 0x98, 0x0c, 0x39, 0x29, 0xee, 0x4d, 0x9b, 0x59, 0x69, 0x5a, 0x5d, 0x5a, 0xea, 0x86,
-  0x8b, 0xbf, 0xe0, 0x65, 0x74, 0x0f, 0x7d, 0xe6, 0x13, 0x53, 0xc8, 0xfd, 0x70, 0xc5, 0x54, 0xa6,
-  0x9f, 0x85, 0x24, 0x33, 0x6b, 0xb2, 0x29, 0xd5, 0x24, 0xc2, 0xc5, 0x6e, 0x52, 0x9b, 0xbf, 0xe7,
-  0x7c, 0xeb, 0xdd, 0x8b, 0x7c, 0xeb, 0x5e, 0xaf, 0xb7, 0xd3, 0xcb, 0x39, 0x57, 0xf6, 0xb4, 0xa6,
-  0x58, 0x39, 0xe7, 0x69, 0x53, 0x9a, 0x7a, 0xcf, 0x17, 0xf8, 0xc4, 0xbf, 0x1f, 0xe7, 0x88, 0x71,
-  0x37, 0xfa, 0xc7, 0x75, 0x2a, 0x82, 0xa7, 0x42, 0xaf, 0xeb, 0xaa, 0x2e, 0x15, 0xee, 0x87, 0xe2,
-  0x6c, 0x4e, 0x85, 0x0c, 0xd0, 0x25, 0x7d, 0xff, 0xf7, 0x62, 0x6e, 0xa5, 0x6c, 0xdc, 0x76, 0x48,
-  0xb5, 0x93, 0xdb, 0xc5, 0x42, 0xc2, 0x3c, 0x16, 0xf3, 0x35, 0xaa, 0x8d, 0x7a, 0xe8, 0x49, 0x55,
-  0xbb, 0x0b, 0x69, 0xd3, 0x51, 0x8b, 0xe1, 0x89, 0x71, 0x9d, 0x04, 0xa8, 0x0c, 0x20, 0x8b, 0xb2,
-  0x9c, 0x29, 0xd3, 0x13, 0xd0, 0x53, 0xfc, 0x94, 0x55, 0x34, 0xbd, 0x40, 0x39, 0x40, 0xa3, 0xd2,
-  0x62, 0x41, 0x73, 0xcb, 0xc6, 0xfd, 0x4f, 0x8d, 0x7d, 0x0e, 0x5a, 0x56, 0x4e, 0xed, 0x65, 0x97,
-  0xf0, 0x52, 0x74, 0xa9, 0xe7, 0xbb, 0x8c, 0x59, 0xc2, 0x95, 0x53, 0x7f, 0x40, 0x8b, 0xb1, 0x56,
-  0x79, 0x2f, 0xeb, 0x29, 0xb0, 0xac, 0x84, 0xe1, 0x92, 0xeb, 0x8b, 0x48, 0xd2, 0x59, 0xda, 0xf5,
-  0x40, 0x76, 0x5d, 0xa8, 0x10, 0x16, 0xaf, 0xa0, 0xc3, 0x94, 0xa7, 0x60, 0x20, 0xca, 0x65, 0x61,
-  0xc3, 0x22, 0x2d, 0xd5, 0x26, 0x09, 0x5b, 0x43, 0x67, 0xe5, 0xd6, 0x65, 0xc3, 0x54, 0xb0, 0x47,
-  0x47, 0x49, 0x20, 0x4a, 0x94, 0x95, 0x25, 0xe2, 0xd8, 0x80, 0xb4, 0x38, 0xbf, 0xf8, 0x68, 0x78,
-  0xbc, 0x62, 0xb4, 0x39, 0xe6, 0x9b, 0x45, 0x6d, 0x74, 0x2a, 0xc7, 0x73, 0x27, 0x3a, 0x0e, 0x27,
-  0x4c, 0xc3, 0x55, 0x44, 0xf3, 0x60, 0x77, 0xbf, 0xdf, 0xeb, 0xe9, 0x4d, 0xe0, 0x93, 0xd3, 0xb4,
-  0xbf, 0x1e, 0xad, 0x92, 0x24, 0xe4, 0x95, 0x89, 0x4f, 0xa2, 0x06, 0x64, 0x93, 0x62, 0xff, 0xfc,
-  0xe0, 0xad, 0xaf, 0x70, 0xe9, 0xa9, 0x6a, 0xdf, 0xc5, 0x45, 0x3d, 0x1e, 0x7d, 0xc5, 0x52, 0x92,
-  0xaf, 0xd2, 0x25, 0x14, 0xfc, 0xd9, 0xcf, 0x0f, 0xf4, 0xe8, 0xed, 0x8b, 0x68, 0x4c, 0xd1, 0x94,
-  0x34, 0x15, 0x48, 0x36, 0x6d, 0xdc, 0x49, 0x56, 0x6b, 0x67, 0x58, 0xbc, 0xf2, 0x34, 0x7a, 0x23,
-  0xf7, 0x6a, 0x52, 0x25, 0xa9, 0x6c, 0xde, 0xc5, 0xe6, 0xdd, 0x8a, 0xe6, 0x17, 0xab, 0x78, 0x7e,
-  0xcd, 0x59, 0xb2, 0x19, 0xc1, 0x0e, 0x22, 0xd8, 0xa9, 0x41, 0x40, 0x3c, 0xb9, 0xb5, 0xbe, 0x19,
-  0xc7, 0x2e, 0xe2, 0xd8, 0xad, 0xc0, 0x31, 0xe6, 0xe5, 0x7a, 0x9b, 0x1b, 0xf7, 0xb0, 0x71, 0xaf,
-  0x8a, 0x80, 0x93, 0x4b, 0x12, 0xb3, 0x20, 0x0e, 0xa3, 0xcd, 0x08, 0xf6, 0x10, 0xc1, 0x5e, 0x05,
-  0x82, 0xab, 0x70, 0xf5, 0x5c, 0xe7, 0xbf, 0x61, 0xdb, 0xdf, 0x2a, 0xda, 0x1e, 0x06, 0x8e, 0x1f,
-  0xce, 0x36, 0x37, 0xde, 0xc7, 0xc6, 0xfb, 0xb5, 0x8d, 0x6b, 0x98, 0x47, 0x53, 0x53, 0x47, 0x05,
-  0x52, 0x1e, 0xd2, 0x4a, 0x47, 0x00, 0x71, 0x0c, 0x8c, 0xb7, 0x4f, 0x96, 0xa1, 0x17, 0x40, 0xc4,
-  0x33, 0xe0, 0x32, 0xca, 0x8b, 0x6f, 0x28, 0x1e, 0x5a, 0x79, 0x85, 0x72, 0xfb, 0x4a, 0x57, 0x3e,
-  0x6c, 0xfb, 0xa7, 0xbb, 0xee, 0x6f, 0x56, 0x6f, 0xa0, 0x02, 0x73, 0x30, 0x99, 0x72, 0x87, 0x69,
-  0x5d, 0x99, 0xec, 0x5c, 0xc1, 0x5a, 0x32, 0xf3, 0xc7, 0x1e, 0x9a, 0x00, 0xad, 0x70, 0x12, 0x88,
-  0xe9, 0x8f, 0x8f, 0x5a, 0xf1, 0x2c, 0xd0, 0x7a, 0xcd, 0x67, 0x7a, 0x7c, 0xe4, 0x01, 0x0d, 0x93,
-  0x30, 0x94, 0x5b, 0x16, 0xc6, 0x15, 0x03, 0x70, 0x67, 0x9b, 0x57, 0xb9, 0x95, 0x9d, 0x0c, 0xb0,
-  0x3a, 0xa1, 0xbc, 0xd3, 0xc8, 0x0d, 0xa4, 0xfe, 0x03, 0x4b, 0xfc, 0x41, 0x71, 0xa5, 0x7e, 0xab,
-  0x62, 0xf7, 0x32, 0x50, 0xf8, 0xd0, 0x2c, 0x63, 0x7d, 0x68, 0x3e, 0xc1, 0x0e, 0xbe, 0xe0, 0x0a,
-  0xbd, 0xdc, 0x82, 0x8c, 0x4d, 0x0a, 0x40, 0x66, 0x19, 0x09, 0x6e, 0x29, 0xd6, 0xe3, 0x30, 0x39,
-  0x0e, 0xc1, 0xf1, 0xd8, 0xcb, 0x15, 0x90, 0x32, 0x43, 0x31, 0x39, 0x63, 0xde, 0x6a, 0x89, 0x87,
-  0x5b, 0xde, 0x79, 0x3e, 0x1e, 0x32, 0x92, 0x45, 0xc8, 0x01, 0xbb, 0x25, 0x7f, 0x3f, 0x3b, 0xfd,
-  0x3d, 0x49, 0x96, 0x97, 0x10, 0x2b, 0xb0, 0x38, 0x19, 0x04, 0xf5, 0x07, 0x79, 0x72, 0xa7, 0x44,
-  0xb2, 0x33, 0x2c, 0x98, 0x4a, 0x81, 0xc9, 0x8f, 0x97, 0x21, 0x78, 0xc4, 0x2b, 0x76, 0x97, 0x18,
-  0xfc, 0x0d, 0x90, 0x99, 0xac, 0x62, 0xac, 0x6a, 0x81, 0x41, 0xea, 0xe0, 0xa9, 0xea, 0x4f, 0xe3,
-  0x64, 0x78, 0x59, 0x1e, 0x31, 0xd6, 0x52, 0x3b, 0xee, 0x77, 0x63, 0x4b, 0x21, 0x10, 0x67, 0xbb,
-  0x2e, 0xce, 0x61, 0x36, 0x0d, 0xda, 0x11, 0xc3, 0x91, 0xdb, 0x57, 0x09, 0x1f, 0xc9, 0xbb, 0x30,
-  0x5a, 0x60, 0x19, 0x9f, 0xda, 0x35, 0x49, 0xe4, 0x21, 0x25, 0x8d, 0x62, 0x25, 0xb7, 0x2c, 0x2d,
-  0xe6, 0x45, 0xdd, 0x78, 0xbc, 0x27, 0x06, 0xf6, 0xe1, 0x09, 0x9f, 0xa0, 0x1d, 0x23, 0x4c, 0xa2,
-  0x1b, 0x15, 0x45, 0xdf, 0x5b, 0x6b, 0x47, 0xb0, 0x8e, 0xa7, 0xb3, 0x94, 0x7b, 0x46, 0x32, 0xa0,
-  0xea, 0x23, 0x05, 0x2d, 0x04, 0x33, 0x0f, 0x5e, 0x52, 0x1e, 0x1c, 0x43, 0x3e, 0x5f, 0x32, 0x07,
-  0x02, 0xa8, 0x03, 0x18, 0x09, 0xef, 0xef, 0x80, 0xa5, 0xfd, 0x1e, 0x68, 0xe8, 0xb9, 0x53, 0x2a,
-  0x34, 0x49, 0x7f, 0xda, 0x06, 0x6b, 0xde, 0xb0, 0x3b, 0x3b, 0xcf, 0x1a, 0x51, 0xdf, 0xc9, 0xda,
-  0x20, 0x00, 0x20, 0x94, 0xc8, 0xf3, 0x95, 0x9f, 0xc8, 0xe1, 0xf3, 0xa3, 0x08, 0x5c, 0x78, 0xb4,
-  0x80, 0xef, 0xc6, 0x24, 0xed, 0xf9, 0x2d, 0xdf, 0xef, 0xc2, 0x07, 0x90, 0xfd, 0x49, 0xa6, 0x33,
-  0x58, 0x19, 0xea, 0x80, 0x6f, 0x00, 0xaf, 0xd5, 0xd4, 0xd5, 0x8e, 0x11, 0x48, 0xf3, 0x40, 0x81,
-  0x62, 0x70, 0x93, 0x16, 0x7c, 0x48, 0x4f, 0x69, 0x8f, 0x1e, 0x14, 0xa8, 0x25, 0xe2, 0x82, 0x0c,
-  0x15, 0xc3, 0x1a, 0x11, 0xa5, 0x5f, 0x88, 0xb4, 0x4a, 0x6b, 0xbe, 0xf2, 0x74, 0x14, 0xfd, 0xd9,
-  0xd7, 0x5c, 0x65, 0x1b, 0x6f, 0xfa, 0xd9, 0xf9, 0x32, 0xa8, 0xdd, 0x12, 0x0b, 0x0a, 0xd0, 0xc8,
-  0x64, 0xa3, 0x76, 0xab, 0xae, 0x08, 0xcb, 0x35, 0xc5, 0x78, 0x49, 0x1d, 0xb1, 0x88, 0xa2, 0xaa,
-  0x41, 0x8f, 0xcf, 0xd7, 0x41, 0x43, 0x0c, 0x8b, 0x8d, 0x97, 0x54, 0x1b, 0x23, 0x11, 0x90, 0xb1,
-  0x57, 0xc3, 0x5e, 0xbe, 0x53, 0xb0, 0xa9, 0xd6, 0xc2, 0x9c, 0x4e, 0x6b, 0xa8, 0xf8, 0xa3, 0x0a,
-  0xf8, 0xe6, 0x49, 0x7f, 0x52, 0x53, 0x0c, 0xc1, 0x10, 0x96, 0x44, 0xa8, 0x90, 0x0e, 0x0f, 0x80,
-  0x89, 0xb7, 0x85, 0xd2, 0x1d, 0x95, 0x8d, 0x49, 0xe6, 0x88, 0x71, 0xcb, 0x21, 0x71, 0x35, 0xe3,
-  0xad, 0xc0, 0x7a, 0xab, 0x24, 0x4b, 0xfd, 0x1e, 0x1c, 0x46, 0x91, 0x73, 0xdf, 0xf6, 0x62, 0xfe,
-  0x57, 0xe3, 0x89, 0xa8, 0xae, 0x8a, 0x41, 0x4b, 0xd6, 0x9e, 0x42, 0x6c, 0xea, 0xd5, 0x8b, 0x11,
-  0x06, 0x60, 0xd8, 0x2d, 0xce, 0x3d, 0x2a, 0x21, 0x9f, 0x56, 0xac, 0x18, 0xaa, 0x1c, 0xfb, 0x15,
-  0x58, 0xef, 0x8c, 0xa5, 0x5e, 0x3b, 0x49, 0x9e, 0x38, 0x55, 0x5e, 0x54, 0x57, 0x50, 0x7a, 0x72,
-  0x99, 0x6f, 0x21, 0x81, 0xb1, 0xb7, 0xea, 0x0e, 0x4e, 0xae, 0xaa, 0xc0, 0x39, 0x4d, 0x82, 0x1f,
-  0x11, 0x83, 0xb0, 0xb2, 0xae, 0xb3, 0xcb, 0xd3, 0x52, 0x6b, 0x0e, 0x5f, 0xdf, 0xdf, 0xe5, 0x19,
-  0x2d, 0x4c, 0x65, 0xae, 0x0d, 0xb8, 0x6c, 0x95, 0x19, 0x18, 0xa8, 0xe2, 0xce, 0xe4, 0x30, 0x46,
-  0xa3, 0x0a, 0x5a, 0xad, 0xf7, 0xe5, 0x59, 0xc4, 0x0b, 0x9f, 0x61, 0xa1, 0xbe, 0x8c, 0x03, 0x1d,
-  0x82, 0xba, 0xcf, 0x0f, 0x2c, 0x8a, 0x95, 0xa1, 0x2d, 0x9a, 0x42, 0x5e, 0x81, 0x25, 0x26, 0xd7,
-  0x51, 0x78, 0x0b, 0xb9, 0x0a, 0x99, 0x84, 0x2c, 0xc6, 0x83, 0x54, 0x58, 0x09, 0x10, 0x46, 0x10,
-  0x96, 0xce, 0x19, 0xf9, 0xca, 0x4d, 0xd0, 0x57, 0xb2, 0x8c, 0xc0, 0xb8, 0x82, 0x47, 0xc1, 0x30,
-  0x9f, 0x63, 0xe2, 0x91, 0x6b, 0x8c, 0xe7, 0x4a, 0x58, 0x56, 0xfe, 0x9b, 0xa1, 0x65, 0x02, 0xea,
-  0xf0, 0xe2, 0x84, 0x78, 0x79, 0xa4, 0x7c, 0x29, 0x96, 0x24, 0xf9, 0x6e, 0xef, 0xc1, 0x54, 0xe5,
-  0x8f, 0xc9, 0x16, 0xcf, 0x69, 0x72, 0xa3, 0xc6, 0xec, 0xcf, 0x38, 0x65, 0x06, 0xb2, 0xf2, 0xcb,
-  0x20, 0x2f, 0x51, 0xa5, 0xa2, 0xb4, 0x57, 0xa2, 0x18, 0xb1, 0x10, 0x52, 0x7f, 0x79, 0x95, 0x95,
-  0xa7, 0x05, 0xbc, 0x3c, 0x8d, 0xd7, 0x5b, 0x05, 0xbc, 0xdc, 0x0b, 0xa4, 0x2a, 0xcd, 0x62, 0x12,
-  0x91, 0xc5, 0x80, 0x91, 0x67, 0x72, 0x46, 0xb0, 0x1e, 0x4d, 0xa1, 0xb1, 0xc1, 0x84, 0xf3, 0x49,
-  0xdf, 0xde, 0x66, 0x30, 0x0f, 0xae, 0xbf, 0x82, 0xc4, 0x03, 0x74, 0x8b, 0x63, 0x51, 0x84, 0xa6,
-  0xfe, 0x39, 0x51, 0xb5, 0xed, 0x8e, 0x0d, 0x02, 0xad, 0x46, 0x24, 0xc1, 0x0d, 0x33, 0x33, 0x91,
-  0x58, 0xd5, 0x07, 0xd1, 0x49, 0xae, 0xde, 0x4f, 0x84, 0x20, 0xfc, 0x90, 0x11, 0xaf, 0xc8, 0x4b,
-  0xfb, 0x82, 0x39, 0x56, 0x65, 0x65, 0x03, 0x71, 0x1a, 0x02, 0xd7, 0x72, 0xf0, 0xc0, 0xe7, 0x2a,
-  0xc0, 0xb3, 0x6f, 0x18, 0xdc, 0x35, 0x03, 0x79, 0x00, 0x1b, 0x9a, 0x4d, 0xd8, 0xdd, 0xf9, 0x14,
-  0x5a, 0x8d, 0x6c, 0x73, 0x7b, 0x3b, 0xd8, 0x92, 0xcb, 0x3e, 0x10, 0xe1, 0xf1, 0x93, 0x72, 0x54,
-  0xcf, 0x8e, 0x65, 0xe7, 0xfb, 0x50, 0x30, 0xda, 0x65, 0xe7, 0x5c, 0xa7, 0xe2, 0x40, 0x84, 0x87,
-  0x83, 0x38, 0xe7, 0x41, 0xa2, 0xe6, 0x18, 0x89, 0x01, 0x3e, 0x24, 0xb0, 0xf1, 0x58, 0x8c, 0x97,
-  0xd6, 0x90, 0x42, 0xa4, 0xd1, 0x4f, 0x7b, 0xce, 0x23, 0xf3, 0x72, 0x55, 0x5d, 0xe0, 0xaa, 0x9f,
-  0x7e, 0xb4, 0x9a, 0x50, 0x2e, 0xc9, 0x4a, 0xfd, 0xaf, 0x6c, 0xdb, 0x86, 0x08, 0x4e, 0x88, 0x64,
-  0x3b, 0xce, 0x15, 0xa2, 0x16, 0xd0, 0x60, 0x1d, 0x9e, 0xcd, 0xd2, 0x93, 0x65, 0xb2, 0x44, 0x11,
-  0x39, 0x03, 0xd6, 0x0e, 0x9d, 0x3a, 0x18, 0x46, 0x7c, 0xa9, 0x60, 0x0a, 0x47, 0x72, 0x53, 0x1a,
-  0xa4, 0x93, 0xcd, 0x95, 0x33, 0xe6, 0x9a, 0xea, 0x83, 0x4a, 0x4c, 0x72, 0xae, 0x98, 0x98, 0x7a,
-  0x07, 0xe2, 0xd6, 0xc1, 0xff, 0xca, 0x38, 0x18, 0x4a, 0xd0, 0xb0, 0xdb, 0xeb, 0xa5, 0x07, 0x30,
-  0xb3, 0xa1, 0xc8, 0x59, 0x7c, 0x01, 0xef, 0x53, 0x6d, 0xf0, 0x51, 0x1b, 0x3c, 0xdd, 0xe7, 0x07,
-  0x5c, 0x84, 0x75, 0xc7, 0xfc, 0x51, 0xf3, 0xdb, 0x22, 0x5b, 0x88, 0x8b, 0x07, 0x31, 0x78, 0x13,
-  0xdb, 0xc9, 0x26, 0x3f, 0x3d, 0x74, 0xa1, 0x9e, 0xf8, 0x09, 0xd5, 0xf4, 0x59, 0xd2, 0xf6, 0xf8,
-  0xe8, 0xa3, 0x90, 0xb4, 0xac, 0x2d, 0x5b, 0x7e, 0x3a, 0x00, 0x78, 0x2c, 0xab, 0x53, 0xbf, 0x8d,
-  0xac, 0xf9, 0x9a, 0x34, 0x59, 0xba, 0xa1, 0xd5, 0xe0, 0x2b, 0x08, 0x9d, 0x21, 0x10, 0xa2, 0x50,
-  0x43, 0x60, 0xee, 0x1f, 0x50, 0x08, 0x53, 0x68, 0x3f, 0xd1, 0x2b, 0x15, 0xa0, 0x74, 0x68, 0x44,
-  0xa0, 0x53, 0x08, 0xa4, 0x56, 0xe8, 0x7d, 0x49, 0xa4, 0x52, 0xbd, 0x82, 0xb8, 0xe4, 0x35, 0x3e,
-  0x95, 0x99, 0xf2, 0x61, 0x7c, 0xce, 0x75, 0xe0, 0x78, 0x20, 0x8e, 0x51, 0x63, 0xe0, 0x8b, 0x51,
-  0xb0, 0x46, 0xc5, 0x44, 0xa8, 0x33, 0xfc, 0x35, 0x97, 0x00, 0xf0, 0x28, 0x6e, 0x7b, 0x9b, 0x9e,
-  0x7c, 0xb8, 0xf8, 0x78, 0x25, 0xad, 0x93, 0x33, 0xc3, 0xef, 0x40, 0x30, 0x3f, 0xb1, 0x9f, 0x99,
-  0xac, 0xc7, 0xc7, 0x92, 0x15, 0x4b, 0x4d, 0x96, 0xb4, 0x54, 0x03, 0x61, 0x9a, 0xd6, 0x42, 0x37,
-  0x20, 0x48, 0x9d, 0xf1, 0x8f, 0x55, 0x04, 0xd7, 0x6c, 0x3a, 0x99, 0xf7, 0xcf, 0x3e, 0x63, 0x94,
-  0x26, 0xee, 0x0b, 0xd8, 0x92, 0xe7, 0x71, 0x80, 0x38, 0x8e, 0x3a, 0xff, 0x82, 0x8f, 0x34, 0xff,
-  0x82, 0x27, 0x96, 0xb9, 0x17, 0x41, 0xf1, 0x62, 0x01, 0xf1, 0x5a, 0xc9, 0x80, 0xfe, 0xa4, 0x0a,
-  0x9e, 0xd6, 0xae, 0x1f, 0x40, 0xb5, 0x6b, 0x01, 0x08, 0x55, 0x11, 0x7b, 0xfe, 0xa3, 0x5a, 0x46,
-  0x01, 0x0f, 0x92, 0xdf, 0xdf, 0xe1, 0xb7, 0x18, 0xc0, 0x74, 0x03, 0x63, 0x25, 0x7f, 0xd5, 0x21,
-  0x76, 0x71, 0x6b, 0x01, 0xc6, 0x23, 0x46, 0x90, 0xf6, 0xb8, 0xf2, 0xfd, 0xc2, 0x0c, 0x4b, 0x73,
-  0x28, 0x17, 0x8a, 0x60, 0x32, 0x10, 0x02, 0x8d, 0xa2, 0x2c, 0x1f, 0x93, 0x27, 0xc9, 0x4a, 0xd3,
-  0x2e, 0xb4, 0x07, 0xe6, 0xd7, 0x49, 0x97, 0xfd, 0x1c, 0x21, 0x4b, 0x18, 0xf2, 0xe4, 0xaf, 0x4d,
-  0x70, 0x32, 0x65, 0x0c, 0x60, 0x36, 0x02, 0x08, 0xa4, 0x5d, 0xfc, 0xf0, 0x21, 0x9c, 0x64, 0xb3,
-  0xc1, 0x9d, 0x45, 0xfe, 0x03, 0x64, 0x8e, 0x99, 0x4e, 0xe4, 0xcc, 0x11, 0x37, 0x74, 0xc5, 0x8a,
-  0xff, 0x20, 0xe5, 0x67, 0x2e, 0xfd, 0x1e, 0xa7, 0x5e, 0x57, 0xa6, 0x2a, 0x7e, 0xe8, 0xf2, 0xb3,
-  0xaa, 0xbc, 0xe8, 0x1a, 0xfd, 0x7a, 0x9f, 0x22, 0x6a, 0x7e, 0xd9, 0x86, 0x1b, 0xfa, 0x3a, 0xbf,
-  0x7f, 0xc3, 0x34, 0x34, 0x7e, 0x8b, 0x87, 0x8d, 0xd0, 0xfe, 0x18, 0x2c, 0x8b, 0x33, 0x63, 0x28,
-  0xba, 0x27, 0x09, 0x5b, 0x60, 0x86, 0xe8, 0x9e, 0x2c, 0x41, 0x6d, 0x20, 0x85, 0x17, 0x60, 0xd0,
-  0x7a, 0xb1, 0x04, 0x6e, 0x60, 0x4e, 0x43, 0xce, 0x80, 0xee, 0x36, 0x91, 0x71, 0x0b, 0xc3, 0x85,
-  0x05, 0xf2, 0x09, 0x6b, 0x37, 0x4f, 0x2e, 0x20, 0x58, 0x31, 0x0a, 0x18, 0xe3, 0x22, 0x46, 0x83,
-  0x63, 0xd3, 0xc1, 0xf2, 0x62, 0x71, 0xb2, 0xca, 0x80, 0x96, 0x4e, 0x32, 0xe7, 0x62, 0x03, 0x3c,
-  0x6d, 0xc7, 0xbe, 0xe7, 0x32, 0xcd, 0x02, 0xa9, 0x00, 0xc6, 0xc6, 0x9f, 0xbc, 0x64, 0xae, 0xd1,
-  0x0e, 0xd5, 0x0f, 0x5a, 0x56, 0xff, 0x26, 0xf4, 0x26, 0xc4, 0xd4, 0xdb, 0xf1, 0xd2, 0xf7, 0x12,
-  0xfe, 0x76, 0xa0, 0x2a, 0xdd, 0x46, 0x5d, 0x3c, 0xad, 0xa6, 0xae, 0x14, 0xc9, 0x46, 0x6b, 0xc8,
-  0xd1, 0x8a, 0x51, 0xb0, 0xf6, 0x3c, 0x8c, 0x13, 0xec, 0xaa, 0x09, 0xcc, 0xc5, 0x08, 0xe7, 0x00,
-  0x9c, 0x70, 0x53, 0x3c, 0x62, 0xfd, 0x68, 0x13, 0x90, 0x36, 0x13, 0xd0, 0x56, 0xfd, 0x49, 0xde,
-  0xd0, 0x51, 0xba, 0x2c, 0xa4, 0x13, 0xb7, 0xbf, 0xc5, 0x07, 0x4b, 0xbb, 0x4b, 0xf1, 0x2c, 0x30,
-  0x1f, 0x2e, 0x0f, 0x25, 0xf1, 0xda, 0x0b, 0x3e, 0x23, 0x76, 0xb9, 0x09, 0xd8, 0xb5, 0x98, 0xe6,
-  0x97, 0x6a, 0x25, 0x48, 0x7a, 0xbf, 0x08, 0x92, 0x7e, 0xa0, 0xc8, 0x07, 0x22, 0x80, 0x0a, 0x4e,
-  0x31, 0xa7, 0x89, 0x3d, 0x35, 0x86, 0x1d, 0x79, 0xff, 0xcb, 0x90, 0xeb, 0xdf, 0xe8, 0x5f, 0xbc,
-  0x05, 0x0f, 0xfa, 0x56, 0x11, 0xba, 0x03, 0x51, 0xa1, 0x1b, 0x63, 0xf1, 0x27, 0x00, 0x72, 0x80,
-  0x61, 0x47, 0xdc, 0x66, 0x83, 0x77, 0x7b, 0x10, 0x99, 0x7c, 0xd2, 0x31, 0xdf, 0x14, 0x04, 0x19,
-  0x5d, 0x34, 0xf8, 0xe2, 0x3f, 0x3e, 0xfd, 0x15, 0xa7, 0x1b, 0x8c, 0x53, 0x4a, 0x16, 0x2c, 0x99,
-  0x87, 0xb8, 0x47, 0x0b, 0x6c, 0x02, 0xd0, 0xdc, 0x86, 0x4c, 0x12, 0x02, 0x6d, 0xb7, 0xc5, 0x77,
-  0x73, 0xe6, 0x2f, 0x8f, 0xe8, 0xa8, 0x31, 0x14, 0x0b, 0x83, 0x72, 0x65, 0x54, 0xfc, 0xc8, 0xad,
-  0x34, 0xfd, 0x8e, 0xdd, 0x1e, 0x0c, 0x3b, 0xe2, 0x43, 0xba, 0x97, 0x5f, 0xd5, 0xa6, 0x91, 0x36,
-  0x3a, 0xc2, 0x46, 0x47, 0x8e, 0xfb, 0x3d, 0x6b, 0x57, 0x68, 0x21, 0x2f, 0x14, 0x19, 0x8d, 0x9d,
-  0x1b, 0x96, 0x81, 0xcc, 0xd5, 0x22, 0xff, 0x70, 0xde, 0x1d, 0x35, 0x50, 0x26, 0xb7, 0x9d, 0xc5,
-  0x72, 0x40, 0x7e, 0x77, 0x22, 0x2c, 0x69, 0xc6, 0x28, 0x3b, 0x59, 0x2d, 0x81, 0x39, 0xdd, 0xd1,
-  0x55, 0x98, 0x38, 0xbe, 0xda, 0x76, 0x4d, 0xb7, 0x81, 0x7d, 0x97, 0x93, 0x2a, 0x4b, 0x36, 0xb2,
-  0x3d, 0x6b, 0x17, 0x87, 0x99, 0x2d, 0x8b, 0x0d, 0xbd, 0xd1, 0x25, 0x83, 0x64, 0x0c, 0x4c, 0xc4,
-  0x04, 0x82, 0xe4, 0x65, 0x78, 0x0b, 0x3a, 0x20, 0x6b, 0x72, 0xb1, 0xa8, 0xf6, 0x5a, 0x6c, 0x31,
-  0xc6, 0x89, 0xd8, 0xca, 0xec, 0x0f, 0x3b, 0x9e, 0x68, 0x77, 0x2d, 0xb7, 0x9c, 0x1b, 0xa2, 0x52,
-  0x64, 0x95, 0xf5, 0x86, 0x45, 0xcc, 0xc5, 0x2d, 0x69, 0x5e, 0x3e, 0x2b, 0x37, 0x2e, 0xd2, 0x9e,
-  0x1b, 0x6f, 0x03, 0xf4, 0x93, 0xc4, 0x59, 0x25, 0x21, 0x5e, 0x04, 0xe2, 0xca, 0xbe, 0x02, 0x16,
-  0xc7, 0xc4, 0xc7, 0xfb, 0x3a, 0x58, 0xf4, 0xcc, 0x9e, 0xf5, 0xe1, 0x11, 0x93, 0xac, 0x96, 0xab,
-  0xd5, 0xf2, 0x70, 0xb2, 0xd8, 0x97, 0xe2, 0x67, 0x97, 0x45, 0xaf, 0x6a, 0x0b, 0x17, 0x4f, 0x85,
-  0xe3, 0xb6, 0x26, 0xde, 0x67, 0x44, 0x8e, 0x57, 0x11, 0x9a, 0xe0, 0xb4, 0x0f, 0x79, 0x8b, 0xd1,
-  0xd9, 0x21, 0x5d, 0x5b, 0x19, 0x5f, 0xdb, 0xd8, 0xea, 0xf6, 0xb2, 0x0d, 0x36, 0xd3, 0x2c, 0x6d,
-  0x56, 0xa7, 0x9b, 0x5b, 0xa3, 0x06, 0x59, 0x1c, 0x16, 0xbb, 0xcf, 0x4e, 0xbc, 0x2a, 0xa4, 0xf8,
-  0xbb, 0xa6, 0xc0, 0xa8, 0xb1, 0xfd, 0xd3, 0xeb, 0xfd, 0xfd, 0xfd, 0x01, 0xf9, 0xb7, 0x70, 0x15,
-  0x15, 0x67, 0x06, 0x24, 0xf8, 0x06, 0xb7, 0x1f, 0xc8, 0x1c, 0x38, 0x46, 0x5c, 0x31, 0x90, 0x36,
-  0xe7, 0xea, 0x55, 0x48, 0x40, 0xa5, 0xe0, 0x3b, 0xe3, 0x89, 0x54, 0xec, 0x4c, 0x99, 0x48, 0x9f,
-  0xee, 0x11, 0x0b, 0x97, 0x1a, 0x03, 0x01, 0x97, 0xc2, 0xe8, 0x41, 0x0c, 0x81, 0x69, 0x91, 0xfb,
-  0x9d, 0xb8, 0xc8, 0xaf, 0x98, 0x7f, 0x6b, 0x2c, 0x56, 0x7e, 0xe2, 0x01, 0x84, 0xec, 0xd5, 0x0b,
-  0xbe, 0x31, 0x19, 0x8f, 0xe2, 0xf2, 0x6b, 0x4c, 0x9c, 0x60, 0x02, 0xf9, 0xdd, 0x14, 0x1a, 0x6f,
-  0x65, 0xdb, 0x51, 0x20, 0x4a, 0x8d, 0x43, 0x35, 0x99, 0x8e, 0x0f, 0x64, 0xf2, 0x59, 0x8c, 0xf3,
-  0xf3, 0x9a, 0x84, 0xb8, 0x55, 0x79, 0x0f, 0xa3, 0x0f, 0x63, 0x7e, 0xa9, 0x00, 0xd2, 0xc8, 0xc1,
-  0x04, 0xf5, 0x7f, 0x63, 0x6c, 0x49, 0x9c, 0x84, 0x6c, 0xfb, 0xc9, 0xc0, 0x3a, 0x24, 0xde, 0x54,
-  0x50, 0x80, 0x95, 0xf2, 0xbc, 0x16, 0x7e, 0x02, 0x8c, 0x75, 0x13, 0x94, 0x4d, 0xdc, 0x4a, 0xc7,
-  0xc6, 0x59, 0x31, 0x3a, 0x27, 0xa5, 0x71, 0xc2, 0x47, 0xca, 0xef, 0xb9, 0x48, 0xef, 0x22, 0x00,
-  0x1f, 0xc7, 0xa2, 0x00, 0x94, 0x24, 0xcf, 0x44, 0x43, 0x1a, 0x7c, 0xa4, 0x10, 0xef, 0xcc, 0x09,
-  0x66, 0x82, 0x04, 0x4d, 0xca, 0x05, 0x01, 0xa1, 0xc7, 0x1b, 0x6a, 0x40, 0x2b, 0x56, 0x31, 0x78,
-  0x00, 0xa5, 0x5c, 0x72, 0xe2, 0x96, 0x68, 0x43, 0x56, 0xc1, 0xf7, 0x00, 0x62, 0x2d, 0x29, 0xd5,
-  0x7a, 0xa6, 0x1c, 0x91, 0xd0, 0xd9, 0x9b, 0xd0, 0x4f, 0xf0, 0xb2, 0x1d, 0xed, 0x0c, 0x4f, 0x05,
-  0xc8, 0x79, 0xe2, 0x7a, 0xe5, 0x10, 0x24, 0x0e, 0x38, 0x0c, 0x60, 0x7a, 0x45, 0x3d, 0x00, 0xaf,
-  0xc0, 0x5f, 0x93, 0x6d, 0xbc, 0x57, 0xa0, 0x54, 0x5a, 0x86, 0x75, 0x13, 0x69, 0x2a, 0x94, 0x2d,
-  0xb7, 0x8f, 0x80, 0x27, 0xf2, 0x48, 0x3c, 0xd1, 0x7a, 0xbd, 0xc5, 0xa1, 0xde, 0xa8, 0x2d, 0x1d,
-  0xeb, 0x71, 0x68, 0x36, 0x9d, 0x7a, 0x2e, 0x9e, 0xef, 0x20, 0xda, 0x0e, 0xc2, 0x6f, 0xaa, 0x50,
-  0x6e, 0x60, 0x31, 0xbf, 0xb6, 0x63, 0x6e, 0x00, 0xc3, 0x82, 0x8e, 0x91, 0x2c, 0xfd, 0xd7, 0xac,
-  0xee, 0x06, 0x48, 0xac, 0x09, 0x6e, 0x1c, 0xf3, 0x15, 0xf7, 0x8a, 0xe2, 0xb4, 0x82, 0x21, 0x11,
-  0xe7, 0xfa, 0x6b, 0xd4, 0x45, 0xa0, 0x10, 0x07, 0x30, 0x14, 0xab, 0xf1, 0xec, 0x04, 0x70, 0x38,
-  0xd5, 0x71, 0xc5, 0xdc, 0x75, 0x15, 0x2f, 0xd7, 0xa2, 0x70, 0xbb, 0xe6, 0x3b, 0xf5, 0xda, 0xad,
-  0x94, 0x5b, 0xd5, 0xfe, 0x64, 0xc2, 0xab, 0xf8, 0xee, 0xe5, 0x44, 0x31, 0x88, 0x57, 0xf0, 0xc7,
-  0xb9, 0x0e, 0x81, 0x08, 0xae, 0x89, 0xd8, 0x3f, 0xaa, 0x25, 0x8a, 0x75, 0x3b, 0x15, 0x1c, 0x69,
-  0xf2, 0x77, 0x46, 0x8d, 0x92, 0xa1, 0xdf, 0xc9, 0xec, 0x08, 0x96, 0xb6, 0xf3, 0xcb, 0xd5, 0xc4,
-  0xb1, 0x90, 0xb8, 0xaf, 0xda, 0x15, 0xab, 0x0b, 0x94, 0x9f, 0x69, 0x14, 0x5d, 0x13, 0x62, 0x68,
-  0xe6, 0xbc, 0x5a, 0xba, 0x7c, 0x8a, 0x51, 0x00, 0x1d, 0x35, 0x53, 0x27, 0x44, 0x6a, 0x5c, 0x1b,
-  0x22, 0x68, 0x55, 0x20, 0x68, 0x49, 0x0c, 0xad, 0x9c, 0xa7, 0x8b, 0x38, 0x9d, 0x67, 0xfc, 0x2c,
-  0x0c, 0xf9, 0x98, 0xd7, 0x23, 0x3e, 0x10, 0x98, 0x7a, 0x53, 0xb9, 0x23, 0xd2, 0xc9, 0x7f, 0xb1,
-  0x72, 0xee, 0xeb, 0xa8, 0x60, 0x45, 0xf9, 0x39, 0x25, 0xd2, 0xa8, 0xac, 0x10, 0x68, 0x5d, 0x63,
-  0x55, 0xe6, 0x80, 0x5f, 0x64, 0xd7, 0xb7, 0x4c, 0x73, 0x79, 0x37, 0x98, 0x33, 0xb4, 0x3e, 0xf0,
-  0x03, 0x9e, 0xaf, 0xf9, 0x7a, 0x62, 0x0b, 0x0f, 0x32, 0xad, 0xe2, 0x7e, 0x17, 0x5e, 0xa9, 0x3a,
-  0x9f, 0x46, 0xa1, 0x8b, 0xdc, 0xb9, 0xa1, 0x1f, 0x34, 0xd4, 0x20, 0x49, 0xd0, 0x1b, 0x89, 0x56,
-  0x30, 0x8c, 0x40, 0x58, 0xbb, 0x6b, 0x0f, 0x82, 0x3c, 0x30, 0xc1, 0x11, 0xf1, 0x9d, 0x19, 0xf1,
-  0xe2, 0x78, 0x05, 0x41, 0x34, 0x76, 0xf7, 0x11, 0x4c, 0xa0, 0xcf, 0xad, 0x22, 0xa8, 0x38, 0xc9,
-  0xb9, 0x53, 0x75, 0xd0, 0x68, 0x54, 0x71, 0x06, 0x48, 0xf1, 0x04, 0x8d, 0x08, 0xda, 0xbf, 0x6b,
-  0xf4, 0xcd, 0xec, 0x0e, 0x00, 0x40, 0x77, 0xdd, 0x82, 0x3d, 0x06, 0x71, 0x68, 0xe4, 0xe5, 0xe1,
-  0xcc, 0xf9, 0xce, 0xd0, 0xf0, 0xb0, 0xd9, 0x42, 0x99, 0x21, 0x06, 0x59, 0xb4, 0x44, 0xfc, 0x8c,
-  0xaf, 0x3d, 0x1b, 0x53, 0xc1, 0x24, 0xa9, 0x66, 0xd7, 0xab, 0x58, 0x54, 0x9d, 0xc0, 0x38, 0x27,
-  0x10, 0xe8, 0xc6, 0xb5, 0xed, 0x73, 0x36, 0x4c, 0x6c, 0xfe, 0xf0, 0x7d, 0x18, 0xb9, 0xc6, 0x28,
-  0x7d, 0x75, 0xec, 0x09, 0x4f, 0x8d, 0x2c, 0x99, 0xf9, 0xe1, 0xb5, 0x08, 0x68, 0xa0, 0x93, 0xe9,
-  0x34, 0x17, 0x05, 0x34, 0xaa, 0x49, 0x3b, 0x7d, 0x53, 0xda, 0xb1, 0x16, 0xda, 0xb4, 0xae, 0x0f,
-  0x38, 0xbd, 0x0d, 0x51, 0xcd, 0xed, 0x87, 0xd1, 0x5f, 0x5c, 0x18, 0xfe, 0x5a, 0x40, 0xe6, 0x83,
-  0x13, 0x9d, 0xaf, 0x2d, 0x21, 0x6a, 0x83, 0xbf, 0x9f, 0x2b, 0x00, 0xcf, 0xaa, 0x2c, 0xea, 0x18,
-  0x5c, 0xad, 0x2f, 0xaa, 0x35, 0xd6, 0x13, 0x14, 0x94, 0x86, 0x2f, 0x87, 0x17, 0x14, 0xae, 0xb1,
-  0x19, 0x03, 0xd6, 0x14, 0x64, 0x18, 0x54, 0x61, 0xc6, 0xba, 0xc2, 0xd5, 0x11, 0xa7, 0x46, 0xc2,
-  0x97, 0x30, 0x25, 0x94, 0xdc, 0x4b, 0x27, 0x7c, 0x53, 0x95, 0x7b, 0x48, 0xc8, 0x25, 0x5b, 0xab,
-  0x65, 0x07, 0x97, 0x10, 0x9e, 0xe3, 0xfb, 0xc9, 0x85, 0xe0, 0x33, 0xdf, 0x4e, 0x06, 0x61, 0xc4,
-  0x42, 0xbb, 0xd0, 0x9f, 0xd4, 0xd4, 0x17, 0x64, 0xa5, 0x8f, 0x8d, 0x82, 0xb5, 0xb5, 0x30, 0x84,
-  0x12, 0x08, 0xaf, 0xae, 0x72, 0xf6, 0x15, 0x31, 0x9f, 0x5c, 0x6e, 0xaa, 0x58, 0xe0, 0x68, 0x5a,
-  0x16, 0x22, 0x44, 0x44, 0xbb, 0xfb, 0x29, 0x61, 0x97, 0x9b, 0x4a, 0x18, 0xd6, 0x3c, 0xed, 0xc9,
-  0x55, 0x59, 0x7a, 0x1a, 0xe5, 0xaa, 0xa1, 0x4b, 0x30, 0x61, 0x09, 0x23, 0x93, 0xf5, 0xe2, 0x83,
-  0x72, 0xfd, 0x50, 0x77, 0xb7, 0xf5, 0x9d, 0xdd, 0x17, 0x4e, 0x69, 0x34, 0xca, 0x55, 0x44, 0x12,
-  0x8a, 0x1f, 0xa0, 0xab, 0x3f, 0xf2, 0xb1, 0x83, 0xa7, 0x77, 0x38, 0xe0, 0x35, 0xfc, 0xae, 0xc5,
-  0x87, 0x87, 0x7c, 0xca, 0xbd, 0x96, 0x4b, 0x8b, 0xba, 0xd6, 0xb3, 0xa4, 0xed, 0xd1, 0xd1, 0x9e,
-  0xec, 0x90, 0xe7, 0x2c, 0xd5, 0xb8, 0x7e, 0xa3, 0xa3, 0xd7, 0x1c, 0x2a, 0xca, 0xb1, 0xa2, 0x51,
-  0x2a, 0x03, 0x18, 0xf1, 0x2d, 0x80, 0x88, 0xb3, 0xae, 0xc2, 0xb7, 0x57, 0x6c, 0xf0, 0xcb, 0xfd,
-  0xfd, 0x5c, 0x02, 0xf5, 0x0a, 0xf7, 0xf7, 0xf9, 0xce, 0xc9, 0xab, 0xfa, 0xdd, 0xfd, 0xc6, 0x21,
-  0x8f, 0x8b, 0x41, 0x5e, 0xc4, 0x44, 0x62, 0x68, 0xb9, 0x70, 0xbc, 0x20, 0x35, 0x76, 0x78, 0xdb,
-  0xd9, 0xb3, 0x16, 0xee, 0x3c, 0x4b, 0x17, 0x44, 0x5e, 0xc9, 0x8f, 0xf6, 0x55, 0x1b, 0xfd, 0x74,
-  0x73, 0x63, 0x0d, 0x2b, 0xbf, 0xa0, 0x51, 0x62, 0xe4, 0xbb, 0xbb, 0xa4, 0xe1, 0xb8, 0x2e, 0x5b,
-  0x42, 0x00, 0xd1, 0xe6, 0xe8, 0x6a, 0xac, 0x44, 0x4e, 0x55, 0x73, 0x63, 0xcf, 0xed, 0x8d, 0xd3,
-  0x8e, 0x17, 0x09, 0x0c, 0xc0, 0x88, 0x8f, 0xfc, 0x7d, 0x95, 0xda, 0x3b, 0xa4, 0x01, 0x8a, 0x38,
-  0xb5, 0x2b, 0xef, 0x1a, 0xe5, 0xbc, 0x9d, 0x3a, 0x60, 0xad, 0xe1, 0x71, 0x1a, 0x41, 0x78, 0x31,
-  0xe9, 0x40, 0x28, 0xc4, 0xf7, 0x6d, 0x6d, 0xfa, 0x17, 0x4c, 0x79, 0xf0, 0x9d, 0xa2, 0xd6, 0xc1,
-  0xd7, 0x70, 0xd8, 0x71, 0x04, 0x6f, 0x2f, 0x71, 0x07, 0xe8, 0x45, 0x8a, 0xb8, 0xa6, 0x87, 0x97,
-  0xa7, 0x65, 0x3d, 0x6c, 0xe4, 0x14, 0x91, 0x88, 0x0b, 0x2a, 0x36, 0x4f, 0xcb, 0xe5, 0x19, 0x55,
-  0xa9, 0x66, 0x8d, 0xa8, 0x14, 0x25, 0x05, 0xb7, 0xbd, 0x36, 0x48, 0x4a, 0xd9, 0x2e, 0x42, 0x64,
-  0x25, 0x6f, 0x4e, 0x8b, 0x79, 0x98, 0x75, 0x85, 0xeb, 0x52, 0xdc, 0xeb, 0xe2, 0x7a, 0xdb, 0x14,
-  0x73, 0x04, 0x91, 0x37, 0x80, 0x59, 0xe4, 0xdb, 0x98, 0xcf, 0xd9, 0xc5, 0x23, 0x29, 0x47, 0x12,
-  0x6b, 0x2e, 0xff, 0x59, 0x8b, 0x43, 0x8f, 0x21, 0x0e, 0x6d, 0x54, 0x5a, 0xc9, 0x45, 0x55, 0x48,
-  0x9a, 0x85, 0x9e, 0x9a, 0xd9, 0x82, 0x37, 0xba, 0xca, 0x35, 0x0e, 0x65, 0x52, 0x88, 0xc4, 0x81,
-  0x0f, 0xc9, 0x77, 0x71, 0x74, 0x51, 0x93, 0xcd, 0x96, 0x7b, 0x30, 0x0b, 0xa9, 0x2b, 0xc4, 0xb1,
-  0xd7, 0x61, 0x08, 0xc9, 0x80, 0x89, 0x39, 0x62, 0xac, 0x82, 0xda, 0x38, 0xed, 0x14, 0x5d, 0xf5,
-  0x7b, 0x67, 0xb1, 0x70, 0x88, 0x1b, 0x46, 0x91, 0xcc, 0x0f, 0x31, 0xa6, 0xe0, 0xce, 0xf5, 0x39,
-  0x1e, 0xbd, 0x87, 0x08, 0x96, 0x68, 0x71, 0x12, 0x85, 0x90, 0x05, 0xa1, 0x19, 0x49, 0xd7, 0x20,
-  0x78, 0x07, 0x8d, 0x5a, 0xec, 0x15, 0xcc, 0xac, 0xe9, 0x01, 0x17, 0x74, 0x88, 0x16, 0xc0, 0x18,
-  0xd6, 0xb1, 0x67, 0xc8, 0xb9, 0xa5, 0x5a, 0x9b, 0x95, 0xf7, 0x7f, 0xd4, 0xb3, 0xac, 0xc1, 0x97,
-  0x69, 0xd1, 0xcb, 0xb1, 0x08, 0x78, 0xd6, 0xde, 0x5f, 0x2b, 0x76, 0xdd, 0x41, 0x6b, 0xc1, 0x96,
-  0xc0, 0xd6, 0xb6, 0xb5, 0xe6, 0xcb, 0xf8, 0xb0, 0x8e, 0xb2, 0x54, 0x18, 0xd4, 0x30, 0xc9, 0xf1,
-  0x49, 0x4e, 0xd7, 0xbb, 0x67, 0xa6, 0xcb, 0x2a, 0xe4, 0x28, 0x99, 0x44, 0xfc, 0x82, 0x62, 0x7c,
-  0x15, 0x39, 0x41, 0xec, 0xf1, 0x3d, 0x12, 0x2e, 0xc9, 0xc7, 0x51, 0x18, 0xc7, 0x53, 0x67, 0xc2,
-  0x9e, 0x61, 0xd5, 0xd5, 0x3b, 0x2a, 0x97, 0x64, 0xf8, 0xe9, 0x69, 0x30, 0xfd, 0xc0, 0x2b, 0x88,
-  0x89, 0x9e, 0x69, 0xf6, 0xf6, 0x48, 0xfa, 0xff, 0xb4, 0x5b, 0x82, 0x17, 0xb7, 0xae, 0x2f, 0xa8,
-  0x5c, 0xbd, 0xa9, 0x19, 0xd3, 0x9d, 0x5f, 0x2e, 0x58, 0x86, 0x60, 0x00, 0x32, 0xab, 0x38, 0xbf,
-  0x40, 0x74, 0xe1, 0xf8, 0x2c, 0x01, 0xd7, 0x9b, 0x64, 0xa3, 0x7b, 0x86, 0xb0, 0x0b, 0x39, 0x1e,
-  0x5c, 0xdc, 0x72, 0x82, 0x09, 0x44, 0xab, 0xc7, 0xf7, 0xae, 0xcf, 0x1a, 0x98, 0x66, 0xa5, 0xe8,
-  0x0a, 0xa4, 0x4a, 0x4a, 0x2f, 0x7e, 0x80, 0xfb, 0x23, 0x12, 0x8b, 0xa4, 0x01, 0x19, 0x0f, 0xb8,
-  0x26, 0xc4, 0xc7, 0xb9, 0xe5, 0x8c, 0x57, 0x9a, 0xff, 0x46, 0xde, 0xc6, 0xbb, 0xde, 0xcf, 0xe9,
-  0x7a, 0x3f, 0x8d, 0x4d, 0xd3, 0x9c, 0x4b, 0x39, 0xbd, 0x20, 0x6f, 0x58, 0xae, 0xb8, 0xe1, 0xae,
-  0x52, 0x09, 0xc5, 0xfa, 0xa3, 0x17, 0x6b, 0x7f, 0x6f, 0x4d, 0x5c, 0x71, 0x69, 0x3c, 0x3b, 0xdd,
-  0xa6, 0xf0, 0x7d, 0xaa, 0x3a, 0xda, 0xf6, 0xc9, 0xf1, 0x12, 0xbe, 0x24, 0x04, 0xe6, 0x67, 0x43,
-  0x5c, 0xf4, 0x0e, 0x04, 0x71, 0x53, 0x44, 0x84, 0xdf, 0x09, 0x0f, 0xc2, 0x37, 0x44, 0x43, 0xe3,
-  0x55, 0x10, 0x79, 0x71, 0x45, 0x30, 0xd1, 0xc0, 0x79, 0xe0, 0x27, 0x6c, 0xf1, 0xf2, 0x4a, 0xc8,
-  0x33, 0xd1, 0xed, 0xf3, 0xc9, 0x10, 0x2f, 0x8f, 0x1c, 0x70, 0x6e, 0x2e, 0xcb, 0x99, 0x93, 0xfa,
-  0x84, 0x45, 0x5a, 0xe7, 0xe3, 0xab, 0xb5, 0xe5, 0xc3, 0x5b, 0x97, 0x8e, 0xde, 0x8b, 0xec, 0x24,
-  0x94, 0x09, 0x02, 0xb7, 0x49, 0x55, 0x87, 0x3e, 0xf2, 0x6b, 0x3a, 0x8d, 0xf4, 0x90, 0x07, 0xad,
-  0x5c, 0x26, 0x79, 0xf3, 0x4c, 0x50, 0xb9, 0x7e, 0x26, 0xb2, 0x51, 0x66, 0xee, 0x33, 0x47, 0x41,
-  0x90, 0xbf, 0xb5, 0x87, 0x41, 0x1a, 0x19, 0x7b, 0x37, 0x9c, 0x07, 0xc1, 0x20, 0xb3, 0xf2, 0x44,
-  0x08, 0xd7, 0xd5, 0xe3, 0x74, 0xf4, 0xc0, 0xb6, 0xec, 0xa0, 0xcb, 0x33, 0x67, 0x8e, 0x2e, 0xa5,
-  0xdd, 0xc1, 0x36, 0x90, 0x10, 0x81, 0x72, 0xdf, 0xb0, 0x3a, 0xeb, 0x53, 0xce, 0x23, 0xca, 0x69,
-  0x84, 0x9a, 0xb9, 0xa3, 0xbc, 0xd2, 0xfc, 0x92, 0xad, 0xaa, 0x1c, 0x4e, 0x6e, 0x50, 0x08, 0x26,
-  0x5c, 0x2e, 0x94, 0x21, 0xc8, 0xf5, 0x57, 0x48, 0x0c, 0x2e, 0x8e, 0x2a, 0x13, 0x81, 0x53, 0x7e,
-  0x1b, 0x0a, 0xd1, 0x6e, 0x23, 0x67, 0x89, 0x4b, 0x3c, 0x8b, 0xf0, 0x06, 0x1a, 0xeb, 0x1b, 0x04,
-  0xbf, 0xa1, 0x9a, 0x38, 0xfe, 0xad, 0x73, 0x1f, 0x13, 0x6c, 0xa9, 0x6f, 0x98, 0x28, 0x05, 0x1e,
-  0xe0, 0x01, 0xae, 0x35, 0xe8, 0x46, 0x59, 0x25, 0x50, 0x34, 0x2a, 0xfc, 0x5c, 0xf5, 0x3c, 0x49,
-  0x93, 0x11, 0x89, 0x63, 0x51, 0xb8, 0xf0, 0xc9, 0x5e, 0xc6, 0x67, 0x65, 0x91, 0xac, 0x6e, 0x9a,
-  0xae, 0xbd, 0xbb, 0x2c, 0xb8, 0xa0, 0x77, 0x17, 0xe3, 0xca, 0x8c, 0x9b, 0x67, 0xaf, 0x53, 0x9e,
-  0x60, 0xe3, 0x05, 0xe5, 0x24, 0x61, 0x8b, 0xa5, 0x5f, 0xee, 0x57, 0x04, 0xce, 0x8d, 0x2c, 0x72,
-  0xee, 0x52, 0xf2, 0xff, 0x1f, 0x39, 0x53, 0x55, 0x14, 0x99, 0xd6, 0x4e, 0x76, 0x21, 0xaf, 0xe3,
-  0x81, 0x52, 0x75, 0xb2, 0xfc, 0xbf, 0xb4, 0x8f, 0xd3, 0xc1, 0xad, 0xa9, 0xdc, 0xca, 0x83, 0xb8,
-  0x46, 0x5d, 0x75, 0xdb, 0xc1, 0x5d, 0x2d, 0xdc, 0xe2, 0xc2, 0xff, 0x1b, 0x87, 0xff, 0x07, 0xad,
-  0x20, 0xfa, 0xe3, 0xd6, 0x61, 0x00, 0x00
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x13, 0xdd, 0x7d, 0xe9, 0x56, 0xe3, 0xc8,
+  0x92, 0xf0, 0x7f, 0x3f, 0x45, 0x92, 0xdd, 0x4d, 0x49, 0x6d, 0xd9, 0x96, 0x0c, 0xa6, 0x29, 0xdb,
+  0x32, 0x03, 0xd4, 0xd2, 0xcc, 0x85, 0x82, 0x83, 0xa9, 0xae, 0x3b, 0xa7, 0xba, 0xa6, 0x4b, 0xc8,
+  0x69, 0x5b, 0x55, 0xb2, 0xe4, 0x2b, 0xc9, 0x2c, 0x03, 0xcc, 0x33, 0xcd, 0x33, 0xcc, 0x93, 0x7d,
+  0x11, 0xb9, 0x68, 0xb1, 0x24, 0x43, 0x7d, 0x77, 0xe6, 0xcf, 0xf4, 0x39, 0x85, 0xb5, 0x44, 0x46,
+  0x46, 0x46, 0xc6, 0x9a, 0x19, 0xa9, 0x1e, 0x6e, 0xbd, 0x39, 0x3f, 0xbe, 0xfa, 0xb7, 0x8b, 0xb7,
+  0x64, 0x9e, 0x2c, 0xfc, 0xd1, 0x10, 0xff, 0x12, 0xdf, 0x09, 0x66, 0x36, 0x65, 0x01, 0x85, 0x7b,
+  0xe6, 0x4c, 0x46, 0xc3, 0x05, 0x4b, 0x1c, 0xe2, 0xce, 0x9d, 0x28, 0x66, 0x89, 0x4d, 0x57, 0xc9,
+  0xb4, 0xb5, 0x4f, 0xe5, 0xd3, 0x86, 0x1b, 0x06, 0x09, 0x0b, 0xe0, 0xf1, 0xad, 0x37, 0x49, 0xe6,
+  0xf6, 0x84, 0xdd, 0x78, 0x2e, 0x6b, 0xf1, 0x1b, 0xc3, 0x0b, 0xbc, 0xc4, 0x73, 0xfc, 0x56, 0xec,
+  0x3a, 0x3e, 0xb3, 0x2d, 0x63, 0xe1, 0xdc, 0x79, 0x8b, 0xd5, 0x22, 0xbd, 0x5f, 0xc5, 0x2c, 0xe2,
+  0x37, 0xce, 0x35, 0xdc, 0x07, 0x21, 0x25, 0x8d, 0xc0, 0x59, 0x30, 0x9b, 0xde, 0x78, 0xec, 0x76,
+  0x19, 0x46, 0x09, 0xf4, 0x92, 0x78, 0x89, 0xcf, 0x46, 0xa7, 0x6f, 0xdf, 0x90, 0x31, 0x4b, 0x12,
+  0x2f, 0x98, 0xc5, 0xc3, 0x8e, 0x78, 0x36, 0x8c, 0xdd, 0xc8, 0x5b, 0x26, 0xa3, 0xc6, 0x8d, 0x13,
+  0x91, 0x89, 0x3d, 0x09, 0xdd, 0xd5, 0x02, 0x28, 0x31, 0x7c, 0x67, 0x19, 0xb1, 0x1b, 0xbb, 0xd7,
+  0xc3, 0xfe, 0x8e, 0x44, 0xb7, 0x7f, 0xd8, 0x26, 0xfe, 0x9c, 0xd9, 0xbb, 0x6c, 0x07, 0x2f, 0x2e,
+  0x8e, 0xec, 0x5d, 0xf3, 0xf5, 0x1e, 0x5e, 0x9e, 0xda, 0xd6, 0xce, 0x0e, 0x7f, 0x78, 0x7a, 0xfd,
+  0x8f, 0x55, 0x98, 0xd8, 0xe6, 0x60, 0xd2, 0x5e, 0x2d, 0xfe, 0x5a, 0xda, 0x9f, 0xbf, 0x18, 0x93,
+  0x76, 0x14, 0xdf, 0x4c, 0xe4, 0x55, 0xf8, 0xd7, 0x6c, 0xe9, 0x85, 0xe2, 0x06, 0xc0, 0xc5, 0x5d,
+  0xcf, 0x1c, 0x60, 0xff, 0x7e, 0xe8, 0x7a, 0x4b, 0x23, 0xf1, 0x16, 0x2c, 0x5c, 0x25, 0x86, 0xbb,
+  0x8a, 0x93, 0x70, 0x31, 0x4e, 0x9c, 0x28, 0x89, 0xed, 0x2d, 0xcb, 0x88, 0xf9, 0xd5, 0x1b, 0x2f,
+  0x4a, 0xee, 0xb1, 0x39, 0x34, 0x3e, 0x3e, 0x3f, 0xbf, 0x61, 0x51, 0xe4, 0x4d, 0x58, 0x6c, 0xf7,
+  0x0c, 0x68, 0x8d, 0x60, 0xf0, 0xb3, 0x8c, 0xc2, 0x24, 0xb4, 0xe9, 0x3c, 0x49, 0x96, 0x7d, 0x3a,
+  0x98, 0xae, 0x02, 0x37, 0xf1, 0xc2, 0x80, 0xfc, 0xae, 0xe9, 0x0f, 0xb7, 0x5e, 0x30, 0x09, 0x6f,
+  0xdb, 0xe1, 0x92, 0x05, 0x1a, 0x07, 0x88, 0xfb, 0x9d, 0xce, 0xf7, 0x20, 0x6c, 0xdf, 0xfa, 0x6c,
+  0xd2, 0x9e, 0xb1, 0xce, 0x94, 0x39, 0xc9, 0x2a, 0x62, 0x71, 0x27, 0x96, 0x9c, 0xea, 0xfc, 0x04,
+  0x6f, 0x5a, 0xea, 0x8e, 0xea, 0x4f, 0x29, 0xbe, 0xa3, 0x35, 0x7c, 0x33, 0x96, 0x7c, 0xbc, 0x3c,
+  0xd5, 0x68, 0x27, 0x03, 0x36, 0xe8, 0x5f, 0x31, 0xf3, 0xa7, 0xf9, 0x56, 0xb3, 0x93, 0x89, 0xc6,
+  0xf4, 0x87, 0x88, 0x41, 0x37, 0x01, 0xc1, 0x3e, 0x93, 0xb7, 0x3e, 0x43, 0xa6, 0x1f, 0xdd, 0xf3,
+  0x57, 0x19, 0x68, 0x38, 0x9d, 0x22, 0x68, 0x1e, 0x26, 0x3e, 0xba, 0xff, 0x00, 0xb3, 0x0b, 0x8f,
+  0x3f, 0x9b, 0x5f, 0xda, 0x37, 0x8e, 0xbf, 0x62, 0x76, 0xcb, 0xca, 0x9a, 0xf8, 0xa1, 0x33, 0xf9,
+  0xd7, 0xb1, 0xc6, 0x8c, 0xc0, 0xde, 0x32, 0xf5, 0x07, 0x9f, 0x25, 0x24, 0xb1, 0x27, 0x6d, 0x37,
+  0x82, 0x61, 0x31, 0x89, 0x43, 0xa3, 0x62, 0xd2, 0xa9, 0x3e, 0x48, 0xda, 0x40, 0xeb, 0x61, 0x92,
+  0x44, 0xde, 0xf5, 0x2a, 0x61, 0xf0, 0x22, 0x72, 0xa9, 0xc1, 0x74, 0x63, 0xfd, 0x79, 0x72, 0xbf,
+  0x64, 0xd4, 0xa0, 0x09, 0xbb, 0x4b, 0x3a, 0xdf, 0x9c, 0x1b, 0x47, 0x21, 0x28, 0x01, 0x3a, 0xf1,
+  0x7d, 0x00, 0x28, 0x02, 0x1d, 0xa6, 0xf7, 0x3a, 0x9c, 0xdc, 0xb7, 0x9d, 0x25, 0xb0, 0x66, 0x72,
+  0x3c, 0xf7, 0xfc, 0x89, 0x96, 0x20, 0xbc, 0x33, 0x99, 0xbc, 0xbd, 0x01, 0x2a, 0x4e, 0xbd, 0x18,
+  0x64, 0x9e, 0x45, 0x1a, 0x45, 0x9a, 0xa9, 0xa1, 0xe9, 0xf6, 0xe8, 0xe1, 0x3d, 0x4b, 0xfe, 0xd0,
+  0x74, 0xc3, 0x9d, 0x33, 0xf7, 0xfb, 0xd8, 0x83, 0x2b, 0xc4, 0x7e, 0x74, 0xaa, 0x21, 0xba, 0xf1,
+  0xb4, 0xa2, 0x6d, 0xbc, 0xba, 0x5e, 0x78, 0x09, 0x35, 0x92, 0xe8, 0x7e, 0xcc, 0x2f, 0x75, 0xa3,
+  0x65, 0xd9, 0xb6, 0x10, 0x3e, 0x60, 0xd1, 0xf6, 0xb6, 0xb8, 0x6c, 0xc7, 0x73, 0x6f, 0x9a, 0x00,
+  0x9e, 0xa5, 0x17, 0xbc, 0x89, 0xc2, 0x25, 0x4c, 0x5a, 0x10, 0x6b, 0xfa, 0x53, 0x35, 0x45, 0x20,
+  0x54, 0x61, 0x04, 0x8c, 0x00, 0x8a, 0x40, 0x35, 0xe3, 0xd0, 0x67, 0x6d, 0x3f, 0x9c, 0x69, 0xf4,
+  0x2d, 0x3e, 0x27, 0x92, 0xcd, 0x30, 0xc3, 0x64, 0xea, 0xf9, 0x8c, 0x33, 0x0c, 0x74, 0x31, 0x02,
+  0xc6, 0x9e, 0xca, 0xe7, 0xe1, 0x94, 0x40, 0xc3, 0xa9, 0x37, 0x5b, 0x45, 0x0e, 0x9f, 0x17, 0xc1,
+  0x30, 0x32, 0x75, 0x3c, 0x94, 0xb3, 0x3f, 0x83, 0x93, 0xc0, 0x0d, 0x17, 0x4b, 0x98, 0x1e, 0x46,
+  0x96, 0xce, 0x8c, 0x91, 0x89, 0x93, 0x38, 0x5b, 0x20, 0x26, 0xb9, 0xd9, 0x8f, 0xe7, 0xe1, 0xed,
+  0x55, 0xe8, 0xc4, 0x89, 0x98, 0x4d, 0x4b, 0x7f, 0x40, 0x1d, 0x49, 0x6c, 0x14, 0x20, 0x9a, 0xe0,
+  0x0b, 0x3e, 0x81, 0x5e, 0x00, 0x24, 0xff, 0x7e, 0x75, 0x76, 0x6a, 0x33, 0x18, 0x8b, 0xeb, 0x3b,
+  0x71, 0x8c, 0x12, 0x62, 0x07, 0x07, 0x72, 0x18, 0x7d, 0x8a, 0x98, 0xa8, 0xe1, 0xfa, 0xcc, 0x89,
+  0xae, 0x84, 0x72, 0x69, 0x52, 0xc9, 0xf8, 0x04, 0x26, 0xf7, 0x30, 0x3e, 0x27, 0xf0, 0x16, 0x9c,
+  0x54, 0x9b, 0x06, 0x61, 0x00, 0x83, 0x92, 0x10, 0x36, 0xcc, 0x80, 0x6a, 0xa4, 0x29, 0xda, 0x40,
+  0xf0, 0xf3, 0x5d, 0xe5, 0xae, 0xdb, 0x11, 0x5b, 0xfa, 0x8e, 0x8b, 0xa2, 0xc4, 0x3b, 0xa5, 0x38,
+  0x26, 0xa3, 0xfb, 0xda, 0x34, 0x73, 0x23, 0xbb, 0x3e, 0xf5, 0x60, 0xa6, 0x62, 0x1c, 0x97, 0x91,
+  0x18, 0x8e, 0xe1, 0xe9, 0x0f, 0xdc, 0xca, 0x30, 0x61, 0x65, 0x02, 0x61, 0x65, 0x1c, 0x69, 0x63,
+  0x12, 0x61, 0x60, 0xbc, 0xac, 0x3d, 0xcc, 0x61, 0x7c, 0xfe, 0x37, 0x4d, 0x30, 0x84, 0xd9, 0x5c,
+  0x34, 0xfe, 0xb1, 0x62, 0x20, 0x02, 0xcc, 0x67, 0x6e, 0x12, 0x46, 0x87, 0xbe, 0xaf, 0xd1, 0x9f,
+  0x16, 0xa7, 0xc7, 0xc4, 0x0b, 0x96, 0xab, 0xe4, 0x33, 0x1a, 0xc4, 0x7f, 0xb7, 0x4f, 0xbf, 0x00,
+  0xc3, 0xa6, 0x61, 0xa4, 0x79, 0x60, 0x9e, 0xbc, 0x21, 0xcc, 0x29, 0x0b, 0x66, 0xc9, 0x7c, 0xe0,
+  0x35, 0x9b, 0x02, 0x55, 0x60, 0xb3, 0xcf, 0xde, 0x97, 0x36, 0x42, 0xb7, 0x41, 0xb0, 0x62, 0x90,
+  0xea, 0x60, 0xa6, 0x99, 0x46, 0x57, 0x1f, 0x78, 0x53, 0x98, 0x5c, 0x93, 0xda, 0x76, 0xf0, 0xf8,
+  0x48, 0x4f, 0x2d, 0x75, 0xd1, 0x55, 0x17, 0x3b, 0x78, 0xa1, 0x66, 0xa8, 0x0a, 0x8b, 0xc0, 0xb1,
+  0x44, 0xf3, 0x7f, 0x02, 0x2a, 0x58, 0xa5, 0xd3, 0xf4, 0xf4, 0x8a, 0x36, 0x93, 0x4c, 0xb1, 0x0d,
+  0xcb, 0xd4, 0x47, 0xf6, 0xbe, 0xa9, 0xa3, 0x7b, 0xf0, 0x82, 0x15, 0x7b, 0x02, 0x0c, 0x2f, 0x20,
+  0x03, 0x2f, 0x76, 0x39, 0x3d, 0xdb, 0xdb, 0x94, 0x6e, 0x09, 0x72, 0x38, 0x46, 0xb8, 0x6f, 0x59,
+  0x85, 0x27, 0x82, 0x64, 0xc7, 0x16, 0x36, 0xba, 0x0d, 0x3d, 0xb9, 0x0e, 0x52, 0x87, 0x3a, 0xc3,
+  0x29, 0xae, 0x61, 0x6e, 0xcc, 0x6f, 0xda, 0x30, 0x13, 0x54, 0x6f, 0x03, 0x4f, 0xdf, 0x3a, 0xee,
+  0x5c, 0x43, 0x7d, 0x61, 0x02, 0xef, 0xa8, 0x65, 0x6d, 0x6f, 0x3b, 0xed, 0xe5, 0x2a, 0x9e, 0x67,
+  0x83, 0x96, 0xef, 0x74, 0x14, 0x09, 0xa7, 0x1d, 0x87, 0x30, 0xe6, 0xc0, 0x1e, 0x05, 0xb6, 0x9d,
+  0x41, 0x64, 0x84, 0xe9, 0xba, 0x34, 0x91, 0x42, 0xb5, 0xbe, 0x8e, 0xc3, 0x28, 0xba, 0x37, 0xf8,
+  0xdc, 0x93, 0x9f, 0x1f, 0xfe, 0x75, 0x7c, 0xfe, 0xa1, 0x2d, 0x58, 0xeb, 0x4d, 0xef, 0x35, 0x47,
+  0x7f, 0x22, 0xae, 0x13, 0xbc, 0x4a, 0xc8, 0x35, 0x23, 0xe0, 0x11, 0x27, 0xed, 0xaf, 0xba, 0x91,
+  0x21, 0xb3, 0x29, 0x15, 0x77, 0x53, 0xf0, 0x6f, 0xa0, 0xf6, 0xc6, 0x96, 0x85, 0x63, 0xeb, 0xfc,
+  0xba, 0xa5, 0x05, 0x0b, 0x62, 0xdb, 0x84, 0x9e, 0x5c, 0x52, 0xf2, 0xf8, 0x48, 0x82, 0x85, 0x6d,
+  0xd3, 0xa3, 0x2b, 0xaa, 0x93, 0xed, 0xed, 0x5f, 0x3b, 0xa9, 0xbb, 0xfa, 0x1f, 0xa5, 0x35, 0xc5,
+  0x0a, 0x34, 0x3b, 0x11, 0x13, 0x22, 0x0a, 0x46, 0xc5, 0xbf, 0x7f, 0x9e, 0x68, 0x94, 0xde, 0x6f,
+  0xb6, 0xd7, 0xb4, 0x06, 0xdf, 0x32, 0xf9, 0xfd, 0xa6, 0xe4, 0xd7, 0x87, 0x89, 0xfd, 0xf6, 0x8c,
+  0xfc, 0xfa, 0x4a, 0x70, 0x7c, 0x25, 0x38, 0xbe, 0x12, 0x1c, 0x5f, 0x09, 0x8e, 0xaf, 0x3f, 0x70,
+  0x78, 0xb8, 0xb4, 0xfd, 0x02, 0x26, 0x4b, 0x17, 0x3d, 0x85, 0x95, 0x3d, 0xbd, 0x54, 0xc6, 0xc3,
+  0x67, 0x64, 0x5c, 0x08, 0xed, 0xb7, 0x54, 0x68, 0x73, 0x3c, 0xc9, 0x3d, 0x5f, 0xe3, 0xf9, 0x85,
+  0x17, 0x70, 0x9b, 0xeb, 0x7b, 0x2e, 0x4a, 0x41, 0x72, 0xcb, 0x58, 0x00, 0xcc, 0x4f, 0x75, 0xf1,
+  0xa9, 0x83, 0x37, 0x92, 0xe8, 0xa7, 0x2d, 0xce, 0xea, 0x6f, 0x05, 0x56, 0x7f, 0xcb, 0xb3, 0xfa,
+  0x09, 0xfe, 0x13, 0x1d, 0x6c, 0x99, 0x99, 0xe5, 0x49, 0xdd, 0x0c, 0xfa, 0x65, 0xa5, 0x1d, 0x68,
+  0xbb, 0x73, 0x78, 0xda, 0x18, 0x39, 0xc1, 0x90, 0xdf, 0xb0, 0xa9, 0xb3, 0xf2, 0xd1, 0xe7, 0x6c,
+  0x29, 0x83, 0xa5, 0x48, 0x06, 0xa6, 0x25, 0xe1, 0xf2, 0x02, 0xfc, 0x90, 0x33, 0x73, 0x84, 0x41,
+  0x95, 0x22, 0xc9, 0xa3, 0xa7, 0x91, 0x05, 0xe6, 0x52, 0x5a, 0x24, 0x7a, 0x15, 0x86, 0x64, 0xe1,
+  0x04, 0xf7, 0x04, 0xc2, 0xb7, 0x98, 0x80, 0x00, 0x90, 0x05, 0x23, 0x49, 0x48, 0xe6, 0x4e, 0x30,
+  0xf1, 0xd9, 0x16, 0x1d, 0xa0, 0xb1, 0x1c, 0x5a, 0x6c, 0x77, 0x7b, 0x5b, 0x0b, 0x9a, 0x36, 0xfd,
+  0x33, 0xf8, 0x33, 0x3a, 0x06, 0xa7, 0x05, 0x51, 0x51, 0x04, 0xaa, 0x80, 0xde, 0xc8, 0x09, 0xc8,
+  0xdb, 0xf1, 0xc5, 0x4e, 0xb7, 0x4d, 0x95, 0xa3, 0x0a, 0xf4, 0x27, 0x4e, 0x3a, 0x77, 0xb4, 0x7f,
+  0x38, 0xbe, 0x37, 0xf1, 0x92, 0x7b, 0x4d, 0x47, 0x6f, 0x09, 0x4f, 0x85, 0x53, 0xd5, 0x72, 0x16,
+  0x9b, 0x05, 0xdc, 0x0b, 0x4b, 0x83, 0xcb, 0x3d, 0x10, 0x86, 0x9b, 0xa0, 0xfb, 0x1c, 0x03, 0x9b,
+  0x0c, 0x78, 0xc3, 0xd3, 0x43, 0xc9, 0x07, 0x76, 0x20, 0x02, 0xc8, 0xbe, 0x69, 0x28, 0x60, 0x80,
+  0x15, 0x9e, 0x66, 0xe2, 0xc5, 0xe0, 0x22, 0xee, 0x01, 0x86, 0x7a, 0x81, 0xef, 0x81, 0xaf, 0xe9,
+  0x4b, 0x97, 0xc3, 0x41, 0x97, 0xf1, 0xaa, 0xfb, 0x02, 0xd8, 0x42, 0x7f, 0x23, 0x73, 0x7b, 0x3b,
+  0x8d, 0x14, 0x3e, 0x9e, 0x14, 0x29, 0x3f, 0x3d, 0x2c, 0x7a, 0x8a, 0xd3, 0x43, 0x30, 0x5e, 0xa2,
+  0xdd, 0x3a, 0xd5, 0x82, 0x82, 0xd3, 0x43, 0xe8, 0xb6, 0x44, 0x42, 0xcf, 0xb4, 0x2b, 0xc8, 0x28,
+  0x76, 0xa6, 0x68, 0x78, 0x88, 0x6f, 0xbd, 0x04, 0x0c, 0x62, 0x05, 0xa3, 0x20, 0x2c, 0x33, 0xd6,
+  0xc9, 0x00, 0xdc, 0x46, 0x4e, 0x6b, 0x72, 0x24, 0x81, 0xba, 0xb9, 0x4e, 0xcc, 0x88, 0xd9, 0xaf,
+  0x44, 0x65, 0x19, 0x72, 0x62, 0x06, 0xd7, 0x10, 0xe0, 0x7d, 0x1f, 0x70, 0xd8, 0x1d, 0xb3, 0x5f,
+  0xea, 0x60, 0xc7, 0x2c, 0x40, 0xf4, 0x2a, 0x20, 0x7a, 0x79, 0x88, 0x5e, 0x05, 0x44, 0xaf, 0x00,
+  0xd1, 0xad, 0x02, 0xe9, 0xa6, 0x30, 0x13, 0x21, 0xfc, 0xfd, 0x0d, 0x0c, 0x55, 0xac, 0x7c, 0xe2,
+  0x30, 0x0b, 0x0b, 0x00, 0xb2, 0x58, 0x06, 0x85, 0x3a, 0x17, 0x33, 0xb3, 0xe4, 0x8c, 0x2d, 0x30,
+  0x5e, 0x50, 0x21, 0xed, 0x33, 0x46, 0xe6, 0x98, 0x36, 0x83, 0xcc, 0xc8, 0x40, 0x98, 0xd4, 0x7c,
+  0xa6, 0xc5, 0xf8, 0x74, 0xad, 0x05, 0x76, 0xe3, 0x40, 0x9c, 0x90, 0xc6, 0xe9, 0x38, 0xd4, 0x37,
+  0x8a, 0xf5, 0xa0, 0x6b, 0x8e, 0xbd, 0xfb, 0x2b, 0xc4, 0x4f, 0x6c, 0xb8, 0xd3, 0x3d, 0xd0, 0xba,
+  0x7b, 0x60, 0xb1, 0xb6, 0xb7, 0xbb, 0xaf, 0xe1, 0xe7, 0xf1, 0x51, 0x4b, 0x7e, 0xb5, 0xbb, 0xba,
+  0x91, 0x29, 0xe6, 0x0e, 0x46, 0xa4, 0x55, 0x74, 0x9a, 0x85, 0x5e, 0x0f, 0xd8, 0xa8, 0xbb, 0x7f,
+  0xd0, 0x35, 0x7f, 0x4d, 0x9a, 0x4e, 0xdf, 0xea, 0xf1, 0x1f, 0x44, 0x32, 0xb2, 0x01, 0x8b, 0x78,
+  0xb9, 0xcf, 0x1f, 0xee, 0xf1, 0xbf, 0xfc, 0xc1, 0x2e, 0xbf, 0xdc, 0xc1, 0xbf, 0x3a, 0x3c, 0xd9,
+  0x01, 0xb7, 0xcb, 0x86, 0xbb, 0xfb, 0x07, 0x3d, 0xf1, 0x2c, 0xe3, 0x21, 0x48, 0x2a, 0xe3, 0x51,
+  0x24, 0x8e, 0x0c, 0xe3, 0x49, 0x23, 0xc1, 0x3f, 0x38, 0x46, 0x21, 0x5b, 0x8b, 0xe5, 0xad, 0x13,
+  0x05, 0x60, 0x2f, 0x4a, 0x33, 0xc5, 0x07, 0x7f, 0xa6, 0x74, 0xed, 0xb7, 0xae, 0x69, 0x96, 0xf4,
+  0x00, 0x66, 0xde, 0xb6, 0x0b, 0xa2, 0x2b, 0x2d, 0x80, 0x6d, 0x75, 0xfb, 0x25, 0x5d, 0xd5, 0xe4,
+  0xbb, 0xa2, 0xac, 0x1b, 0x9b, 0x02, 0x39, 0x11, 0x70, 0xa8, 0x48, 0xee, 0xea, 0x4b, 0x2e, 0xec,
+  0xf0, 0x20, 0xec, 0x10, 0xee, 0xcf, 0x2b, 0x7b, 0x24, 0x23, 0xcc, 0x66, 0xde, 0x53, 0x93, 0x8b,
+  0x6e, 0x54, 0x18, 0x1b, 0x73, 0x42, 0x9b, 0x7e, 0x5e, 0xf0, 0x42, 0xf4, 0x46, 0xdb, 0xdb, 0xe1,
+  0xf0, 0xf5, 0xde, 0x01, 0x3d, 0xb9, 0x20, 0x90, 0x1c, 0x40, 0x36, 0x18, 0xf7, 0x69, 0x3f, 0x1c,
+  0xed, 0xbe, 0x3e, 0xa0, 0x6f, 0xc0, 0xd8, 0x93, 0xf7, 0x17, 0x27, 0xe7, 0xe2, 0x89, 0x75, 0x40,
+  0xf1, 0x06, 0xdf, 0x53, 0xf1, 0x54, 0x5a, 0x31, 0xab, 0x8c, 0x78, 0xf7, 0x35, 0xe2, 0xdd, 0xdb,
+  0x3d, 0xa0, 0xc7, 0xfe, 0x77, 0x85, 0x03, 0x3c, 0x86, 0xd3, 0xb4, 0xa5, 0x80, 0x87, 0x86, 0x0f,
+  0xc9, 0x8f, 0x6d, 0x0d, 0xdc, 0x61, 0x6f, 0xe0, 0x2a, 0xb7, 0x1e, 0xd7, 0x08, 0x0f, 0x6d, 0xba,
+  0xd0, 0x05, 0x48, 0xcf, 0x20, 0x06, 0x96, 0xe6, 0x08, 0xdf, 0xde, 0x76, 0x87, 0xbb, 0x8f, 0x8f,
+  0xa2, 0x47, 0xc8, 0x86, 0x5c, 0x7e, 0x6d, 0xe1, 0xcb, 0x1e, 0x80, 0xb8, 0xcd, 0x5d, 0x73, 0x18,
+  0x1e, 0x68, 0x71, 0x8d, 0x42, 0x1a, 0x31, 0x44, 0xf1, 0xff, 0x58, 0x79, 0x11, 0xb7, 0x56, 0x7a,
+  0xbf, 0x0c, 0x28, 0xe6, 0x3c, 0x0f, 0x06, 0xe9, 0x79, 0xea, 0x02, 0x21, 0xbe, 0x03, 0x5d, 0x10,
+  0x0c, 0x8e, 0xa6, 0x9c, 0x0d, 0xca, 0x62, 0x55, 0x3c, 0x7b, 0x7c, 0xdc, 0x01, 0x12, 0x43, 0x23,
+  0xe4, 0xb2, 0x1b, 0x82, 0xec, 0x42, 0xdb, 0x5a, 0xad, 0xf6, 0x73, 0x79, 0x2f, 0x04, 0x23, 0x46,
+  0x1e, 0x21, 0xc4, 0xae, 0xe0, 0xfc, 0xbf, 0xdb, 0x1c, 0xdf, 0x01, 0xe6, 0x93, 0x5b, 0x56, 0x9f,
+  0xa7, 0x95, 0x4f, 0x46, 0xf2, 0x68, 0x07, 0x30, 0x05, 0xd6, 0x6f, 0xd8, 0x45, 0xb7, 0x8b, 0x0c,
+  0xe9, 0xee, 0xe3, 0xf5, 0x0e, 0xbf, 0xde, 0xe5, 0x9c, 0xdb, 0x05, 0xce, 0xed, 0xee, 0x6c, 0xd9,
+  0xe1, 0xe3, 0xe3, 0xfe, 0x3e, 0xd2, 0xc4, 0xb1, 0xbb, 0x21, 0xc7, 0x5e, 0x64, 0x41, 0x8e, 0xdb,
+  0xd8, 0xde, 0x96, 0x08, 0xf6, 0x0f, 0x04, 0x6f, 0xfa, 0x29, 0x2f, 0x39, 0x8a, 0x89, 0x37, 0x03,
+  0x1c, 0x4d, 0x7a, 0x4b, 0xcb, 0x78, 0x14, 0x19, 0x25, 0x95, 0xca, 0x53, 0x58, 0xcd, 0x90, 0x4f,
+  0xe7, 0x45, 0x86, 0x98, 0x7a, 0xb1, 0x3b, 0xb7, 0xa2, 0xbb, 0x17, 0x52, 0x1a, 0xd1, 0x0d, 0x23,
+  0xde, 0xdc, 0x34, 0xa6, 0xff, 0x33, 0xcc, 0x9a, 0x56, 0xe1, 0xb1, 0xf6, 0xb2, 0x49, 0xb3, 0x7b,
+  0xa6, 0x52, 0xa8, 0xaa, 0x40, 0x42, 0xe1, 0x71, 0x4a, 0x78, 0x02, 0x98, 0x66, 0x13, 0xa6, 0x79,
+  0x73, 0x3b, 0xbf, 0xa2, 0xff, 0xdd, 0xfd, 0x4d, 0x3d, 0x82, 0x49, 0x2b, 0x5b, 0x93, 0x6c, 0xb0,
+  0x27, 0xc1, 0x0d, 0xc4, 0x5e, 0x6c, 0x42, 0x20, 0x97, 0x86, 0x90, 0x1f, 0xda, 0x5e, 0x42, 0xa0,
+  0x08, 0xb6, 0x69, 0x42, 0xb4, 0x28, 0x4c, 0x1c, 0x7c, 0x65, 0xed, 0x9b, 0xff, 0xfd, 0x5f, 0x7a,
+  0x1a, 0x0a, 0x4d, 0x36, 0xe3, 0x9b, 0xb0, 0x3b, 0x34, 0x21, 0x7c, 0x8d, 0xac, 0x4f, 0x9f, 0xe4,
+  0xf4, 0xdf, 0x96, 0xe7, 0x3d, 0x29, 0x11, 0x9c, 0x70, 0xa1, 0x02, 0x7b, 0x7b, 0xf8, 0xa9, 0x2d,
+  0x6c, 0x2b, 0x9b, 0x70, 0x84, 0xb6, 0x8c, 0x4f, 0x8e, 0x2f, 0x73, 0x71, 0x86, 0x2e, 0xd6, 0xe7,
+  0x7e, 0x28, 0xd5, 0x06, 0xcb, 0x6b, 0x1a, 0x31, 0xfc, 0x8b, 0xc0, 0xc5, 0x64, 0x69, 0xb7, 0x5f,
+  0x4a, 0xbb, 0x97, 0xb6, 0x5f, 0x93, 0x76, 0x1b, 0xab, 0xca, 0x57, 0x2a, 0x9f, 0x39, 0x86, 0x3c,
+  0x61, 0x29, 0x73, 0x15, 0xcc, 0x6d, 0x96, 0x2a, 0xb7, 0x59, 0xea, 0xb5, 0x06, 0x64, 0xc5, 0xf5,
+  0x05, 0xbc, 0xaa, 0xcd, 0x57, 0x17, 0x06, 0x15, 0x8d, 0x55, 0x62, 0xb4, 0x54, 0x89, 0x91, 0xe8,
+  0xe3, 0xf9, 0xbc, 0x66, 0x95, 0x0b, 0x20, 0x78, 0x52, 0xf3, 0xc0, 0xa9, 0xc7, 0xce, 0xc0, 0x3f,
+  0x1a, 0xe2, 0xc6, 0x0b, 0x80, 0x25, 0xfc, 0x52, 0x4c, 0x91, 0x1b, 0xfa, 0x61, 0x64, 0xd3, 0x9f,
+  0xa6, 0xd3, 0x29, 0x1d, 0xa4, 0x59, 0x50, 0xda, 0x30, 0x5b, 0x25, 0xcd, 0xda, 0xb7, 0xac, 0xdc,
+  0x4a, 0xc0, 0x26, 0xba, 0x55, 0x42, 0xb7, 0x94, 0x2b, 0x01, 0x7e, 0x69, 0x25, 0xc0, 0x5f, 0x5b,
+  0x09, 0x70, 0x6b, 0x56, 0x02, 0x70, 0xfe, 0xfe, 0x99, 0xa5, 0x00, 0x77, 0xc3, 0x52, 0xc0, 0x37,
+  0x90, 0x8b, 0x6f, 0x99, 0x5c, 0x60, 0x3a, 0x0b, 0xc3, 0xf3, 0xb6, 0xec, 0x6f, 0x82, 0xa6, 0x1b,
+  0xa0, 0xf2, 0xb9, 0xb4, 0xf6, 0x46, 0x71, 0xe1, 0x46, 0x71, 0xe1, 0x46, 0x71, 0xe1, 0x46, 0x71,
+  0xe1, 0x26, 0x97, 0xd6, 0xde, 0x54, 0xa6, 0xb5, 0x8b, 0xca, 0x9e, 0x5e, 0x9a, 0xd6, 0x2e, 0x36,
+  0xa5, 0xb5, 0x82, 0xfd, 0xdf, 0x4a, 0xec, 0xcf, 0x9e, 0xac, 0xb3, 0x28, 0x7b, 0x87, 0xd8, 0xf4,
+  0xa7, 0x27, 0x57, 0x2c, 0x43, 0x00, 0x6b, 0x59, 0x6e, 0x19, 0x22, 0x37, 0x83, 0xfa, 0x41, 0x59,
+  0xae, 0xc0, 0x3b, 0xd3, 0x7e, 0xe9, 0xf1, 0xda, 0xca, 0xc6, 0x26, 0x94, 0x34, 0x8c, 0x9c, 0x60,
+  0x86, 0x86, 0x83, 0x8b, 0xe8, 0xd3, 0x13, 0xf3, 0x63, 0xc6, 0xb9, 0x35, 0xad, 0x6a, 0x81, 0xb4,
+  0x0e, 0xf2, 0x4b, 0xf7, 0x90, 0x99, 0x65, 0x0b, 0xf7, 0x9f, 0x57, 0x5f, 0xc0, 0xee, 0x70, 0x2b,
+  0xe5, 0xc7, 0xa8, 0x30, 0xd2, 0x73, 0x85, 0xd2, 0x74, 0xc9, 0x87, 0x60, 0xb6, 0x30, 0xd5, 0x01,
+  0xcb, 0x93, 0xc7, 0x64, 0x4c, 0x21, 0x32, 0xd0, 0xee, 0xb3, 0x5e, 0x4b, 0x78, 0x74, 0xbd, 0x39,
+  0x1d, 0x85, 0x18, 0x0c, 0xd9, 0xf7, 0xcd, 0xa9, 0x6e, 0x4c, 0x47, 0x11, 0xdc, 0x44, 0x36, 0x5c,
+  0xfe, 0x98, 0xf6, 0x0e, 0xd1, 0x5f, 0x69, 0x71, 0x13, 0x5a, 0x02, 0xe3, 0x45, 0x3f, 0x68, 0x55,
+  0x71, 0x01, 0xfc, 0x58, 0x6e, 0xd6, 0xc8, 0xf0, 0x60, 0x59, 0x7a, 0x6e, 0xdb, 0xf1, 0x01, 0x05,
+  0x7e, 0x69, 0xb4, 0x19, 0x37, 0x29, 0x59, 0xce, 0xef, 0x63, 0xcf, 0x75, 0x7c, 0x65, 0xd5, 0x17,
+  0x66, 0x21, 0xd3, 0x71, 0x0c, 0xb1, 0x63, 0xe2, 0x74, 0x30, 0xd4, 0xff, 0x15, 0x52, 0x7f, 0xe9,
+  0x86, 0xae, 0x9d, 0xcc, 0x09, 0x5f, 0x3b, 0xee, 0xf7, 0x59, 0x14, 0xae, 0x82, 0x89, 0xfd, 0x15,
+  0xcd, 0xb8, 0x13, 0xb5, 0x66, 0x91, 0x33, 0xf1, 0x70, 0x35, 0xff, 0xb5, 0x39, 0x61, 0x33, 0x83,
+  0xfc, 0xfc, 0x20, 0xd6, 0x0e, 0xf6, 0xcc, 0x03, 0x71, 0xf1, 0x1a, 0xa2, 0x74, 0x3e, 0xfb, 0xb9,
+  0x19, 0x74, 0x5d, 0x97, 0x3e, 0x11, 0x53, 0x01, 0x3f, 0xfd, 0x62, 0x90, 0x9f, 0x76, 0x77, 0x77,
+  0xb3, 0x7b, 0x02, 0xfd, 0xff, 0xa2, 0x7f, 0x95, 0xb3, 0xc1, 0x26, 0x75, 0x29, 0x41, 0x34, 0x3a,
+  0x73, 0x92, 0x39, 0x5a, 0x23, 0x8d, 0xdb, 0x51, 0x63, 0xdf, 0x34, 0xf5, 0xc7, 0x47, 0xd1, 0xf3,
+  0xbe, 0x59, 0xed, 0x1f, 0x2b, 0xf0, 0x09, 0x71, 0x54, 0xd8, 0x9c, 0xbb, 0x0a, 0x6c, 0x96, 0xb9,
+  0x3e, 0x10, 0xe9, 0xe6, 0x20, 0xd1, 0x8c, 0xc3, 0xa0, 0xc0, 0xcc, 0xac, 0xff, 0x7d, 0xf3, 0x17,
+  0x5c, 0x85, 0x07, 0x74, 0x6d, 0x5c, 0x39, 0x21, 0x0b, 0xb6, 0x08, 0xa3, 0x7b, 0xda, 0xcc, 0x56,
+  0x58, 0x0e, 0xbe, 0x12, 0x6d, 0x78, 0x3d, 0x7a, 0x7b, 0x79, 0x79, 0x7e, 0xd9, 0x27, 0x1f, 0xf9,
+  0x4a, 0x49, 0x08, 0xfe, 0x18, 0x98, 0xc1, 0xb3, 0xcf, 0xa3, 0xad, 0x61, 0xe7, 0x7a, 0xa4, 0x7f,
+  0x85, 0x10, 0x5d, 0xef, 0x03, 0x3e, 0x53, 0xac, 0xc0, 0x2c, 0x01, 0x42, 0x3a, 0x70, 0xee, 0x14,
+  0x67, 0x36, 0xa7, 0xdd, 0x65, 0x9e, 0xaf, 0x69, 0x80, 0xb6, 0x19, 0xff, 0x2a, 0xb2, 0x1b, 0xbd,
+  0xd3, 0x83, 0x51, 0x74, 0xba, 0x83, 0x99, 0x3d, 0x1b, 0xf5, 0x0e, 0x32, 0xa8, 0x99, 0xde, 0x9f,
+  0xf1, 0xa6, 0xf7, 0xb8, 0x5e, 0x74, 0x0a, 0xc9, 0xb9, 0x5d, 0x5a, 0x99, 0x30, 0x4e, 0xec, 0x7c,
+  0x4a, 0x95, 0xad, 0x58, 0xcc, 0x86, 0x56, 0xdb, 0xec, 0x6e, 0x6f, 0x6f, 0x9d, 0xc2, 0xbf, 0x93,
+  0x03, 0x40, 0xf1, 0x76, 0x7c, 0x41, 0x7a, 0x7f, 0xe0, 0x62, 0x23, 0xb9, 0xf5, 0x92, 0x39, 0xb1,
+  0x0e, 0xc9, 0xc7, 0xf1, 0x11, 0x89, 0x57, 0xcb, 0xa5, 0x7f, 0x4f, 0xfb, 0xda, 0x7d, 0xd3, 0x3e,
+  0x3d, 0xa0, 0x56, 0xf7, 0x0f, 0x42, 0xfb, 0x27, 0x07, 0xf4, 0xd3, 0xb8, 0xbb, 0x6f, 0xf5, 0x88,
+  0xb8, 0xa7, 0xd0, 0x90, 0x1a, 0x00, 0x31, 0xc3, 0x3f, 0xf4, 0x50, 0xb6, 0xc2, 0x85, 0xb4, 0x80,
+  0x87, 0x04, 0xb8, 0xd2, 0x84, 0xc3, 0xa6, 0x22, 0x02, 0x98, 0xd7, 0x0f, 0xd6, 0x12, 0xa3, 0x35,
+  0xc6, 0x36, 0xd5, 0xf8, 0x2a, 0x55, 0x18, 0x27, 0x84, 0x4d, 0xa7, 0x80, 0x26, 0x36, 0xc8, 0x7f,
+  0xd2, 0xc1, 0xb8, 0x69, 0xcf, 0xed, 0x79, 0x81, 0x13, 0x73, 0xbd, 0x3f, 0x37, 0xc6, 0xbc, 0x63,
+  0x2f, 0x26, 0x2c, 0x08, 0x57, 0xb3, 0xb9, 0x3e, 0xbc, 0x8e, 0x46, 0xd9, 0x5a, 0x50, 0x61, 0x7a,
+  0xef, 0x0b, 0x4b, 0x44, 0xd9, 0xf3, 0x13, 0xd4, 0xb7, 0xb1, 0x78, 0xf9, 0x4d, 0xc8, 0x44, 0x51,
+  0x5c, 0xf7, 0x25, 0x27, 0x4f, 0xae, 0x64, 0x72, 0x4a, 0x95, 0x64, 0xe6, 0xb6, 0xce, 0x9c, 0x38,
+  0x79, 0x1b, 0x4c, 0xe4, 0xca, 0x1e, 0x1b, 0x5a, 0x6a, 0xb5, 0xce, 0x1c, 0xdc, 0x3c, 0xb7, 0xde,
+  0x30, 0x06, 0xc1, 0x62, 0x2d, 0x70, 0x23, 0x99, 0x09, 0x69, 0x3e, 0xbf, 0x44, 0xb1, 0xde, 0x64,
+  0x20, 0x96, 0xfc, 0x9e, 0x37, 0x55, 0xa5, 0x86, 0x92, 0xd2, 0x80, 0xe7, 0x50, 0x81, 0xc8, 0xa1,
+  0x20, 0xf5, 0xd6, 0x0d, 0x2f, 0xfe, 0xe0, 0x7c, 0xd0, 0x6e, 0xf4, 0x03, 0xb3, 0x7f, 0x93, 0x0d,
+  0x15, 0x92, 0x5a, 0x9c, 0xd4, 0x74, 0x9b, 0x50, 0x6c, 0x5b, 0xac, 0x75, 0x77, 0xac, 0xf6, 0x74,
+  0x34, 0xea, 0x8d, 0xaf, 0x70, 0xe9, 0xd0, 0x4e, 0xd2, 0xd8, 0x6d, 0xaa, 0x6d, 0x69, 0x90, 0x66,
+  0x81, 0xdb, 0x72, 0x46, 0x18, 0x49, 0x1d, 0x35, 0x71, 0xeb, 0xe6, 0xf1, 0xb1, 0x25, 0x1e, 0x82,
+  0x44, 0x3b, 0xd2, 0xa7, 0x7a, 0x22, 0xe9, 0x83, 0x08, 0x91, 0x72, 0x3f, 0x8a, 0x00, 0x6a, 0xb9,
+  0xfa, 0xeb, 0x70, 0xe2, 0xdd, 0x10, 0xbe, 0x79, 0x64, 0xf3, 0x4e, 0x46, 0x7f, 0x06, 0xc3, 0x79,
+  0xa4, 0x9e, 0xc4, 0x0b, 0x1f, 0x9f, 0xfc, 0xfc, 0xe0, 0x34, 0xad, 0xa7, 0x3e, 0xbc, 0x12, 0xa1,
+  0x06, 0x11, 0xfb, 0xdb, 0xa7, 0x57, 0xf0, 0xe2, 0x89, 0x12, 0x08, 0x54, 0xe6, 0x68, 0x16, 0x6c,
+  0xfa, 0xf1, 0x44, 0x4b, 0x22, 0x60, 0x07, 0x1d, 0xc1, 0x1b, 0x41, 0x16, 0x4e, 0xf4, 0xab, 0x61,
+  0xb8, 0xe4, 0xc3, 0x96, 0x09, 0x6a, 0xb7, 0x4b, 0x89, 0x0a, 0x79, 0x47, 0x5c, 0x1d, 0xee, 0x86,
+  0x1d, 0x01, 0x32, 0x5a, 0x03, 0xdd, 0x31, 0xe9, 0x68, 0xfc, 0xb7, 0xbd, 0x7d, 0xab, 0xdb, 0xe1,
+  0x80, 0xbb, 0xe4, 0xf2, 0xfd, 0xd1, 0xa7, 0x5a, 0x68, 0x8b, 0x8e, 0xae, 0xce, 0x2c, 0x00, 0xab,
+  0x83, 0xe8, 0xee, 0x52, 0xc8, 0x35, 0xcd, 0xef, 0xbf, 0xff, 0x47, 0x2d, 0x44, 0x4f, 0xe0, 0xe8,
+  0xbe, 0xae, 0x85, 0xd8, 0xa3, 0xa3, 0x8f, 0xc7, 0xe3, 0xfd, 0xd7, 0xe6, 0x4e, 0x2d, 0xc8, 0x6b,
+  0x05, 0xb2, 0x99, 0xe0, 0x1e, 0x0c, 0x0f, 0xc7, 0x65, 0x5a, 0xb5, 0x10, 0x30, 0xa4, 0xc3, 0x8b,
+  0x43, 0xcb, 0xec, 0xd6, 0x42, 0x74, 0xe9, 0xe8, 0xf4, 0xe2, 0xcd, 0xfe, 0xbe, 0xb9, 0x57, 0x0b,
+  0xb2, 0xcb, 0x41, 0xf6, 0xf6, 0xeb, 0x29, 0xee, 0xed, 0xd0, 0xd1, 0xc5, 0xeb, 0x7d, 0xab, 0x16,
+  0xc0, 0x7a, 0x2d, 0x48, 0xb5, 0x2c, 0xf2, 0x69, 0xee, 0x25, 0xac, 0x0e, 0x6e, 0x17, 0x86, 0x74,
+  0x1e, 0x74, 0xce, 0xa7, 0xd3, 0x5a, 0x08, 0x18, 0xd2, 0xc5, 0xa7, 0xb3, 0x67, 0xd0, 0x74, 0x05,
+  0xd0, 0xf1, 0xf1, 0x55, 0x2d, 0xc8, 0x8e, 0x00, 0x01, 0x06, 0xd7, 0x82, 0xec, 0xa6, 0x20, 0xb5,
+  0x73, 0xb0, 0xdb, 0x4b, 0x61, 0x9a, 0xf9, 0xde, 0xfe, 0xbc, 0xdb, 0x71, 0xb7, 0x5a, 0xad, 0x35,
+  0xe0, 0xbd, 0x0c, 0xf8, 0x4d, 0x0e, 0xba, 0xd5, 0x02, 0x70, 0xf6, 0xea, 0x09, 0x74, 0xa4, 0xd8,
+  0x60, 0x1f, 0xd8, 0xf1, 0xe6, 0xcd, 0x05, 0x36, 0x20, 0x5a, 0xc0, 0x92, 0xdb, 0x30, 0xfa, 0xae,
+  0x67, 0x7d, 0x94, 0xc0, 0x81, 0x37, 0x6f, 0xad, 0xf6, 0x8e, 0xf5, 0xe2, 0x06, 0xc0, 0xa7, 0xc3,
+  0x28, 0x69, 0x7d, 0x60, 0xc9, 0x8b, 0x9b, 0xec, 0xa7, 0x24, 0x7d, 0xaa, 0x86, 0xef, 0x08, 0xed,
+  0x1c, 0xa1, 0x27, 0x80, 0x5b, 0xb4, 0x11, 0xde, 0xc4, 0xa6, 0x6e, 0x28, 0x14, 0x9e, 0x9b, 0x76,
+  0x9b, 0x4a, 0xdb, 0xde, 0x97, 0x91, 0xc6, 0xe8, 0x18, 0x43, 0x09, 0x72, 0x1e, 0x4d, 0x58, 0x54,
+  0xb2, 0x15, 0xc7, 0xe7, 0xbc, 0x69, 0x99, 0x18, 0x60, 0xcf, 0xfb, 0xcb, 0xa3, 0x7a, 0x62, 0x81,
+  0x1f, 0xf9, 0xf9, 0x2d, 0xbd, 0x87, 0xe1, 0x1f, 0x5d, 0xbe, 0xaf, 0x7f, 0x0f, 0x32, 0x72, 0x79,
+  0xb4, 0xe1, 0x3d, 0x08, 0xc8, 0xd1, 0xfb, 0xcb, 0xfa, 0xf7, 0x20, 0x1c, 0xef, 0x8f, 0x2e, 0x2b,
+  0x99, 0xd3, 0x01, 0xbe, 0xe4, 0xd9, 0x33, 0xf1, 0x66, 0x38, 0xc8, 0xdb, 0x12, 0x83, 0xb8, 0x9f,
+  0x1b, 0x8d, 0x6f, 0x9d, 0x65, 0x9f, 0x14, 0xd9, 0xf2, 0x49, 0xb2, 0xa5, 0xcc, 0x94, 0x0f, 0xd0,
+  0xa6, 0x56, 0x15, 0x41, 0x13, 0xc9, 0x36, 0xa9, 0x95, 0xfa, 0xae, 0x78, 0xff, 0xbe, 0xd6, 0x4c,
+  0x8a, 0xf7, 0xd9, 0xa8, 0x9e, 0x1d, 0x93, 0x5f, 0x33, 0xa6, 0x63, 0x3f, 0x74, 0xbf, 0xaf, 0x0f,
+  0x6a, 0x7c, 0x51, 0x37, 0xa8, 0xb1, 0x1f, 0xde, 0xb2, 0x38, 0xd9, 0x30, 0x2e, 0x84, 0xd8, 0x30,
+  0xac, 0x0f, 0x61, 0xb4, 0x70, 0xfc, 0x0d, 0xe3, 0x7a, 0xe7, 0xd4, 0xa3, 0xdf, 0x15, 0xaf, 0x0b,
+  0x04, 0x54, 0x0d, 0x1c, 0x7f, 0xe2, 0xa5, 0x13, 0x70, 0x06, 0x2c, 0xe3, 0x89, 0x18, 0x8d, 0x58,
+  0xe3, 0x81, 0x06, 0xf0, 0x66, 0x44, 0x86, 0x62, 0xd3, 0x18, 0xcb, 0x72, 0x6c, 0x1a, 0xac, 0x16,
+  0xd7, 0x2c, 0xa2, 0xca, 0x2d, 0x8e, 0x85, 0x96, 0x60, 0x6b, 0x3f, 0x16, 0xd7, 0xd2, 0x9f, 0xfa,
+  0x44, 0xa4, 0x62, 0x94, 0xe0, 0x2a, 0x02, 0x70, 0x04, 0xc3, 0x63, 0x54, 0xfa, 0xd7, 0x16, 0x55,
+  0x54, 0xfe, 0xfc, 0xa0, 0xe2, 0x20, 0x47, 0xe7, 0xce, 0x95, 0xf7, 0x04, 0xbe, 0x38, 0x97, 0xc4,
+  0x21, 0xd2, 0x2f, 0x36, 0xba, 0xda, 0x01, 0xee, 0x7f, 0x0d, 0x28, 0x51, 0x0b, 0xc1, 0xa4, 0x33,
+  0xda, 0x0e, 0xae, 0xe3, 0xe5, 0xa0, 0x3c, 0x87, 0x6e, 0xad, 0xe2, 0x9e, 0xf2, 0x98, 0xa2, 0xbf,
+  0x71, 0x50, 0xc7, 0xc5, 0x81, 0xc8, 0x11, 0x58, 0x72, 0x04, 0x3c, 0x62, 0xbf, 0x38, 0x7a, 0xa2,
+  0xd9, 0x54, 0x66, 0x24, 0xa5, 0x43, 0x40, 0x5a, 0x29, 0x50, 0x28, 0x98, 0x2d, 0x8d, 0x4b, 0xa7,
+  0xc4, 0x71, 0x53, 0x72, 0x9c, 0x2f, 0xd0, 0x4b, 0x86, 0x6f, 0x22, 0xcd, 0x14, 0xa4, 0xa5, 0xfd,
+  0xa9, 0xe0, 0x65, 0x2d, 0x32, 0xd1, 0x07, 0x10, 0xa1, 0x7f, 0x5c, 0x4e, 0xb4, 0x64, 0xee, 0xc5,
+  0xc0, 0xb3, 0x4e, 0xb1, 0x57, 0x4b, 0xf6, 0xfa, 0x82, 0x0e, 0xad, 0x02, 0x2f, 0x7e, 0xb0, 0x9f,
+  0xee, 0xcb, 0xfb, 0xe9, 0xfe, 0x33, 0xfd, 0xec, 0xbc, 0xbc, 0x9f, 0x9d, 0x7f, 0xa6, 0x9f, 0xdd,
+  0x97, 0xf7, 0xb3, 0xfb, 0xe3, 0xfd, 0xac, 0xc9, 0x70, 0x54, 0x2b, 0xc3, 0x28, 0x4d, 0x19, 0x55,
+  0x90, 0x10, 0x09, 0xaa, 0xd4, 0x02, 0xaf, 0xa4, 0x6e, 0x4d, 0xc6, 0xf9, 0xfa, 0xea, 0x75, 0x78,
+  0xa7, 0x28, 0x3c, 0xfe, 0x43, 0x8d, 0xa5, 0xda, 0x0c, 0xc6, 0x1b, 0xbb, 0x1f, 0x7f, 0xf7, 0x96,
+  0x64, 0xea, 0x45, 0x90, 0x76, 0x61, 0x70, 0xbf, 0x51, 0x9f, 0xc6, 0xa7, 0x82, 0x17, 0x05, 0x3b,
+  0x00, 0x09, 0x27, 0xcd, 0xac, 0xe5, 0x9a, 0xde, 0xd4, 0x12, 0x35, 0xdd, 0x48, 0x14, 0xc4, 0x61,
+  0xe4, 0x92, 0x4d, 0x23, 0x16, 0x67, 0x0a, 0xce, 0x39, 0x34, 0x15, 0x04, 0x54, 0x33, 0xe2, 0xf2,
+  0xdd, 0x66, 0x46, 0x38, 0x1b, 0xfb, 0x3c, 0x5c, 0x25, 0x61, 0xcb, 0x75, 0x7c, 0x77, 0xe5, 0x3b,
+  0x09, 0x23, 0xb7, 0x18, 0xe7, 0x61, 0xe5, 0x2d, 0xa4, 0x8b, 0x3e, 0x99, 0x46, 0xe1, 0x02, 0x43,
+  0x8f, 0xbe, 0x98, 0xb1, 0xbc, 0xe3, 0x38, 0xfc, 0x54, 0xe5, 0x38, 0xcc, 0x4d, 0xbe, 0xd0, 0x1a,
+  0x1d, 0x45, 0xde, 0x6c, 0x9e, 0xb0, 0xa8, 0x06, 0xa0, 0x3b, 0x3a, 0x74, 0x5d, 0x2c, 0x02, 0xac,
+  0xc3, 0xb0, 0x33, 0x7a, 0xb3, 0xaa, 0x75, 0x29, 0xbb, 0xa3, 0x33, 0xe7, 0xae, 0xec, 0x2d, 0x84,
+  0x89, 0x4d, 0x99, 0xc3, 0x7f, 0xbf, 0x0e, 0x3c, 0x48, 0x88, 0x63, 0x16, 0x25, 0x87, 0x93, 0x6f,
+  0x8e, 0x0b, 0x29, 0x1c, 0x66, 0xc6, 0x1a, 0xbd, 0x66, 0x90, 0x8c, 0x33, 0x16, 0x4c, 0xa8, 0xe1,
+  0xeb, 0x4f, 0x32, 0x3d, 0xd3, 0x92, 0xcf, 0xad, 0x96, 0xf3, 0xa5, 0x1d, 0xb1, 0x45, 0x78, 0xc3,
+  0x34, 0xdd, 0x80, 0x3b, 0xb9, 0x02, 0xd7, 0x2c, 0xe5, 0xce, 0xce, 0x30, 0xcd, 0xef, 0x5a, 0x56,
+  0xf5, 0xc2, 0x4e, 0xab, 0xdc, 0x68, 0x54, 0x5e, 0x03, 0x0a, 0x1e, 0x1f, 0x79, 0xb9, 0x44, 0x21,
+  0x0f, 0x3d, 0x3e, 0x3f, 0xd3, 0x80, 0xc9, 0x90, 0x88, 0xe2, 0x86, 0xb4, 0x99, 0xd5, 0xa3, 0xd5,
+  0xe5, 0xa2, 0x6e, 0xb8, 0xf8, 0x0b, 0x1e, 0x46, 0xf7, 0xd0, 0x67, 0x3e, 0x1b, 0x85, 0x84, 0x0f,
+  0x97, 0x49, 0x65, 0xce, 0x59, 0xc8, 0x2c, 0xb3, 0x26, 0x9b, 0xf2, 0x4b, 0x22, 0x5c, 0xec, 0x26,
+  0xb5, 0xf9, 0x7b, 0xce, 0xb7, 0xde, 0xbd, 0xc8, 0xb7, 0xee, 0xf5, 0x7a, 0x3b, 0xbd, 0x9c, 0x73,
+  0x65, 0x4f, 0x6b, 0x8a, 0x95, 0x73, 0x9e, 0x36, 0xa5, 0xa9, 0xf7, 0x7c, 0x81, 0x4f, 0xfc, 0xfb,
+  0x71, 0x8e, 0x18, 0x77, 0xa3, 0x7f, 0x5c, 0xa7, 0x22, 0x78, 0x2a, 0xf4, 0xba, 0xae, 0xea, 0x52,
+  0xe1, 0x7e, 0x28, 0xce, 0xe6, 0x54, 0xc8, 0x00, 0x5d, 0xd2, 0xf7, 0x7f, 0x2f, 0xe6, 0x56, 0xca,
+  0xc6, 0x6d, 0x87, 0x54, 0x3b, 0xb9, 0x47, 0x2c, 0x24, 0xcc, 0x63, 0x31, 0x5f, 0x98, 0xda, 0xa8,
+  0x87, 0x9e, 0x54, 0xb5, 0xbb, 0x90, 0x36, 0x1d, 0xb5, 0x02, 0x9e, 0x18, 0xd7, 0x49, 0x80, 0xca,
+  0x00, 0xb2, 0x28, 0x6b, 0x98, 0x32, 0x3d, 0x01, 0x3d, 0xc5, 0x57, 0x59, 0x19, 0xd3, 0x0b, 0x94,
+  0x03, 0x34, 0x2a, 0xad, 0x10, 0x34, 0xb7, 0x6c, 0xdc, 0xf4, 0xd4, 0xd8, 0xe7, 0xa0, 0x65, 0xe5,
+  0xd4, 0x5e, 0x76, 0x09, 0x0f, 0x45, 0x97, 0x7a, 0xbe, 0xcb, 0x98, 0x25, 0x5c, 0x39, 0xf5, 0x07,
+  0xb4, 0x18, 0x6b, 0xe5, 0xf6, 0xb2, 0x88, 0x02, 0x6b, 0x49, 0x18, 0xae, 0xb3, 0xbe, 0x88, 0x24,
+  0x9d, 0xa5, 0x5d, 0x0f, 0x64, 0xd7, 0x85, 0xb2, 0x60, 0xf1, 0x08, 0x3a, 0x4c, 0x79, 0x0a, 0x06,
+  0xa2, 0x5c, 0x0b, 0x36, 0x2c, 0xd2, 0x52, 0x6d, 0x92, 0xb0, 0x35, 0x74, 0x56, 0x6e, 0x5d, 0x36,
+  0x4c, 0x05, 0x7b, 0x74, 0x94, 0x04, 0xa2, 0x2e, 0x59, 0x59, 0x22, 0x8e, 0x0d, 0x48, 0x8b, 0xf3,
+  0x2b, 0x8e, 0x86, 0xc7, 0xcb, 0x44, 0x9b, 0x63, 0xbe, 0x43, 0xd4, 0x46, 0xa7, 0x72, 0x3c, 0x77,
+  0xa2, 0xe3, 0x70, 0xc2, 0x34, 0x5c, 0x3a, 0x34, 0x0f, 0x76, 0xf7, 0xfb, 0xbd, 0x9e, 0xde, 0x04,
+  0x3e, 0x39, 0x4d, 0xfb, 0xeb, 0xd1, 0x2a, 0x49, 0x42, 0x5e, 0x8e, 0xf8, 0x24, 0x0a, 0x3f, 0x36,
+  0x29, 0xf6, 0xcf, 0x0f, 0xde, 0xfa, 0xb2, 0x96, 0x9e, 0xaa, 0xf6, 0x5d, 0x5c, 0xd4, 0xe3, 0xd1,
+  0x57, 0xac, 0x1f, 0xf9, 0x2a, 0x5d, 0x42, 0xc1, 0x9f, 0xfd, 0xfc, 0x40, 0x8f, 0xde, 0xbe, 0x88,
+  0xc6, 0x14, 0x4d, 0x49, 0x53, 0x81, 0x64, 0xd3, 0xc6, 0xed, 0x63, 0xb5, 0x60, 0x86, 0x15, 0x2b,
+  0x4f, 0xa3, 0x37, 0x72, 0x83, 0x26, 0x55, 0x92, 0xca, 0xe6, 0x5d, 0x6c, 0xde, 0xad, 0x68, 0x7e,
+  0xb1, 0x8a, 0xe7, 0xd7, 0x9c, 0x25, 0x9b, 0x11, 0xec, 0x20, 0x82, 0x9d, 0x1a, 0x04, 0xc4, 0x93,
+  0xfb, 0xe9, 0x9b, 0x71, 0xec, 0x22, 0x8e, 0xdd, 0x0a, 0x1c, 0x63, 0x5e, 0xa3, 0xb7, 0xb9, 0x71,
+  0x0f, 0x1b, 0xf7, 0xaa, 0x08, 0x38, 0xb9, 0x24, 0x31, 0x0b, 0xe2, 0x30, 0xda, 0x8c, 0x60, 0x0f,
+  0x11, 0xec, 0x55, 0x20, 0xb8, 0x0a, 0x57, 0xcf, 0x75, 0xfe, 0x1b, 0xb6, 0xfd, 0xad, 0xa2, 0xed,
+  0x61, 0xe0, 0xf8, 0xe1, 0x6c, 0x73, 0xe3, 0x7d, 0x6c, 0xbc, 0x5f, 0xdb, 0xb8, 0x86, 0x79, 0x34,
+  0x35, 0x75, 0x54, 0x20, 0xe5, 0x21, 0xad, 0x74, 0x04, 0x10, 0xc7, 0xc0, 0x78, 0xfb, 0x64, 0x19,
+  0x7a, 0x01, 0x44, 0x3c, 0x03, 0x2e, 0xa3, 0xbc, 0xe2, 0x86, 0xe2, 0x49, 0x95, 0x57, 0x28, 0xb7,
+  0xaf, 0x74, 0xe5, 0xc3, 0xb6, 0x7f, 0xba, 0xeb, 0xfe, 0x66, 0xf5, 0x06, 0x2a, 0x30, 0x07, 0x93,
+  0x29, 0xb7, 0x95, 0xd6, 0x95, 0xc9, 0xce, 0x55, 0xa9, 0x25, 0x33, 0x7f, 0xec, 0xa1, 0x09, 0xd0,
+  0x0a, 0xc7, 0x7f, 0x98, 0xfe, 0xf8, 0xa8, 0x15, 0x0f, 0x00, 0xad, 0x17, 0x7a, 0xa6, 0x67, 0x46,
+  0x1e, 0xd0, 0x30, 0x09, 0x43, 0xb9, 0x65, 0x61, 0x5c, 0x31, 0x00, 0x77, 0xb6, 0x79, 0x69, 0x5b,
+  0xd9, 0xc9, 0x00, 0x4b, 0x12, 0xca, 0xdb, 0x8b, 0xdc, 0x40, 0xea, 0x3f, 0xb0, 0xae, 0x1f, 0x14,
+  0x97, 0xe7, 0xb7, 0x2a, 0xb6, 0x2c, 0x03, 0x85, 0x0f, 0xcd, 0x32, 0x16, 0x85, 0xe6, 0x13, 0xec,
+  0xe0, 0x0b, 0x2e, 0xcb, 0xcb, 0x7d, 0xc7, 0xd8, 0xa4, 0x00, 0x64, 0x96, 0x91, 0xe0, 0x3e, 0x62,
+  0x3d, 0x0e, 0x93, 0xe3, 0x10, 0x1c, 0x8f, 0xbd, 0x5c, 0xd5, 0x28, 0x33, 0x14, 0x93, 0x33, 0xe6,
+  0xad, 0x96, 0x78, 0xa2, 0xe5, 0x9d, 0xe7, 0xe3, 0xc9, 0x22, 0x59, 0x79, 0x1c, 0xb0, 0x5b, 0xf2,
+  0xf7, 0xb3, 0xd3, 0xdf, 0x93, 0x64, 0x79, 0x09, 0xb1, 0x02, 0x8b, 0x93, 0x41, 0x50, 0x7f, 0x7a,
+  0x27, 0x77, 0x34, 0x24, 0x3b, 0xb8, 0x82, 0xa9, 0x14, 0x98, 0xfc, 0x78, 0x19, 0x82, 0x47, 0xbc,
+  0x62, 0x77, 0x89, 0xc1, 0x9f, 0x00, 0x99, 0xc9, 0x2a, 0xc6, 0x52, 0x16, 0x18, 0xa4, 0x0e, 0x9e,
+  0xaa, 0xfe, 0x08, 0x4e, 0x86, 0x97, 0xe5, 0x11, 0x63, 0x01, 0xb5, 0xe3, 0x7e, 0x37, 0xb6, 0x14,
+  0x02, 0x71, 0xa0, 0xeb, 0xe2, 0x1c, 0x66, 0xd3, 0xa0, 0x1d, 0x31, 0x1c, 0xb9, 0x67, 0x95, 0xf0,
+  0x91, 0xbc, 0x0b, 0xa3, 0x05, 0xd6, 0xee, 0xa9, 0xad, 0x92, 0x44, 0x9e, 0x4c, 0xd2, 0x28, 0x96,
+  0x6f, 0xcb, 0x7a, 0x62, 0x5e, 0xc9, 0x8d, 0x67, 0x7a, 0x62, 0x60, 0x1f, 0x1e, 0xeb, 0x09, 0xda,
+  0x31, 0xc2, 0x24, 0xba, 0x51, 0x51, 0xe9, 0xbd, 0xb5, 0x76, 0xee, 0xea, 0x78, 0x3a, 0x4b, 0xb9,
+  0x67, 0x24, 0x03, 0xaa, 0x5e, 0x52, 0xd0, 0x42, 0x30, 0xf3, 0xe0, 0x25, 0xe5, 0x69, 0x31, 0xe4,
+  0xf3, 0x25, 0x73, 0x20, 0x80, 0x3a, 0x80, 0x91, 0xf0, 0xfe, 0x0e, 0x58, 0xda, 0xef, 0x81, 0x86,
+  0x9e, 0x3b, 0xa5, 0x42, 0x93, 0xf4, 0xa7, 0x6d, 0xb0, 0xd0, 0x0d, 0xbb, 0xb3, 0xf3, 0xac, 0x11,
+  0x45, 0x9d, 0xac, 0x0d, 0x02, 0x00, 0x42, 0x89, 0x3c, 0x5f, 0xf9, 0x89, 0x1c, 0x3e, 0x3f, 0x7f,
+  0xc0, 0x85, 0x47, 0x0b, 0xf8, 0x16, 0x4c, 0xd2, 0x9e, 0xdf, 0xf2, 0x4d, 0x2e, 0xbc, 0x00, 0xd9,
+  0x9f, 0x64, 0x3a, 0x83, 0xe5, 0xa0, 0x0e, 0xf8, 0x06, 0xf0, 0x5a, 0x4d, 0x5d, 0x6d, 0x13, 0x81,
+  0x34, 0x0f, 0x14, 0x28, 0x06, 0x37, 0x69, 0x95, 0x87, 0xf4, 0x94, 0xf6, 0xe8, 0x41, 0x81, 0x5a,
+  0x22, 0x2e, 0xc8, 0x50, 0x31, 0x2c, 0x0c, 0x51, 0xfa, 0x85, 0x48, 0xab, 0xb4, 0xe6, 0x2b, 0x4f,
+  0x47, 0xd1, 0x9f, 0x7d, 0xcd, 0x95, 0xb3, 0xf1, 0xa6, 0x9f, 0x9d, 0x2f, 0x83, 0xda, 0x7d, 0xb0,
+  0xa0, 0x00, 0x8d, 0x4c, 0x36, 0x6a, 0xf7, 0xe7, 0x8a, 0xb0, 0x5c, 0x53, 0x8c, 0x97, 0x14, 0x0f,
+  0x8b, 0x28, 0xaa, 0x1a, 0xf4, 0xf8, 0x7c, 0x1d, 0x34, 0xc4, 0xb0, 0xd8, 0x78, 0x49, 0x89, 0x31,
+  0x12, 0x01, 0x19, 0x7b, 0x35, 0xec, 0xe5, 0x3b, 0x05, 0x9b, 0x6a, 0x2d, 0xcc, 0xe9, 0xb4, 0x86,
+  0x8a, 0x3f, 0xaa, 0x80, 0x6f, 0x9e, 0xf4, 0x27, 0x35, 0xc5, 0x10, 0x0c, 0x61, 0x1d, 0x84, 0x0a,
+  0xe9, 0xf0, 0xd4, 0x97, 0x78, 0x5a, 0xa8, 0xd7, 0x51, 0xd9, 0x98, 0x64, 0x8e, 0x18, 0xb7, 0x1c,
+  0x12, 0x57, 0x33, 0xde, 0x0a, 0xac, 0xb7, 0x4a, 0xb2, 0xd4, 0xfd, 0xe0, 0x30, 0x8a, 0x9c, 0xfb,
+  0xb6, 0x17, 0xf3, 0x5f, 0x8d, 0x27, 0xa2, 0xba, 0xaa, 0x00, 0x2d, 0x59, 0x7b, 0x0a, 0xb1, 0xa9,
+  0x57, 0x2f, 0x46, 0x18, 0x80, 0x61, 0xb7, 0x38, 0xf7, 0xa8, 0x84, 0x7c, 0x5a, 0xb1, 0x4c, 0xa8,
+  0x72, 0xec, 0x57, 0x60, 0xbd, 0x33, 0x96, 0x7a, 0xed, 0x24, 0x79, 0xe2, 0x54, 0x79, 0x51, 0x5d,
+  0x15, 0xe9, 0xc9, 0x65, 0xbe, 0x85, 0x04, 0xc6, 0xde, 0xaa, 0x3b, 0x38, 0xb9, 0xaa, 0x02, 0xe7,
+  0x34, 0x09, 0x7e, 0x44, 0x0c, 0xc2, 0xca, 0xba, 0xce, 0x2e, 0x4f, 0x4b, 0xad, 0x39, 0x7c, 0x7d,
+  0x7f, 0x97, 0x67, 0xb4, 0x30, 0x95, 0xb9, 0x36, 0xe0, 0xb2, 0x55, 0x66, 0x60, 0xa0, 0x8a, 0x3b,
+  0x93, 0xc3, 0x18, 0x8d, 0x2a, 0x68, 0xb5, 0xde, 0x97, 0x07, 0x10, 0x2f, 0x7c, 0x86, 0xd5, 0xf9,
+  0x32, 0x0e, 0x74, 0x08, 0xea, 0x3e, 0x3f, 0xa5, 0x28, 0x56, 0x86, 0xb6, 0x68, 0x0a, 0x79, 0x05,
+  0x96, 0x98, 0x5c, 0x47, 0xe1, 0x2d, 0xe4, 0x2a, 0x64, 0x12, 0xb2, 0x18, 0x4f, 0x4f, 0xe1, 0xf6,
+  0x7f, 0x18, 0x41, 0x58, 0x3a, 0x67, 0xe4, 0x2b, 0x37, 0x41, 0x5f, 0xc9, 0x32, 0x02, 0xe3, 0x0a,
+  0x1e, 0x05, 0xc3, 0x7c, 0x8e, 0x89, 0x47, 0xae, 0x31, 0x1e, 0x26, 0x61, 0x59, 0xcd, 0x6f, 0x86,
+  0x96, 0x09, 0xa8, 0xc3, 0x8b, 0x13, 0xe2, 0xe5, 0x91, 0xf2, 0xa5, 0x58, 0x92, 0xe4, 0xbb, 0xbd,
+  0x07, 0x53, 0x95, 0x3f, 0x1b, 0x5b, 0x3c, 0x9c, 0xc9, 0x8d, 0x1a, 0xb3, 0x3f, 0xe3, 0x94, 0x19,
+  0xc8, 0xca, 0x2f, 0x83, 0xbc, 0x44, 0x95, 0x2a, 0xd1, 0x5e, 0x89, 0x0a, 0xc4, 0x42, 0x48, 0xfd,
+  0xe5, 0x55, 0x56, 0x93, 0x16, 0xf0, 0x9a, 0x34, 0x5e, 0x64, 0x15, 0xf0, 0x1a, 0x2f, 0x90, 0xaa,
+  0x34, 0x8b, 0x49, 0x44, 0x16, 0x03, 0x46, 0x9e, 0xc9, 0x19, 0xc1, 0x22, 0x34, 0x85, 0xc6, 0x06,
+  0x13, 0xce, 0x27, 0x7d, 0x7b, 0x9b, 0xc1, 0x3c, 0xb8, 0xfe, 0x0a, 0x12, 0x0f, 0xd0, 0x2d, 0x8e,
+  0x45, 0x11, 0x9a, 0xfa, 0xe7, 0x44, 0x15, 0xb4, 0x3b, 0x36, 0x08, 0xb4, 0x1a, 0x91, 0x04, 0x37,
+  0xcc, 0xcc, 0x44, 0x62, 0x29, 0x1f, 0x44, 0x27, 0xb9, 0x22, 0x3f, 0x11, 0x82, 0xf0, 0x93, 0x45,
+  0xbc, 0x0c, 0x2f, 0xed, 0x0b, 0xe6, 0x58, 0xd5, 0x92, 0x0d, 0xc4, 0x11, 0x08, 0x5c, 0xcb, 0xc1,
+  0x53, 0x9e, 0xab, 0x00, 0x0f, 0xbc, 0x61, 0x70, 0xd7, 0x0c, 0xe4, 0xa9, 0x6b, 0x68, 0x36, 0x61,
+  0x77, 0xe7, 0x53, 0x68, 0x35, 0xb2, 0xcd, 0xed, 0xed, 0x60, 0x4b, 0x2e, 0xfb, 0x40, 0x84, 0xc7,
+  0x8f, 0xc7, 0x51, 0x3d, 0x3b, 0x8b, 0x9d, 0xef, 0x43, 0xc1, 0x68, 0x97, 0x9d, 0x73, 0x9d, 0x8a,
+  0x53, 0x10, 0x1e, 0x0e, 0xe2, 0x9c, 0x07, 0x89, 0x9a, 0x63, 0x24, 0x06, 0xf8, 0x90, 0xc0, 0xc6,
+  0xb3, 0x30, 0x5e, 0x5a, 0x38, 0x0a, 0x91, 0x46, 0x3f, 0xed, 0x39, 0x8f, 0xcc, 0xcb, 0x95, 0x72,
+  0x81, 0xab, 0x7e, 0xfa, 0xd1, 0x12, 0x42, 0xb9, 0x24, 0x2b, 0xf5, 0xbf, 0xb2, 0x6d, 0x1b, 0x22,
+  0x38, 0x21, 0x92, 0xed, 0x38, 0x57, 0x7d, 0x5a, 0x40, 0x83, 0xc5, 0x77, 0x36, 0x4b, 0x8f, 0x93,
+  0xc9, 0xba, 0x44, 0xe4, 0x0c, 0x58, 0x3b, 0x74, 0xea, 0x60, 0x18, 0xf1, 0xa1, 0x82, 0x29, 0x9c,
+  0xc3, 0x4d, 0x69, 0x90, 0x4e, 0x36, 0x57, 0xc3, 0x98, 0x6b, 0xaa, 0x0f, 0x2a, 0x31, 0xc9, 0xb9,
+  0x62, 0x62, 0xea, 0x1d, 0x88, 0x5b, 0x07, 0xff, 0x2b, 0xe3, 0x60, 0x28, 0x41, 0xc3, 0x6e, 0xaf,
+  0x97, 0x9e, 0xba, 0xcc, 0x86, 0x22, 0x67, 0xf1, 0x05, 0xbc, 0x4f, 0xb5, 0xc1, 0x47, 0x6d, 0xf0,
+  0x74, 0x9f, 0x9f, 0x6a, 0x11, 0xd6, 0x1d, 0xf3, 0x47, 0xcd, 0x6f, 0x8b, 0x6c, 0x21, 0x2e, 0x9e,
+  0xbe, 0xe0, 0x4d, 0x6c, 0x27, 0x9b, 0xfc, 0xf4, 0xa4, 0x85, 0xba, 0xe2, 0xc7, 0x52, 0xd3, 0x6b,
+  0x49, 0xdb, 0xe3, 0xa3, 0x8f, 0x42, 0xd2, 0xb2, 0xb6, 0x6c, 0xf9, 0xea, 0x00, 0xe0, 0xb1, 0x96,
+  0x4e, 0xdd, 0x1b, 0x59, 0xf3, 0x35, 0x69, 0xb2, 0x74, 0x43, 0xab, 0xc1, 0x57, 0x10, 0x3a, 0x43,
+  0x20, 0x44, 0xa1, 0x86, 0xc0, 0xdc, 0x3f, 0xa0, 0x10, 0xa6, 0xd0, 0x7e, 0xa2, 0x57, 0x2a, 0x40,
+  0xe9, 0xa4, 0x88, 0x40, 0xa7, 0x10, 0x48, 0xad, 0xd0, 0xfb, 0x92, 0x48, 0xa5, 0x7a, 0x05, 0x71,
+  0xc9, 0x6b, 0x7c, 0x2a, 0x33, 0xe5, 0x13, 0xf8, 0x9c, 0xeb, 0xc0, 0xf1, 0x40, 0x9c, 0x9d, 0xc6,
+  0xc0, 0x17, 0xa3, 0x60, 0x8d, 0x8a, 0x89, 0x50, 0x07, 0xf7, 0x6b, 0x4e, 0xfe, 0xf3, 0x28, 0x6e,
+  0x7b, 0x9b, 0x9e, 0x7c, 0xb8, 0xf8, 0x78, 0x25, 0xad, 0x93, 0x33, 0xc3, 0xf7, 0x40, 0x30, 0x3f,
+  0xa6, 0x9f, 0x99, 0xac, 0xc7, 0xc7, 0x92, 0x15, 0x4b, 0x4d, 0x96, 0xb4, 0x54, 0x03, 0x61, 0x9a,
+  0xd6, 0x42, 0x37, 0x20, 0x48, 0x1d, 0xec, 0x8f, 0x55, 0x04, 0xd7, 0x6c, 0x3a, 0x99, 0xf7, 0xcf,
+  0x5e, 0x63, 0x94, 0x26, 0x3e, 0x12, 0xb0, 0x25, 0x0f, 0xe1, 0x00, 0x71, 0x1c, 0x75, 0xfe, 0x01,
+  0x1f, 0x69, 0xfe, 0x01, 0x4f, 0x2c, 0x73, 0x0f, 0x82, 0xe2, 0xd7, 0x04, 0xc4, 0x63, 0x25, 0x03,
+  0xfa, 0x93, 0xaa, 0x72, 0x5a, 0xfb, 0xe6, 0x00, 0xaa, 0x5d, 0x0b, 0x40, 0xa8, 0x8a, 0xd8, 0xf3,
+  0x2f, 0xd5, 0x32, 0x0a, 0x78, 0x90, 0xfc, 0xfe, 0x0e, 0xff, 0x74, 0x01, 0x4c, 0x37, 0x30, 0x56,
+  0xf2, 0x57, 0x9d, 0x5c, 0x17, 0x9f, 0x2a, 0xc0, 0x78, 0xc4, 0x08, 0xd2, 0x1e, 0x57, 0xbe, 0x5f,
+  0x98, 0x61, 0x69, 0x0e, 0xe5, 0x42, 0x11, 0x4c, 0x06, 0x42, 0xa0, 0x51, 0x94, 0x35, 0x63, 0xf2,
+  0xf8, 0x58, 0x69, 0xda, 0x85, 0xf6, 0xc0, 0xfc, 0x3a, 0xe9, 0xb2, 0x9f, 0x23, 0x64, 0x09, 0x43,
+  0x9e, 0xfc, 0xb7, 0x12, 0x9c, 0x4c, 0x19, 0x03, 0x98, 0x8d, 0x00, 0x02, 0x69, 0x17, 0x5f, 0x7c,
+  0x08, 0x27, 0xd9, 0x6c, 0x70, 0x67, 0x91, 0x7f, 0x01, 0x99, 0x63, 0xa6, 0x13, 0x39, 0x73, 0xc4,
+  0x0d, 0x5d, 0xb1, 0xcc, 0x3f, 0x48, 0xf9, 0x99, 0x4b, 0xbf, 0xc7, 0xa9, 0xd7, 0x95, 0xa9, 0x8a,
+  0x1f, 0xba, 0xfc, 0x80, 0x2a, 0xaf, 0xb4, 0x46, 0xbf, 0xde, 0xa7, 0x88, 0x9a, 0x7f, 0x61, 0xc3,
+  0x0d, 0x7d, 0x9d, 0x7f, 0x74, 0xc3, 0x34, 0x34, 0xfe, 0xe9, 0x0e, 0x1b, 0xa1, 0xfd, 0x31, 0x58,
+  0x16, 0x67, 0xc6, 0x50, 0x74, 0x4f, 0x12, 0xb6, 0xc0, 0x0c, 0xd1, 0x3d, 0x59, 0x82, 0xda, 0x40,
+  0x0a, 0x2f, 0xc0, 0xa0, 0xf5, 0x62, 0x09, 0xdc, 0xc0, 0x9c, 0x86, 0x9c, 0x01, 0xdd, 0x6d, 0x22,
+  0xe3, 0x16, 0x86, 0x0b, 0x0b, 0xe4, 0x13, 0x16, 0x6c, 0x9e, 0x5c, 0x40, 0xb0, 0x62, 0x14, 0x30,
+  0xc6, 0x45, 0x8c, 0x06, 0xc7, 0xa6, 0x83, 0xe5, 0xc5, 0x8a, 0x64, 0x95, 0x01, 0x2d, 0x9d, 0x64,
+  0xce, 0xc5, 0x06, 0x78, 0xda, 0x8e, 0x7d, 0xcf, 0x65, 0x9a, 0x05, 0x52, 0x01, 0x8c, 0x8d, 0x3f,
+  0x79, 0xc9, 0x5c, 0xa3, 0x1d, 0xaa, 0x1f, 0xb4, 0xac, 0xfe, 0x4d, 0xe8, 0x4d, 0x88, 0xa9, 0xb7,
+  0xe3, 0xa5, 0xef, 0x25, 0xfc, 0xe9, 0x40, 0x95, 0xb7, 0x8d, 0xba, 0x78, 0x44, 0x4d, 0x7d, 0x47,
+  0x24, 0x1b, 0xad, 0x21, 0x47, 0x2b, 0x46, 0xc1, 0xda, 0xf3, 0x30, 0x4e, 0xb0, 0xab, 0x26, 0x30,
+  0x17, 0x23, 0x9c, 0x03, 0x70, 0xc2, 0x4d, 0x71, 0x89, 0x45, 0xa3, 0x4d, 0x40, 0xda, 0x4c, 0x40,
+  0x5b, 0xf5, 0x27, 0xf9, 0x59, 0x8e, 0xd2, 0x17, 0x42, 0x3a, 0x71, 0xfb, 0x5b, 0x7c, 0xb0, 0xb4,
+  0xbb, 0x14, 0x0f, 0x00, 0xf3, 0xe1, 0xf2, 0x50, 0x12, 0xbf, 0x75, 0xc1, 0x67, 0xc4, 0x2e, 0x37,
+  0x01, 0xbb, 0x16, 0xd3, 0xfc, 0x52, 0xad, 0x04, 0x49, 0x3f, 0x2a, 0x82, 0xa4, 0x1f, 0x28, 0xf2,
+  0x81, 0x08, 0xa0, 0x82, 0x53, 0xcc, 0x69, 0x62, 0x4f, 0x8d, 0x61, 0x47, 0x7e, 0xf4, 0x65, 0xc8,
+  0xf5, 0x6f, 0xf4, 0x2f, 0xde, 0x82, 0x07, 0x7d, 0xab, 0x08, 0xdd, 0x81, 0x28, 0xcb, 0x8d, 0xb1,
+  0xe2, 0x13, 0x00, 0x39, 0xc0, 0xb0, 0x23, 0x3e, 0x61, 0x83, 0x1f, 0xf4, 0x20, 0x32, 0xf9, 0xa4,
+  0x63, 0xbe, 0x29, 0x08, 0x32, 0xba, 0x68, 0xf0, 0xc5, 0x7f, 0xbc, 0xfa, 0x2b, 0x4e, 0x37, 0x18,
+  0xa7, 0x94, 0x2c, 0x58, 0x32, 0x0f, 0x71, 0x8f, 0x16, 0xd8, 0x04, 0xa0, 0xb9, 0x0d, 0x99, 0x24,
+  0x04, 0xda, 0x6e, 0x8b, 0xcf, 0xe6, 0xcc, 0x5f, 0x1e, 0xd1, 0x51, 0x63, 0x28, 0x16, 0x06, 0xe5,
+  0xca, 0xa8, 0xb8, 0xc9, 0xad, 0x34, 0xfd, 0x8e, 0xdd, 0x1e, 0x0c, 0x3b, 0xe2, 0x45, 0xba, 0x97,
+  0x5f, 0xd5, 0xa6, 0x91, 0x36, 0x3a, 0xc2, 0x46, 0x47, 0x8e, 0xfb, 0x3d, 0x6b, 0x57, 0x68, 0x21,
+  0xbf, 0x22, 0x32, 0x1a, 0x3b, 0x37, 0x2c, 0x03, 0x99, 0xab, 0x45, 0xfe, 0xe1, 0xbc, 0x3b, 0x6a,
+  0xa0, 0x4c, 0x6e, 0x3b, 0x8b, 0xe5, 0x80, 0xfc, 0xee, 0x44, 0x58, 0xc7, 0x8c, 0x51, 0x76, 0xb2,
+  0x5a, 0x02, 0x73, 0xba, 0xa3, 0xab, 0x30, 0x71, 0x7c, 0xb5, 0xed, 0x9a, 0x6e, 0x03, 0xfb, 0x2e,
+  0x27, 0x55, 0x96, 0x6c, 0x64, 0x7b, 0xd6, 0x2e, 0x0e, 0x33, 0x5b, 0x16, 0x1b, 0x7a, 0xa3, 0x4b,
+  0x06, 0xc9, 0x18, 0x98, 0x88, 0x09, 0x04, 0xc9, 0xcb, 0xf0, 0x16, 0x74, 0x40, 0x16, 0xe2, 0x62,
+  0x25, 0xed, 0xb5, 0xd8, 0x62, 0x8c, 0x13, 0xb1, 0x95, 0xd9, 0x1f, 0x76, 0x3c, 0xd1, 0xee, 0x5a,
+  0x6e, 0x39, 0x37, 0x44, 0xa5, 0xc8, 0x2a, 0xeb, 0x0d, 0x2b, 0x97, 0x8b, 0x5b, 0xd2, 0xbc, 0x66,
+  0x56, 0x6e, 0x5c, 0xa4, 0x3d, 0x37, 0xde, 0x06, 0xe8, 0x27, 0x89, 0xb3, 0x4a, 0x42, 0xfc, 0xfa,
+  0x87, 0x2b, 0xfb, 0x0a, 0x58, 0x1c, 0x13, 0x1f, 0x3f, 0xd2, 0xc1, 0xa2, 0x67, 0xf6, 0xac, 0x0f,
+  0x8f, 0x98, 0x64, 0xb5, 0x5c, 0xad, 0x96, 0x27, 0x92, 0xc5, 0xbe, 0x14, 0x3f, 0xb0, 0x2c, 0x7a,
+  0x55, 0x5b, 0xb8, 0x78, 0x14, 0x1c, 0xb7, 0x35, 0xf1, 0x23, 0x46, 0xe4, 0x78, 0x15, 0xa1, 0x09,
+  0x4e, 0xfb, 0x90, 0x9f, 0x2e, 0x3a, 0x3b, 0xa4, 0x6b, 0x2b, 0xe3, 0x6b, 0x1b, 0x5b, 0xdd, 0x5e,
+  0xb6, 0xc1, 0x66, 0x9a, 0xa5, 0xcd, 0xea, 0x74, 0x73, 0x6b, 0xd4, 0x20, 0x8b, 0xc3, 0x62, 0xf7,
+  0xd9, 0x31, 0x57, 0x85, 0x14, 0xef, 0x6b, 0x0a, 0x8c, 0x1a, 0xdb, 0x3f, 0xbd, 0xde, 0xdf, 0xdf,
+  0x1f, 0x90, 0x7f, 0x0b, 0x57, 0x51, 0x71, 0x66, 0x40, 0x82, 0x6f, 0x70, 0xfb, 0x81, 0xcc, 0x81,
+  0x63, 0xc4, 0x15, 0x03, 0x69, 0x73, 0xae, 0x5e, 0x85, 0x04, 0x54, 0x0a, 0xde, 0x33, 0x9e, 0x48,
+  0xc5, 0xce, 0x94, 0x89, 0xf4, 0xe9, 0x1e, 0xb1, 0x70, 0xa9, 0x31, 0x10, 0x70, 0x29, 0x8c, 0x1e,
+  0xc4, 0x10, 0x98, 0x16, 0xb9, 0xdf, 0x89, 0x8b, 0xfc, 0x8a, 0xf9, 0xbb, 0xc6, 0x62, 0xe5, 0x27,
+  0x1e, 0x40, 0xc8, 0x5e, 0xbd, 0xe0, 0x1b, 0x93, 0xf1, 0x28, 0x2e, 0xbf, 0xc6, 0xc4, 0x09, 0x26,
+  0x90, 0xdf, 0x4d, 0xa1, 0xf1, 0x56, 0xb6, 0x1d, 0x05, 0xa2, 0xd4, 0x38, 0x54, 0x93, 0xe9, 0xf8,
+  0x40, 0x26, 0x9f, 0xc5, 0x38, 0x3f, 0xaf, 0x49, 0x88, 0x5b, 0x95, 0xf7, 0x30, 0xfa, 0x30, 0xe6,
+  0x5f, 0x12, 0x40, 0x1a, 0x39, 0x98, 0xa0, 0xfe, 0x6f, 0x8c, 0x2d, 0x89, 0x93, 0x90, 0x6d, 0x3f,
+  0x19, 0x58, 0x87, 0xc4, 0x9b, 0x0a, 0x0a, 0xb0, 0x3c, 0x9e, 0x17, 0xc0, 0x4f, 0x80, 0xb1, 0x6e,
+  0x82, 0xb2, 0x89, 0x5b, 0xe9, 0xd8, 0x38, 0xab, 0x40, 0xe7, 0xa4, 0x34, 0x4e, 0xf8, 0x48, 0xf9,
+  0xc7, 0x2d, 0xd2, 0x0f, 0x10, 0x80, 0x8f, 0x63, 0x51, 0x00, 0x4a, 0x92, 0x67, 0xa2, 0x21, 0x0d,
+  0x3e, 0x52, 0x88, 0x1f, 0xca, 0x09, 0x66, 0x82, 0x04, 0x4d, 0xca, 0x05, 0x01, 0xa1, 0xc7, 0xcf,
+  0xd2, 0x80, 0x56, 0xac, 0x62, 0xf0, 0x00, 0x4a, 0xb9, 0xe4, 0xc4, 0x2d, 0xd1, 0x86, 0xac, 0x82,
+  0xef, 0x01, 0xc4, 0x5a, 0x52, 0xaa, 0xf5, 0x4c, 0x39, 0x22, 0xa1, 0xb3, 0x37, 0xa1, 0x9f, 0xe0,
+  0x17, 0x76, 0xb4, 0x33, 0x3c, 0x0a, 0x20, 0xe7, 0x89, 0xeb, 0x95, 0x43, 0x90, 0x38, 0xe0, 0x30,
+  0x80, 0xe9, 0x15, 0xf5, 0x00, 0xbc, 0xec, 0x7e, 0x4d, 0xb6, 0xf1, 0x63, 0x02, 0xa5, 0xd2, 0x32,
+  0xac, 0x9b, 0x48, 0x53, 0xa1, 0x6c, 0xb9, 0x7d, 0x04, 0x3c, 0x91, 0xe7, 0xe0, 0x89, 0xd6, 0xeb,
+  0x2d, 0x0e, 0xf5, 0x46, 0x6d, 0xe9, 0x58, 0x8f, 0x43, 0xb3, 0xe9, 0xd4, 0x73, 0xf1, 0x50, 0x07,
+  0xd1, 0x76, 0x10, 0x7e, 0x53, 0x59, 0x72, 0x03, 0x2b, 0xf8, 0xb5, 0x1d, 0x73, 0x03, 0x18, 0x16,
+  0x74, 0x8c, 0x64, 0xbd, 0xbf, 0x66, 0x75, 0x37, 0x40, 0x62, 0x21, 0x70, 0xe3, 0x98, 0xaf, 0xb8,
+  0x57, 0x14, 0xa7, 0x15, 0x0c, 0x89, 0x38, 0xcc, 0x5f, 0xa3, 0x2e, 0x02, 0x85, 0x38, 0x75, 0xa1,
+  0x58, 0x8d, 0x07, 0x26, 0x80, 0xc3, 0xa9, 0x8e, 0x2b, 0xe6, 0xae, 0xab, 0x78, 0xb9, 0x16, 0x85,
+  0xdb, 0x35, 0xdf, 0xa9, 0xd7, 0x6e, 0xa5, 0xdc, 0xaa, 0xf6, 0x27, 0x13, 0x5e, 0xc5, 0x77, 0x2f,
+  0x27, 0x8a, 0x41, 0xbc, 0x82, 0x1f, 0xe7, 0x3a, 0x04, 0x22, 0xb8, 0x26, 0x62, 0xff, 0xa8, 0x96,
+  0x28, 0xd6, 0xed, 0x54, 0x70, 0xa4, 0xc9, 0xdf, 0x19, 0x35, 0x4a, 0x86, 0x7e, 0x27, 0xb3, 0x23,
+  0x58, 0xcf, 0xce, 0xbf, 0xa8, 0x26, 0xce, 0x82, 0xc4, 0x7d, 0xd5, 0xae, 0x58, 0x5d, 0xa0, 0xfc,
+  0x4c, 0xa3, 0xe8, 0x9a, 0x10, 0x43, 0x33, 0xe7, 0xd5, 0xd2, 0xe5, 0x53, 0x8c, 0x02, 0xe8, 0xa8,
+  0x99, 0x3a, 0x21, 0x52, 0xe3, 0xda, 0x10, 0x41, 0xab, 0x02, 0x41, 0x4b, 0x62, 0x68, 0xe5, 0x3c,
+  0x5d, 0xc4, 0xe9, 0x3c, 0xe3, 0x07, 0x60, 0xc8, 0xc7, 0xbc, 0x1e, 0xf1, 0x81, 0xc0, 0xd4, 0x9b,
+  0xca, 0x1d, 0x91, 0x4e, 0xfe, 0x8d, 0x95, 0x73, 0x5f, 0x47, 0x05, 0x2b, 0xca, 0x0f, 0x27, 0x91,
+  0x46, 0x65, 0x85, 0x40, 0xeb, 0x1a, 0xab, 0x32, 0x07, 0xfc, 0xeb, 0x75, 0x7d, 0xcb, 0x34, 0x97,
+  0x77, 0x83, 0x39, 0x43, 0xeb, 0x03, 0x37, 0x70, 0x7d, 0xcd, 0xd7, 0x13, 0x5b, 0x78, 0x7a, 0x69,
+  0x15, 0xf7, 0xbb, 0xf0, 0x48, 0xd5, 0xf9, 0x34, 0x0a, 0x5d, 0xe4, 0x0e, 0x0b, 0xfd, 0xa0, 0xa1,
+  0x06, 0x49, 0x82, 0xde, 0x48, 0xb4, 0x82, 0x61, 0x04, 0xc2, 0xda, 0x5d, 0x7b, 0x10, 0xe4, 0x81,
+  0x09, 0x8e, 0x88, 0xef, 0xcc, 0x88, 0x17, 0xc7, 0x2b, 0x08, 0xa2, 0xb1, 0xbb, 0x8f, 0x60, 0x02,
+  0x7d, 0x6e, 0x15, 0x41, 0xc5, 0x49, 0xce, 0x9d, 0xaa, 0xd3, 0x45, 0xa3, 0x8a, 0x83, 0x3f, 0x8a,
+  0x27, 0x68, 0x44, 0xd0, 0xfe, 0x5d, 0xa3, 0x6f, 0x66, 0x77, 0x00, 0x00, 0xba, 0xeb, 0x16, 0xec,
+  0x31, 0x88, 0x43, 0x23, 0x2f, 0x0f, 0x67, 0xce, 0x77, 0x86, 0x86, 0x87, 0xcd, 0x16, 0xca, 0x0c,
+  0x31, 0xc8, 0xa2, 0x25, 0xe2, 0x67, 0x7c, 0xed, 0xd9, 0x98, 0x0a, 0x26, 0x49, 0x35, 0xbb, 0x5e,
+  0xc5, 0xa2, 0xea, 0x04, 0xc6, 0x39, 0x81, 0x40, 0x37, 0xae, 0x6d, 0x9f, 0xb3, 0x61, 0x62, 0xf3,
+  0x87, 0xef, 0xc3, 0xc8, 0x35, 0x46, 0xe9, 0xab, 0x63, 0x4f, 0x78, 0x6a, 0x64, 0xc9, 0xcc, 0x0f,
+  0xaf, 0x45, 0x40, 0x03, 0x9d, 0x4c, 0xa7, 0xb9, 0x28, 0xa0, 0x51, 0x4d, 0xda, 0xe9, 0x9b, 0xd2,
+  0x8e, 0xb5, 0xd0, 0xa6, 0x75, 0x7d, 0xc0, 0xe9, 0x6d, 0x88, 0x6a, 0x6e, 0x3f, 0x8c, 0xfe, 0xe2,
+  0xc2, 0xf0, 0xd7, 0x02, 0x32, 0x1f, 0x9c, 0xe8, 0x7c, 0x6d, 0x09, 0x51, 0x1b, 0xfc, 0xfd, 0x5c,
+  0x01, 0x78, 0x56, 0x65, 0x51, 0xc7, 0xe0, 0x6a, 0x7d, 0x51, 0xad, 0xb1, 0x9e, 0xa0, 0xa0, 0x34,
+  0x7c, 0x39, 0xbc, 0xa0, 0x70, 0x8d, 0xcd, 0x18, 0xb0, 0xa6, 0x20, 0xc3, 0xa0, 0x0a, 0x33, 0xd6,
+  0x15, 0xae, 0x8e, 0x38, 0x35, 0x12, 0xbe, 0x84, 0x29, 0xa1, 0xe4, 0x5e, 0x3a, 0xe1, 0x9b, 0xaa,
+  0xdc, 0x43, 0x42, 0x2e, 0xd9, 0x5a, 0x2d, 0x3b, 0xb8, 0x84, 0xf0, 0x1c, 0xdf, 0x4f, 0x2e, 0x04,
+  0x9f, 0xf9, 0x76, 0x32, 0x08, 0x23, 0x16, 0xda, 0x85, 0xfe, 0xa4, 0xa6, 0xbe, 0x20, 0x2b, 0x7d,
+  0x6c, 0x14, 0xac, 0xad, 0x85, 0x21, 0x94, 0x40, 0x78, 0x75, 0x95, 0xb3, 0xaf, 0x88, 0xf9, 0xe4,
+  0x72, 0x53, 0xc5, 0x02, 0x47, 0xd3, 0xb2, 0x10, 0x21, 0x22, 0xda, 0xdd, 0x4f, 0x09, 0xbb, 0xdc,
+  0x54, 0xc2, 0xb0, 0xe6, 0x69, 0x4f, 0xae, 0xca, 0xd2, 0xd3, 0x28, 0x57, 0x0d, 0x5d, 0x82, 0x09,
+  0x4b, 0x18, 0x99, 0xac, 0x17, 0x1f, 0x94, 0xeb, 0x87, 0xba, 0xbb, 0xad, 0xef, 0xec, 0xbe, 0x70,
+  0x34, 0xa3, 0x51, 0xae, 0x22, 0x92, 0x50, 0xfc, 0xd4, 0x5c, 0xfd, 0x39, 0x8f, 0x1d, 0x3c, 0xb2,
+  0xc3, 0x01, 0xaf, 0xe1, 0xbe, 0x16, 0x1f, 0x9e, 0xec, 0x29, 0xf7, 0x5a, 0x2e, 0x2d, 0xea, 0x5a,
+  0xcf, 0x92, 0xb6, 0x47, 0x47, 0x7b, 0xb2, 0x43, 0x9e, 0xb3, 0x54, 0xe3, 0xfa, 0x8d, 0x8e, 0x5e,
+  0x73, 0xa8, 0x28, 0xc7, 0x8a, 0x46, 0xa9, 0x0c, 0x60, 0xc4, 0xb7, 0x00, 0x22, 0xce, 0xba, 0x0a,
+  0xdf, 0x5e, 0xb1, 0xc1, 0x2f, 0xf7, 0xf7, 0x73, 0x09, 0xd4, 0x2b, 0xdc, 0xdf, 0xe7, 0x3b, 0x27,
+  0xaf, 0xea, 0x77, 0xf7, 0x1b, 0x87, 0x3c, 0x2e, 0x06, 0x79, 0x11, 0x13, 0x89, 0xa1, 0xe5, 0xc2,
+  0xf1, 0x82, 0xd4, 0xd8, 0xe1, 0x27, 0xce, 0x9e, 0xb5, 0x70, 0xe7, 0x59, 0xba, 0x20, 0xf2, 0x4a,
+  0x7e, 0x9e, 0xaf, 0xda, 0xe8, 0xa7, 0x9b, 0x1b, 0x6b, 0x58, 0xf9, 0x57, 0x19, 0x25, 0x46, 0xbe,
+  0xbb, 0x4b, 0x1a, 0x8e, 0xeb, 0xb2, 0x25, 0x04, 0x10, 0x6d, 0x8e, 0xae, 0xc6, 0x4a, 0xe4, 0x54,
+  0x35, 0x37, 0xf6, 0xdc, 0xde, 0x38, 0xed, 0x78, 0x91, 0xc0, 0x00, 0x8c, 0xf8, 0xc8, 0x9f, 0x57,
+  0xa9, 0xbd, 0x43, 0x1a, 0xa0, 0x88, 0x53, 0xbb, 0xf2, 0x03, 0xa3, 0x9c, 0xb7, 0x53, 0x07, 0xac,
+  0x35, 0x5c, 0x4e, 0x23, 0x08, 0x2f, 0x26, 0x1d, 0x08, 0x85, 0xf8, 0xbe, 0xad, 0x4d, 0xff, 0x82,
+  0x29, 0x0f, 0xbe, 0x53, 0xd4, 0x3a, 0x78, 0x1b, 0x0e, 0x3b, 0x8e, 0xe0, 0xed, 0x25, 0xee, 0x00,
+  0xbd, 0x48, 0x11, 0xd7, 0xf4, 0xf0, 0xf2, 0xb4, 0xac, 0x87, 0x8d, 0x9c, 0x22, 0x12, 0xf1, 0x55,
+  0x8a, 0xcd, 0xd3, 0x72, 0x79, 0x46, 0x55, 0xaa, 0x59, 0x23, 0x2a, 0x45, 0x49, 0xc1, 0x6d, 0xaf,
+  0x0d, 0x92, 0x52, 0xb6, 0x8b, 0x10, 0x59, 0xc9, 0xcf, 0xa5, 0xc5, 0x3c, 0xcc, 0xba, 0xc2, 0x75,
+  0x29, 0xee, 0x75, 0x71, 0xbd, 0x6d, 0x8a, 0x39, 0x82, 0xc8, 0x1b, 0xc0, 0x2c, 0xf2, 0x6d, 0xcc,
+  0xe7, 0xec, 0xe2, 0x91, 0x94, 0x23, 0x89, 0x35, 0x97, 0xff, 0xac, 0xc5, 0xa1, 0xc7, 0x10, 0x87,
+  0x36, 0x2a, 0xad, 0xe4, 0xa2, 0x2a, 0x24, 0xcd, 0x42, 0x4f, 0xcd, 0x6c, 0xc1, 0x13, 0x5d, 0xe5,
+  0x1a, 0x87, 0x32, 0x29, 0x44, 0xe2, 0xc0, 0x87, 0xe4, 0xbb, 0x38, 0xba, 0xa8, 0xc9, 0x66, 0xcb,
+  0x3d, 0x98, 0x85, 0xd4, 0x15, 0xe2, 0xd8, 0xeb, 0x30, 0x84, 0x64, 0xc0, 0xc4, 0x1c, 0x31, 0x56,
+  0x41, 0x6d, 0x9c, 0x76, 0x8a, 0xae, 0xfa, 0xbd, 0xb3, 0x58, 0x38, 0xc4, 0x0d, 0xa3, 0x48, 0xe6,
+  0x87, 0x18, 0x53, 0x70, 0xe7, 0xfa, 0x1c, 0x8f, 0xde, 0x43, 0x04, 0x4b, 0xb4, 0x38, 0x89, 0x42,
+  0xc8, 0x82, 0xd0, 0x8c, 0xa4, 0x6b, 0x10, 0xbc, 0x83, 0x46, 0x2d, 0xf6, 0x0a, 0x66, 0xd6, 0xf4,
+  0x80, 0x0b, 0x3a, 0x44, 0x0b, 0x60, 0x0c, 0xeb, 0xd8, 0x33, 0xe4, 0xdc, 0x52, 0xad, 0xcd, 0xca,
+  0xfb, 0x3f, 0xea, 0x59, 0xd6, 0xe0, 0xcb, 0xb4, 0xe8, 0xe5, 0x58, 0x04, 0x3c, 0x6b, 0xef, 0xaf,
+  0x15, 0xbb, 0xee, 0xa0, 0xb5, 0x60, 0x4b, 0x60, 0x6b, 0xdb, 0x5a, 0xf3, 0x65, 0x7c, 0x58, 0x47,
+  0x59, 0x2a, 0x0c, 0x6a, 0x98, 0xe4, 0xf8, 0x24, 0xa7, 0xeb, 0xdd, 0x33, 0xd3, 0x65, 0x15, 0x72,
+  0x94, 0x4c, 0x22, 0x7e, 0x41, 0x31, 0xbe, 0x8a, 0x9c, 0x20, 0xf6, 0xf8, 0x1e, 0x09, 0x97, 0xe4,
+  0xe3, 0x28, 0x8c, 0xe3, 0xa9, 0x33, 0x61, 0xcf, 0xb0, 0xea, 0xea, 0x1d, 0x95, 0x4b, 0x32, 0xfc,
+  0xc8, 0x34, 0x98, 0x7e, 0xe0, 0x15, 0xc4, 0x44, 0xcf, 0x34, 0x7b, 0x7b, 0x24, 0xfd, 0x7f, 0xda,
+  0x2d, 0xc1, 0xaf, 0xb5, 0xae, 0x2f, 0xa8, 0x5c, 0xbd, 0xa9, 0x19, 0xd3, 0x9d, 0x5f, 0x2e, 0x58,
+  0x86, 0x60, 0x00, 0x32, 0xab, 0x38, 0xbf, 0x40, 0x74, 0xe1, 0xf8, 0x2c, 0x01, 0xd7, 0x9b, 0x64,
+  0xa3, 0x7b, 0x86, 0xb0, 0x0b, 0x39, 0x1e, 0x5c, 0xdc, 0x72, 0x82, 0x09, 0x44, 0xab, 0xc7, 0xf7,
+  0xae, 0xcf, 0x1a, 0x98, 0x66, 0xa5, 0xe8, 0x0a, 0xa4, 0x4a, 0x4a, 0x2f, 0x7e, 0x80, 0xfb, 0x23,
+  0x12, 0x8b, 0xa4, 0x01, 0x19, 0x0f, 0xb8, 0x26, 0xc4, 0xc7, 0xb9, 0xe5, 0x8c, 0x57, 0x9a, 0xff,
+  0x46, 0x7e, 0x82, 0x77, 0xbd, 0x9f, 0xd3, 0xf5, 0x7e, 0x1a, 0x9b, 0xa6, 0x39, 0x97, 0x72, 0x7a,
+  0x41, 0xde, 0xb0, 0x5c, 0x71, 0xc3, 0x5d, 0xa5, 0x12, 0x8a, 0xf5, 0x47, 0x2f, 0xd6, 0xfe, 0xde,
+  0x9a, 0xb8, 0xe2, 0xd2, 0x78, 0x76, 0xba, 0x4d, 0xe1, 0xfb, 0x54, 0x75, 0xb4, 0xed, 0x93, 0xe3,
+  0x25, 0x7c, 0x49, 0x08, 0xcc, 0xcf, 0x86, 0xb8, 0xe8, 0x1d, 0x08, 0xe2, 0xa6, 0x88, 0x08, 0xdf,
+  0x13, 0x1e, 0x84, 0x6f, 0x88, 0x86, 0xc6, 0xab, 0x20, 0xf2, 0xe2, 0x8a, 0x60, 0xa2, 0x81, 0xf3,
+  0xc0, 0x8f, 0xd5, 0xe2, 0x17, 0x2b, 0x21, 0xcf, 0x44, 0xb7, 0xcf, 0x27, 0x43, 0x3c, 0x3c, 0x72,
+  0xc0, 0xb9, 0xb9, 0x2c, 0x67, 0x4e, 0xea, 0x13, 0x16, 0x69, 0x9d, 0x8f, 0xaf, 0xd6, 0x96, 0x0f,
+  0x6f, 0x5d, 0x3a, 0x7a, 0x2f, 0xb2, 0x93, 0x50, 0x26, 0x08, 0xdc, 0x26, 0x55, 0x1d, 0xfa, 0xc8,
+  0xaf, 0xe9, 0x34, 0xd2, 0x43, 0x1e, 0xb4, 0x72, 0x99, 0xe4, 0xcd, 0x33, 0x41, 0xe5, 0xfa, 0x99,
+  0xc8, 0x46, 0x99, 0xb9, 0xcf, 0x1c, 0x05, 0x41, 0xfe, 0xd6, 0x1e, 0x06, 0x69, 0x64, 0xec, 0xdd,
+  0x70, 0x1e, 0x04, 0x83, 0xcc, 0xca, 0x13, 0x21, 0x5c, 0x57, 0x8f, 0xd3, 0xd1, 0x03, 0xdb, 0xb2,
+  0x83, 0x2e, 0xcf, 0x9c, 0x39, 0xba, 0x94, 0x76, 0x07, 0xdb, 0x40, 0x42, 0x04, 0xca, 0x7d, 0xc3,
+  0xea, 0xac, 0x4f, 0x39, 0x8f, 0x28, 0xa7, 0x11, 0x6a, 0xe6, 0x8e, 0xf2, 0x4a, 0xf3, 0x4b, 0xb6,
+  0xaa, 0x72, 0x38, 0xb9, 0x41, 0x21, 0x98, 0x70, 0xb9, 0x50, 0x86, 0x20, 0xd7, 0x5f, 0x21, 0x31,
+  0xb8, 0x38, 0xaa, 0x4c, 0x04, 0x4e, 0xf9, 0x27, 0x50, 0x88, 0x76, 0x1b, 0x39, 0x4b, 0x5c, 0xe2,
+  0x59, 0x84, 0x37, 0xd0, 0x58, 0xdf, 0x20, 0xf8, 0x0d, 0xd5, 0xc4, 0xf1, 0x6f, 0x9d, 0xfb, 0x98,
+  0x60, 0x4b, 0x7d, 0xc3, 0x44, 0x29, 0xf0, 0x00, 0x0f, 0x70, 0xad, 0x41, 0x37, 0xca, 0x2a, 0x81,
+  0xa2, 0x51, 0xe1, 0xe7, 0xaa, 0xe7, 0x49, 0x9a, 0x8c, 0x48, 0x1c, 0x8b, 0xc2, 0x85, 0x4f, 0xf6,
+  0x32, 0x3e, 0x2b, 0x8b, 0x64, 0x75, 0xd3, 0x74, 0xed, 0xdd, 0x65, 0xc1, 0x05, 0xbd, 0xbb, 0x18,
+  0x57, 0x66, 0xdc, 0x3c, 0x7b, 0x9d, 0xf2, 0x04, 0x1b, 0xbf, 0x4a, 0x4e, 0x12, 0xb6, 0x58, 0xfa,
+  0xe5, 0x7e, 0x45, 0xe0, 0xdc, 0xc8, 0x22, 0xe7, 0x2e, 0x25, 0xff, 0xff, 0x91, 0x33, 0x55, 0x45,
+  0x91, 0x69, 0xed, 0x64, 0x17, 0xf2, 0x3a, 0x1e, 0x28, 0x55, 0x27, 0xcb, 0xff, 0x4b, 0xfb, 0x38,
+  0x1d, 0xdc, 0x9a, 0xca, 0xad, 0x3c, 0x88, 0x6f, 0xa7, 0xab, 0x6e, 0x3b, 0xb8, 0xab, 0x85, 0x5b,
+  0x5c, 0xf8, 0xff, 0x6e, 0xf8, 0x7f, 0xdd, 0x2b, 0x12, 0xfb, 0xcb, 0x61, 0x00, 0x00
 };
 
 
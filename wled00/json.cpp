@@ -1,15 +1,7 @@
 #include "wled.h"
 
 #include "palettes.h"
-
-#define JSON_PATH_STATE      1
-#define JSON_PATH_INFO       2
-#define JSON_PATH_STATE_INFO 3
-#define JSON_PATH_NODES      4
-#define JSON_PATH_PALETTES   5
-#define JSON_PATH_FXDATA     6
-#define JSON_PATH_NETWORKS   7
-#define JSON_PATH_EFFECTS    8
+#include <memory>
 
 /*
  * JSON API (De)serialization
@@ -305,8 +297,14 @@ bool deserializeSegment(JsonObject elem, byte it, byte presetId)
 
 // deserializes WLED state (fileDoc points to doc object if called from web server)
 // presetId is non-0 if called from handlePreset()
-bool deserializeState(JsonObject root, byte callMode, byte presetId)
+// returns true if a full state response was requested, applied (if given) is false if the state lock timed out
+// and nothing was applied (caller must retry or report the failure, ERR_NOBUF)
+bool deserializeState(JsonObject root, byte callMode, byte presetId, bool *applied)
 {
+  StateLockGuard stateLock(1); // serialization in network task must not see segments change
+  if (applied) *applied = stateLock.owns_lock();
+  if (!stateLock) return false;
+
   bool stateResponse = root[F("v")] | false;
 
   #if defined(WLED_DEBUG) && defined(WLED_DEBUG_HOST)
@@ -549,7 +547,8 @@ void serializeSegment(JsonObject& root, Segment& seg, byte id, bool forPreset, b
   root["m12"] = seg.map1D2D;
 }
 
-void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segmentBounds, bool selectedSegmentsOnly)
+// state without segments
+static void serializeStateHead(JsonObject root, bool forPreset, bool includeBri)
 {
   if (includeBri) {
     root["on"] = (bri > 0);
@@ -586,6 +585,11 @@ void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segme
   }
 
   root[F("mainseg")] = strip.getMainSegmentId();
+}
+
+void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segmentBounds, bool selectedSegmentsOnly)
+{
+  serializeStateHead(root, forPreset, includeBri);
 
   JsonArray seg = root.createNestedArray("seg");
   for (size_t s = 0; s < strip.getMaxSegments(); s++) {
@@ -619,7 +623,14 @@ void serializeInfo(JsonObject root)
   leds[F("count")] = strip.getLengthTotal();
   leds[F("pwr")] = strip.currentMilliamps;
   leds["fps"] = strip.getFps();
+  leds[F("fxus")] = strip.getEffectTime();  // avg. time spent in effect functions per frame (us)
+  leds[F("shus")] = strip.getShowTime();    // avg. time spent in show() per frame (us)
+  leds[F("sdata")] = Segment::getUsedSegmentData(); // bytes of effect data in use
   leds[F("maxpwr")] = (strip.currentMilliamps)? strip.ablMilliampsMax : 0;
+  if (strip.currentMilliamps) {
+    JsonArray bpwr = leds.createNestedArray(F("bpwr")); // estimated current per bus (mA), in order of LED outputs
+    for (uint8_t b = 0; b < busses.getNumBusses(); b++) bpwr.add(busses.getBus(b)->getUsedCurrent());
+  }
   leds[F("maxseg")] = strip.getMaxSegments();
   //leds[F("actseg")] = strip.getActiveSegmentsNum();
   //leds[F("seglock")] = false; //might be used in the future to prevent modifications to segment config
@@ -684,12 +695,26 @@ void serializeInfo(JsonObject root)
     root[F("lip")] = realtimeIP.toString();
   }
 
+  JsonObject rtstat = root.createNestedObject(F("rtstat")); // realtime (DDP/E1.31/Art-Net) frame statistics
+  rtstat[F("frames")] = e131Frames;
+  rtstat[F("drop")]   = e131UniDropped;
+  rtstat[F("late")]   = e131UniLate;
+  rtstat[F("ooo")]    = e131UniOoo;
+
   #ifdef WLED_ENABLE_WEBSOCKETS
   root[F("ws")] = ws.count();
   #else
   root[F("ws")] = -1;
   #endif
 
+  JsonObject jlock = root.createNestedObject(F("jlock")); // JSON document pool/lock contention
+  jlock[F("pool")] = WLED_JSON_POOL_SIZE;
+  jlock[F("acq")]  = jsonLockStats.acquired;
+  jlock[F("cont")] = jsonLockStats.contended;
+  jlock[F("pld")]  = jsonLockStats.pooled;
+  jlock[F("fail")] = jsonLockStats.failed;
+  jlock[F("maxw")] = jsonLockStats.maxWait;
+
   root[F("fxcount")] = strip.getModeCount();
   root[F("palcount")] = strip.getPaletteCount();
   root[F("cpalcount")] = strip.customPalettes.size(); //number of custom palettes
@@ -717,6 +742,15 @@ void serializeInfo(JsonObject root)
   fs_info["t"] = fsBytesTotal / 1000;
   fs_info[F("pmt")] = presetsModifiedTime;
 
+  // segment arena (effect data & transitions) usage in bytes
+  const SegmentArena &arena = Segment::getArena();
+  JsonObject arena_info = root.createNestedObject(F("arena"));
+  arena_info["t"]      = arena.getSize();
+  arena_info["u"]      = arena.getUsed();
+  arena_info[F("hw")]  = arena.getHighWater();   // high-water mark
+  arena_info[F("lfb")] = arena.getLargestFree(); // largest free block (fragmentation)
+  arena_info[F("fb")]  = arena.getFallbacks();   // allocations served from heap
+
   root[F("ndc")] = nodeListEnabled ? (int)Nodes.size() : -1;
 
   #ifdef ARDUINO_ARCH_ESP32
@@ -1020,16 +1054,232 @@ void serializeModeNames(JsonArray arr)
   }
 }
 
-// Global buffer locking response helper class (to make sure lock is released when AsyncJsonResponse is destroyed)
+// document sizes of the last state head, info and segment pieces (first attempt for the next piece of that kind)
+static size_t jsStateSize = 0, jsInfoSize = 0, jsSegSize = 0;
+
+enum : uint8_t { JS_END, JS_OPEN, JS_STATE, JS_SEG_OPEN, JS_SEG, JS_STATE_END, JS_INFO_KEY, JS_INFO, JS_CLOSE, JS_EFFECTS_KEY, JS_EFFECTS, JS_EFFECT, JS_EFFECTS_END, JS_PALETTES_KEY, JS_PALETTES };
+
+static const uint8_t jsProgramEnd[]       PROGMEM = { JS_END };
+static const uint8_t jsProgramState[]     PROGMEM = { JS_STATE, JS_SEG_OPEN, JS_SEG, JS_STATE_END, JS_END };
+static const uint8_t jsProgramInfo[]      PROGMEM = { JS_INFO, JS_END };
+static const uint8_t jsProgramStateInfo[] PROGMEM = { JS_OPEN, JS_STATE, JS_SEG_OPEN, JS_SEG, JS_STATE_END, JS_INFO_KEY, JS_INFO, JS_CLOSE, JS_END };
+static const uint8_t jsProgramEffects[]   PROGMEM = { JS_EFFECTS, JS_EFFECT, JS_EFFECTS_END, JS_END };
+static const uint8_t jsProgramAll[]       PROGMEM = { JS_OPEN, JS_STATE, JS_SEG_OPEN, JS_SEG, JS_STATE_END, JS_INFO_KEY, JS_INFO,
+                                                      JS_EFFECTS_KEY, JS_EFFECTS, JS_EFFECT, JS_EFFECTS_END, JS_PALETTES_KEY, JS_PALETTES, JS_CLOSE, JS_END };
+
+JsonStreamer::JsonStreamer(byte subJson, bool measureOnly) : _measureOnly(measureOnly)
+{
+  switch (subJson) {
+    case JSON_PATH_STATE:      _program = jsProgramState;     break;
+    case JSON_PATH_INFO:       _program = jsProgramInfo;      break;
+    case JSON_PATH_STATE_INFO: _program = jsProgramStateInfo; break;
+    case JSON_PATH_EFFECTS:    _program = jsProgramEffects;   break;
+    default:                   _program = jsProgramAll;       break;
+  }
+}
+
+JsonStreamer::~JsonStreamer()
+{
+  delete _doc;
+  free(_buf);
+}
+
+bool JsonStreamer::canStream(byte subJson)
+{
+  return subJson == 0 || subJson == JSON_PATH_STATE || subJson == JSON_PATH_INFO || subJson == JSON_PATH_STATE_INFO || subJson == JSON_PATH_EFFECTS;
+}
+
+// generates first piece (up to and including first document piece), false if it failed
+// used to report a failure before any response has been sent
+bool JsonStreamer::begin()
+{
+  size_t direct;
+  return next(nullptr, 0, direct) || !_failed;
+}
+
+// grows piece buffer to at least size bytes
+bool JsonStreamer::reserveBuf(size_t size)
+{
+  if (_bufSize >= size) return true;
+  free(_buf);
+  _buf = (char*)malloc(size);
+  _bufSize = _buf ? size : 0;
+  return _buf != nullptr;
+}
+
+// fills piece document using fill(), document is reused and only grown if piece does not fit
+// first attempt uses size (from previous piece of same kind), which is updated
+template<typename Fill>
+bool JsonStreamer::fillDoc(size_t &size, Fill fill)
+{
+  size_t capacity = size ? size : 1024;
+  for (;;) {
+    if (!_doc || _doc->capacity() < capacity) {
+      delete _doc;
+      _doc = new DynamicJsonDocument(capacity);
+      if (_doc->capacity() == 0) break; // out of memory
+    }
+    _doc->clear();
+    fill(_doc->to<JsonObject>());
+    if (!_doc->overflowed()) {
+      size = MIN(_doc->memoryUsage() + _doc->memoryUsage()/8 + 64, (size_t)JSON_BUFFER_SIZE); // some headroom for changing values
+      return true;
+    }
+    if (_doc->capacity() >= JSON_BUFFER_SIZE) break;
+    capacity = MIN(_doc->capacity() * 2, (size_t)JSON_BUFFER_SIZE);
+  }
+  delete _doc;
+  _doc = nullptr;
+  DEBUG_PRINTLN(F("JSON stream piece too large!"));
+  return false;
+}
+
+// serializes piece document (with _prefix, without its last _trim chars) straight into dst if it fits
+// (direct is set to bytes written) or else into the piece buffer, called while document still refers to state
+bool JsonStreamer::emitDoc(char *dst, size_t room, size_t &direct)
+{
+  size_t p = _prefix ? strlen_P(_prefix) : 0;
+  _pgm = nullptr;
+  _len = _pos = 0;
+  if (dst && room > p + 2) {
+    size_t w = serializeJson(*_doc, dst + p, room - p);
+    if (w + 1 < room - p) { // not truncated
+      if (p) memcpy_P(dst, _prefix, p);
+      direct = p + w - _trim;
+      _prefix = nullptr;
+      return true;
+    }
+  }
+  size_t w = measureJson(*_doc);
+  if (!reserveBuf(p + w + 1)) return false;
+  if (p) memcpy_P(_buf, _prefix, p);
+  serializeJson(*_doc, _buf + p, _bufSize - p);
+  _len = p + w - _trim;
+  _prefix = nullptr;
+  return true;
+}
+
+// generates next piece of output, returns false when finished
+// document pieces are written straight into dst (direct is set to bytes written) if they fit into room
+bool JsonStreamer::next(char *dst, size_t room, size_t &direct)
+{
+  direct = 0;
+  _pgm = nullptr;
+  _len = _pos = 0;
+  for (;;) {
+    bool ok = true;
+    switch (pgm_read_byte(_program + _step)) {
+      case JS_END:
+        return false;
+      case JS_OPEN:         _prefix = PSTR("{\"state\":"); break; // written with state
+      case JS_SEG_OPEN:     _pgm = PSTR(",\"seg\":["); break;     // state head is written without its closing brace
+      case JS_INFO_KEY:     _pgm = PSTR(",\"info\":"); break;
+      case JS_CLOSE:        _pgm = PSTR("}"); break;
+      case JS_STATE_END:    _pgm = PSTR("]}"); break;
+      case JS_EFFECTS_KEY:  _pgm = PSTR(",\"effects\":"); break;
+      case JS_EFFECTS:      _pgm = PSTR("["); break;
+      case JS_EFFECTS_END:  _pgm = PSTR("]"); break;
+      case JS_PALETTES_KEY: _pgm = PSTR(",\"palettes\":"); break;
+      case JS_PALETTES:     _pgm = JSON_palette_names; break;
+      case JS_STATE: {
+        if (!requestStateLock(17)) { ok = false; break; }
+        byte err = errorFlag; // serializeStateHead() clears error once it is reported
+        ok = fillDoc(jsStateSize, [](JsonObject root) { serializeStateHead(root, false, true); });
+        if (_measureOnly) errorFlag = err;
+        _trim = 1; // segments follow
+        if (ok) ok = emitDoc(dst, room, direct);
+        _trim = 0;
+        releaseStateLock();
+        } break;
+      case JS_INFO:
+        if (!requestStateLock(17)) { ok = false; break; }
+        ok = fillDoc(jsInfoSize, [](JsonObject root) { serializeInfo(root); });
+        if (ok) ok = emitDoc(dst, room, direct);
+        releaseStateLock();
+        break;
+      case JS_SEG: { // one segment per piece, segments may change between pieces (not within)
+        if (!requestStateLock(17)) { ok = false; break; }
+        while (_item < strip.getSegmentsNum() && !strip.getSegment(_item).isActive()) _item++;
+        bool more = _item < strip.getSegmentsNum();
+        if (more) {
+          if (_count++) _prefix = PSTR(",");
+          byte id = _item++;
+          ok = fillDoc(jsSegSize, [id](JsonObject root) { serializeSegment(root, strip.getSegment(id), id); });
+          if (ok) ok = emitDoc(dst, room, direct);
+        }
+        releaseStateLock();
+        if (!more) {
+          _item = _count = 0;
+          break;
+        }
+        if (!ok) break;
+        return true;
+        }
+      case JS_EFFECT: // one effect name per piece (same names as serializeModeNames())
+        if (_item < strip.getModeCount()) {
+          char lineBuffer[256];
+          strncpy_P(lineBuffer, strip.getModeData(_item++), sizeof(lineBuffer)/sizeof(char)-1);
+          lineBuffer[sizeof(lineBuffer)/sizeof(char)-1] = '\0'; // terminate string
+          if (lineBuffer[0] == 0) continue;
+          char* dataPtr = strchr(lineBuffer,'@');
+          if (dataPtr) *dataPtr = 0; // terminate mode data after name
+          StaticJsonDocument<16> name;
+          name.set((const char*)lineBuffer); // stores pointer only
+          size_t w = measureJson(name);      // escaped name
+          if (!reserveBuf(w + 2)) { ok = false; break; }
+          size_t p = 0;
+          if (_count++) _buf[p++] = ',';
+          serializeJson(name, _buf + p, _bufSize - p);
+          _len = p + w;
+          return true;
+        }
+        _item = _count = 0;
+        break;
+    }
+    if (!ok) { // abort (response will be incomplete)
+      _failed = true;
+      _program = jsProgramEnd;
+      _step = 0;
+      _len = 0;
+      return false;
+    }
+    _step++;
+    if (direct) return true;
+    if (_pgm) _len = strlen_P(_pgm);
+    if (_len) return true;
+  }
+}
+
+// copies next part of the response into buf, returns 0 when finished
+size_t JsonStreamer::read(uint8_t *buf, size_t maxLen)
+{
+  size_t n = 0;
+  while (n < maxLen) {
+    if (_pos >= _len) { // generate next piece (straight into buf if it fits)
+      size_t direct;
+      if (!next((char*)buf + n, maxLen - n, direct)) break;
+      n += direct;
+      continue;
+    }
+    size_t chunk = MIN(maxLen - n, _len - _pos);
+    if (_pgm) memcpy_P(buf + n, _pgm + _pos, chunk);
+    else      memcpy(buf + n, _buf + _pos, chunk);
+    _pos += chunk;
+    n += chunk;
+  }
+  return n;
+}
+
+// Pooled buffer locking response helper class (to make sure document is released when AsyncJsonResponse is destroyed)
 class LockedJsonResponse: public AsyncJsonResponse {
+  JsonDocument *_lockedDoc;
   public:
-  // WARNING: constructor assumes requestJSONBufferLock() was successfully acquired externally/prior to constructing the instance
+  // WARNING: constructor assumes the document was successfully acquired (acquireJsonDoc()) prior to constructing the instance
   // Not a good practice with C++. Unfortunately AsyncJsonResponse only has 2 constructors - for dynamic buffer or existing buffer,
   // with existing buffer it clears its content during construction
-  // if the lock was not acquired (using JSONBufferGuard class) previous implementation still cleared existing buffer
-  inline LockedJsonResponse(JsonDocument *doc, bool isArray) : AsyncJsonResponse(doc, isArray) {};
-  // destructor will remove JSON buffer lock when response is destroyed in AsyncWebServer
-  virtual ~LockedJsonResponse() { releaseJSONBufferLock(); };
+  inline LockedJsonResponse(JsonDocument *doc, bool isArray) : AsyncJsonResponse(doc, isArray), _lockedDoc(doc) {};
+  // destructor will release document when response is destroyed in AsyncWebServer
+  virtual ~LockedJsonResponse() { releaseJsonDoc(_lockedDoc); };
 };
 
 void serveJson(AsyncWebServerRequest* request)
@@ -1062,44 +1312,57 @@ void serveJson(AsyncWebServerRequest* request)
     return;
   }
 
-  if (!requestJSONBufferLock(17)) {
+  // compact binary encoding of state/info (no JSON buffer needed)
+  if ((subJson == JSON_PATH_STATE || subJson == JSON_PATH_INFO || subJson == JSON_PATH_STATE_INFO) &&
+      (request->hasParam(F("mp")) || (request->hasHeader("Accept") && request->header("Accept").indexOf(F("msgpack")) >= 0))) {
+    if (!requestStateLock(17)) {
+      request->send(503, "application/json", F("{\"error\":3}"));
+      return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream("application/msgpack");
+    serializeStateInfoMsgPack(response, subJson != JSON_PATH_INFO, subJson != JSON_PATH_STATE);
+    releaseStateLock();
+    request->send(response);
+    return;
+  }
+
+  // state, info and effects are streamed piece by piece (no document of the full response needed)
+  if (JsonStreamer::canStream(subJson)) {
+    // first piece is generated before status is sent, so state being busy can be reported
+    // a piece failing later ends the response (client sees incomplete JSON)
+    std::shared_ptr<JsonStreamer> streamer(new JsonStreamer(subJson));
+    if (!streamer->begin()) {
+      request->send(503, "application/json", F("{\"error\":3}"));
+      return;
+    }
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [streamer](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return streamer->read(buffer, maxLen);
+    });
+    request->send(response);
+    return;
+  }
+
+  JsonDocument *jDoc = acquireJsonDoc(17); // serialization only, does not need to wait for global document
+  if (!jDoc) {
     request->send(503, "application/json", F("{\"error\":3}"));
     return;
   }
-  // releaseJSONBufferLock() will be called when "response" is destroyed (from AsyncWebServer)
+  // releaseJsonDoc() will be called when "response" is destroyed (from AsyncWebServer)
   // make sure you delete "response" if no "request->send(response);" is made
-  LockedJsonResponse *response = new LockedJsonResponse(&doc, subJson==JSON_PATH_FXDATA || subJson==JSON_PATH_EFFECTS); // will clear and convert JsonDocument into JsonArray if necessary
+  LockedJsonResponse *response = new LockedJsonResponse(jDoc, subJson==JSON_PATH_FXDATA); // will clear and convert JsonDocument into JsonArray if necessary
 
   JsonVariant lDoc = response->getRoot();
 
   switch (subJson)
   {
-    case JSON_PATH_STATE:
-      serializeState(lDoc); break;
-    case JSON_PATH_INFO:
-      serializeInfo(lDoc); break;
     case JSON_PATH_NODES:
       serializeNodes(lDoc); break;
     case JSON_PATH_PALETTES:
       serializePalettes(lDoc, request->hasParam("page") ? request->getParam("page")->value().toInt() : 0); break;
-    case JSON_PATH_EFFECTS:
-      serializeModeNames(lDoc); break;
     case JSON_PATH_FXDATA:
       serializeModeData(lDoc); break;
     case JSON_PATH_NETWORKS:
       serializeNetworks(lDoc); break;
-    default: //all
-      JsonObject state = lDoc.createNestedObject("state");
-      serializeState(state);
-      JsonObject info = lDoc.createNestedObject("info");
-      serializeInfo(info);
-      if (subJson != JSON_PATH_STATE_INFO)
-      {
-        JsonArray effects = lDoc.createNestedArray(F("effects"));
-        serializeModeNames(effects); // remove WLED-SR extensions from effect names
-        lDoc[F("palettes")] = serialized((const __FlashStringHelper*)JSON_palette_names);
-      }
-      //lDoc["m"] = lDoc.memoryUsage(); // JSON buffer usage, for remote debugging
   }
 
   DEBUG_PRINTF("JSON buffer size: %u for request: %d\n", lDoc.memoryUsage(), subJson);
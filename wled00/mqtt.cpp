@@ -7,6 +7,8 @@
 #ifdef WLED_ENABLE_MQTT
 #define MQTT_KEEP_ALIVE_TIME 60    // contact the MQTT broker every 60 seconds
 
+static char *deferredApiPayload = nullptr; // JSON API message that found state busy, applied again from handleMqtt()
+
 void parseMQTTBriPayload(char* payload)
 {
   if      (strstr(payload, "ON") || strstr(payload, "on") || strstr(payload, "true")) {bri = briLast; stateUpdated(CALL_MODE_DIRECT_CHANGE);}
@@ -109,8 +111,13 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
       return;
     }
     if (payloadStr[0] == '{') { //JSON API
-      deserializeJson(doc, payloadStr);
-      deserializeState(doc.as<JsonObject>());
+      bool applied;
+      deserializeJson(doc, (const char*)payloadStr); // copies strings, payload is kept if it has to be applied again
+      deserializeState(doc.as<JsonObject>(), CALL_MODE_DIRECT_CHANGE, 0, &applied);
+      if (!applied && !deferredApiPayload) {
+        deferredApiPayload = payloadStr; // keep message for loop (state is busy)
+        payloadStr = nullptr;
+      }
     } else { //HTTP API
       String apireq = "win"; apireq += '&'; // reduce flash string usage
       apireq += payloadStr;
@@ -129,6 +136,20 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
 }
 
 
+// applies JSON API message that could not be applied from MQTT callback
+void handleMqtt()
+{
+  if (!deferredApiPayload || !requestJSONBufferLock(15)) return;
+  bool applied;
+  deserializeJson(doc, (const char*)deferredApiPayload);
+  deserializeState(doc.as<JsonObject>(), CALL_MODE_DIRECT_CHANGE, 0, &applied);
+  releaseJSONBufferLock();
+  if (!applied) return; // try again on next loop
+  delete[] deferredApiPayload;
+  deferredApiPayload = nullptr;
+}
+
+
 void publishMqtt()
 {
   doPublishMqtt = false;
@@ -0,0 +1,267 @@
+#include "wled.h"
+
+/*
+ * Compact binary (MessagePack) encoding of state and info
+ * Written directly from globals and the segment array (no JSON document is built),
+ * keys and structure match the JSON API so generic MessagePack decoders yield the same objects.
+ * Only the fields needed for monitoring/dashboards are included.
+ */
+
+class MsgPackWriter {
+  public:
+    MsgPackWriter(Print *out) : _out(out), _len(0) {} // out == nullptr only measures
+    size_t length() const { return _len; }
+
+    void map(size_t n)   { if (n < 16) u8(0x80 | n); else { u8(0xDE); u16(n); } }
+    void array(size_t n) { if (n < 16) u8(0x90 | n); else { u8(0xDC); u16(n); } }
+    void boolean(bool b) { u8(b ? 0xC3 : 0xC2); }
+    void uint(uint32_t v) {
+      if      (v < 128)   u8(v);
+      else if (v < 256)   { u8(0xCC); u8(v); }
+      else if (v < 65536) { u8(0xCD); u16(v); }
+      else                { u8(0xCE); u32(v); }
+    }
+    void sint(int32_t v) {
+      if      (v >= 0)      uint(v);
+      else if (v >= -32)    u8(v);
+      else if (v >= -128)   { u8(0xD0); u8(v); }
+      else if (v >= -32768) { u8(0xD1); u16(v); }
+      else                  { u8(0xD2); u32(v); }
+    }
+    void str(const char *s) {
+      size_t n = strlen(s);
+      strHeader(n);
+      put((const uint8_t*)s, n);
+    }
+    void str(const __FlashStringHelper *s) {
+      PGM_P p = (PGM_P)s;
+      size_t n = strlen_P(p);
+      strHeader(n);
+      for (size_t i = 0; i < n; i++) u8(pgm_read_byte(p + i));
+    }
+    // key/value helpers
+    void kv(const __FlashStringHelper *k, uint32_t v) { str(k); uint(v); }
+    void ki(const __FlashStringHelper *k, int32_t v)  { str(k); sint(v); }
+    void kb(const __FlashStringHelper *k, bool v)     { str(k); boolean(v); }
+    void ks(const __FlashStringHelper *k, const char *v) { str(k); str(v); }
+
+  private:
+    Print  *_out;
+    size_t  _len;
+
+    void strHeader(size_t n) {
+      if      (n < 32)  u8(0xA0 | n);
+      else if (n < 256) { u8(0xD9); u8(n); }
+      else              { u8(0xDA); u16(n); }
+    }
+    void put(const uint8_t *b, size_t n) { if (_out) _out->write(b, n); _len += n; }
+    void u8(uint8_t v)   { if (_out) _out->write(v); _len++; }
+    void u16(uint16_t v) { u8(v >> 8); u8(v); }
+    void u32(uint32_t v) { u16(v >> 16); u16(v); }
+};
+
+// Print into a fixed size memory buffer (i.e. WS message buffer)
+class BufferPrint : public Print {
+  public:
+    BufferPrint(uint8_t *buf, size_t len) : _buf(buf), _left(len) {}
+    size_t write(uint8_t c) {
+      if (!_left) return 0;
+      *_buf++ = c; _left--;
+      return 1;
+    }
+    size_t write(const uint8_t *b, size_t n) {
+      if (n > _left) n = _left;
+      memcpy(_buf, b, n); _buf += n; _left -= n;
+      return n;
+    }
+  private:
+    uint8_t *_buf;
+    size_t   _left;
+};
+
+static void writeSegment(MsgPackWriter &mp, Segment &seg, byte id)
+{
+  bool matrix = false;
+  #ifndef WLED_DISABLE_2D
+  matrix = strip.isMatrix;
+  #endif
+  mp.map(28 + (matrix ? 5 : 0) + (seg.name != nullptr));
+  mp.kv(F("id"), id);
+  mp.kv(F("start"), seg.start);
+  mp.kv(F("stop"), seg.stop);
+  #ifndef WLED_DISABLE_2D
+  if (matrix) {
+    mp.kv(F("startY"), seg.startY);
+    mp.kv(F("stopY"), seg.stopY);
+  }
+  #endif
+  mp.kv(F("len"), seg.stop - seg.start);
+  mp.kv(F("grp"), seg.grouping);
+  mp.kv(F("spc"), seg.spacing);
+  mp.ki(F("of"), seg.offset);
+  mp.kb(F("on"), seg.on);
+  mp.kb(F("frz"), seg.freeze);
+  mp.kv(F("bri"), seg.opacity ? seg.opacity : 255);
+  mp.kv(F("cct"), seg.cct);
+  mp.kv(F("set"), seg.set);
+  if (seg.name != nullptr) mp.ks(F("n"), seg.name);
+  mp.str(F("col"));
+  mp.array(3);
+  bool white = strip.hasWhiteChannel();
+  for (size_t i = 0; i < 3; i++) {
+    uint32_t c = seg.colors[i];
+    mp.array(white ? 4 : 3);
+    mp.uint(R(c)); mp.uint(G(c)); mp.uint(B(c));
+    if (white) mp.uint(W(c));
+  }
+  mp.kv(F("fx"), seg.mode);
+  mp.kv(F("sx"), seg.speed);
+  mp.kv(F("ix"), seg.intensity);
+  mp.kv(F("pal"), seg.palette);
+  mp.kv(F("c1"), seg.custom1);
+  mp.kv(F("c2"), seg.custom2);
+  mp.kv(F("c3"), seg.custom3);
+  mp.kb(F("sel"), seg.isSelected());
+  mp.kb(F("rev"), seg.reverse);
+  mp.kb(F("mi"), seg.mirror);
+  #ifndef WLED_DISABLE_2D
+  if (matrix) {
+    mp.kb(F("rY"), seg.reverse_y);
+    mp.kb(F("mY"), seg.mirror_y);
+    mp.kb(F("tp"), seg.transpose);
+  }
+  #endif
+  mp.kb(F("o1"), seg.check1);
+  mp.kb(F("o2"), seg.check2);
+  mp.kb(F("o3"), seg.check3);
+  mp.kv(F("si"), seg.soundSim);
+  mp.kv(F("m12"), seg.map1D2D);
+}
+
+static void writeState(MsgPackWriter &mp)
+{
+  mp.map(10);
+  mp.kb(F("on"), bri > 0);
+  mp.kv(F("bri"), briLast);
+  mp.kv(F("transition"), transitionDelay/100); //in 100ms
+  mp.ki(F("ps"), (currentPreset > 0) ? currentPreset : -1);
+  mp.ki(F("pl"), currentPlaylist);
+
+  mp.str(F("nl"));
+  mp.map(5);
+  mp.kb(F("on"), nightlightActive);
+  mp.kv(F("dur"), nightlightDelayMins);
+  mp.kv(F("mode"), nightlightMode);
+  mp.kv(F("tbri"), nightlightTargetBri);
+  mp.ki(F("rem"), nightlightActive ? (int32_t)((nightlightDelayMs - (millis() - nightlightStartTime)) / 1000) : -1); // seconds remaining
+
+  mp.str(F("udpn"));
+  mp.map(4);
+  mp.kb(F("send"), notifyDirect);
+  mp.kb(F("recv"), receiveNotifications);
+  mp.kv(F("sgrp"), syncGroups);
+  mp.kv(F("rgrp"), receiveGroups);
+
+  mp.kv(F("lor"), realtimeOverride);
+  mp.kv(F("mainseg"), strip.getMainSegmentId());
+
+  size_t nSegs = 0;
+  for (size_t s = 0; s < strip.getSegmentsNum(); s++) if (strip.getSegment(s).isActive()) nSegs++;
+  mp.str(F("seg"));
+  mp.array(nSegs);
+  for (size_t s = 0; s < strip.getSegmentsNum(); s++) {
+    Segment &sg = strip.getSegment(s);
+    if (sg.isActive()) writeSegment(mp, sg, s);
+  }
+}
+
+static void writeInfo(MsgPackWriter &mp)
+{
+  mp.map(18);
+  mp.ks(F("ver"), versionString);
+  mp.kv(F("vid"), VERSION);
+
+  bool matrix = false;
+  #ifndef WLED_DISABLE_2D
+  matrix = strip.isMatrix;
+  #endif
+  uint8_t totalLC = 0;
+  for (size_t s = 0; s < strip.getSegmentsNum(); s++) {
+    if (strip.getSegment(s).isActive()) totalLC |= strip.getSegment(s).getLightCapabilities();
+  }
+  mp.str(F("leds"));
+  mp.map(9 + matrix);
+  mp.kv(F("count"), strip.getLengthTotal());
+  mp.kv(F("pwr"), strip.currentMilliamps);
+  mp.kv(F("fps"), strip.getFps());
+  mp.kv(F("fxus"), strip.getEffectTime());
+  mp.kv(F("shus"), strip.getShowTime());
+  mp.kv(F("sdata"), Segment::getUsedSegmentData());
+  mp.kv(F("maxpwr"), strip.currentMilliamps ? strip.ablMilliampsMax : 0);
+  mp.kv(F("maxseg"), strip.getMaxSegments());
+  mp.kv(F("lc"), totalLC);
+  #ifndef WLED_DISABLE_2D
+  if (matrix) {
+    mp.str(F("matrix"));
+    mp.map(2);
+    mp.kv(F("w"), Segment::maxWidth);
+    mp.kv(F("h"), Segment::maxHeight);
+  }
+  #endif
+
+  mp.kb(F("str"), syncToggleReceive);
+  mp.ks(F("name"), serverDescription);
+  mp.kv(F("udpport"), udpPort);
+  mp.kb(F("live"), realtimeMode);
+  mp.ki(F("liveseg"), useMainSegmentOnly ? strip.getMainSegmentId() : -1);
+  #ifdef WLED_ENABLE_WEBSOCKETS
+  mp.ki(F("ws"), ws.count());
+  #else
+  mp.ki(F("ws"), -1);
+  #endif
+  mp.kv(F("fxcount"), strip.getModeCount());
+  mp.kv(F("palcount"), strip.getPaletteCount());
+  mp.kv(F("cpalcount"), strip.customPalettes.size());
+
+  int qrssi = WiFi.RSSI();
+  mp.str(F("wifi"));
+  mp.map(3);
+  mp.ki(F("rssi"), qrssi);
+  mp.ki(F("signal"), getSignalQuality(qrssi));
+  mp.kv(F("channel"), WiFi.channel());
+
+  mp.ki(F("ndc"), nodeListEnabled ? (int)Nodes.size() : -1);
+  mp.kv(F("freeheap"), ESP.getFreeHeap());
+  mp.kv(F("uptime"), millis()/1000 + rolloverMillis*4294967);
+  mp.ks(F("mac"), escapedMac.c_str());
+  char s[16] = "";
+  if (Network.isConnected()) {
+    IPAddress localIP = Network.localIP();
+    sprintf(s, "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
+  }
+  mp.ks(F("ip"), s);
+}
+
+// serializes state and/or info (as {"state":{..},"info":{..}} if both) and returns the number of bytes
+// out == nullptr only measures the required size
+size_t serializeStateInfoMsgPack(Print *out, bool state, bool info)
+{
+  MsgPackWriter mp(out);
+  if (state && info) {
+    mp.map(2);
+    mp.str(F("state")); writeState(mp);
+    mp.str(F("info"));  writeInfo(mp);
+  } else if (state) {
+    writeState(mp);
+  } else if (info) {
+    writeInfo(mp);
+  }
+  return mp.length();
+}
+
+// writes into buf of len bytes (which must be at least as large as measured)
+size_t serializeStateInfoMsgPack(uint8_t *buf, size_t len, bool state, bool info)
+{
+  BufferPrint bp(buf, len);
+  return serializeStateInfoMsgPack(&bp, state, info);
+}
@@ -20,6 +20,83 @@ static const char *getFileName(bool persist = true) {
   return persist ? "/presets.json" : "/tmp.json";
 }
 
+#if WLED_PRESET_CACHE_SIZE > 0
+// LRU cache of recently applied presets so that switching between them (playlists, buttons) does not read the filesystem
+// presets are stored MessagePack encoded (compact and quicker to parse than JSON)
+static struct {
+  uint8_t *data;
+  uint16_t len;
+  byte     id;    // 0 = unused
+  uint32_t used;  // for LRU replacement
+} presetCache[WLED_PRESET_CACHE_SIZE];
+static uint32_t presetCacheTime = 0;
+// bumped by invalidatePresetCache() whenever all of presets.json is (or may be) replaced, i.e. upload or /edit (async context)
+// cache is dropped on next lookup if its content was read at an older generation
+static volatile uint16_t presetsGeneration = 0;
+static uint16_t presetCacheGeneration = 0;
+
+static void dropPresetCache(byte index) {
+  for (auto &e : presetCache) {
+    if (!e.id || (index && e.id != index)) continue;
+    free(e.data);
+    e.data = nullptr;
+    e.id = 0;
+  }
+}
+
+static void checkPresetCacheGeneration() {
+  uint16_t gen = presetsGeneration;
+  if (gen == presetCacheGeneration) return;
+  DEBUG_PRINTLN(F("Presets file changed, dropping cache."));
+  dropPresetCache(0);
+  presetCacheGeneration = gen;
+}
+
+static bool loadCachedPreset(byte index, JsonDocument *dest) {
+  checkPresetCacheGeneration(); // a preset cached after this miss is dropped on next lookup if file changes meanwhile
+  for (auto &e : presetCache) {
+    if (e.id != index || !e.data) continue;
+    if (deserializeMsgPack(*dest, (const uint8_t*)e.data, e.len)) return false; // const input: strings are copied into document
+    e.used = ++presetCacheTime;
+    DEBUG_PRINTLN(F("Preset from cache."));
+    return true;
+  }
+  return false;
+}
+
+static void cachePreset(byte index, JsonDocument *src) {
+  size_t len = measureMsgPack(*src);
+  if (len == 0 || len > PRESET_CACHE_MAX_LEN) return;
+  auto *slot = &presetCache[0]; // unused or least recently used entry
+  for (auto &e : presetCache) {
+    if (!e.id) { slot = &e; break; }
+    if (e.used < slot->used) slot = &e;
+  }
+  free(slot->data);
+  slot->data = nullptr;
+  slot->id = 0;
+  #if defined(ARDUINO_ARCH_ESP32) && defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+  if (psramFound())
+    slot->data = (uint8_t*) ps_malloc(len);
+  else
+  #endif
+  if (ESP.getFreeHeap() > len + MIN_HEAP_SIZE) slot->data = (uint8_t*) malloc(len);
+  if (!slot->data) return;
+  slot->len  = serializeMsgPack(*src, slot->data, len);
+  slot->id   = index;
+  slot->used = ++presetCacheTime;
+}
+#endif
+
+// call before writing preset index to presets.json (0 if file is replaced), the write itself does not drop other presets
+// 0 may be used from async context (cache is only dropped on next lookup)
+void invalidatePresetCache(byte index) {
+  #if WLED_PRESET_CACHE_SIZE > 0
+  if (index) dropPresetCache(index);
+  else       presetsGeneration++;
+  #endif
+}
+
 static void doSaveState() {
   bool persist = (presetToSave < 251);
   const char *filename = getFileName(persist);
@@ -34,7 +111,12 @@ static void doSaveState() {
     serializePlaylist(sObj);
     if (includeBri) sObj["on"] = true;
   } else {
+    if (!requestStateLock(10)) { // state may be changed from network task
+      releaseJSONBufferLock();
+      return; // try again on next loop
+    }
     serializeState(sObj, true, includeBri, segBounds, selectedOnly);
+    releaseStateLock();
   }
   sObj["n"] = saveName;
   if (quickLoad[0]) sObj[F("ql")] = quickLoad;
@@ -46,6 +128,8 @@ static void doSaveState() {
     DEBUG_PRINTLN();
   #endif
 */
+  if (persist) invalidatePresetCache(presetToSave);
+
   #if defined(ARDUINO_ARCH_ESP32)
   if (!persist) {
     if (tmpRAMbuffer!=nullptr) free(tmpRAMbuffer);
@@ -160,8 +244,16 @@ void handlePresets()
     errorFlag = ERR_NONE;
   } else
   #endif
+  #if WLED_PRESET_CACHE_SIZE > 0
+  if (tmpPreset < 255 && loadCachedPreset(tmpPreset, fileDoc)) {
+    errorFlag = ERR_NONE;
+  } else
+  #endif
   {
   errorFlag = readObjectFromFileUsingId(filename, tmpPreset, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
+  #if WLED_PRESET_CACHE_SIZE > 0
+  if (tmpPreset < 255 && !errorFlag) cachePreset(tmpPreset, fileDoc); // before deserializeState() modifies it
+  #endif
   }
   fdo = fileDoc->as<JsonObject>();
 
@@ -178,7 +270,16 @@ void handlePresets()
     if (!fdo["seg"].isNull() || !fdo["on"].isNull() || !fdo["bri"].isNull() || !fdo["nl"].isNull() || !fdo["ps"].isNull() || !fdo[F("playlist")].isNull()) changePreset = true;
     if (!(tmpMode == CALL_MODE_BUTTON_PRESET && fdo["ps"].is<const char *>() && strchr(fdo["ps"].as<const char *>(),'~') != strrchr(fdo["ps"].as<const char *>(),'~')))
       fdo.remove("ps"); // remove load request for presets to prevent recursive crash (if not called by button and contains preset cycling string "1~5~")
-    deserializeState(fdo, CALL_MODE_NO_NOTIFY, tmpPreset); // may change presetToApply by calling applyPreset()
+    bool applied;
+    deserializeState(fdo, CALL_MODE_NO_NOTIFY, tmpPreset, &applied); // may change presetToApply by calling applyPreset()
+    if (!applied) { // state busy, try again on next loop (temporary preset keeps its RAM buffer)
+      if (!presetToApply) {
+        presetToApply   = tmpPreset;
+        callModeToApply = tmpMode;
+      }
+      releaseJSONBufferLock();
+      return;
+    }
   }
   if (!errorFlag && tmpPreset < 255 && changePreset) currentPreset = tmpPreset;
 
@@ -230,6 +331,7 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
       sObj.remove(F("psave"));
       if (sObj["n"].isNull()) sObj["n"] = saveName;
       initPresetsFile(); // just in case if someone deleted presets.json using /edit
+      invalidatePresetCache(index);
       writeObjectToFileUsingId(getFileName(index<255), index, fileDoc);
       presetsModifiedTime = toki.second(); //unix time
       updateFSInfo();
@@ -244,6 +346,7 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
 
 void deletePreset(byte index) {
   StaticJsonDocument<24> empty;
+  invalidatePresetCache(index);
   writeObjectToFileUsingId(getFileName(), index, &empty);
   presetsModifiedTime = toki.second(); //unix time
   updateFSInfo();
@@ -158,6 +158,7 @@ void realtimeLock(uint32_t timeoutMs, byte md)
       start = mainseg.start;
       stop  = mainseg.stop;
       mainseg.freeze = true;
+      mainseg.fill(BLACK); // clear render buffer too (it is painted on every frame)
     } else {
       start = 0;
       stop  = strip.getLengthTotal();
@@ -221,9 +222,11 @@ void handleNotifications()
     notify(notificationSentCallMode,true);
   }
 
-  if (e131NewData && millis() - strip.getLastShow() > 15)
+  handleE131Frame();
+  if (e131NewData) // set once per complete realtime frame (DDP push, assembled E1.31/Art-Net frame)
   {
     e131NewData = false;
+    e131Frames++;
     strip.show();
   }
 
@@ -252,13 +255,7 @@ void handleNotifications()
       rgbUdp.read(lbuf, packetSize);
       realtimeLock(realtimeTimeoutMs, REALTIME_MODE_HYPERION);
       if (realtimeOverride && !(realtimeMode && useMainSegmentOnly)) return;
-      uint16_t id = 0;
-      uint16_t totalLen = strip.getLengthTotal();
-      for (size_t i = 0; i < packetSize -2; i += 3)
-      {
-        setRealtimePixel(id, lbuf[i], lbuf[i+1], lbuf[i+2], 0);
-        id++; if (id >= totalLen) break;
-      }
+      setRealtimePixels(0, packetSize/3, lbuf, 3);
       if (!(realtimeMode && useMainSegmentOnly)) strip.show();
       return;
     }
@@ -492,16 +489,7 @@ void handleNotifications()
     byte numPackets = udpIn[5];
 
     uint16_t id = (tpmPayloadFrameSize/3)*(packetNum-1); //start LED
-    uint16_t totalLen = strip.getLengthTotal();
-    for (size_t i = 6; i < tpmPayloadFrameSize + 4U; i += 3)
-    {
-      if (id < totalLen)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-        id++;
-      }
-      else break;
-    }
+    if (packetSize > 6) setRealtimePixels(id, MIN(tpmPayloadFrameSize, packetSize - 6) / 3, &udpIn[6], 3);
     if (tpmPacketCount == numPackets) //reset packet count and show if all packets were received
     {
       tpmPacketCount = 0;
@@ -526,7 +514,6 @@ void handleNotifications()
     }
     if (realtimeOverride && !(realtimeMode && useMainSegmentOnly)) return;
 
-    uint16_t totalLen = strip.getLengthTotal();
     if ((udpIn[0] == 1) && (packetSize > 5)) //warls - avoiding infinite "for" loop (unsigned underflow)    
     {
       for (size_t i = 2; i < packetSize -3; i += 4)
@@ -535,40 +522,18 @@ void handleNotifications()
       }
     } else if (udpIn[0] == 2) //drgb
     {
-      uint16_t id = 0;
-      for (size_t i = 2; i < packetSize -2; i += 3)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-
-        id++; if (id >= totalLen) break;
-      }
-    } else if ((udpIn[0] == 3) && (packetSize > 5)) //drgbw - avoiding infinite "for" loop (unsigned underflow)
+      setRealtimePixels(0, (packetSize-2)/3, &udpIn[2], 3);
+    } else if ((udpIn[0] == 3) && (packetSize > 5)) //drgbw
     {
-      uint16_t id = 0;
-      for (size_t i = 2; i < packetSize -3; i += 4)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-
-        id++; if (id >= totalLen) break;
-      }
-    } else if (udpIn[0] == 4) //dnrgb
+      setRealtimePixels(0, (packetSize-2)/4, &udpIn[2], 4);
+    } else if ((udpIn[0] == 4) && (packetSize > 3)) //dnrgb
     {
       uint16_t id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (size_t i = 4; i < packetSize -2; i += 3)
-      {
-        if (id >= totalLen) break;
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-        id++;
-      }
-    } else if (udpIn[0] == 5) //dnrgbw
+      setRealtimePixels(id, (packetSize-4)/3, &udpIn[4], 3);
+    } else if ((udpIn[0] == 5) && (packetSize > 3)) //dnrgbw
     {
       uint16_t id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (size_t i = 4; i < packetSize -2; i += 4)
-      {
-        if (id >= totalLen) break;
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-        id++;
-      }
+      setRealtimePixels(id, (packetSize-4)/4, &udpIn[4], 4);
     }
     strip.show();
     return;
@@ -611,6 +576,33 @@ void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w)
   }
 }
 
+// bulk version of setRealtimePixel() for contiguous RGB (channels=3) or RGBW (channels=4) data
+// bounds and gamma correction are resolved once, bus buffers are written per contiguous run
+void setRealtimePixels(uint16_t start, uint16_t count, const byte *data, uint8_t channels)
+{
+  int pix = start + arlsOffset;
+  if (pix < 0) { // pixels shifted below 0 are dropped
+    if (-pix >= count) return;
+    data  += -pix * channels;
+    count -= -pix;
+    start += -pix;
+    pix    = 0;
+  }
+  int totalLen = strip.getLengthTotal();
+  if (pix >= totalLen) return;
+  if (pix + count > totalLen) count = totalLen - pix;
+
+  if (useMainSegmentOnly || pix < strip.getMappingLength()) {
+    // segment or ledmap decides where pixels go, set them one by one
+    for (unsigned i = 0; i < count; i++, data += channels) {
+      setRealtimePixel(start + i, data[0], data[1], data[2], channels > 3 ? data[3] : 0);
+    }
+    return;
+  }
+  bool useGamma = !arlsDisableGammaCorrection && gammaCorrectCol;
+  busses.setPixelColors(pix, count, data, channels, useGamma ? NeoGammaWLEDMethod::getTable() : nullptr);
+}
+
 /*********************************************************************************************\
    Refresh aging for remote units, drop if too old...
 \*********************************************************************************************/
@@ -723,11 +715,38 @@ void sendSysInfoUDP()
 static       size_t sequenceNumber = 0; // this needs to be shared across all outputs
 static const size_t ART_NET_HEADER_SIZE = 12;
 static const byte   ART_NET_HEADER[] PROGMEM = {0x41,0x72,0x74,0x2d,0x4e,0x65,0x74,0x00,0x00,0x50,0x00,0x0e};
+static const size_t E131_HEADER_SIZE = 126; // root, framing and DMP layer including DMX start code
+static const byte   E131_ACN_ID[] PROGMEM = {0x41,0x53,0x43,0x2d,0x45,0x31,0x2e,0x31,0x37,0x00,0x00,0x00};
+#define REALTIME_PACKET_MAXSIZE (DDP_HEADER_LEN + DDP_CHANNELS_PER_PACKET) // largest packet of all protocols
+
+static WiFiUDP  ddpUdp;                 // reused for all outputs so the socket is not recreated every frame
+static uint8_t *packetBuffer = nullptr; // complete packet is assembled here and sent with a single write
+
+// copies len channel values to dst while applying brightness (same result as scale8())
+// 4 channels are processed at once (2 per 16 bit lane)
+static void scaleChannels(uint8_t *dst, const uint8_t *src, size_t len, uint8_t bri) {
+  if (bri == 255) { memcpy(dst, src, len); return; }
+  const uint32_t scale = bri + 1;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t v;
+    memcpy(&v, src + i, 4);
+    v = ((((v & 0x00FF00FF) * scale) >> 8) & 0x00FF00FF) | ((((v >> 8) & 0x00FF00FF) * scale) & 0xFF00FF00);
+    memcpy(dst + i, &v, 4);
+  }
+  for (; i < len; i++) dst[i] = (src[i] * scale) >> 8;
+}
+
+static inline void putU16(uint8_t *p, uint16_t v) { p[0] = v >> 8; p[1] = v; } // network byte order
 
 uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8_t *buffer, uint8_t bri, bool isRGBW)  {
   if (!(apActive || interfacesInited) || !client[0] || !length) return 1;  // network not initialised or dummy/unset IP address  031522 ajn added check for ap
 
-  WiFiUDP ddpUdp;
+  if (!packetBuffer) packetBuffer = (uint8_t*) malloc(REALTIME_PACKET_MAXSIZE); // kept for the lifetime of the device
+  if (!packetBuffer) {
+    DEBUG_PRINTLN(F("Realtime output: no memory for packet buffer"));
+    return 1;
+  }
 
   switch (type) {
     case 0: // DDP
@@ -762,28 +781,20 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
           }
         }
 
-        // write the header
-        /*0*/ddpUdp.write(flags);
-        /*1*/ddpUdp.write(sequenceNumber++ & 0x0F); // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
-        /*2*/ddpUdp.write(isRGBW ?  DDP_TYPE_RGBW32 : DDP_TYPE_RGB24);
-        /*3*/ddpUdp.write(DDP_ID_DISPLAY);
+        // header
+        /*0*/packetBuffer[0] = flags;
+        /*1*/packetBuffer[1] = sequenceNumber++ & 0x0F; // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
+        /*2*/packetBuffer[2] = isRGBW ?  DDP_TYPE_RGBW32 : DDP_TYPE_RGB24;
+        /*3*/packetBuffer[3] = DDP_ID_DISPLAY;
         // data offset in bytes, 32-bit number, MSB first
-        /*4*/ddpUdp.write(0xFF & (channel >> 24));
-        /*5*/ddpUdp.write(0xFF & (channel >> 16));
-        /*6*/ddpUdp.write(0xFF & (channel >>  8));
-        /*7*/ddpUdp.write(0xFF & (channel      ));
+        /*4*/putU16(packetBuffer+4, channel >> 16);
+        /*6*/putU16(packetBuffer+6, channel);
         // data length in bytes, 16-bit number, MSB first
-        /*8*/ddpUdp.write(0xFF & (packetSize >> 8));
-        /*9*/ddpUdp.write(0xFF & (packetSize     ));
-
-        // write the colors, the write write(const uint8_t *buffer, size_t size)
-        // function is just a loop internally too
-        for (size_t i = 0; i < packetSize; i += (isRGBW?4:3)) {
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // R
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // G
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // B
-          if (isRGBW) ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // W
-        }
+        /*8*/putU16(packetBuffer+8, packetSize);
+
+        scaleChannels(packetBuffer + DDP_HEADER_LEN, buffer + bufferOffset, packetSize, bri);
+        bufferOffset += packetSize;
+        ddpUdp.write(packetBuffer, DDP_HEADER_LEN + packetSize);
 
         if (!ddpUdp.endPacket()) {
           DEBUG_PRINTLN(F("WiFiUDP.endPacket returned an error"));
@@ -795,61 +806,77 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
     } break;
 
     case 1: //E1.31
-    {
-    } break;
-
     case 2: //ArtNet
     {
-      // calculate the number of UDP packets we need to send
+      // calculate the number of UDP packets we need to send, 1 full packet == 1 full universe
       const size_t channelCount = length * (isRGBW?4:3); // 1 channel for every R,G,B,(W?) value
-      const size_t ARTNET_CHANNELS_PER_PACKET = isRGBW?512:510; // 512/4=128 RGBW LEDs, 510/3=170 RGB LEDs
-      const size_t packetCount = ((channelCount-1)/ARTNET_CHANNELS_PER_PACKET)+1;
+      const size_t CHANNELS_PER_PACKET = isRGBW?512:510; // 512/4=128 RGBW LEDs, 510/3=170 RGB LEDs
+      const size_t packetCount = ((channelCount-1)/CHANNELS_PER_PACKET)+1;
+      const size_t headerSize = (type == 1) ? E131_HEADER_SIZE : ART_NET_HEADER_SIZE + 6;
 
-      uint32_t channel = 0; 
       size_t bufferOffset = 0;
 
       sequenceNumber++;
+      if (sequenceNumber > 255) sequenceNumber = 0;
+
+      // parts of the header that do not change between universes
+      if (type == 1) {
+        memset(packetBuffer, 0, E131_HEADER_SIZE);
+        putU16(packetBuffer+0, 0x0010);                                 // preamble size
+        memcpy_P(packetBuffer+4, E131_ACN_ID, sizeof(E131_ACN_ID));     // ACN packet identifier
+        packetBuffer[21] = 0x04;                                        // root vector: VECTOR_ROOT_E131_DATA
+        memcpy(packetBuffer+22, "WLED", 4);                             // CID (16 bytes), unique per device
+        strncpy((char*)packetBuffer+26, escapedMac.c_str(), 12);
+        packetBuffer[43] = 0x02;                                        // framing vector: VECTOR_E131_DATA_PACKET
+        strncpy((char*)packetBuffer+44, serverDescription, 63);         // source name
+        packetBuffer[108] = 100;                                        // priority (default)
+        packetBuffer[111] = sequenceNumber;
+        packetBuffer[117] = 0x02;                                       // DMP vector: VECTOR_DMP_SET_PROPERTY
+        packetBuffer[118] = 0xA1;                                       // address & data type
+        putU16(packetBuffer+121, 0x0001);                               // address increment
+      } else {
+        memcpy_P(packetBuffer, ART_NET_HEADER, ART_NET_HEADER_SIZE);    // This doesn't change. Hard coded ID, OpCode, and protocol version.
+        packetBuffer[12] = sequenceNumber;                              // sequence number. 1..255
+        packetBuffer[13] = 0x00;                                        // physical - more an FYI, not really used for anything. 0..3
+      }
 
       for (size_t currentPacket = 0; currentPacket < packetCount; currentPacket++) {
 
-        if (sequenceNumber > 255) sequenceNumber = 0;
-
-        if (!ddpUdp.beginPacket(client, ARTNET_DEFAULT_PORT)) {
-          DEBUG_PRINTLN(F("Art-Net WiFiUDP.beginPacket returned an error"));
+        if (!ddpUdp.beginPacket(client, (type == 1) ? E131_DEFAULT_PORT : ARTNET_DEFAULT_PORT)) {
+          DEBUG_PRINTLN(F("Art-Net/E1.31 WiFiUDP.beginPacket returned an error"));
           return 1; // borked
         }
 
-        size_t packetSize = ARTNET_CHANNELS_PER_PACKET;
+        size_t packetSize = CHANNELS_PER_PACKET;
 
         if (currentPacket == (packetCount - 1U)) {
           // last packet
-          if (channelCount % ARTNET_CHANNELS_PER_PACKET) {
-            packetSize = channelCount % ARTNET_CHANNELS_PER_PACKET;
+          if (channelCount % CHANNELS_PER_PACKET) {
+            packetSize = channelCount % CHANNELS_PER_PACKET;
           }
         }
 
-        byte header_buffer[ART_NET_HEADER_SIZE];
-        memcpy_P(header_buffer, ART_NET_HEADER, ART_NET_HEADER_SIZE);
-        ddpUdp.write(header_buffer, ART_NET_HEADER_SIZE); // This doesn't change. Hard coded ID, OpCode, and protocol version.
-        ddpUdp.write(sequenceNumber & 0xFF); // sequence number. 1..255
-        ddpUdp.write(0x00); // physical - more an FYI, not really used for anything. 0..3
-        ddpUdp.write((currentPacket) & 0xFF); // Universe LSB. 1 full packet == 1 full universe, so just use current packet number.
-        ddpUdp.write(0x00); // Universe MSB, unused.
-        ddpUdp.write(0xFF & (packetSize >> 8)); // 16-bit length of channel data, MSB
-        ddpUdp.write(0xFF & (packetSize     )); // 16-bit length of channel data, LSB
-
-        for (size_t i = 0; i < packetSize; i += (isRGBW?4:3)) {
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // R
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // G
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // B
-          if (isRGBW) ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // W
+        if (type == 1) {
+          const size_t total = E131_HEADER_SIZE + packetSize;
+          putU16(packetBuffer+16,  0x7000 | (total - 16));   // root layer flags & length
+          putU16(packetBuffer+38,  0x7000 | (total - 38));   // framing layer flags & length
+          putU16(packetBuffer+113, currentPacket + 1);       // universe (E1.31 universes start at 1)
+          putU16(packetBuffer+115, 0x7000 | (total - 115));  // DMP layer flags & length
+          putU16(packetBuffer+123, packetSize + 1);          // property value count (including start code)
+        } else {
+          packetBuffer[14] = currentPacket & 0xFF;           // Universe LSB. 1 full packet == 1 full universe, so just use current packet number.
+          packetBuffer[15] = 0x00;                           // Universe MSB, unused.
+          putU16(packetBuffer+16, packetSize);               // 16-bit length of channel data
         }
 
+        scaleChannels(packetBuffer + headerSize, buffer + bufferOffset, packetSize, bri);
+        bufferOffset += packetSize;
+        ddpUdp.write(packetBuffer, headerSize + packetSize);
+
         if (!ddpUdp.endPacket()) {
-          DEBUG_PRINTLN(F("Art-Net WiFiUDP.endPacket returned an error"));
+          DEBUG_PRINTLN(F("Art-Net/E1.31 WiFiUDP.endPacket returned an error"));
           return 1; // borked
         }
-        channel += packetSize;
       }
     } break;
   }
@@ -198,18 +198,15 @@ bool isAsterisksOnly(const char* str, byte maxLen)
 
 
 //threading/network callback details: https://github.com/Aircoookie/WLED/pull/2336#discussion_r762276994
-bool requestJSONBufferLock(uint8_t module)
+static bool lockJSONBuffer(uint8_t module, unsigned long timeout)
 {
   unsigned long now = millis();
 
-  while (jsonBufferLock && millis()-now < 1000) delay(1); // wait for a second for buffer lock
+  while (jsonBufferLock && millis()-now < timeout) delay(1); // wait for buffer lock
 
-  if (millis()-now >= 1000) {
-    DEBUG_PRINT(F("ERROR: Locking JSON buffer failed! ("));
-    DEBUG_PRINT(jsonBufferLock);
-    DEBUG_PRINTLN(")");
-    return false; // waiting time-outed
-  }
+  uint16_t waited = millis()-now;
+  if (waited > jsonLockStats.maxWait) jsonLockStats.maxWait = waited;
+  if (jsonBufferLock) return false; // waiting time-outed
 
   jsonBufferLock = module ? module : 255;
   DEBUG_PRINT(F("JSON buffer locked. ("));
@@ -220,6 +217,21 @@ bool requestJSONBufferLock(uint8_t module)
   return true;
 }
 
+bool requestJSONBufferLock(uint8_t module, unsigned long timeout)
+{
+  if (jsonBufferLock) jsonLockStats.contended++;
+
+  if (!lockJSONBuffer(module, timeout)) { // by default wait for a second for buffer lock
+    jsonLockStats.failed++;
+    DEBUG_PRINT(F("ERROR: Locking JSON buffer failed! ("));
+    DEBUG_PRINT(jsonBufferLock);
+    DEBUG_PRINTLN(")");
+    return false;
+  }
+  jsonLockStats.acquired++;
+  return true;
+}
+
 
 void releaseJSONBufferLock()
 {
@@ -230,6 +242,118 @@ void releaseJSONBufferLock()
   jsonBufferLock = 0;
 }
 
+#if WLED_JSON_POOL_SIZE > 1
+// additional documents for read-only requests (allocated when global doc is found locked)
+// documents in PSRAM are kept for the next burst, internal heap is released as soon as a document is released
+static JsonDocument     *jsonPool[WLED_JSON_POOL_SIZE-1] = {nullptr};
+static volatile uint8_t  jsonPoolLock[WLED_JSON_POOL_SIZE-1] = {0};
+#endif
+
+// returns global doc if it is free or else a free pool document without waiting
+// if all documents are busy it waits for the global doc like requestJSONBufferLock()
+// requests that modify state (deserializeState() etc.) must use requestJSONBufferLock() so they stay serialized
+// the document does not protect state, serialize state under requestStateLock()
+JsonDocument* acquireJsonDoc(uint8_t module)
+{
+  if (!jsonBufferLock && lockJSONBuffer(module, 0)) {
+    jsonLockStats.acquired++;
+    return &doc;
+  }
+  jsonLockStats.contended++;
+#if WLED_JSON_POOL_SIZE > 1
+  for (size_t i = 0; i < WLED_JSON_POOL_SIZE-1; i++) {
+    if (jsonPoolLock[i]) continue;
+    jsonPoolLock[i] = module ? module : 255;
+    if (!jsonPool[i]) {
+      #if defined(ARDUINO_ARCH_ESP32) && defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+      if (psramFound() || ESP.getFreeHeap() > JSON_BUFFER_SIZE + MIN_HEAP_SIZE)
+      #else
+      if (ESP.getFreeHeap() > JSON_BUFFER_SIZE + MIN_HEAP_SIZE)
+      #endif
+        jsonPool[i] = new PSRAMDynamicJsonDocument(JSON_BUFFER_SIZE);
+      if (jsonPool[i] && jsonPool[i]->capacity() == 0) { delete jsonPool[i]; jsonPool[i] = nullptr; } // allocation failed
+    }
+    if (!jsonPool[i]) { jsonPoolLock[i] = 0; break; }
+    DEBUG_PRINTF("JSON pool document %u locked (%u).\n", i, jsonPoolLock[i]);
+    jsonPool[i]->clear();
+    jsonLockStats.acquired++;
+    jsonLockStats.pooled++;
+    return jsonPool[i];
+  }
+#endif
+  if (lockJSONBuffer(module, 1000)) { // every document busy, wait for global doc
+    jsonLockStats.acquired++;
+    return &doc;
+  }
+  jsonLockStats.failed++;
+  DEBUG_PRINTLN(F("ERROR: No free JSON document!"));
+  return nullptr;
+}
+
+void releaseJsonDoc(JsonDocument* d)
+{
+  if (d == &doc) {
+    releaseJSONBufferLock();
+    return;
+  }
+#if WLED_JSON_POOL_SIZE > 1
+  for (size_t i = 0; i < WLED_JSON_POOL_SIZE-1; i++) if (jsonPool[i] == d) {
+    #if defined(ARDUINO_ARCH_ESP32) && defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+    if (!psramFound())
+    #endif
+    {
+      delete jsonPool[i]; // do not keep JSON_BUFFER_SIZE of internal heap after a burst of requests
+      jsonPool[i] = nullptr;
+    }
+    jsonPoolLock[i] = 0; // only after document is released
+  }
+#endif
+}
+
+
+// state lock: the network task must not walk segments and busses (serializeState(), serializeInfo()) while
+// loop or deserializeState() change them, held only while serializing or applying (not while sending)
+static volatile uint8_t stateLock = 0;
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE stateLockMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+static bool tryStateLock(uint8_t module)
+{
+  bool locked = false;
+  #ifdef ARDUINO_ARCH_ESP32
+  portENTER_CRITICAL(&stateLockMux);
+  #endif
+  if (!stateLock) {
+    stateLock = module ? module : 255;
+    locked = true;
+  }
+  #ifdef ARDUINO_ARCH_ESP32
+  portEXIT_CRITICAL(&stateLockMux);
+  #endif
+  return locked;
+}
+
+bool requestStateLock(uint8_t module, unsigned long timeout)
+{
+  unsigned long now = millis();
+  while (!tryStateLock(module)) {
+    if (millis() - now >= timeout) {
+      DEBUG_PRINT(F("ERROR: Locking state failed! ("));
+      DEBUG_PRINT(stateLock);
+      DEBUG_PRINTLN(")");
+      return false;
+    }
+    delay(1);
+  }
+  return true;
+}
+
+void releaseStateLock()
+{
+  stateLock = 0;
+}
+
 
 // extracts effect mode (or palette) name from names serialized string
 // caller must provide large enough buffer for name (including SR extensions)!
@@ -527,13 +651,15 @@ um_data_t* simulateSound(uint8_t simulationId)
 }
 
 
-// enumerate all ledmapX.json files on FS and extract ledmap names if existing
+// enumerate all ledmapX.json (or ledmapX.bin) files on FS and extract ledmap names if existing
 void enumerateLedmaps() {
   ledMaps = 1;
   for (size_t i=1; i<WLED_MAX_LEDMAPS; i++) {
     char fileName[33];
-    sprintf_P(fileName, PSTR("/ledmap%d.json"), i);
-    bool isFile = WLED_FS.exists(fileName);
+    sprintf_P(fileName, PSTR("/ledmap%d.bin"), i);
+    bool isBinary = WLED_FS.exists(fileName);
+    if (!isBinary) sprintf_P(fileName, PSTR("/ledmap%d.json"), i);
+    bool isFile = isBinary || WLED_FS.exists(fileName);
 
     #ifndef ESP8266
     if (ledmapNames[i-1]) { //clear old name
@@ -546,7 +672,13 @@ void enumerateLedmaps() {
       ledMaps |= 1 << i;
 
       #ifndef ESP8266
-      if (requestJSONBufferLock(21)) {
+      if (isBinary) {
+        char name[33];
+        MapFileReader map(fileName);
+        if (!map.getName(name, sizeof(name))) snprintf_P(name, 32, PSTR("ledmap%d.bin"), i);
+        ledmapNames[i-1] = new char[strlen(name)+1];
+        if (ledmapNames[i-1]) strcpy(ledmapNames[i-1], name);
+      } else if (requestJSONBufferLock(21)) {
         if (readObjectFromFile(fileName, nullptr, &doc)) {
           size_t len = 0;
           if (!doc["n"].isNull()) {
@@ -156,7 +156,7 @@ void WLED::loop()
 
   //LED settings have been saved, re-init busses
   //This code block causes severe FPS drop on ESP32 with the original "if (busConfigs[0] != nullptr)" conditional. Investigate!
-  if (doInitBusses) {
+  if (doInitBusses && requestStateLock(19)) { // busses and segments must not be serialized while being replaced
     doInitBusses = false;
     DEBUG_PRINTLN(F("Re-init busses."));
     bool aligned = strip.checkSegmentAlignment(); //see if old segments match old bus(ses)
@@ -175,9 +175,12 @@ void WLED::loop()
       }
       delete busConfigs[i]; busConfigs[i] = nullptr;
     }
+    releaseStateLock(); // finalizeInit() needs JSON buffer lock, which is taken before state lock elsewhere
     strip.finalizeInit(); // also loads default ledmap if present
+    bool locked = requestStateLock(19);
     if (aligned) strip.makeAutoSegments();
     else strip.fixInvalidSegments();
+    if (locked) releaseStateLock();
     doSerializeConfig = true;
   }
   if (loadLedmap >= 0) {
@@ -189,6 +192,9 @@ void WLED::loop()
 
   yield();
   handleWs();
+  #ifndef WLED_DISABLE_MQTT
+  handleMqtt();
+  #endif
   handleStatusLED();
 
   toki.resetTick();
@@ -314,6 +320,9 @@ void WLED::setup()
   DEBUG_PRINT(" ");
   DEBUG_PRINT(VERSION);
   DEBUG_PRINTLN(F(" INIT---"));
+  #ifdef WLED_BENCHMARK_COLOR_MATH
+  colorMathBenchmark();
+  #endif
 #ifdef ARDUINO_ARCH_ESP32
   DEBUG_PRINT(F("esp32 "));
   DEBUG_PRINTLN(ESP.getSdkVersion());
@@ -415,6 +424,9 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
   initPresetsFile();
 #endif
   updateFSInfo();
+  #ifdef WLED_BENCHMARK_LEDMAP
+  WS2812FX::benchmarkLedmaps();
+  #endif
 
   // generate module IDs must be done before AP setup
   escapedMac = WiFi.macAddress();
@@ -437,6 +449,9 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
   DEBUG_PRINTLN(F("Initializing strip"));
   beginStrip();
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
+  #ifdef WLED_BENCHMARK_COLOR_ORDER
+  busses.benchmarkColorOrder();
+  #endif
 
   DEBUG_PRINTLN(F("Usermods setup"));
   userSetup();
@@ -333,6 +333,11 @@ WLED_GLOBAL byte bootPreset   _INIT(0);                   // save preset to load
 //if false, only one segment spanning the total LEDs is created,
 //but not on LED settings save if there is more than one segment currently
 WLED_GLOBAL bool autoSegments       _INIT(false);
+// busses without double buffering only hold brightness scaled colors, reading pixels back is lossy
+// brightness/ABL limit changes repaint them from segment render buffers (lossless) if all their pixels come from these,
+// otherwise (realtime data, uncovered or overlapping segments) colors are restored from the bus (lossy)
+// build with -D WLED_LOSSLESS_BRIGHTNESS to retain unscaled colors for them too: costs 3 (RGB) or 4 (RGBW) bytes of RAM per LED,
+// pixel reads become plain buffer reads and brightness is applied to retained colors only when painting NeoPixelBus
 #ifdef ESP8266
 WLED_GLOBAL bool useGlobalLedBuffer _INIT(false); // double buffering disabled on ESP8266
 #else
@@ -702,6 +707,10 @@ WLED_GLOBAL WiFiUDP ntpUdp;
 WLED_GLOBAL ESPAsyncE131 e131 _INIT_N(((handleE131Packet)));
 WLED_GLOBAL ESPAsyncE131 ddp  _INIT_N(((handleE131Packet)));
 WLED_GLOBAL bool e131NewData _INIT(false);
+WLED_GLOBAL uint32_t e131Frames _INIT(0);      // realtime frames shown
+WLED_GLOBAL uint32_t e131UniDropped _INIT(0);  // universes missing from shown frames or dropped while frames waited for show()
+WLED_GLOBAL uint32_t e131UniLate _INIT(0);     // universes/packets arriving after a newer one
+WLED_GLOBAL uint32_t e131UniOoo _INIT(0);      // universes arriving with a gap in sequence numbers
 
 // led fx library object
 WLED_GLOBAL BusManager busses _INIT(BusManager());
@@ -756,6 +765,14 @@ WLED_GLOBAL int8_t spi_sclk  _INIT(SPISCLKPIN);
 // global ArduinoJson buffer
 WLED_GLOBAL StaticJsonDocument<JSON_BUFFER_SIZE> doc;
 WLED_GLOBAL volatile uint8_t jsonBufferLock _INIT(0);
+// JSON buffer lock and document pool statistics (shown in info)
+WLED_GLOBAL struct JsonLockStats {
+  uint32_t acquired;  // documents handed out
+  uint32_t contended; // requests that found global document locked
+  uint32_t pooled;    // requests served by an additional pool document
+  uint32_t failed;    // requests that got no document (timeout or pool exhausted)
+  uint16_t maxWait;   // longest wait for global document (ms)
+} jsonLockStats _INIT_N(({ 0, 0, 0, 0, 0 }));
 
 // enable additional debug output
 #if defined(WLED_DEBUG_HOST)
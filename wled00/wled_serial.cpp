@@ -120,14 +120,18 @@ void handleSerial()
             releaseJSONBufferLock();
             return;
           }
-          verboseResponse = deserializeState(doc.as<JsonObject>());
+          bool applied;
+          verboseResponse = deserializeState(doc.as<JsonObject>(), CALL_MODE_DIRECT_CHANGE, 0, &applied);
           //only send response if TX pin is unused for other purposes
-          if (verboseResponse && (!pinManager.isPinAllocated(hardwareTX) || pinManager.getPinOwner(hardwareTX) == PinOwner::DebugOut)) {
+          if (!applied && (!pinManager.isPinAllocated(hardwareTX) || pinManager.getPinOwner(hardwareTX) == PinOwner::DebugOut)) {
+            Serial.println(F("{\"error\":3}")); // ERR_NOBUF, state is busy (sender has to repeat)
+          } else if (verboseResponse && (!pinManager.isPinAllocated(hardwareTX) || pinManager.getPinOwner(hardwareTX) == PinOwner::DebugOut)) {
             doc.clear();
+            StateLockGuard stateLock(16);
             JsonObject state = doc.createNestedObject("state");
-            serializeState(state);
+            if (stateLock) serializeState(state);
             JsonObject info  = doc.createNestedObject("info");
-            serializeInfo(info);
+            if (stateLock) serializeInfo(info);
 
             serializeJson(doc, Serial);
             Serial.println();
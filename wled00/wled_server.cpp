@@ -52,13 +52,18 @@ void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t
     request->_tempFile = WLED_FS.open(finalname, "w");
     DEBUG_PRINT(F("Uploading "));
     DEBUG_PRINTLN(finalname);
-    if (finalname.equals("/presets.json")) presetsModifiedTime = toki.second();
+    if (finalname.equals("/presets.json")) {
+      presetsModifiedTime = toki.second();
+      invalidatePresetCache();
+    }
+    invalidateObjectIndex(finalname.c_str()); // object offsets are unknown
   }
   if (len) {
     request->_tempFile.write(data,len);
   }
   if (final) {
     request->_tempFile.close();
+    if (filename.indexOf(F("presets.json")) >= 0) invalidatePresetCache(); // presets may have been read while uploading
     if (filename.indexOf(F("cfg.json")) >= 0) { // check for filename with or without slash
       doReboot = true;
       request->send(200, "text/plain", F("Configuration restore successful.\nRebooting..."));
@@ -79,6 +84,14 @@ void createEditHandler(bool enable) {
       #else
       editHandler = &server.addHandler(new SPIFFSEditor("","",WLED_FS));//http_username,http_password));
       #endif
+      // editor may change presets.json (when request starts and until it ends)
+      editHandler->setFilter([](AsyncWebServerRequest *request) {
+        if (request->method() != HTTP_GET && request->url().equalsIgnoreCase(F("/edit"))) {
+          invalidatePresetCache();
+          request->onDisconnect([]() { invalidatePresetCache(); });
+        }
+        return true;
+      });
     #else
       editHandler = &server.on("/edit", HTTP_GET, [](AsyncWebServerRequest *request){
         serveMessage(request, 501, "Not implemented", F("The FS editor is disabled in this build."), 254);
@@ -198,7 +211,13 @@ void initServer()
         DEBUG_PRINTLN();
       #endif
       */
-      verboseResponse = deserializeState(root);
+      bool applied;
+      verboseResponse = deserializeState(root, CALL_MODE_DIRECT_CHANGE, 0, &applied);
+      if (!applied) {
+        releaseJSONBufferLock();
+        request->send(503, "application/json", F("{"error":3}")); // ERR_NOBUF, state is busy
+        return;
+      }
     } else {
       if (!correctPIN && strlen(settingsPIN)>0) {
         request->send(401, "application/json", F("{\"error\":1}")); // ERR_DENIED
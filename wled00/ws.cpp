@@ -10,16 +10,142 @@ unsigned long wsLastLiveTime = 0;
 //uint8_t* wsFrameBuffer = nullptr;
 
 #define WS_LIVE_INTERVAL 40
+#define WS_JSON_SLACK    64 // extra bytes for JSON state pushes (values may change between measuring and writing)
+
+// clients that requested binary (MessagePack) state updates using {"bin":true}
+#define WS_MAX_BINARY_CLIENTS 4
+static uint32_t wsBinaryClients[WS_MAX_BINARY_CLIENTS] = {0};
+
+// connected clients, so JSON updates can skip binary clients (AsyncWebSocket does not expose its client list safely)
+#define WS_MAX_CLIENTS 8
+static uint32_t wsClients[WS_MAX_CLIENTS] = {0};
+static bool     wsClientsOverflow = false; // a client could not be tracked, JSON updates go to all clients
+
+static void setConnectedClient(uint32_t id, bool connected)
+{
+  for (size_t i = 0; i < WS_MAX_CLIENTS; i++) if (wsClients[i] == id) wsClients[i] = 0;
+  if (!connected) {
+    if (!ws.count()) wsClientsOverflow = false;
+    return;
+  }
+  for (size_t i = 0; i < WS_MAX_CLIENTS; i++) if (!wsClients[i]) { wsClients[i] = id; return; }
+  wsClientsOverflow = true;
+}
+
+static bool isBinaryClient(uint32_t id)
+{
+  for (size_t i = 0; i < WS_MAX_BINARY_CLIENTS; i++) if (wsBinaryClients[i] == id) return true;
+  return false;
+}
+
+static void setBinaryClient(uint32_t id, bool binary)
+{
+  for (size_t i = 0; i < WS_MAX_BINARY_CLIENTS; i++) if (wsBinaryClients[i] == id) wsBinaryClients[i] = 0;
+  if (!binary) return;
+  for (size_t i = 0; i < WS_MAX_BINARY_CLIENTS; i++) if (!wsBinaryClients[i]) { wsBinaryClients[i] = id; return; }
+  DEBUG_PRINTLN(F("WS too many binary clients."));
+}
+
+// text messages that could not get the JSON buffer immediately are applied from handleWs() in arrival order
+// filled from network task, emptied from loop
+#define WS_QUEUE_LEN 4
+typedef struct {
+  uint32_t client;
+  size_t   len;
+  uint8_t *data;
+} WsQueueEntry;
+static WsQueueEntry wsQueue[WS_QUEUE_LEN] = {};
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE wsQueueMux = portMUX_INITIALIZER_UNLOCKED;
+#define WS_QUEUE_LOCK()   portENTER_CRITICAL(&wsQueueMux)
+#define WS_QUEUE_UNLOCK() portEXIT_CRITICAL(&wsQueueMux)
+#else // ESP8266 network callbacks do not preempt the loop
+#define WS_QUEUE_LOCK()
+#define WS_QUEUE_UNLOCK()
+#endif
+
+static void wsQueueMessage(uint32_t client, const uint8_t *data, size_t len, bool front = false)
+{
+  uint8_t *copy = (uint8_t*)malloc(len); // not allowed within critical section
+  if (copy) {
+    memcpy(copy, data, len);
+    WS_QUEUE_LOCK();
+    if (front && !wsQueue[WS_QUEUE_LEN-1].data) { // retried message is applied before later ones
+      for (size_t i = WS_QUEUE_LEN-1; i > 0; i--) wsQueue[i] = wsQueue[i-1];
+      wsQueue[0].data = nullptr;
+    }
+    for (size_t i = 0; i < WS_QUEUE_LEN; i++) {
+      if (wsQueue[i].data) continue;
+      wsQueue[i].data = copy;
+      wsQueue[i].len = len;
+      wsQueue[i].client = client;
+      copy = nullptr;
+      break;
+    }
+    WS_QUEUE_UNLOCK();
+    if (!copy) return;
+    free(copy);
+  }
+  DEBUG_PRINTLN(F("WS queue full, message dropped."));
+  AsyncWebSocketClient *c = ws.client(client);
+  if (c) c->text(F("{\"error\":3}")); // ERR_NOBUF
+}
+
+// applies JSON message (JSON buffer must be locked, it will be released)
+// returns false if state was busy and message has to be applied again later
+static bool wsApplyMessage(AsyncWebSocketClient * client, uint8_t *data, size_t len)
+{
+  bool verboseResponse = false;
+
+  DeserializationError error = deserializeJson(doc, data, len);
+  JsonObject root = doc.as<JsonObject>();
+  if (error || root.isNull()) {
+    releaseJSONBufferLock();
+    return true;
+  }
+  if (root["v"] && root.size() == 1) {
+    //if the received value is just "{"v":true}", send only to this client
+    verboseResponse = true;
+  } else if (root.containsKey("lv")) {
+    if (client) wsLiveClientId = root["lv"] ? client->id() : 0;
+  } else if (root.containsKey("bin")) {
+    if (client) setBinaryClient(client->id(), root["bin"]);
+    verboseResponse = true;
+  } else {
+    bool applied;
+    verboseResponse = deserializeState(root, CALL_MODE_DIRECT_CHANGE, 0, &applied);
+    if (!applied) {
+      releaseJSONBufferLock();
+      return false;
+    }
+  }
+  releaseJSONBufferLock(); // will clean fileDoc
+
+  if (client && !interfaceUpdateCallMode) { // individual client response only needed if no WS broadcast soon
+    if (verboseResponse) {
+      sendDataWs(client);
+    } else {
+      // we have to send something back otherwise WS connection closes
+      client->text(F("{\"success\":true}"));
+    }
+    // force broadcast in 500ms after updating client
+    //lastInterfaceUpdate = millis() - (INTERFACE_UPDATE_COOLDOWN -500); // ESP8266 does not like this
+  }
+  return true;
+}
 
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
   if(type == WS_EVT_CONNECT){
     //client connected
     DEBUG_PRINTLN(F("WS client connected."));
+    setConnectedClient(client->id(), true);
     sendDataWs(client);
   } else if(type == WS_EVT_DISCONNECT){
     //client disconnected
     if (client->id() == wsLiveClientId) wsLiveClientId = 0;
+    setBinaryClient(client->id(), false);
+    setConnectedClient(client->id(), false);
     DEBUG_PRINTLN(F("WS client disconnected."));
   } else if(type == WS_EVT_DATA){
     // data packet
@@ -35,34 +161,10 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           return;
         }
 
-        bool verboseResponse = false;
-        if (!requestJSONBufferLock(11)) return;
-
-        DeserializationError error = deserializeJson(doc, data, len);
-        JsonObject root = doc.as<JsonObject>();
-        if (error || root.isNull()) {
-          releaseJSONBufferLock();
-          return;
-        }
-        if (root["v"] && root.size() == 1) {
-          //if the received value is just "{"v":true}", send only to this client
-          verboseResponse = true;
-        } else if (root.containsKey("lv")) {
-          wsLiveClientId = root["lv"] ? client->id() : 0;
+        if (!wsQueue[0].data && !jsonBufferLock && requestJSONBufferLock(11, 0)) {
+          if (!wsApplyMessage(client, data, len)) wsQueueMessage(client->id(), data, len, true); // will release JSON buffer
         } else {
-          verboseResponse = deserializeState(root);
-        }
-        releaseJSONBufferLock(); // will clean fileDoc
-
-        if (!interfaceUpdateCallMode) { // individual client response only needed if no WS broadcast soon
-          if (verboseResponse) {
-            sendDataWs(client);
-          } else {
-            // we have to send something back otherwise WS connection closes
-            client->text(F("{\"success\":true}"));
-          }
-          // force broadcast in 500ms after updating client
-          //lastInterfaceUpdate = millis() - (INTERFACE_UPDATE_COOLDOWN -500); // ESP8266 does not like this
+          wsQueueMessage(client->id(), data, len); // JSON buffer busy, apply in handleWs() instead of blocking network task
         }
       }
     } else {
@@ -96,60 +198,120 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
   }
 }
 
+// sends MessagePack encoded state and info, does not need JSON buffer
+static bool sendDataWsBinary(AsyncWebSocketClient * client)
+{
+  if (!client || client->status() != WS_CONNECTED) return false;
+  if (!requestStateLock(11)) return false; // state must not change between measuring and writing
+  size_t len = serializeStateInfoMsgPack((Print*)nullptr, true, true);
+  AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
+  if (!buffer) {
+    releaseStateLock();
+    DEBUG_PRINTLN(F("WS buffer allocation failed."));
+    return false;
+  }
+  buffer->lock();
+  serializeStateInfoMsgPack(buffer->get(), len, true, true);
+  releaseStateLock();
+  client->binary(buffer);
+  buffer->unlock();
+  ws._cleanBuffers();
+  return true;
+}
+
 void sendDataWs(AsyncWebSocketClient * client)
 {
   if (!ws.count()) return;
   AsyncWebSocketMessageBuffer * buffer;
+  size_t nBinary = 0; // binary clients updated
 
-  if (!requestJSONBufferLock(12)) return;
+  if (client) {
+    if (isBinaryClient(client->id())) {
+      sendDataWsBinary(client);
+      return;
+    }
+  } else {
+    for (size_t i = 0; i < WS_MAX_BINARY_CLIENTS; i++) {
+      if (wsBinaryClients[i] && sendDataWsBinary(ws.client(wsBinaryClients[i]))) nBinary++;
+    }
+    if (nBinary >= ws.count()) return; // no JSON clients left
+  }
 
-  JsonObject state = doc.createNestedObject("state");
-  serializeState(state);
-  JsonObject info  = doc.createNestedObject("info");
-  serializeInfo(info);
+  // state & info are streamed into a buffer sized from the previous push (measured first if there is none)
+  // values like uptime or heap may change in between so message gets some slack (padded with whitespace)
+  static size_t lastLen = 0;
+  uint8_t tmp[128];
+  size_t len = 0, pos = 0, n;
+  for (;;) {
+    bool measured = !lastLen;
+    len = lastLen;
+    if (measured) {
+      len = 0;
+      JsonStreamer measure(JSON_PATH_STATE_INFO, true);
+      while ((n = measure.read(tmp, sizeof(tmp)))) len += n;
+      if (!len) return;
+      len += WS_JSON_SLACK;
+    }
+    DEBUG_PRINTF("JSON length: %u for WS request.\n", len);
 
-  size_t len = measureJson(doc);
-  DEBUG_PRINTF("JSON buffer size: %u for WS request (%u).\n", doc.memoryUsage(), len);
+    size_t heap1 = ESP.getFreeHeap();
+    DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
+    #ifdef ESP8266
+    if (len>heap1) {
+      DEBUG_PRINTLN(F("Out of memory (WS)!"));
+      return;
+    }
+    #endif
+    buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes on ESP8266
+    #ifdef ESP8266
+    size_t heap2 = ESP.getFreeHeap();
+    DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
+    #else
+    size_t heap2 = 0; // ESP32 variants do not have the same issue and will work without checking heap allocation
+    #endif
+    if (!buffer || heap1-heap2<len) {
+      DEBUG_PRINTLN(F("WS buffer allocation failed."));
+      ws.closeAll(1013); //code 1013 = temporary overload, try again later
+      ws.cleanupClients(0); //disconnect all clients to release memory
+      ws._cleanBuffers();
+      return; //out of memory
+    }
 
-  size_t heap1 = ESP.getFreeHeap();
-  DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
-  #ifdef ESP8266
-  if (len>heap1) {
-    DEBUG_PRINTLN(F("Out of memory (WS)!"));
-    return;
-  }
-  #endif
-  buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes on ESP8266
-  #ifdef ESP8266
-  size_t heap2 = ESP.getFreeHeap();
-  DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
-  #else
-  size_t heap2 = 0; // ESP32 variants do not have the same issue and will work without checking heap allocation
-  #endif
-  if (!buffer || heap1-heap2<len) {
-    releaseJSONBufferLock();
-    DEBUG_PRINTLN(F("WS buffer allocation failed."));
-    ws.closeAll(1013); //code 1013 = temporary overload, try again later
-    ws.cleanupClients(0); //disconnect all clients to release memory
+    buffer->lock();
+    uint8_t *out = buffer->get();
+    pos = 0;
+    JsonStreamer writer(JSON_PATH_STATE_INFO);
+    while (pos < len && (n = writer.read(out + pos, len - pos))) pos += n;
+    if (writer.failed()) pos = 0;
+    else if (pos < len || !writer.read(tmp, 1)) break; // complete
+    buffer->unlock();
     ws._cleanBuffers();
-    return; //out of memory
+    lastLen = 0; // measure on retry
+    if (!pos || measured) { // piece failed or grew by more than slack, try again with next update
+      DEBUG_PRINTLN(F("WS message outgrew buffer."));
+      return;
+    }
   }
-
-  buffer->lock();
-  serializeJson(doc, (char *)buffer->get(), len);
+  lastLen = pos + WS_JSON_SLACK;
+  memset(buffer->get() + pos, ' ', len - pos);
 
   DEBUG_PRINT(F("Sending WS data "));
   if (client) {
     client->text(buffer);
     DEBUG_PRINTLN(F("to a single client."));
-  } else {
+  } else if (!nBinary || wsClientsOverflow) {
     ws.textAll(buffer);
     DEBUG_PRINTLN(F("to multiple clients."));
+  } else {
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) { // binary clients already got their update
+      if (!wsClients[i] || isBinaryClient(wsClients[i])) continue;
+      AsyncWebSocketClient *c = ws.client(wsClients[i]);
+      if (c && c->status() == WS_CONNECTED) c->text(buffer);
+    }
+    DEBUG_PRINTLN(F("to JSON clients."));
   }
   buffer->unlock();
   ws._cleanBuffers();
-
-  releaseJSONBufferLock();
 }
 
 bool sendLiveLedsWs(uint32_t wsClient)
@@ -214,6 +376,17 @@ bool sendLiveLedsWs(uint32_t wsClient)
 
 void handleWs()
 {
+  if (wsQueue[0].data && !jsonBufferLock && requestJSONBufferLock(11, 0)) {
+    WS_QUEUE_LOCK();
+    WsQueueEntry m = wsQueue[0];
+    for (size_t i = 1; i < WS_QUEUE_LEN; i++) wsQueue[i-1] = wsQueue[i];
+    wsQueue[WS_QUEUE_LEN-1].data = nullptr;
+    WS_QUEUE_UNLOCK();
+    // client may have disconnected meanwhile, will release JSON buffer
+    if (!wsApplyMessage(ws.client(m.client), m.data, m.len)) wsQueueMessage(m.client, m.data, m.len, true); // state busy, retry next loop
+    free(m.data);
+  }
+
   if (millis() - wsLastLiveTime > WS_LIVE_INTERVAL)
   {
     #ifdef ESP8266